@@ -0,0 +1,785 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It implements the coalescing of small RPC
+ * requests (CRT_RPC_FEAT_COALESCE). The client packs the requests to one
+ * endpoint into a single CRT_OPC_RPC_BATCH RPC, the server unpacks them into
+ * individual handler invocations and packs the replies back the same way.
+ */
+
+#include <crt_internal.h>
+
+static struct crt_batch *
+crt_batch_alloc(crt_size_t buf_size)
+{
+	struct crt_batch	*batch;
+
+	C_ALLOC_PTR(batch);
+	if (batch == NULL)
+		return NULL;
+
+	C_ALLOC(batch->cb_buf, buf_size);
+	if (batch->cb_buf == NULL) {
+		C_FREE_PTR(batch);
+		return NULL;
+	}
+	batch->cb_buf_size = buf_size;
+	CRT_INIT_LIST_HEAD(&batch->cb_link);
+	pthread_mutex_init(&batch->cb_mutex, NULL);
+
+	return batch;
+}
+
+void
+crt_batch_free(struct crt_batch *batch)
+{
+	if (batch == NULL)
+		return;
+
+	C_ASSERT(!batch->cb_open);
+	pthread_mutex_destroy(&batch->cb_mutex);
+	C_FREE(batch->cb_buf, batch->cb_buf_size);
+	C_FREE_PTR(batch);
+}
+
+/* create a proc encoding into the free space of the batch buffer */
+static int
+crt_batch_proc_create(struct crt_context *ctx, struct crt_batch *batch,
+		      hg_proc_t *proc)
+{
+	hg_return_t	hg_ret;
+
+	hg_ret = hg_proc_create(ctx->cc_hg_ctx.chc_hgcla,
+				(char *)batch->cb_buf + batch->cb_buf_len,
+				batch->cb_buf_size - batch->cb_buf_len,
+				HG_ENCODE, HG_NOHASH, proc);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("hg_proc_create failed, hg_ret: %d.\n", hg_ret);
+		return -CER_HG;
+	}
+
+	return 0;
+}
+
+/*
+ * Pack the common header and input of \a rpc_priv behind the requests already
+ * in \a batch. Returns -CER_OVERFLOW if it does not fit, \a size returns the
+ * packed size in both cases.
+ */
+static int
+crt_batch_pack_req(struct crt_context *ctx, struct crt_batch *batch,
+		   struct crt_rpc_priv *rpc_priv, hg_size_t *size)
+{
+	hg_proc_t	proc;
+	int		rc;
+
+	C_ASSERT(batch->cb_num < CRT_BATCH_MAX_NUM);
+	rc = crt_batch_proc_create(ctx, batch, &proc);
+	if (rc != 0)
+		return rc;
+
+	rc = crt_proc_in_common(proc, &rpc_priv->crp_pub.cr_input);
+	/* mercury spills to an extra buffer once the given one is used up */
+	*size = hg_proc_get_size_used(proc);
+	hg_proc_free(proc);
+	if (rc != 0) {
+		C_ERROR("crt_proc_in_common failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+		return rc;
+	}
+	if (batch->cb_buf_len + *size > batch->cb_buf_size)
+		return -CER_OVERFLOW;
+
+	batch->cb_buf_len += *size;
+	batch->cb_subs[batch->cb_num] = rpc_priv;
+	rpc_priv->crp_batch = batch;
+	rpc_priv->crp_batch_idx = batch->cb_num;
+	batch->cb_num++;
+	if (rpc_priv->crp_timeout_ms != 0 &&
+	    (batch->cb_timeout_ms == 0 ||
+	     rpc_priv->crp_timeout_ms < batch->cb_timeout_ms))
+		batch->cb_timeout_ms = rpc_priv->crp_timeout_ms;
+
+	return 0;
+}
+
+/* caller should hold the cc_batch_mutex */
+static struct crt_batch *
+crt_batch_lookup(struct crt_context *ctx, crt_endpoint_t *ep)
+{
+	struct crt_batch	*batch;
+
+	crt_list_for_each_entry(batch, &ctx->cc_batch_list, cb_link) {
+		if (batch->cb_ep.ep_grp == ep->ep_grp &&
+		    batch->cb_ep.ep_rank == ep->ep_rank &&
+		    batch->cb_ep.ep_tag == ep->ep_tag)
+			return batch;
+	}
+
+	return NULL;
+}
+
+/* caller should hold the cc_batch_mutex */
+static void
+crt_batch_add(struct crt_context *ctx, struct crt_batch *batch)
+{
+	C_ASSERT(!batch->cb_open);
+	crt_list_add_tail(&batch->cb_link, &ctx->cc_batch_list);
+	batch->cb_open = 1;
+	__atomic_store_n(&ctx->cc_batch_num, ctx->cc_batch_num + 1,
+			 __ATOMIC_RELAXED);
+}
+
+/* caller should hold the cc_batch_mutex */
+static void
+crt_batch_del(struct crt_context *ctx, struct crt_batch *batch)
+{
+	C_ASSERT(batch->cb_open);
+	crt_list_del_init(&batch->cb_link);
+	batch->cb_open = 0;
+	__atomic_store_n(&ctx->cc_batch_num, ctx->cc_batch_num - 1,
+			 __ATOMIC_RELAXED);
+}
+
+/* unpack the replies in \a out into the requests of \a batch */
+static void
+crt_batch_unpack_replies(struct crt_context *ctx, struct crt_batch *batch,
+			 struct crt_rpc_batch_out *out, int *status)
+{
+	struct crt_rpc_priv	*rpc_priv;
+	hg_proc_t		 proc;
+	hg_return_t		 hg_ret;
+	uint32_t		 i, idx;
+	int32_t			 rc;
+
+	if (out->cbo_num == 0)
+		return;
+
+	hg_ret = hg_proc_create(ctx->cc_hg_ctx.chc_hgcla,
+				out->cbo_body.iov_buf, out->cbo_body.iov_len,
+				HG_DECODE, HG_NOHASH, &proc);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("hg_proc_create failed, hg_ret: %d.\n", hg_ret);
+		return;
+	}
+
+	for (i = 0; i < out->cbo_num; i++) {
+		if (crt_proc_uint32_t(proc, &idx) != 0 ||
+		    crt_proc_int32_t(proc, &rc) != 0) {
+			C_ERROR("failed to unpack reply %d of %d.\n",
+				i, out->cbo_num);
+			break;
+		}
+		if (idx >= batch->cb_num ||
+		    batch->cb_subs[idx]->crp_batch_done) {
+			C_ERROR("bad reply index %d, batch of %d.\n",
+				idx, batch->cb_num);
+			break;
+		}
+		rpc_priv = batch->cb_subs[idx];
+		rpc_priv->crp_batch_done = 1;
+		if (rc == 0) {
+			rc = crt_proc_out_common(proc,
+						 &rpc_priv->crp_pub.cr_output);
+			if (rc != 0) {
+				C_ERROR("crt_proc_out_common failed, rc: %d, "
+					"opc: 0x%x.\n", rc,
+					rpc_priv->crp_pub.cr_opc);
+				status[idx] = rc;
+				break;
+			}
+			rpc_priv->crp_output_got = 1;
+			rpc_priv->crp_state = RPC_REPLY_RECVED;
+		}
+		status[idx] = rc;
+	}
+
+	hg_proc_free(proc);
+}
+
+/*
+ * Complete every request of \a batch, with its reply in \a out if any. \a rc
+ * is the status of the carrier RPC, if it failed all the requests fail.
+ */
+static void
+crt_batch_complete(struct crt_context *ctx, struct crt_batch *batch,
+		   struct crt_rpc_batch_out *out, int rc)
+{
+	struct crt_rpc_priv	*rpc_priv;
+	struct crt_rpc_priv	*parent;
+	int			 status[CRT_BATCH_MAX_NUM];
+	uint32_t		 i;
+
+	/* detach the requests, see crt_batch_req_abort */
+	pthread_mutex_lock(&ctx->cc_batch_mutex);
+	for (i = 0; i < batch->cb_num; i++)
+		batch->cb_subs[i]->crp_batch = NULL;
+	parent = batch->cb_parent;
+	batch->cb_parent = NULL;
+	pthread_mutex_unlock(&ctx->cc_batch_mutex);
+
+	/* a request without reply failed on the server */
+	for (i = 0; i < batch->cb_num; i++)
+		status[i] = (rc != 0) ? rc : -CER_PROTO;
+	if (rc == 0)
+		crt_batch_unpack_replies(ctx, batch, out, status);
+
+	for (i = 0; i < batch->cb_num; i++) {
+		rpc_priv = batch->cb_subs[i];
+		/* the output is decoded in place, decref in crt_batch_req_fini */
+		if (rpc_priv->crp_output_got && parent != NULL &&
+		    rpc_priv->crp_opc_info->coi_iov_inplace) {
+			crt_req_addref(&parent->crp_pub);
+			rpc_priv->crp_batch_carrier = parent;
+		}
+		crt_rpc_complete(rpc_priv, status[i]);
+		/* corresponding to the refcount taken in crt_rpc_priv_init() */
+		crt_req_decref(&rpc_priv->crp_pub);
+	}
+
+	crt_batch_free(batch);
+	if (parent != NULL)
+		crt_req_decref(&parent->crp_pub); /* addref in crt_batch_send */
+}
+
+static int
+crt_batch_reply_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_batch	*batch = cb_info->cci_arg;
+	crt_rpc_t		*rpc_pub = cb_info->cci_rpc;
+
+	C_ASSERT(batch != NULL && rpc_pub != NULL);
+	if (cb_info->cci_rc != 0)
+		C_ERROR("batch of %d requests to rank %d tag %d failed, "
+			"rc: %d.\n", batch->cb_num, batch->cb_ep.ep_rank,
+			batch->cb_ep.ep_tag, cb_info->cci_rc);
+
+	crt_batch_complete(rpc_pub->cr_ctx, batch,
+			   cb_info->cci_rc == 0 ? crt_reply_get(rpc_pub) : NULL,
+			   cb_info->cci_rc);
+
+	return 0;
+}
+
+/* send \a batch in a CRT_OPC_RPC_BATCH RPC, fail its requests on error */
+static void
+crt_batch_send(struct crt_context *ctx, struct crt_batch *batch)
+{
+	struct crt_rpc_batch_in	*in;
+	struct crt_rpc_priv	*parent;
+	crt_rpc_t		*req = NULL;
+	int			 rc;
+
+	C_ASSERT(!batch->cb_open && batch->cb_num > 0);
+	rc = crt_req_create_internal(ctx, batch->cb_ep, CRT_OPC_RPC_BATCH,
+				     false /* forward */, &req);
+	if (rc != 0) {
+		C_ERROR("crt_req_create_internal failed, rc: %d.\n", rc);
+		C_GOTO(out, rc);
+	}
+
+	in = crt_req_get(req);
+	in->cbi_num = batch->cb_num;
+	crt_iov_set(&in->cbi_body, batch->cb_buf, batch->cb_buf_len);
+	if (batch->cb_timeout_ms != 0)
+		crt_req_set_timeout_ms(req, batch->cb_timeout_ms);
+
+	parent = container_of(req, struct crt_rpc_priv, crp_pub);
+	crt_req_addref(req); /* decref in crt_batch_complete */
+	pthread_mutex_lock(&ctx->cc_batch_mutex);
+	batch->cb_parent = parent;
+	pthread_mutex_unlock(&ctx->cc_batch_mutex);
+
+	rc = crt_req_send(req, crt_batch_reply_cb, batch);
+	if (rc != 0)
+		C_ERROR("crt_req_send failed, rc: %d.\n", rc);
+
+out:
+	if (rc != 0)
+		crt_batch_complete(ctx, batch, NULL, rc);
+}
+
+/*
+ * Queue \a rpc_priv in the open batch of its endpoint. Returns zero if queued,
+ * positive if the request is too large to be coalesced and should be sent by
+ * itself, negative value if error.
+ */
+int
+crt_batch_req_add(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_context	*ctx;
+	struct crt_batch	*batch;
+	struct crt_batch	*batch_prev = NULL;
+	struct crt_batch	*batch_full = NULL;
+	hg_size_t		 size;
+	int			 rc;
+
+	C_ASSERT(rpc_priv != NULL);
+	ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+	/* packed in the request header, makes the server reply in batch */
+	rpc_priv->crp_flags |= CRT_RPC_FLAG_BATCHED;
+
+	pthread_mutex_lock(&ctx->cc_batch_mutex);
+	batch = crt_batch_lookup(ctx, &rpc_priv->crp_pub.cr_ep);
+	if (batch != NULL) {
+		rc = crt_batch_pack_req(ctx, batch, rpc_priv, &size);
+		if (rc == 0)
+			C_GOTO(queued, rc);
+		if (rc != -CER_OVERFLOW || size > CRT_BATCH_BUF_SIZE)
+			C_GOTO(unlock, rc);
+		/* no room left, send it and open a new one */
+		crt_batch_del(ctx, batch);
+		batch_prev = batch;
+	}
+
+	batch = crt_batch_alloc(CRT_BATCH_BUF_SIZE);
+	if (batch == NULL)
+		C_GOTO(unlock, rc = -CER_NOMEM);
+	batch->cb_ep = rpc_priv->crp_pub.cr_ep;
+	rc = crt_batch_pack_req(ctx, batch, rpc_priv, &size);
+	if (rc != 0) {
+		crt_batch_free(batch);
+		C_GOTO(unlock, rc);
+	}
+	crt_batch_add(ctx, batch);
+
+queued:
+	rpc_priv->crp_state = RPC_REQ_SENT;
+	if (batch->cb_num == CRT_BATCH_MAX_NUM) {
+		crt_batch_del(ctx, batch);
+		batch_full = batch;
+	}
+
+unlock:
+	pthread_mutex_unlock(&ctx->cc_batch_mutex);
+
+	if (rc == -CER_OVERFLOW)
+		rc = 1;
+	if (rc != 0)
+		rpc_priv->crp_flags &= ~CRT_RPC_FLAG_BATCHED;
+	if (batch_prev != NULL)
+		crt_batch_send(ctx, batch_prev);
+	if (batch_full != NULL)
+		crt_batch_send(ctx, batch_full);
+
+	return rc;
+}
+
+/*
+ * A coalesced request can only be aborted together with the other requests of
+ * its batch, by canceling the carrier RPC.
+ */
+int
+crt_batch_req_abort(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_context	*ctx;
+	struct crt_batch	*batch;
+	struct crt_rpc_priv	*parent = NULL;
+	int			 rc = 0;
+
+	C_ASSERT(rpc_priv != NULL);
+	ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+
+	pthread_mutex_lock(&ctx->cc_batch_mutex);
+	batch = rpc_priv->crp_batch;
+	if (batch != NULL && batch->cb_open) {
+		/* not sent yet, send it now to have a carrier to cancel */
+		crt_batch_del(ctx, batch);
+		pthread_mutex_unlock(&ctx->cc_batch_mutex);
+		crt_batch_send(ctx, batch);
+		pthread_mutex_lock(&ctx->cc_batch_mutex);
+		batch = rpc_priv->crp_batch;
+	}
+	if (batch != NULL) {
+		parent = batch->cb_parent;
+		if (parent != NULL)
+			crt_req_addref(&parent->crp_pub);
+		else
+			/* being sent by another thread */
+			rc = -CER_AGAIN;
+	}
+	pthread_mutex_unlock(&ctx->cc_batch_mutex);
+
+	if (parent != NULL) {
+		rc = crt_hg_req_cancel(parent);
+		crt_req_decref(&parent->crp_pub);
+	}
+
+	return rc;
+}
+
+/* send all open batches of \a ctx */
+void
+crt_batch_flush(struct crt_context *ctx)
+{
+	struct crt_batch	*batch, *next;
+	crt_list_t		 batch_list;
+
+	C_ASSERT(ctx != NULL);
+	if (__atomic_load_n(&ctx->cc_batch_num, __ATOMIC_RELAXED) == 0)
+		return;
+
+	CRT_INIT_LIST_HEAD(&batch_list);
+	pthread_mutex_lock(&ctx->cc_batch_mutex);
+	crt_list_for_each_entry_safe(batch, next, &ctx->cc_batch_list,
+				     cb_link) {
+		crt_batch_del(ctx, batch);
+		crt_list_add_tail(&batch->cb_link, &batch_list);
+	}
+	pthread_mutex_unlock(&ctx->cc_batch_mutex);
+
+	crt_list_for_each_entry_safe(batch, next, &batch_list, cb_link) {
+		crt_list_del_init(&batch->cb_link);
+		crt_batch_send(ctx, batch);
+	}
+}
+
+/* release what crt_batch.c unpacked for a coalesced request */
+void
+crt_batch_req_fini(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_context	*ctx;
+	struct crt_rpc_priv	*parent;
+	hg_proc_t		 proc;
+	hg_return_t		 hg_ret;
+
+	C_ASSERT(rpc_priv != NULL);
+	ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+
+	if (rpc_priv->crp_output_got || rpc_priv->crp_input_got) {
+		hg_ret = hg_proc_create(ctx->cc_hg_ctx.chc_hgcla, NULL, 0,
+					HG_FREE, HG_NOHASH, &proc);
+		if (hg_ret != HG_SUCCESS) {
+			C_ERROR("hg_proc_create failed, hg_ret: %d.\n",
+				hg_ret);
+		} else {
+			if (rpc_priv->crp_output_got)
+				crt_proc_out_common(proc,
+						&rpc_priv->crp_pub.cr_output);
+			if (rpc_priv->crp_input_got)
+				crt_proc_in_common(proc,
+						&rpc_priv->crp_pub.cr_input);
+			hg_proc_free(proc);
+		}
+		rpc_priv->crp_output_got = 0;
+		rpc_priv->crp_input_got = 0;
+	}
+
+	if (rpc_priv->crp_batch_carrier != NULL) {
+		parent = rpc_priv->crp_batch_carrier;
+		rpc_priv->crp_batch_carrier = NULL;
+		/* addref in crt_batch_complete */
+		crt_req_decref(&parent->crp_pub);
+	}
+
+	if (rpc_priv->crp_srv && rpc_priv->crp_batch != NULL) {
+		parent = rpc_priv->crp_batch->cb_parent;
+		rpc_priv->crp_batch = NULL;
+		/* addref in crt_hdlr_rpc_batch */
+		crt_req_decref(&parent->crp_pub);
+	}
+}
+
+/* send the replies packed so far as the reply of the carrier RPC */
+static int
+crt_batch_reply_flush(struct crt_batch *batch)
+{
+	struct crt_rpc_batch_out	*out;
+	struct crt_rpc_priv		*parent;
+	int				 rc;
+
+	parent = batch->cb_parent;
+	C_ASSERT(parent != NULL);
+	out = crt_reply_get(&parent->crp_pub);
+	out->cbo_num = batch->cb_reply_num;
+	crt_iov_set(&out->cbo_body, batch->cb_buf, batch->cb_buf_len);
+
+	rc = crt_hg_reply_send(parent);
+	if (rc != 0)
+		C_ERROR("crt_hg_reply_send failed, rc: %d.\n", rc);
+
+	return rc;
+}
+
+static int
+crt_batch_proc_reply(hg_proc_t proc, struct crt_rpc_priv *rpc_priv,
+		     int32_t status)
+{
+	uint32_t	idx = rpc_priv->crp_batch_idx;
+	int		rc;
+
+	rc = crt_proc_uint32_t(proc, &idx);
+	if (rc != 0)
+		return rc;
+	rc = crt_proc_int32_t(proc, &status);
+	if (rc != 0 || status != 0)
+		return rc;
+
+	return crt_proc_out_common(proc, &rpc_priv->crp_pub.cr_output);
+}
+
+/*
+ * Pack the reply of \a rpc_priv behind the replies in \a batch, the buffer
+ * grows for large replies. Caller should hold the cb_mutex.
+ */
+static int
+crt_batch_pack_reply(struct crt_batch *batch, struct crt_rpc_priv *rpc_priv,
+		     int32_t status)
+{
+	struct crt_context	*ctx;
+	hg_proc_t		 proc;
+	hg_size_t		 size;
+	crt_size_t		 buf_size;
+	void			*buf;
+	int			 rc;
+
+	ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+	while (1) {
+		rc = crt_batch_proc_create(ctx, batch, &proc);
+		if (rc != 0)
+			return rc;
+		rc = crt_batch_proc_reply(proc, rpc_priv, status);
+		size = hg_proc_get_size_used(proc);
+		hg_proc_free(proc);
+		if (rc != 0)
+			return rc;
+		if (batch->cb_buf_len + size <= batch->cb_buf_size)
+			break;
+
+		/* not enough room, grow the buffer and pack again */
+		buf_size = max(batch->cb_buf_size * 2,
+			       batch->cb_buf_len + size);
+		C_ALLOC(buf, buf_size);
+		if (buf == NULL)
+			return -CER_NOMEM;
+		memcpy(buf, batch->cb_buf, batch->cb_buf_len);
+		C_FREE(batch->cb_buf, batch->cb_buf_size);
+		batch->cb_buf = buf;
+		batch->cb_buf_size = buf_size;
+	}
+
+	batch->cb_buf_len += size;
+	batch->cb_reply_num++;
+
+	return 0;
+}
+
+/*
+ * Account the reply (status zero) or the failure of a coalesced request, the
+ * carrier replies once every request of the batch is accounted.
+ */
+static int
+crt_batch_reply_add(struct crt_rpc_priv *rpc_priv, int status)
+{
+	struct crt_batch	*batch;
+	bool			 done;
+	int			 rc;
+
+	batch = rpc_priv->crp_batch;
+	C_ASSERT(batch != NULL);
+
+	pthread_mutex_lock(&batch->cb_mutex);
+	if (rpc_priv->crp_batch_done) {
+		pthread_mutex_unlock(&batch->cb_mutex);
+		return -CER_ALREADY;
+	}
+	/* if packing failed the client finds no reply and fails the request */
+	rc = crt_batch_pack_reply(batch, rpc_priv, status);
+	rpc_priv->crp_batch_done = 1;
+	batch->cb_replied++;
+	C_ASSERT(batch->cb_replied <= batch->cb_num);
+	done = (batch->cb_replied == batch->cb_num);
+	pthread_mutex_unlock(&batch->cb_mutex);
+
+	if (done)
+		crt_batch_reply_flush(batch);
+
+	return rc;
+}
+
+int
+crt_batch_reply_send(struct crt_rpc_priv *rpc_priv)
+{
+	C_ASSERT(rpc_priv != NULL && rpc_priv->crp_srv);
+	return crt_batch_reply_add(rpc_priv, 0);
+}
+
+/* fail a coalesced request whose handler did not reply */
+void
+crt_batch_reply_skip(struct crt_rpc_priv *rpc_priv, int status)
+{
+	C_ASSERT(rpc_priv != NULL && status != 0);
+	if (!rpc_priv->crp_srv || rpc_priv->crp_batch == NULL)
+		return;
+	crt_batch_reply_add(rpc_priv, status);
+}
+
+/* unpack one request of a batch into a new server-side RPC */
+static int
+crt_batch_unpack_req(struct crt_context *ctx, hg_proc_t proc,
+		     struct crt_rpc_priv **req_unpacked)
+{
+	struct crt_rpc_priv	*rpc_priv;
+	struct crt_opc_info	*opc_info;
+	crt_opcode_t		 opc;
+	int			 rc;
+
+	rpc_priv = crt_rpc_pool_alloc(ctx, sizeof(*rpc_priv));
+	if (rpc_priv == NULL)
+		return -CER_NOMEM;
+	rpc_priv->crp_pub.cr_ctx = ctx;
+
+	rc = crt_proc_common_hdr(proc, &rpc_priv->crp_req_hdr);
+	if (rc != 0) {
+		C_ERROR("crt_proc_common_hdr failed, rc: %d.\n", rc);
+		crt_rpc_pool_free(ctx, rpc_priv, sizeof(*rpc_priv));
+		return rc;
+	}
+	opc = rpc_priv->crp_req_hdr.cch_opc;
+	opc_info = crt_opc_lookup(crt_gdata.cg_opc_map, opc);
+	if (opc_info == NULL ||
+	    (opc_info->coi_rpc_cb == NULL && opc_info->coi_vec_cb == NULL)) {
+		C_ERROR("opc: 0x%x, lookup failed or no handler.\n", opc);
+		crt_rpc_pool_free(ctx, rpc_priv, sizeof(*rpc_priv));
+		return -CER_UNREG;
+	}
+	rpc_priv->crp_opc_info = opc_info;
+	rpc_priv->crp_flags = rpc_priv->crp_req_hdr.cch_flags |
+			      CRT_RPC_FLAG_BATCHED;
+
+	rc = crt_rpc_priv_init(rpc_priv, ctx, opc, true /* srv_flag */,
+			       false /* forward */);
+	if (rc != 0) {
+		C_ERROR("crt_rpc_priv_init failed, opc: 0x%x, rc: %d.\n",
+			opc, rc);
+		C_GOTO(decref, rc);
+	}
+	if (rpc_priv->crp_pub.cr_input != NULL) {
+		rc = crt_proc_input(rpc_priv, proc);
+		if (rc != 0) {
+			C_ERROR("crt_proc_input failed, opc: 0x%x, rc: %d.\n",
+				opc, rc);
+			C_GOTO(decref, rc);
+		}
+		rpc_priv->crp_input_got = 1;
+	}
+	rpc_priv->crp_pub.cr_ep.ep_rank = rpc_priv->crp_req_hdr.cch_rank;
+	rpc_priv->crp_pub.cr_ep.ep_grp = NULL;
+
+	*req_unpacked = rpc_priv;
+	return 0;
+
+decref:
+	crt_req_decref(&rpc_priv->crp_pub);
+	return rc;
+}
+
+int
+crt_hdlr_rpc_batch(crt_rpc_t *rpc_req)
+{
+	struct crt_rpc_batch_in	*in;
+	struct crt_rpc_priv	*parent;
+	struct crt_rpc_priv	*rpc_priv;
+	struct crt_batch	*batch;
+	struct crt_context	*ctx;
+	hg_proc_t		 proc;
+	hg_return_t		 hg_ret;
+	uint32_t		 i, num;
+	int			 rc = 0;
+
+	C_ASSERT(rpc_req != NULL);
+	parent = container_of(rpc_req, struct crt_rpc_priv, crp_pub);
+	ctx = (struct crt_context *)rpc_req->cr_ctx;
+	in = crt_req_get(rpc_req);
+	C_ASSERT(in != NULL);
+
+	batch = crt_batch_alloc(CRT_BATCH_BUF_SIZE);
+	if (batch == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+	/* freed with the carrier, see crt_rpc_priv_fini */
+	batch->cb_parent = parent;
+	parent->crp_batch = batch;
+
+	if (in->cbi_num > CRT_BATCH_MAX_NUM) {
+		C_ERROR("batch of %d requests, max %d.\n", in->cbi_num,
+			CRT_BATCH_MAX_NUM);
+		C_GOTO(reply, rc = -CER_PROTO);
+	}
+	batch->cb_num = in->cbi_num;
+
+	hg_ret = hg_proc_create(ctx->cc_hg_ctx.chc_hgcla,
+				in->cbi_body.iov_buf, in->cbi_body.iov_len,
+				HG_DECODE, HG_NOHASH, &proc);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("hg_proc_create failed, hg_ret: %d.\n", hg_ret);
+		C_GOTO(reply, rc = -CER_HG);
+	}
+	for (num = 0; num < in->cbi_num; num++) {
+		rc = crt_batch_unpack_req(ctx, proc, &rpc_priv);
+		if (rc != 0) {
+			C_ERROR("failed to unpack request %d of %d, rc: %d.\n",
+				num, in->cbi_num, rc);
+			break;
+		}
+		rpc_priv->crp_batch = batch;
+		rpc_priv->crp_batch_idx = num;
+		batch->cb_subs[num] = rpc_priv;
+		crt_req_addref(rpc_req); /* decref in crt_batch_req_fini */
+	}
+	hg_proc_free(proc);
+
+	/* the requests not unpacked get no reply, the client fails them */
+	batch->cb_replied = in->cbi_num - num;
+	if (num == 0)
+		C_GOTO(reply, rc);
+
+	for (i = 0; i < num; i++) {
+		rpc_priv = batch->cb_subs[i];
+		rc = crt_rpc_common_hdlr(rpc_priv);
+		/* as crt_rpc_handler_common, with ABT the ULT decrefs it */
+		if (rc != 0 || ctx->cc_pool == NULL)
+			crt_req_decref(&rpc_priv->crp_pub);
+	}
+
+	return 0;
+
+reply:
+	crt_batch_reply_flush(batch);
+out:
+	return rc;
+}
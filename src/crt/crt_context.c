@@ -41,101 +41,311 @@
 #include <abt.h>
 #include <crt_internal.h>
 
-static void crt_epi_destroy(struct crt_ep_inflight *epi);
+static void
+crt_epi_destroy(struct crt_ep_inflight *epi)
+{
+	C_ASSERT(epi != NULL);
+	C_ASSERT(epi->epi_initialized == 1);
+
+	C_ASSERT(crt_list_empty(&epi->epi_req_waitq));
+	C_ASSERT(epi->epi_req_wait_num == 0);
+
+	C_ASSERT(crt_list_empty(&epi->epi_req_q));
+	C_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
+
+	pthread_mutex_destroy(&epi->epi_mutex);
 
-static struct crt_ep_inflight *
-epi_link2ptr(crt_list_t *rlink)
+	C_FREE_PTR(epi);
+}
+
+static inline uint32_t
+crt_epi_hash(crt_endpoint_t *ep)
 {
-	C_ASSERT(rlink != NULL);
-	return container_of(rlink, struct crt_ep_inflight, epi_link);
+	return crt_hash_mix96((uint32_t)((uintptr_t)ep->ep_grp >> 3),
+			      ep->ep_rank, ep->ep_tag);
 }
 
-static int
-epi_op_key_get(struct chash_table *hhtab, crt_list_t *rlink, void **key_pp)
+static inline bool
+crt_epi_match(struct crt_ep_inflight *epi, crt_endpoint_t *ep)
+{
+	return epi->epi_ep.ep_rank == ep->ep_rank &&
+	       epi->epi_ep.ep_tag == ep->ep_tag &&
+	       epi->epi_ep.ep_grp == ep->ep_grp;
+}
+
+struct crt_epi_table *
+crt_epi_table_alloc(uint32_t cap)
 {
-	struct crt_ep_inflight *epi = epi_link2ptr(rlink);
+	struct crt_epi_table	*tab;
 
-	/* TODO: use global rank */
-	*key_pp = (void *)&epi->epi_ep.ep_rank;
-	return sizeof(epi->epi_ep.ep_rank);
+	C_ASSERT(cap != 0 && (cap & (cap - 1)) == 0);
+	C_ALLOC(tab, sizeof(*tab) + cap * sizeof(tab->et_slots[0]));
+	if (tab != NULL)
+		tab->et_cap = cap;
+
+	return tab;
 }
 
-static uint32_t
-epi_op_key_hash(struct chash_table *hhtab, const void *key, unsigned int ksize)
+void
+crt_epi_table_free(struct crt_epi_table *tab)
 {
-	C_ASSERT(ksize == sizeof(crt_rank_t));
+	struct crt_epi_table	*prev;
 
-	return (unsigned int)(*(const uint32_t *)key %
-		(1U << CRT_EPI_TABLE_BITS));
+	while (tab != NULL) {
+		prev = tab->et_prev;
+		C_FREE(tab, sizeof(*tab) + tab->et_cap *
+			    sizeof(tab->et_slots[0]));
+		tab = prev;
+	}
 }
 
-static bool
-epi_op_key_cmp(struct chash_table *hhtab, crt_list_t *rlink,
-	  const void *key, unsigned int ksize)
+/*
+ * Lookup the epi of \a ep, lock-free. Slots are published with release
+ * semantic after the epi is fully initialized, and never cleared until the
+ * context is destroyed, so the first empty slot terminates the probe.
+ */
+struct crt_ep_inflight *
+crt_epi_lookup(struct crt_context *ctx, crt_endpoint_t *ep)
 {
-	struct crt_ep_inflight *epi = epi_link2ptr(rlink);
+	struct crt_epi_table	*tab;
+	struct crt_ep_inflight	*epi;
+	uint32_t		 mask;
+	uint32_t		 i;
+
+	tab = __atomic_load_n(&ctx->cc_epi_table, __ATOMIC_ACQUIRE);
+	mask = tab->et_cap - 1;
+	for (i = crt_epi_hash(ep) & mask; ; i = (i + 1) & mask) {
+		epi = __atomic_load_n(&tab->et_slots[i], __ATOMIC_ACQUIRE);
+		if (epi == NULL || crt_epi_match(epi, ep))
+			return epi;
+	}
+}
+
+static void
+crt_epi_table_put(struct crt_epi_table *tab, struct crt_ep_inflight *epi)
+{
+	uint32_t	mask = tab->et_cap - 1;
+	uint32_t	i;
+
+	for (i = crt_epi_hash(&epi->epi_ep) & mask; tab->et_slots[i] != NULL;
+	     i = (i + 1) & mask)
+		;
+	__atomic_store_n(&tab->et_slots[i], epi, __ATOMIC_RELEASE);
+}
+
+/*
+ * Insert \a epi to the index, grow the index when it becomes half full.
+ * Caller should hold crt_context::cc_mutex.
+ */
+int
+crt_epi_insert(struct crt_context *ctx, struct crt_ep_inflight *epi)
+{
+	struct crt_epi_table	*tab = ctx->cc_epi_table;
+	struct crt_epi_table	*new_tab;
+	uint32_t		 i;
+
+	if ((ctx->cc_epi_num + 1) * 2 > tab->et_cap) {
+		new_tab = crt_epi_table_alloc(tab->et_cap * 2);
+		if (new_tab == NULL)
+			return -CER_NOMEM;
+		for (i = 0; i < tab->et_cap; i++) {
+			if (tab->et_slots[i] != NULL)
+				crt_epi_table_put(new_tab, tab->et_slots[i]);
+		}
+		/* readers may still probe the old one, free it with context */
+		new_tab->et_prev = tab;
+		__atomic_store_n(&ctx->cc_epi_table, new_tab, __ATOMIC_RELEASE);
+		tab = new_tab;
+	}
 
-	C_ASSERT(ksize == sizeof(crt_rank_t));
-	/* TODO: use global rank */
+	crt_epi_table_put(tab, epi);
+	ctx->cc_epi_num++;
 
-	return epi->epi_ep.ep_rank == *(crt_rank_t *)key;
+	return 0;
 }
 
 static void
-epi_op_rec_addref(struct chash_table *hhtab, crt_list_t *rlink)
+crt_rpc_pool_init(struct crt_rpc_pool *pool)
 {
-	epi_link2ptr(rlink)->epi_ref++;
+	memset(pool, 0, sizeof(*pool));
+	pthread_spin_init(&pool->cp_lock, PTHREAD_PROCESS_PRIVATE);
 }
 
+/*
+ * Drop the cached objects. RPCs the user still holds references on can outlive
+ * their context, with pooled objects out the pool (and the context embedding
+ * it) is kept until the last one is returned. Returns true if the context can
+ * be freed right away.
+ */
 static bool
-epi_op_rec_decref(struct chash_table *hhtab, crt_list_t *rlink)
+crt_rpc_pool_fini(struct crt_rpc_pool *pool)
 {
-	struct crt_ep_inflight *epi = epi_link2ptr(rlink);
+	struct crt_rpc_pool_class	*pc;
+	struct crt_rpc_pool_obj		*obj;
+	bool				 idle;
+	int				 i;
+
+	pthread_spin_lock(&pool->cp_lock);
+	for (i = 0; i < CRT_RPC_POOL_CLASS_NUM; i++) {
+		pc = &pool->cp_class[i];
+		while (pc->pc_free != NULL) {
+			obj = pc->pc_free;
+			pc->pc_free = obj->po_next;
+			C_FREE(obj, 1UL << (i + CRT_RPC_POOL_MIN_SHIFT));
+		}
+		pc->pc_free_num = 0;
+	}
+	pool->cp_dead = true;
+	idle = (pool->cp_busy == 0);
+	pthread_spin_unlock(&pool->cp_lock);
 
-	epi->epi_ref--;
-	return epi->epi_ref == 0;
+	if (idle)
+		pthread_spin_destroy(&pool->cp_lock);
+
+	return idle;
 }
 
-static void
-epi_op_rec_free(struct chash_table *hhtab, crt_list_t *rlink)
+/* return the size class index, or -1 if the size bypasses the pool */
+static inline int
+crt_rpc_pool_class_idx(crt_size_t size)
 {
-	crt_epi_destroy(epi_link2ptr(rlink));
+	unsigned int	shift;
+
+	if (size > (1UL << CRT_RPC_POOL_MAX_SHIFT))
+		return -1;
+	shift = crt_power2_nbits((unsigned int)size);
+	if (shift < CRT_RPC_POOL_MIN_SHIFT)
+		shift = CRT_RPC_POOL_MIN_SHIFT;
+
+	return shift - CRT_RPC_POOL_MIN_SHIFT;
 }
 
-static chash_table_ops_t epi_table_ops = {
-	.hop_key_get		= epi_op_key_get,
-	.hop_key_hash		= epi_op_key_hash,
-	.hop_key_cmp		= epi_op_key_cmp,
-	.hop_rec_addref		= epi_op_rec_addref,
-	.hop_rec_decref		= epi_op_rec_decref,
-	.hop_rec_free		= epi_op_rec_free,
-};
+/*
+ * Allocate a zeroed object of \a size bytes from the context's RPC pool, fall
+ * back to the heap when the size class has no cached object.
+ */
+void *
+crt_rpc_pool_alloc(struct crt_context *ctx, crt_size_t size)
+{
+	struct crt_rpc_pool		*pool;
+	struct crt_rpc_pool_class	*pc;
+	struct crt_rpc_pool_obj		*obj = NULL;
+	void				*ptr;
+	int				 idx;
+
+	C_ASSERT(ctx != NULL && size > 0);
+	pool = &ctx->cc_rpc_pool;
+	idx = crt_rpc_pool_class_idx(size);
+
+	pthread_spin_lock(&pool->cp_lock);
+	C_ASSERT(!pool->cp_dead);
+	if (idx >= 0 && pool->cp_class[idx].pc_free != NULL) {
+		pc = &pool->cp_class[idx];
+		obj = pc->pc_free;
+		pc->pc_free = obj->po_next;
+		pc->pc_free_num--;
+		pool->cp_hit++;
+	} else {
+		pool->cp_miss++;
+	}
+	if (idx >= 0)
+		pool->cp_busy++;
+	pthread_spin_unlock(&pool->cp_lock);
+
+	if (obj != NULL) {
+		memset(obj, 0, size);
+		return obj;
+	}
 
-static void
-crt_epi_destroy(struct crt_ep_inflight *epi)
+	/* allocate the whole class size so the object can be recycled */
+	if (idx >= 0)
+		size = 1UL << (idx + CRT_RPC_POOL_MIN_SHIFT);
+	C_ALLOC(ptr, size);
+
+	return ptr;
+}
+
+/*
+ * Return an object allocated by crt_rpc_pool_alloc() to the pool. Frees the
+ * context if it was destroyed and this is its last object out.
+ */
+void
+crt_rpc_pool_free(struct crt_context *ctx, void *ptr, crt_size_t size)
 {
-	C_ASSERT(epi != NULL);
+	struct crt_rpc_pool		*pool;
+	struct crt_rpc_pool_class	*pc;
+	struct crt_rpc_pool_obj		*obj = ptr;
+	bool				 last = false;
+	int				 idx;
 
-	C_ASSERT(epi->epi_ref == 0);
-	C_ASSERT(epi->epi_initialized == 1);
+	C_ASSERT(ctx != NULL);
+	if (ptr == NULL)
+		return;
+
+	pool = &ctx->cc_rpc_pool;
+	idx = crt_rpc_pool_class_idx(size);
+	if (idx < 0) {
+		C_FREE(ptr, size);
+		return;
+	}
 
-	C_ASSERT(crt_list_empty(&epi->epi_req_waitq));
-	C_ASSERT(epi->epi_req_wait_num == 0);
+	pc = &pool->cp_class[idx];
+	pthread_spin_lock(&pool->cp_lock);
+	C_ASSERT(pool->cp_busy > 0);
+	pool->cp_busy--;
+	if (pool->cp_dead) {
+		last = (pool->cp_busy == 0);
+	} else if (pc->pc_free_num < CRT_RPC_POOL_MAX_FREE) {
+		obj->po_next = pc->pc_free;
+		pc->pc_free = obj;
+		pc->pc_free_num++;
+		obj = NULL;
+	}
+	pthread_spin_unlock(&pool->cp_lock);
+
+	if (obj != NULL)
+		C_FREE(obj, 1UL << (idx + CRT_RPC_POOL_MIN_SHIFT));
+	if (last) {
+		C_DEBUG("freeing destroyed context %p with its last RPC.\n",
+			ctx);
+		pthread_spin_destroy(&pool->cp_lock);
+		C_FREE_PTR(ctx);
+	}
+}
 
-	C_ASSERT(crt_list_empty(&epi->epi_req_q));
-	C_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
+int
+crt_context_pool_query(crt_context_t crt_ctx, struct crt_pool_stats *stats)
+{
+	struct crt_context	*ctx;
+	struct crt_rpc_pool	*pool;
+	int			 i;
+	int			 rc = 0;
 
-	/* crt_list_del_init(&epi->epi_link); */
-	pthread_mutex_destroy(&epi->epi_mutex);
+	if (crt_ctx == CRT_CONTEXT_NULL || stats == NULL) {
+		C_ERROR("invalid parameter, crt_ctx: %p, stats: %p.\n",
+			crt_ctx, stats);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
 
-	C_FREE_PTR(epi);
+	ctx = (struct crt_context *)crt_ctx;
+	pool = &ctx->cc_rpc_pool;
+
+	pthread_spin_lock(&pool->cp_lock);
+	stats->cps_hit = pool->cp_hit;
+	stats->cps_miss = pool->cp_miss;
+	stats->cps_cached = 0;
+	for (i = 0; i < CRT_RPC_POOL_CLASS_NUM; i++)
+		stats->cps_cached += pool->cp_class[i].pc_free_num;
+	pthread_spin_unlock(&pool->cp_lock);
+
+out:
+	return rc;
 }
 
 static int
 crt_context_init(crt_context_t crt_ctx)
 {
 	struct crt_context	*ctx;
-	uint32_t		 bh_node_cnt;
 	int			 rc;
 
 	C_ASSERT(crt_ctx != NULL);
@@ -143,26 +353,35 @@ crt_context_init(crt_context_t crt_ctx)
 
 	CRT_INIT_LIST_HEAD(&ctx->cc_link);
 
-	/* create timeout binheap */
-	bh_node_cnt = CRT_MAX_INFLIGHT_PER_EP_CTX * 64;
-	rc = crt_binheap_create_inplace(CBH_FT_NOLOCK, bh_node_cnt,
-					NULL /* priv */, &crt_timeout_bh_ops,
-					&ctx->cc_bh_timeout);
+	/* init timeout wheel */
+	rc = crt_twheel_init(&ctx->cc_timeout_wheel, CRT_TIMEOUT_TICK_US,
+			     crt_timeus_secdiff(0));
 	if (rc != 0) {
-		C_ERROR("crt_binheap_create_inplace failed, rc: %d.\n", rc);
+		C_ERROR("crt_twheel_init failed, rc: %d.\n", rc);
 		C_GOTO(out, rc);
 	}
+	ctx->cc_timeout_next = UINT64_MAX;
 
-	/* create epi table, use external lock */
-	rc =  chash_table_create_inplace(DHASH_FT_NOLOCK, CRT_EPI_TABLE_BITS,
-			NULL, &epi_table_ops, &ctx->cc_epi_table);
-	if (rc != 0) {
-		C_ERROR("chash_table_create_inplace failed, rc: %d.\n", rc);
-		crt_binheap_destroy_inplace(&ctx->cc_bh_timeout);
-		C_GOTO(out, rc);
+	/* create epi index */
+	ctx->cc_epi_table = crt_epi_table_alloc(1U << CRT_EPI_TABLE_BITS);
+	if (ctx->cc_epi_table == NULL) {
+		C_ERROR("crt_epi_table_alloc failed.\n");
+		C_GOTO(out, rc = -CER_NOMEM);
 	}
+	ctx->cc_epi_num = 0;
 
+	pthread_mutex_init(&ctx->cc_timeout_mutex, NULL);
 	pthread_mutex_init(&ctx->cc_mutex, NULL);
+	CRT_INIT_LIST_HEAD(&ctx->cc_batch_list);
+	ctx->cc_batch_num = 0;
+	pthread_mutex_init(&ctx->cc_batch_mutex, NULL);
+	CRT_INIT_LIST_HEAD(&ctx->cc_vec_list);
+	ctx->cc_vec_next = UINT64_MAX;
+	pthread_mutex_init(&ctx->cc_vec_mutex, NULL);
+	CRT_INIT_LIST_HEAD(&ctx->cc_addr_pend_list);
+	ctx->cc_addr_pend_next = UINT64_MAX;
+	pthread_mutex_init(&ctx->cc_addr_mutex, NULL);
+	crt_rpc_pool_init(&ctx->cc_rpc_pool);
 
 out:
 	return rc;
@@ -195,7 +414,14 @@ crt_context_create(void *arg, crt_context_t *crt_ctx)
 	rc = crt_hg_ctx_init(&ctx->cc_hg_ctx, crt_gdata.cg_ctx_num);
 	if (rc != 0) {
 		C_ERROR("crt_hg_ctx_init failed rc: %d.\n", rc);
-		C_FREE_PTR(ctx);
+		crt_epi_table_free(ctx->cc_epi_table);
+		pthread_mutex_destroy(&ctx->cc_timeout_mutex);
+		pthread_mutex_destroy(&ctx->cc_mutex);
+		pthread_mutex_destroy(&ctx->cc_batch_mutex);
+		pthread_mutex_destroy(&ctx->cc_vec_mutex);
+		pthread_mutex_destroy(&ctx->cc_addr_mutex);
+		if (crt_rpc_pool_fini(&ctx->cc_rpc_pool))
+			C_FREE_PTR(ctx);
 		pthread_rwlock_unlock(&crt_gdata.cg_rwlock);
 		C_GOTO(out, rc);
 	}
@@ -241,18 +467,14 @@ crt_rpc_complete(struct crt_rpc_priv *rpc_priv, int rc)
 
 /* abort the RPCs in inflight queue and waitq in the epi. */
 static int
-crt_ctx_epi_abort(crt_list_t *rlink, void *args)
+crt_ctx_epi_abort(struct crt_ep_inflight *epi, int force)
 {
-	struct crt_ep_inflight	*epi;
 	struct crt_context	*ctx;
 	struct crt_rpc_priv	*rpc_priv, *rpc_next;
 	bool			msg_logged;
-	int			force;
 	int			rc = 0;
 
-	C_ASSERT(rlink != NULL);
-	C_ASSERT(args != NULL);
-	epi = epi_link2ptr(rlink);
+	C_ASSERT(epi != NULL);
 	ctx = epi->epi_ctx;
 	C_ASSERT(ctx != NULL);
 
@@ -261,7 +483,6 @@ crt_ctx_epi_abort(crt_list_t *rlink, void *args)
 	    crt_list_empty(&epi->epi_req_q))
 		C_GOTO(out, rc = 0);
 
-	force = *(int *)args;
 	if (force == 0) {
 		C_ERROR("cannot abort endpoint (idx %d, rank %d, req_wait_num "
 			CF_U64", req_num "CF_U64", reply_num "CF_U64", "
@@ -324,6 +545,8 @@ int
 crt_context_destroy(crt_context_t crt_ctx, int force)
 {
 	struct crt_context	*ctx;
+	struct crt_epi_table	*tab;
+	uint32_t		i;
 	int			rc = 0;
 
 	if (crt_ctx == CRT_CONTEXT_NULL) {
@@ -333,32 +556,60 @@ crt_context_destroy(crt_context_t crt_ctx, int force)
 
 	ctx = (struct crt_context *)crt_ctx;
 
-	pthread_mutex_lock(&ctx->cc_mutex);
+	/* send out the open batches, so they are tracked as inflight RPCs */
+	crt_batch_flush(ctx);
+	/* hand the pending requests to their vectored handlers */
+	crt_rpc_vec_dispatch(ctx, true);
 
-	rc = chash_table_traverse(&ctx->cc_epi_table, crt_ctx_epi_abort,
-				  &force);
+	/*
+	 * address lookups in flight still reference the context, when forced
+	 * their entries are detached and freed by the lookup callbacks.
+	 */
+	if (force) {
+		crt_grp_addr_pend_abort(ctx);
+	} else {
+		pthread_mutex_lock(&ctx->cc_addr_mutex);
+		if (!crt_list_empty(&ctx->cc_addr_pend_list))
+			rc = -CER_BUSY;
+		pthread_mutex_unlock(&ctx->cc_addr_mutex);
+	}
 	if (rc != 0) {
 		C_DEBUG("destroy context (idx %d, force %d), "
-			"chash_table_traverse failed rc: %d.\n",
-			ctx->cc_idx, force, rc);
-		pthread_mutex_unlock(&ctx->cc_mutex);
+			"address lookups pending.\n", ctx->cc_idx, force);
 		C_GOTO(out, rc);
 	}
 
-	rc = chash_table_destroy_inplace(&ctx->cc_epi_table,
-					 true /* force */);
-	if (rc != 0) {
-		C_ERROR("destroy context (idx %d, force %d), "
-			"chash_table_destroy_inplace failed, rc: %d.\n",
-			ctx->cc_idx, force, rc);
-		pthread_mutex_unlock(&ctx->cc_mutex);
-		C_GOTO(out, rc);
+	pthread_mutex_lock(&ctx->cc_mutex);
+
+	tab = ctx->cc_epi_table;
+	for (i = 0; i < tab->et_cap; i++) {
+		if (tab->et_slots[i] == NULL)
+			continue;
+		rc = crt_ctx_epi_abort(tab->et_slots[i], force);
+		if (rc != 0) {
+			C_DEBUG("destroy context (idx %d, force %d), "
+				"crt_ctx_epi_abort failed rc: %d.\n",
+				ctx->cc_idx, force, rc);
+			pthread_mutex_unlock(&ctx->cc_mutex);
+			C_GOTO(out, rc);
+		}
 	}
 
-	crt_binheap_destroy_inplace(&ctx->cc_bh_timeout);
+	for (i = 0; i < tab->et_cap; i++) {
+		if (tab->et_slots[i] != NULL)
+			crt_epi_destroy(tab->et_slots[i]);
+	}
+	crt_epi_table_free(tab);
+	ctx->cc_epi_table = NULL;
+	ctx->cc_epi_num = 0;
 
 	pthread_mutex_unlock(&ctx->cc_mutex);
+	crt_grp_lc_ctx_purge(ctx);
 	pthread_mutex_destroy(&ctx->cc_mutex);
+	pthread_mutex_destroy(&ctx->cc_timeout_mutex);
+	pthread_mutex_destroy(&ctx->cc_batch_mutex);
+	pthread_mutex_destroy(&ctx->cc_vec_mutex);
+	pthread_mutex_destroy(&ctx->cc_addr_mutex);
 
 	rc = crt_hg_ctx_fini(&ctx->cc_hg_ctx);
 	if (rc == 0) {
@@ -366,7 +617,9 @@ crt_context_destroy(crt_context_t crt_ctx, int force)
 		crt_gdata.cg_ctx_num--;
 		crt_list_del_init(&ctx->cc_link);
 		pthread_rwlock_unlock(&crt_gdata.cg_rwlock);
-		C_FREE_PTR(ctx);
+		/* or with the last RPC the user holds */
+		if (crt_rpc_pool_fini(&ctx->cc_rpc_pool))
+			C_FREE_PTR(ctx);
 	} else {
 		C_ERROR("crt_hg_ctx_fini failed rc: %d.\n", rc);
 	}
@@ -379,22 +632,17 @@ int
 crt_ep_abort(crt_endpoint_t ep)
 {
 	struct crt_context	*ctx = NULL;
-	crt_list_t		*rlink;
-	int			force;
-	int			rc = 0;
+	struct crt_ep_inflight	*epi;
+	int			 rc = 0;
 
 	pthread_rwlock_rdlock(&crt_gdata.cg_rwlock);
 
 	crt_list_for_each_entry(ctx, &crt_gdata.cg_ctx_list, cc_link) {
 		rc = 0;
 		pthread_mutex_lock(&ctx->cc_mutex);
-		rlink = chash_rec_find(&ctx->cc_epi_table, (void *)&ep.ep_rank,
-				       sizeof(ep.ep_rank));
-		if (rlink != NULL) {
-			force = true;
-			rc = crt_ctx_epi_abort(rlink, &force);
-			chash_rec_decref(&ctx->cc_epi_table, rlink);
-		}
+		epi = crt_epi_lookup(ctx, &ep);
+		if (epi != NULL)
+			rc = crt_ctx_epi_abort(epi, true /* force */);
 		pthread_mutex_unlock(&ctx->cc_mutex);
 		if (rc != 0) {
 			C_ERROR("context (idx %d), ep_abort (rank %d), "
@@ -409,91 +657,106 @@ crt_ep_abort(crt_endpoint_t ep)
 	return rc;
 }
 
-/* caller should already hold crt_ctx->cc_mutex */
-static int
+/* arm the RPC's timer, caller should hold the epi_mutex */
+static void
 crt_req_timeout_track(crt_rpc_t *req)
 {
 	struct crt_context	*crt_ctx;
 	struct crt_rpc_priv	*rpc_priv;
-	int			 rc;
 
 	crt_ctx = (struct crt_context *)req->cr_ctx;
 	C_ASSERT(crt_ctx != NULL);
 	rpc_priv = container_of(req, struct crt_rpc_priv, crp_pub);
 
-	/* add to binheap for timeout tracking */
-	crt_req_addref(req); /* decref in crt_req_timeout_untrack */
-	rc = crt_binheap_insert(&crt_ctx->cc_bh_timeout,
-				&rpc_priv->crp_timeout_bp_node);
-	if (rc == 0) {
-		rpc_priv->crp_in_binheap = 1;
-	} else {
-		C_ERROR("rpc_priv %p (opc 0x%x), crt_binheap_insert "
-			"failed, rc: %d.\n", rpc_priv,
-			rpc_priv->crp_pub.cr_opc, rc);
-		crt_req_decref(req);
-	}
+	rpc_priv->crp_timeout_ts = crt_req_deadline(rpc_priv);
 
-	return rc;
+	crt_req_addref(req); /* decref in crt_req_timeout_untrack */
+	pthread_mutex_lock(&crt_ctx->cc_timeout_mutex);
+	crt_twheel_arm(&crt_ctx->cc_timeout_wheel, &rpc_priv->crp_timeout_node,
+		       rpc_priv->crp_timeout_ts);
+	if (rpc_priv->crp_timeout_ts < crt_ctx->cc_timeout_next)
+		__atomic_store_n(&crt_ctx->cc_timeout_next,
+				 rpc_priv->crp_timeout_ts, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&crt_ctx->cc_timeout_mutex);
 }
 
-/* caller should already hold crt_ctx->cc_mutex */
+/* cancel the RPC's timer if armed, caller should hold the epi_mutex */
 static void
 crt_req_timeout_untrack(crt_rpc_t *req)
 {
 	struct crt_context	*crt_ctx;
 	struct crt_rpc_priv	*rpc_priv;
+	bool			 armed;
 
 	crt_ctx = (struct crt_context *)req->cr_ctx;
 	C_ASSERT(crt_ctx != NULL);
 	rpc_priv = container_of(req, struct crt_rpc_priv, crp_pub);
 
-	/* remove from timeout binheap */
-	if (rpc_priv->crp_in_binheap == 1) {
-		rpc_priv->crp_in_binheap = 0;
-		crt_binheap_remove(&crt_ctx->cc_bh_timeout,
-				   &rpc_priv->crp_timeout_bp_node);
+	pthread_mutex_lock(&crt_ctx->cc_timeout_mutex);
+	armed = crt_twheel_armed(&rpc_priv->crp_timeout_node);
+	if (armed)
+		crt_twheel_cancel(&crt_ctx->cc_timeout_wheel,
+				  &rpc_priv->crp_timeout_node);
+	pthread_mutex_unlock(&crt_ctx->cc_timeout_mutex);
+
+	if (armed)
 		crt_req_decref(req); /* addref in crt_req_timeout_track */
-	}
 }
 
 static void
 crt_context_timeout_check(struct crt_context *crt_ctx)
 {
 	struct crt_rpc_priv		*rpc_priv, *next;
-	struct crt_binheap_node		*bh_node;
+	crt_list_t			 expired_list;
 	crt_list_t			 timeout_list;
 	uint64_t			 ts_now;
 
 	C_ASSERT(crt_ctx != NULL);
 
+	/*
+	 * Called by every crt_progress, nothing can expire before the cached
+	 * deadline. The coarse clock lags by at most a few milli-seconds,
+	 * which only delays the timeout a bit.
+	 */
+	ts_now = crt_timeus_coarse();
+	/* requests still waiting for the address of their target */
+	crt_grp_addr_pend_expire(crt_ctx, ts_now);
+	if (ts_now < __atomic_load_n(&crt_ctx->cc_timeout_next,
+				     __ATOMIC_RELAXED))
+		return;
+
+	CRT_INIT_LIST_HEAD(&expired_list);
 	CRT_INIT_LIST_HEAD(&timeout_list);
-	ts_now = crt_timeus_secdiff(0);
-
-	pthread_mutex_lock(&crt_ctx->cc_mutex);
-	while (1) {
-		bh_node = crt_binheap_root(&crt_ctx->cc_bh_timeout);
-		if (bh_node == NULL)
-			break;
-		rpc_priv = container_of(bh_node, struct crt_rpc_priv,
-					crp_timeout_bp_node);
-		if (rpc_priv->crp_timeout_ts > ts_now)
-			break;
-
-		crt_req_timeout_untrack(&rpc_priv->crp_pub);
 
+	pthread_mutex_lock(&crt_ctx->cc_timeout_mutex);
+	crt_twheel_expire(&crt_ctx->cc_timeout_wheel, ts_now, &expired_list);
+	__atomic_store_n(&crt_ctx->cc_timeout_next,
+			 crt_twheel_next(&crt_ctx->cc_timeout_wheel),
+			 __ATOMIC_RELAXED);
+	/* disarm inside the lock, so crt_req_timeout_untrack skips them */
+	crt_list_for_each_entry_safe(rpc_priv, next, &expired_list,
+				     crp_timeout_node.tn_link) {
+		crt_list_del_init(&rpc_priv->crp_timeout_node.tn_link);
 		crt_list_add_tail(&rpc_priv->crp_tmp_link, &timeout_list);
-		C_ERROR("rpc_priv %p (opc 0x%x) timed out.\n", rpc_priv,
-			rpc_priv->crp_pub.cr_opc);
-	};
-	pthread_mutex_unlock(&crt_ctx->cc_mutex);
+	}
+	pthread_mutex_unlock(&crt_ctx->cc_timeout_mutex);
 
 	/* handle the timeout RPCs */
 	crt_list_for_each_entry_safe(rpc_priv, next, &timeout_list,
 				     crp_tmp_link) {
 		crt_list_del_init(&rpc_priv->crp_tmp_link);
+		C_ERROR("rpc_priv %p (opc 0x%x) timed out.\n", rpc_priv,
+			rpc_priv->crp_pub.cr_opc);
 		crt_rpc_complete(rpc_priv, -CER_TIMEDOUT);
+		/*
+		 * cancel the forward so its callback comes back on a later
+		 * progress and releases the handle for crt_req_reset().
+		 */
+		if (__atomic_load_n(&rpc_priv->crp_fwd_inflight,
+				    __ATOMIC_ACQUIRE))
+			crt_hg_req_cancel(rpc_priv);
 		crt_context_req_untrack(&rpc_priv->crp_pub);
+		crt_req_decref(&rpc_priv->crp_pub); /* addref in track */
 	}
 }
 
@@ -509,8 +772,7 @@ crt_context_req_track(crt_rpc_t *req)
 	struct crt_rpc_priv	*rpc_priv;
 	struct crt_context	*crt_ctx;
 	struct crt_ep_inflight	*epi;
-	crt_list_t		*rlink;
-	crt_rank_t		ep_rank;
+	crt_endpoint_t		ep;
 	int			rc = 0;
 
 	C_ASSERT(req != NULL);
@@ -518,83 +780,126 @@ crt_context_req_track(crt_rpc_t *req)
 	C_ASSERT(crt_ctx != NULL);
 
 	/* TODO use global rank */
-	ep_rank = req->cr_ep.ep_rank;
-
-	/* lookup the crt_ep_inflight (create one if not found) */
-	pthread_mutex_lock(&crt_ctx->cc_mutex);
-	rlink = chash_rec_find(&crt_ctx->cc_epi_table, (void *)&ep_rank,
-			       sizeof(ep_rank));
-	if (rlink == NULL) {
-		C_ALLOC_PTR(epi);
+	ep = req->cr_ep;
+
+	/* lookup the crt_ep_inflight, the fast path takes no context lock */
+	epi = crt_epi_lookup(crt_ctx, &ep);
+	if (epi == NULL) {
+		/* create one if not found, re-lookup under the lock */
+		pthread_mutex_lock(&crt_ctx->cc_mutex);
+		epi = crt_epi_lookup(crt_ctx, &ep);
 		if (epi == NULL) {
-			pthread_mutex_unlock(&crt_ctx->cc_mutex);
-			C_GOTO(out, rc = -CER_NOMEM);
-		}
+			C_ALLOC_PTR(epi);
+			if (epi == NULL) {
+				pthread_mutex_unlock(&crt_ctx->cc_mutex);
+				C_GOTO(out, rc = -CER_NOMEM);
+			}
 
-		/* init the epi fields */
-		CRT_INIT_LIST_HEAD(&epi->epi_link);
-		epi->epi_ep.ep_rank = ep_rank;
-		epi->epi_ctx = crt_ctx;
-		CRT_INIT_LIST_HEAD(&epi->epi_req_q);
-		epi->epi_req_num = 0;
-		epi->epi_reply_num = 0;
-		CRT_INIT_LIST_HEAD(&epi->epi_req_waitq);
-		epi->epi_req_wait_num = 0;
-		/* epi_ref init as 1 to avoid other thread delete it but here
-		 * still need to access it, decref before exit this routine. */
-		epi->epi_ref = 1;
-		epi->epi_initialized = 1;
-		pthread_mutex_init(&epi->epi_mutex, NULL);
-
-		rc = chash_rec_insert(&crt_ctx->cc_epi_table, &ep_rank,
-				      sizeof(ep_rank), &epi->epi_link,
-				      true /* exclusive */);
+			/* init the epi fields */
+			epi->epi_ep = ep;
+			epi->epi_ctx = crt_ctx;
+			CRT_INIT_LIST_HEAD(&epi->epi_req_q);
+			epi->epi_req_num = 0;
+			epi->epi_reply_num = 0;
+			CRT_INIT_LIST_HEAD(&epi->epi_req_waitq);
+			epi->epi_req_wait_num = 0;
+			epi->epi_window = CRT_MAX_INFLIGHT_PER_EP_CTX;
+			epi->epi_initialized = 1;
+			pthread_mutex_init(&epi->epi_mutex, NULL);
+
+			rc = crt_epi_insert(crt_ctx, epi);
+			if (rc != 0) {
+				C_ERROR("crt_epi_insert failed, rc: %d.\n",
+					rc);
+				pthread_mutex_destroy(&epi->epi_mutex);
+				C_FREE_PTR(epi);
+			}
+		}
+		pthread_mutex_unlock(&crt_ctx->cc_mutex);
 		if (rc != 0)
-			C_ERROR("chash_rec_insert failed, rc: %d.\n", rc);
-	} else {
-		epi = epi_link2ptr(rlink);
-		C_ASSERT(epi->epi_ctx == crt_ctx);
+			C_GOTO(out, rc);
 	}
-	pthread_mutex_unlock(&crt_ctx->cc_mutex);
-
-	if (rc != 0)
-		C_GOTO(out, rc);
+	C_ASSERT(epi->epi_ctx == crt_ctx);
 
 	/* add the RPC req to crt_ep_inflight */
 	rpc_priv = container_of(req, struct crt_rpc_priv, crp_pub);
 	pthread_mutex_lock(&epi->epi_mutex);
 	C_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
-	rpc_priv->crp_timeout_ts = crt_timeus_secdiff(CRT_DEFAULT_TIMEOUT_S);
 	rpc_priv->crp_epi = epi;
 	crt_req_addref(req);
-	if ((epi->epi_req_num - epi->epi_reply_num) >=
-	    CRT_MAX_INFLIGHT_PER_EP_CTX) {
+	if ((epi->epi_req_num - epi->epi_reply_num) >= epi->epi_window) {
 		crt_list_add_tail(&rpc_priv->crp_epi_link,
 				   &epi->epi_req_waitq);
 		epi->epi_req_wait_num++;
 		rpc_priv->crp_state = RPC_QUEUED;
 		rc = CRT_REQ_TRACK_IN_WAITQ;
 	} else {
-		rc = crt_req_timeout_track(req);
-		if (rc != 0) {
-			C_ERROR("crt_req_timeout_track failed, rc: %d.\n", rc);
-			crt_req_decref(req); /* roll back the addref above */
-			C_GOTO(failed, rc);
-		}
-
+		crt_req_timeout_track(req);
 		crt_list_add_tail(&rpc_priv->crp_epi_link, &epi->epi_req_q);
 		epi->epi_req_num++;
+		rpc_priv->crp_send_ts = crt_timeus_secdiff(0);
 		rc = CRT_REQ_TRACK_IN_INFLIGHQ;
 	}
-failed:
 	pthread_mutex_unlock(&epi->epi_mutex);
 
-	chash_rec_decref(&crt_ctx->cc_epi_table, &epi->epi_link);
-
 out:
 	return rc;
 }
 
+static inline void
+crt_epi_window_decrease(struct crt_ep_inflight *epi, uint64_t now)
+{
+	/* at most once per RTT, a burst of losses is one congestion event */
+	if (now - epi->epi_decrease_ts < epi->epi_srtt_us)
+		return;
+
+	epi->epi_window = max(epi->epi_window / 2, CRT_EPI_WINDOW_MIN);
+	epi->epi_window_acked = 0;
+	epi->epi_decrease_ts = now;
+}
+
+/*
+ * AIMD update of the epi's flow-control window when an inflight RPC leaves,
+ * called with epi_mutex held.
+ */
+static void
+crt_epi_window_update(struct crt_ep_inflight *epi,
+		      struct crt_rpc_priv *rpc_priv)
+{
+	uint64_t	now;
+	uint64_t	rtt;
+
+	if (rpc_priv->crp_state != RPC_COMPLETED &&
+	    rpc_priv->crp_state != RPC_TIMEOUT)
+		return;
+
+	now = crt_timeus_secdiff(0);
+	if (rpc_priv->crp_state == RPC_TIMEOUT) {
+		crt_epi_window_decrease(epi, now);
+		return;
+	}
+
+	rtt = now > rpc_priv->crp_send_ts ? now - rpc_priv->crp_send_ts : 1;
+	if (epi->epi_srtt_us == 0) {
+		epi->epi_srtt_us = rtt;
+		epi->epi_min_rtt_us = rtt;
+	} else {
+		epi->epi_srtt_us = (epi->epi_srtt_us * 7 + rtt) / 8;
+		epi->epi_min_rtt_us = min(epi->epi_min_rtt_us, rtt);
+	}
+
+	if (epi->epi_srtt_us > epi->epi_min_rtt_us * CRT_EPI_RTT_CONGEST) {
+		crt_epi_window_decrease(epi, now);
+		return;
+	}
+
+	/* additive increase, by one per window of replies */
+	if (++epi->epi_window_acked >= epi->epi_window) {
+		epi->epi_window_acked = 0;
+		epi->epi_window = min(epi->epi_window + 1, CRT_EPI_WINDOW_MAX);
+	}
+}
+
 void
 crt_context_req_untrack(crt_rpc_t *req)
 {
@@ -628,6 +933,8 @@ crt_context_req_untrack(crt_rpc_t *req)
 		epi->epi_req_num--;
 	C_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
 
+	crt_epi_window_update(epi, rpc_priv);
+
 	crt_req_timeout_untrack(req);
 
 	/* decref corresponding to addref in crt_context_req_track */
@@ -635,19 +942,15 @@ crt_context_req_untrack(crt_rpc_t *req)
 
 	/* process waitq */
 	inflight = epi->epi_req_num - epi->epi_reply_num;
-	C_ASSERT(inflight >= 0 && inflight <= CRT_MAX_INFLIGHT_PER_EP_CTX);
-	credits = CRT_MAX_INFLIGHT_PER_EP_CTX - inflight;
+	C_ASSERT(inflight >= 0);
+	/* can be negative after the window shrunk */
+	credits = epi->epi_window - inflight;
 	while (credits > 0 && !crt_list_empty(&epi->epi_req_waitq)) {
 		C_ASSERT(epi->epi_req_wait_num > 0);
 		rpc_priv = crt_list_entry(epi->epi_req_waitq.next,
 					   struct crt_rpc_priv, crp_epi_link);
 		rpc_priv->crp_state = RPC_INITED;
-		rpc_priv->crp_timeout_ts =
-			crt_timeus_secdiff(CRT_DEFAULT_TIMEOUT_S);
-
-		rc = crt_req_timeout_track(&rpc_priv->crp_pub);
-		if (rc != 0)
-			C_ERROR("crt_req_timeout_track failed, rc: %d.\n", rc);
+		crt_req_timeout_track(&rpc_priv->crp_pub);
 
 		/* remove from waitq and add to in-flight queue */
 		crt_list_move_tail(&rpc_priv->crp_epi_link, &epi->epi_req_q);
@@ -655,6 +958,7 @@ crt_context_req_untrack(crt_rpc_t *req)
 		C_ASSERT(epi->epi_req_wait_num >= 0);
 		epi->epi_req_num++;
 		C_ASSERT(epi->epi_req_num >= epi->epi_reply_num);
+		rpc_priv->crp_send_ts = crt_timeus_secdiff(0);
 
 		/* add to resend list */
 		crt_list_add_tail(&rpc_priv->crp_tmp_link, &submit_list);
@@ -682,6 +986,55 @@ crt_context_req_untrack(crt_rpc_t *req)
 	}
 }
 
+int
+crt_ep_flow_query(crt_context_t crt_ctx, crt_endpoint_t *ep,
+		  struct crt_ep_flow_stats *stats)
+{
+	struct crt_context	*ctx;
+	struct crt_ep_inflight	*epi;
+	int			 rc = 0;
+
+	if (crt_ctx == CRT_CONTEXT_NULL || ep == NULL || stats == NULL) {
+		C_ERROR("invalid parameter, crt_ctx %p, ep %p, stats %p.\n",
+			crt_ctx, ep, stats);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+
+	ctx = (struct crt_context *)crt_ctx;
+	epi = crt_epi_lookup(ctx, ep);
+	if (epi == NULL)
+		C_GOTO(out, rc = -CER_NONEXIST);
+
+	pthread_mutex_lock(&epi->epi_mutex);
+	stats->cefs_window = epi->epi_window;
+	stats->cefs_inflight = epi->epi_req_num - epi->epi_reply_num;
+	stats->cefs_wait_num = epi->epi_req_wait_num;
+	stats->cefs_srtt_us = epi->epi_srtt_us;
+	stats->cefs_min_rtt_us = epi->epi_min_rtt_us;
+	pthread_mutex_unlock(&epi->epi_mutex);
+
+out:
+	return rc;
+}
+
+int
+crt_context_set_progress_spin(crt_context_t crt_ctx, uint32_t spin_us)
+{
+	struct crt_context	*ctx;
+	int			 rc = 0;
+
+	if (crt_ctx == CRT_CONTEXT_NULL) {
+		C_ERROR("invalid parameter (NULL crt_ctx).\n");
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+
+	ctx = (struct crt_context *)crt_ctx;
+	ctx->cc_hg_ctx.chc_spin_us = spin_us;
+
+out:
+	return rc;
+}
+
 crt_context_t
 crt_context_lookup(int ctx_idx)
 {
@@ -783,9 +1136,16 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 
 	ctx = (struct crt_context *)crt_ctx;
 	if (timeout == 0 || cond_cb == NULL) { /** fast path */
+		/** coalesced requests queued since last progress go out now */
+		crt_batch_flush(ctx);
 		crt_context_timeout_check(ctx);
 
-		rc = crt_hg_progress(&ctx->cc_hg_ctx, timeout);
+		rc = crt_hg_progress(&ctx->cc_hg_ctx,
+				     crt_rpc_vec_timeout(ctx, timeout));
+		/** requests gathered by this pass go to vectored handlers */
+		if (crt_rpc_vec_dispatch(ctx, false) > 0 &&
+		    rc == -CER_TIMEDOUT)
+			rc = 0;
 		if (rc && rc != -CER_TIMEDOUT) {
 			C_ERROR("crt_hg_progress failed, rc: %d.\n", rc);
 			C_GOTO(out, rc);
@@ -813,11 +1173,12 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 	if (timeout <= 0) {
 		C_ASSERT(timeout < 0);
 		/**
-		 * For infinite timeout, use a mercury timeout of 1s to avoid
+		 * For infinite timeout, use a mercury timeout of 1ms to avoid
 		 * being blocked indefinitely if another thread has called
-		 * crt_hg_progress() behind our back
+		 * crt_hg_progress() behind our back, and to check the timeouts
+		 * and the condition callback often enough
 		 */
-		hg_timeout = 0;
+		hg_timeout = 1000;
 	} else  {
 		now = crt_timeus_secdiff(0);
 		end = now + timeout;
@@ -829,9 +1190,12 @@ crt_progress(crt_context_t crt_ctx, int64_t timeout,
 	}
 
 	while (true) {
+		crt_batch_flush(ctx);
 		crt_context_timeout_check(ctx);
 
-		rc = crt_hg_progress(&ctx->cc_hg_ctx, hg_timeout);
+		rc = crt_hg_progress(&ctx->cc_hg_ctx,
+				     crt_rpc_vec_timeout(ctx, hg_timeout));
+		crt_rpc_vec_dispatch(ctx, false);
 		if (rc && rc != -CER_TIMEDOUT) {
 			C_ERROR("crt_hg_progress failed with %d\n", rc);
 			C_GOTO(out, rc = 0);
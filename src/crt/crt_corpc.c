@@ -77,7 +77,6 @@ crt_corpc_info_init(struct crt_rpc_priv *rpc_priv,
 
 	rpc_priv->crp_pub.cr_co_bulk_hdl = co_bulk_hdl;
 	co_info->co_priv = priv;
-	CRT_INIT_LIST_HEAD(&co_info->co_child_rpcs);
 	CRT_INIT_LIST_HEAD(&co_info->co_replied_rpcs);
 
 	/* init the corpc header */
@@ -91,7 +90,13 @@ crt_corpc_info_init(struct crt_rpc_priv *rpc_priv,
 
 		co_hdr->coh_int_grpid = grp_priv->gp_int_grpid;
 		co_hdr->coh_excluded_ranks = co_info->co_excluded_ranks;
-		co_hdr->coh_inline_ranks = NULL;
+		/* the members of a group being created, see crt_group_create */
+		if (flags & CRT_RPC_FLAG_MEMBS_INLINE) {
+			rpc_priv->crp_flags |= CRT_RPC_FLAG_MEMBS_INLINE;
+			co_hdr->coh_inline_ranks = grp_priv->gp_membs;
+		} else {
+			co_hdr->coh_inline_ranks = NULL;
+		}
 		co_hdr->coh_grp_ver = grp_ver;
 		co_hdr->coh_tree_topo = tree_topo;
 		co_hdr->coh_root = grp_root;
@@ -106,7 +111,7 @@ out:
 }
 
 static int
-crt_corpc_initiate(struct crt_rpc_priv *rpc_priv)
+crt_corpc_initiate(struct crt_rpc_priv *rpc_priv, struct crt_corpc_pipe *pipe)
 {
 	struct crt_grp_gdata	*grp_gdata;
 	struct crt_grp_priv	*grp_priv;
@@ -121,6 +126,14 @@ crt_corpc_initiate(struct crt_rpc_priv *rpc_priv)
 	if (rpc_priv->crp_flags & CRT_RPC_FLAG_PRIMARY_GRP) {
 		grp_priv = grp_gdata->gg_srv_pri_grp;
 		C_ASSERT(grp_priv != NULL);
+	} else if (rpc_priv->crp_flags & CRT_RPC_FLAG_MEMBS_INLINE) {
+		/* create the group before forwarding over its tree */
+		rc = crt_grp_corpc_create(rpc_priv, &grp_priv);
+		if (rc != 0) {
+			C_ERROR("crt_grp_corpc_create "CF_X64" failed, "
+				"rc: %d.\n", co_hdr->coh_int_grpid, rc);
+			C_GOTO(out, rc);
+		}
 	} else {
 		grp_priv = crt_grp_lookup_int_grpid(co_hdr->coh_int_grpid);
 		if (grp_priv == NULL) {
@@ -140,6 +153,7 @@ crt_corpc_initiate(struct crt_rpc_priv *rpc_priv)
 			rc, rpc_priv->crp_pub.cr_opc);
 		C_GOTO(out, rc);
 	}
+	rpc_priv->crp_corpc_info->co_pipe = pipe;
 
 	rc = crt_corpc_req_hdlr(&rpc_priv->crp_pub);
 	if (rc != 0)
@@ -177,7 +191,7 @@ crt_corpc_chained_bulk_cb(const struct crt_bulk_cb_info *cb_info)
 
 	rpc_priv = container_of(rpc_req, struct crt_rpc_priv, crp_pub);
 	rpc_priv->crp_pub.cr_co_bulk_hdl = local_bulk_hdl;
-	rc = crt_corpc_initiate(rpc_priv);
+	rc = crt_corpc_initiate(rpc_priv, NULL /* pipe */);
 	if (rc != 0)
 		C_ERROR("crt_corpc_initiate failed, rc: %d, opc: 0x%x.\n",
 			rc, rpc_req->cr_opc);
@@ -238,6 +252,628 @@ out:
 	return rc;
 }
 
+/*
+ * A pipelined chained bulk. Rather than pulling the whole collective bulk
+ * before forwarding the corpc, a rank forwards it at once and pulls the bulk
+ * from its parent chunk by chunk, with at most cp_window chunks in flight.
+ * The children do the same against this rank, they ask how much of the bulk
+ * landed here by CRT_OPC_CORPC_BULK_WAIT, which is parked until enough of it
+ * did. So chunk k is forwarded down the tree while chunk k + 1 is still
+ * arriving. The local RPC handler sees the whole bulk and runs once it
+ * landed.
+ *
+ * A rank holding the whole bulk already (the root) has a pipe with no parent,
+ * it only serves its children.
+ */
+struct crt_corpc_pipe {
+	/* link to crt_corpc_pipes */
+	crt_list_t		 cp_link;
+	uint64_t		 cp_id;
+	/* one for crt_corpc_pipes, one for each operation in flight */
+	uint32_t		 cp_ref;
+	struct crt_rpc_priv	*cp_rpc;
+	/* the parent's bulk and pipe, CRT_BULK_NULL if the bulk is local */
+	crt_bulk_t		 cp_parent_bulk;
+	crt_rank_t		 cp_parent_rank;
+	uint64_t		 cp_parent_id;
+	crt_bulk_t		 cp_local_bulk;
+	crt_size_t		 cp_len;
+	crt_size_t		 cp_chunk;
+	uint32_t		 cp_chunk_num;
+	uint32_t		 cp_window;
+	/* chunks [0, cp_ready) landed */
+	uint32_t		 cp_ready;
+	/* the next chunk to pull */
+	uint32_t		 cp_next;
+	uint32_t		 cp_inflight;
+	/* bytes landed on the parent as of its last CRT_OPC_CORPC_BULK_WAIT */
+	crt_size_t		 cp_parent_ready;
+	/* per chunk landed flag, the chunks in the window land in any order */
+	uint8_t			*cp_landed;
+	/* parked CRT_OPC_CORPC_BULK_WAIT requests of the children */
+	crt_list_t		 cp_waiters;
+	/* a CRT_OPC_CORPC_BULK_WAIT to the parent is in flight */
+	uint32_t		 cp_waiting:1,
+	/* the local RPC handler waits for the whole bulk */
+				 cp_hdlr_pending:1,
+	/* the failure was handled, see crt_corpc_pipe_progress */
+				 cp_failed:1,
+	/* in crt_corpc_pipes, the corpc is not finished yet */
+				 cp_registered:1;
+	int			 cp_rc;
+	pthread_mutex_t		 cp_mutex;
+};
+
+struct crt_corpc_pipe_waiter {
+	crt_list_t		 cpw_link;
+	crt_rpc_t		*cpw_rpc;
+	crt_size_t		 cpw_want;
+};
+
+/* the pipes of this rank, looked up by the id from the children */
+static CRT_LIST_HEAD(crt_corpc_pipes);
+static pthread_mutex_t crt_corpc_pipes_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t crt_corpc_pipe_last_id;
+
+/* bytes landed, from the start of the bulk */
+static inline crt_size_t
+crt_corpc_pipe_ready(struct crt_corpc_pipe *pipe)
+{
+	return min((crt_size_t)pipe->cp_ready * pipe->cp_chunk, pipe->cp_len);
+}
+
+static int
+crt_corpc_pipe_create(struct crt_rpc_priv *rpc_priv, crt_bulk_t local_bulk,
+		      crt_size_t len, crt_bulk_t parent_bulk,
+		      struct crt_corpc_pipe **pipe_out)
+{
+	struct crt_corpc_pipe	*pipe;
+	int			 rc = 0;
+
+	C_ASSERT(local_bulk != CRT_BULK_NULL && len > 0);
+
+	C_ALLOC_PTR(pipe);
+	if (pipe == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+
+	pipe->cp_rpc = rpc_priv;
+	pipe->cp_local_bulk = local_bulk;
+	pipe->cp_len = len;
+	pipe->cp_chunk = crt_gdata.cg_corpc_chunk_size;
+	/* a parent pipelines it even if this rank does not, pull it at once */
+	if (pipe->cp_chunk == 0 || pipe->cp_chunk > len)
+		pipe->cp_chunk = len;
+	pipe->cp_chunk_num = (len + pipe->cp_chunk - 1) / pipe->cp_chunk;
+	pipe->cp_window = crt_gdata.cg_corpc_chunk_window;
+	pipe->cp_parent_bulk = parent_bulk;
+	if (parent_bulk != CRT_BULK_NULL) {
+		C_ALLOC(pipe->cp_landed, pipe->cp_chunk_num);
+		if (pipe->cp_landed == NULL) {
+			C_FREE_PTR(pipe);
+			C_GOTO(out, rc = -CER_NOMEM);
+		}
+		pipe->cp_parent_rank = rpc_priv->crp_req_hdr.cch_rank;
+		pipe->cp_parent_id = rpc_priv->crp_coreq_hdr.coh_bulk_pipe;
+	} else {
+		pipe->cp_ready = pipe->cp_chunk_num;
+		pipe->cp_next = pipe->cp_chunk_num;
+		pipe->cp_parent_ready = len;
+	}
+	CRT_INIT_LIST_HEAD(&pipe->cp_waiters);
+	pthread_mutex_init(&pipe->cp_mutex, NULL);
+	pipe->cp_ref = 1;
+	pipe->cp_registered = 1;
+
+	pthread_mutex_lock(&crt_corpc_pipes_mutex);
+	pipe->cp_id = ++crt_corpc_pipe_last_id;
+	crt_list_add(&pipe->cp_link, &crt_corpc_pipes);
+	pthread_mutex_unlock(&crt_corpc_pipes_mutex);
+
+	C_DEBUG("pipe "CF_U64" of rpc %p, len "CF_U64", chunk "CF_U64" x %d, "
+		"parent pipe "CF_U64".\n", pipe->cp_id, rpc_priv, len,
+		pipe->cp_chunk, pipe->cp_chunk_num, pipe->cp_parent_id);
+	*pipe_out = pipe;
+out:
+	return rc;
+}
+
+static inline void
+crt_corpc_pipe_addref_locked(struct crt_corpc_pipe *pipe)
+{
+	pipe->cp_ref++;
+}
+
+static void
+crt_corpc_pipe_decref(struct crt_corpc_pipe *pipe)
+{
+	bool	destroy;
+
+	pthread_mutex_lock(&pipe->cp_mutex);
+	C_ASSERT(pipe->cp_ref > 0);
+	destroy = (--pipe->cp_ref == 0);
+	pthread_mutex_unlock(&pipe->cp_mutex);
+	if (!destroy)
+		return;
+
+	C_ASSERT(crt_list_empty(&pipe->cp_waiters));
+	if (pipe->cp_landed != NULL)
+		C_FREE(pipe->cp_landed, pipe->cp_chunk_num);
+	pthread_mutex_destroy(&pipe->cp_mutex);
+	C_FREE_PTR(pipe);
+}
+
+static struct crt_corpc_pipe *
+crt_corpc_pipe_lookup(uint64_t pipe_id)
+{
+	struct crt_corpc_pipe	*pipe;
+	bool			 found = false;
+
+	pthread_mutex_lock(&crt_corpc_pipes_mutex);
+	crt_list_for_each_entry(pipe, &crt_corpc_pipes, cp_link) {
+		if (pipe->cp_id != pipe_id)
+			continue;
+		pthread_mutex_lock(&pipe->cp_mutex);
+		crt_corpc_pipe_addref_locked(pipe);
+		pthread_mutex_unlock(&pipe->cp_mutex);
+		found = true;
+		break;
+	}
+	pthread_mutex_unlock(&crt_corpc_pipes_mutex);
+
+	return found ? pipe : NULL;
+}
+
+/* move the waiters whose want is satisfied to \a waiters, lock held */
+static void
+crt_corpc_pipe_ready_waiters(struct crt_corpc_pipe *pipe, crt_list_t *waiters)
+{
+	struct crt_corpc_pipe_waiter	*waiter, *next;
+	crt_size_t			 ready;
+
+	ready = crt_corpc_pipe_ready(pipe);
+	crt_list_for_each_entry_safe(waiter, next, &pipe->cp_waiters,
+				     cpw_link) {
+		if (waiter->cpw_want <= ready)
+			crt_list_move_tail(&waiter->cpw_link, waiters);
+	}
+}
+
+static void
+crt_corpc_pipe_wake(crt_list_t *waiters, crt_size_t ready, int wake_rc)
+{
+	struct crt_corpc_pipe_waiter	*waiter, *next;
+	struct crt_corpc_bulk_wait_out	*wait_out;
+	int				 rc;
+
+	crt_list_for_each_entry_safe(waiter, next, waiters, cpw_link) {
+		crt_list_del(&waiter->cpw_link);
+		wait_out = crt_reply_get(waiter->cpw_rpc);
+		wait_out->bw_ready = ready;
+		wait_out->bw_rc = wake_rc;
+		rc = crt_reply_send(waiter->cpw_rpc);
+		if (rc != 0)
+			C_ERROR("crt_reply_send failed, rc: %d, opc: 0x%x.\n",
+				rc, waiter->cpw_rpc->cr_opc);
+		/* corresponds to addref in crt_hdlr_corpc_bulk_wait */
+		crt_req_decref(waiter->cpw_rpc);
+		C_FREE_PTR(waiter);
+	}
+}
+
+/* called when the corpc finished on this rank, see crt_rpc_priv_free */
+void
+crt_corpc_pipe_unregister(struct crt_corpc_info *co_info)
+{
+	struct crt_corpc_pipe	*pipe;
+	crt_list_t		 waiters;
+
+	pipe = co_info->co_pipe;
+	if (pipe == NULL)
+		return;
+	co_info->co_pipe = NULL;
+
+	pthread_mutex_lock(&crt_corpc_pipes_mutex);
+	crt_list_del_init(&pipe->cp_link);
+	pthread_mutex_unlock(&crt_corpc_pipes_mutex);
+
+	CRT_INIT_LIST_HEAD(&waiters);
+	pthread_mutex_lock(&pipe->cp_mutex);
+	pipe->cp_registered = 0;
+	crt_list_splice_init(&pipe->cp_waiters, &waiters);
+	pthread_mutex_unlock(&pipe->cp_mutex);
+
+	/* the children all replied, no one should still wait */
+	crt_corpc_pipe_wake(&waiters, 0, -CER_CANCELED);
+	crt_corpc_pipe_decref(pipe);
+}
+
+static int crt_corpc_pipe_get_cb(const struct crt_bulk_cb_info *cb_info);
+static int crt_corpc_pipe_wait_cb(const struct crt_cb_info *cb_info);
+
+static int
+crt_corpc_pipe_get(struct crt_corpc_pipe *pipe, uint32_t idx)
+{
+	struct crt_bulk_desc	 bulk_desc;
+	crt_size_t		 off;
+	int			 rc;
+
+	off = (crt_size_t)idx * pipe->cp_chunk;
+	bulk_desc.bd_rpc = &pipe->cp_rpc->crp_pub;
+	bulk_desc.bd_bulk_op = CRT_BULK_GET;
+	bulk_desc.bd_remote_hdl = pipe->cp_parent_bulk;
+	bulk_desc.bd_remote_off = off;
+	bulk_desc.bd_local_hdl = pipe->cp_local_bulk;
+	bulk_desc.bd_local_off = off;
+	bulk_desc.bd_len = min(pipe->cp_chunk, pipe->cp_len - off);
+
+	crt_req_addref(&pipe->cp_rpc->crp_pub);
+	rc = crt_bulk_transfer(&bulk_desc, crt_corpc_pipe_get_cb, pipe, NULL);
+	if (rc != 0) {
+		C_ERROR("crt_bulk_transfer failed, rc: %d, opc: 0x%x.\n",
+			rc, pipe->cp_rpc->crp_pub.cr_opc);
+		crt_req_decref(&pipe->cp_rpc->crp_pub);
+	}
+
+	return rc;
+}
+
+static int
+crt_corpc_pipe_wait(struct crt_corpc_pipe *pipe, crt_size_t want)
+{
+	struct crt_corpc_bulk_wait_in	*wait_in;
+	crt_rpc_t			*wait_rpc;
+	crt_endpoint_t			 tgt_ep;
+	int				 rc;
+
+	tgt_ep.ep_grp = NULL;
+	tgt_ep.ep_rank = pipe->cp_parent_rank;
+	tgt_ep.ep_tag = 0;
+	rc = crt_req_create(pipe->cp_rpc->crp_pub.cr_ctx, tgt_ep,
+			    CRT_OPC_CORPC_BULK_WAIT, &wait_rpc);
+	if (rc != 0) {
+		C_ERROR("crt_req_create(CRT_OPC_CORPC_BULK_WAIT) failed, "
+			"rc: %d.\n", rc);
+		C_GOTO(out, rc);
+	}
+	wait_in = crt_req_get(wait_rpc);
+	wait_in->bw_pipe_id = pipe->cp_parent_id;
+	wait_in->bw_want = want;
+
+	crt_req_addref(&pipe->cp_rpc->crp_pub);
+	rc = crt_req_send(wait_rpc, crt_corpc_pipe_wait_cb, pipe);
+	if (rc != 0) {
+		C_ERROR("crt_req_send(CRT_OPC_CORPC_BULK_WAIT) failed, "
+			"rc: %d.\n", rc);
+		crt_req_decref(&pipe->cp_rpc->crp_pub);
+	}
+
+out:
+	return rc;
+}
+
+/*
+ * Pull the chunks landed on the parent within the window, ask the parent for
+ * more, and once nothing is in flight any more fail the pipe if anything
+ * went wrong.
+ */
+static void
+crt_corpc_pipe_progress(struct crt_corpc_pipe *pipe)
+{
+	struct crt_rpc_priv	*rpc_priv = pipe->cp_rpc;
+	crt_list_t		 waiters;
+	crt_size_t		 off, want = 0;
+	uint32_t		 idx;
+	bool			 hdlr_pending = false;
+	int			 rc;
+
+	for (;;) {
+		pthread_mutex_lock(&pipe->cp_mutex);
+		if (!pipe->cp_registered || pipe->cp_rc != 0 ||
+		    pipe->cp_inflight >= pipe->cp_window ||
+		    pipe->cp_next >= pipe->cp_chunk_num)
+			break;
+		off = (crt_size_t)pipe->cp_next * pipe->cp_chunk;
+		if (off + min(pipe->cp_chunk, pipe->cp_len - off) >
+		    pipe->cp_parent_ready)
+			break;
+		idx = pipe->cp_next++;
+		pipe->cp_inflight++;
+		crt_corpc_pipe_addref_locked(pipe);
+		pthread_mutex_unlock(&pipe->cp_mutex);
+
+		rc = crt_corpc_pipe_get(pipe, idx);
+		if (rc == 0)
+			continue;
+
+		pthread_mutex_lock(&pipe->cp_mutex);
+		pipe->cp_inflight--;
+		pipe->cp_ref--;
+		if (pipe->cp_rc == 0)
+			pipe->cp_rc = rc;
+		pthread_mutex_unlock(&pipe->cp_mutex);
+	}
+
+	/* mutex held here */
+	if (pipe->cp_registered && pipe->cp_rc == 0 && !pipe->cp_waiting &&
+	    pipe->cp_parent_ready < pipe->cp_len) {
+		/* the end of the first chunk not landed on the parent yet */
+		idx = pipe->cp_parent_ready / pipe->cp_chunk;
+		want = min((crt_size_t)(idx + 1) * pipe->cp_chunk, pipe->cp_len);
+		pipe->cp_waiting = 1;
+		crt_corpc_pipe_addref_locked(pipe);
+	}
+	pthread_mutex_unlock(&pipe->cp_mutex);
+
+	if (want != 0) {
+		rc = crt_corpc_pipe_wait(pipe, want);
+		if (rc != 0) {
+			pthread_mutex_lock(&pipe->cp_mutex);
+			pipe->cp_waiting = 0;
+			pipe->cp_ref--;
+			if (pipe->cp_rc == 0)
+				pipe->cp_rc = rc;
+			pthread_mutex_unlock(&pipe->cp_mutex);
+		}
+	}
+
+	CRT_INIT_LIST_HEAD(&waiters);
+	pthread_mutex_lock(&pipe->cp_mutex);
+	if (!pipe->cp_registered || pipe->cp_rc == 0 || pipe->cp_failed ||
+	    pipe->cp_inflight > 0 || pipe->cp_waiting) {
+		pthread_mutex_unlock(&pipe->cp_mutex);
+		return;
+	}
+	pipe->cp_failed = 1;
+	rc = pipe->cp_rc;
+	hdlr_pending = pipe->cp_hdlr_pending;
+	pipe->cp_hdlr_pending = 0;
+	crt_list_splice_init(&pipe->cp_waiters, &waiters);
+	pthread_mutex_unlock(&pipe->cp_mutex);
+
+	C_ERROR("pipe "CF_U64" of rpc %p (opc: 0x%x) failed, rc: %d.\n",
+		pipe->cp_id, rpc_priv, rpc_priv->crp_pub.cr_opc, rc);
+	/* fail the subtree, then finish the local handling without the handler */
+	crt_corpc_pipe_wake(&waiters, 0, rc);
+	if (!hdlr_pending)
+		return;
+	rpc_priv->crp_reply_hdr.cch_co_rc = rc;
+	rc = crt_reply_send(&rpc_priv->crp_pub);
+	if (rc != 0)
+		C_ERROR("crt_reply_send failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+	/* the ULT of the handler would have dropped it, see crt_handle_rpc */
+	if (((struct crt_context *)rpc_priv->crp_pub.cr_ctx)->cc_pool != NULL)
+		crt_req_decref(&rpc_priv->crp_pub);
+}
+
+static int
+crt_corpc_pipe_get_cb(const struct crt_bulk_cb_info *cb_info)
+{
+	struct crt_corpc_pipe	*pipe;
+	struct crt_rpc_priv	*rpc_priv;
+	crt_list_t		 waiters;
+	crt_size_t		 ready = 0;
+	uint32_t		 idx;
+	bool			 run_hdlr = false;
+	int			 rc;
+
+	pipe = cb_info->bci_arg;
+	C_ASSERT(pipe != NULL);
+	rpc_priv = pipe->cp_rpc;
+	idx = cb_info->bci_bulk_desc->bd_local_off / pipe->cp_chunk;
+	C_ASSERT(idx < pipe->cp_chunk_num);
+
+	CRT_INIT_LIST_HEAD(&waiters);
+	pthread_mutex_lock(&pipe->cp_mutex);
+	pipe->cp_inflight--;
+	if (cb_info->bci_rc != 0) {
+		C_ERROR("pipe "CF_U64" chunk %d, bulk failed, rc: %d, "
+			"opc: 0x%x.\n", pipe->cp_id, idx, cb_info->bci_rc,
+			rpc_priv->crp_pub.cr_opc);
+		if (pipe->cp_rc == 0)
+			pipe->cp_rc = cb_info->bci_rc;
+	} else {
+		pipe->cp_landed[idx] = 1;
+		while (pipe->cp_ready < pipe->cp_chunk_num &&
+		       pipe->cp_landed[pipe->cp_ready])
+			pipe->cp_ready++;
+		ready = crt_corpc_pipe_ready(pipe);
+		crt_corpc_pipe_ready_waiters(pipe, &waiters);
+		if (pipe->cp_ready == pipe->cp_chunk_num &&
+		    pipe->cp_hdlr_pending) {
+			pipe->cp_hdlr_pending = 0;
+			run_hdlr = true;
+		}
+	}
+	pthread_mutex_unlock(&pipe->cp_mutex);
+
+	crt_corpc_pipe_wake(&waiters, ready, 0);
+	if (run_hdlr) {
+		rc = crt_rpc_common_hdlr(rpc_priv);
+		if (rc != 0)
+			C_ERROR("crt_rpc_common_hdlr (opc: 0x%x) failed, "
+				"rc: %d.\n", rpc_priv->crp_pub.cr_opc, rc);
+	}
+	crt_corpc_pipe_progress(pipe);
+
+	crt_corpc_pipe_decref(pipe);
+	/* corresponds to addref in crt_corpc_pipe_get */
+	crt_req_decref(&rpc_priv->crp_pub);
+	return 0;
+}
+
+static int
+crt_corpc_pipe_wait_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_corpc_bulk_wait_out	*wait_out;
+	struct crt_corpc_pipe		*pipe;
+	struct crt_rpc_priv		*rpc_priv;
+	int				 rc;
+
+	pipe = cb_info->cci_arg;
+	C_ASSERT(pipe != NULL);
+	rpc_priv = pipe->cp_rpc;
+	wait_out = crt_reply_get(cb_info->cci_rpc);
+	rc = cb_info->cci_rc;
+	if (rc == 0)
+		rc = wait_out->bw_rc;
+
+	pthread_mutex_lock(&pipe->cp_mutex);
+	pipe->cp_waiting = 0;
+	if (rc != 0) {
+		C_ERROR("pipe "CF_U64" wait for parent pipe "CF_U64" failed, "
+			"rc: %d.\n", pipe->cp_id, pipe->cp_parent_id, rc);
+		if (pipe->cp_rc == 0)
+			pipe->cp_rc = rc;
+	} else if (wait_out->bw_ready > pipe->cp_parent_ready) {
+		pipe->cp_parent_ready = min(wait_out->bw_ready, pipe->cp_len);
+	}
+	pthread_mutex_unlock(&pipe->cp_mutex);
+
+	crt_corpc_pipe_progress(pipe);
+
+	crt_corpc_pipe_decref(pipe);
+	/* corresponds to addref in crt_corpc_pipe_wait */
+	crt_req_decref(&rpc_priv->crp_pub);
+	return 0;
+}
+
+/* defer the local RPC handler till the whole bulk landed */
+static bool
+crt_corpc_pipe_defer_hdlr(struct crt_corpc_pipe *pipe)
+{
+	bool	deferred = false;
+
+	pthread_mutex_lock(&pipe->cp_mutex);
+	if (pipe->cp_ready < pipe->cp_chunk_num) {
+		pipe->cp_hdlr_pending = 1;
+		deferred = true;
+	}
+	pthread_mutex_unlock(&pipe->cp_mutex);
+
+	return deferred;
+}
+
+int
+crt_hdlr_corpc_bulk_wait(crt_rpc_t *rpc_req)
+{
+	struct crt_corpc_bulk_wait_in	*wait_in;
+	struct crt_corpc_bulk_wait_out	*wait_out;
+	struct crt_corpc_pipe_waiter	*waiter = NULL;
+	struct crt_corpc_pipe		*pipe;
+	int				 rc = 0;
+
+	wait_in = crt_req_get(rpc_req);
+	wait_out = crt_reply_get(rpc_req);
+	C_ASSERT(wait_in != NULL && wait_out != NULL);
+
+	pipe = crt_corpc_pipe_lookup(wait_in->bw_pipe_id);
+	if (pipe == NULL) {
+		C_ERROR("pipe "CF_U64" does not exist.\n",
+			wait_in->bw_pipe_id);
+		C_GOTO(out, wait_out->bw_rc = -CER_NONEXIST);
+	}
+
+	pthread_mutex_lock(&pipe->cp_mutex);
+	if (pipe->cp_rc != 0) {
+		wait_out->bw_rc = pipe->cp_rc;
+	} else if (!pipe->cp_registered) {
+		/* unregistered meanwhile, its waiters were replied already */
+		wait_out->bw_rc = -CER_CANCELED;
+	} else if (crt_corpc_pipe_ready(pipe) >= wait_in->bw_want) {
+		wait_out->bw_ready = crt_corpc_pipe_ready(pipe);
+	} else {
+		C_ALLOC_PTR(waiter);
+		if (waiter == NULL) {
+			wait_out->bw_rc = -CER_NOMEM;
+		} else {
+			waiter->cpw_rpc = rpc_req;
+			waiter->cpw_want = wait_in->bw_want;
+			/* corresponds to decref in crt_corpc_pipe_wake */
+			crt_req_addref(rpc_req);
+			crt_list_add_tail(&waiter->cpw_link, &pipe->cp_waiters);
+		}
+	}
+	pthread_mutex_unlock(&pipe->cp_mutex);
+	crt_corpc_pipe_decref(pipe);
+
+	/* replied once enough of the bulk landed */
+	if (waiter != NULL)
+		C_GOTO(out_parked, rc);
+
+out:
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		C_ERROR("crt_reply_send failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_req->cr_opc);
+out_parked:
+	return rc;
+}
+
+/*
+ * forward the corpc at once and pull the chained bulk from the parent's pipe
+ * meanwhile, see crt_corpc_pipe.
+ */
+static int
+crt_corpc_pipe_start(struct crt_rpc_priv *rpc_priv, crt_bulk_t parent_bulk_hdl,
+		     crt_size_t bulk_len)
+{
+	struct crt_corpc_pipe	*pipe = NULL;
+	crt_bulk_t		 local_bulk_hdl;
+	crt_sg_list_t		 bulk_sgl;
+	crt_iov_t		 bulk_iov;
+	int			 rc = 0;
+
+	bulk_iov.iov_buf = calloc(1, bulk_len);
+	if (bulk_iov.iov_buf == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+	bulk_iov.iov_buf_len = bulk_len;
+	bulk_sgl.sg_nr.num = 1;
+	bulk_sgl.sg_iovs = &bulk_iov;
+
+	rc = crt_bulk_create(rpc_priv->crp_pub.cr_ctx, &bulk_sgl, CRT_BULK_RW,
+			     &local_bulk_hdl);
+	if (rc != 0) {
+		C_ERROR("crt_bulk_create failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+		free(bulk_iov.iov_buf);
+		C_GOTO(out, rc);
+	}
+
+	rc = crt_corpc_pipe_create(rpc_priv, local_bulk_hdl, bulk_len,
+				   parent_bulk_hdl, &pipe);
+	if (rc != 0) {
+		C_ERROR("crt_corpc_pipe_create failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+		crt_bulk_free(local_bulk_hdl);
+		free(bulk_iov.iov_buf);
+		C_GOTO(out, rc);
+	}
+
+	/* the buffer is freed with the bulk, see crt_corpc_free_chained_bulk */
+	rpc_priv->crp_pub.cr_co_bulk_hdl = local_bulk_hdl;
+	rc = crt_corpc_initiate(rpc_priv, pipe);
+	if (rc != 0)
+		C_ERROR("crt_corpc_initiate failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+	if (rpc_priv->crp_corpc_info == NULL) {
+		/* not forwarded, the pipe is not used by anyone */
+		pthread_mutex_lock(&crt_corpc_pipes_mutex);
+		crt_list_del_init(&pipe->cp_link);
+		pthread_mutex_unlock(&crt_corpc_pipes_mutex);
+		crt_corpc_pipe_decref(pipe);
+		rpc_priv->crp_pub.cr_co_bulk_hdl = CRT_BULK_NULL;
+		crt_bulk_free(local_bulk_hdl);
+		free(bulk_iov.iov_buf);
+		C_GOTO(out, rc);
+	}
+
+	crt_corpc_pipe_progress(pipe);
+
+out:
+	return rc;
+}
+
 /* only be called in crt_rpc_handler_common after RPC header unpacked */
 int
 crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
@@ -272,6 +908,12 @@ crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
 			C_GOTO(out, rc);
 		}
 
+		if (co_hdr->coh_bulk_pipe != 0) {
+			rc = crt_corpc_pipe_start(rpc_priv, parent_bulk_hdl,
+						  bulk_len);
+			C_GOTO(out, rc);
+		}
+
 		bulk_iov.iov_buf = calloc(1, bulk_len);
 		if (bulk_iov.iov_buf == NULL)
 			C_GOTO(out, rc = -CER_NOMEM);
@@ -309,7 +951,7 @@ crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
 		C_GOTO(out, rc);
 	} else {
 		rpc_priv->crp_pub.cr_co_bulk_hdl = CRT_BULK_NULL;
-		rc = crt_corpc_initiate(rpc_priv);
+		rc = crt_corpc_initiate(rpc_priv, NULL /* pipe */);
 		if (rc != 0)
 			C_ERROR("crt_corpc_initiate failed,rc: %d,opc: 0x%x.\n",
 				rc, rpc_priv->crp_pub.cr_opc);
@@ -365,7 +1007,7 @@ crt_corpc_req_create(crt_context_t crt_ctx, crt_group_t *grp,
 		}
 	}
 
-	rc = crt_rpc_priv_alloc(opc, &rpc_priv);
+	rc = crt_rpc_priv_alloc(crt_ctx, opc, &rpc_priv);
 	if (rc != 0) {
 		C_ERROR("crt_rpc_priv_alloc, rc: %d, opc: 0x%x.\n", rc, opc);
 		C_GOTO(out, rc);
@@ -469,91 +1111,300 @@ corpc_add_child_rpc(struct crt_rpc_priv *parent_rpc_priv,
 	child_co_hdr->coh_padding = parent_co_hdr->coh_padding;
 
 	co_info = parent_rpc_priv->crp_corpc_info;
+	child_co_hdr->coh_bulk_pipe = (co_info->co_pipe == NULL) ? 0 :
+				      co_info->co_pipe->cp_id;
+	child_rpc_priv->crp_co_body = parent_rpc_priv->crp_co_body;
+	child_rpc_priv->crp_co_body_len = parent_rpc_priv->crp_co_body_len;
 
+	/* decref in crt_corpc_aggregate or on crt_req_send failure */
 	rc = crt_req_addref(&child_rpc_priv->crp_pub);
 	if (rc != 0)
 		C_ERROR("crt_req_addref failed, opc: 0x%x.\n, rc: %d.",
 			child_rpc_priv->crp_pub.cr_opc, rc);
-
-	pthread_spin_lock(&parent_rpc_priv->crp_lock);
-	crt_list_add_tail(&child_rpc_priv->crp_parent_link,
-			  &co_info->co_child_rpcs);
-	pthread_spin_unlock(&parent_rpc_priv->crp_lock);
 }
 
 static inline void
-corpc_del_child_rpc_locked(struct crt_rpc_priv *parent_rpc_priv,
-			   struct crt_rpc_priv *child_rpc_priv)
+crt_corpc_fail_parent_rpc(struct crt_rpc_priv *parent_rpc_priv, int failed_rc)
 {
-	int	rc;
+	crt_rank_t	 myrank;
 
-	C_ASSERT(parent_rpc_priv != NULL);
-	C_ASSERT(child_rpc_priv != NULL);
-	C_ASSERT(parent_rpc_priv->crp_coll == 1 &&
-		 parent_rpc_priv->crp_corpc_info != NULL);
+	crt_group_rank(NULL, &myrank);
 
-	crt_list_del_init(&child_rpc_priv->crp_parent_link);
-	/* decref corresponds to the addref in corpc_add_child_rpc */
-	rc = crt_req_decref(&child_rpc_priv->crp_pub);
-	if (rc != 0)
-		C_ERROR("crt_req_addref failed, opc: 0x%x.\n, rc: %d.",
-			child_rpc_priv->crp_pub.cr_opc, rc);
+	__atomic_store_n(&parent_rpc_priv->crp_reply_hdr.cch_co_rc, failed_rc,
+			 __ATOMIC_RELAXED);
+	C_ERROR("myrank %d, set parent rpc (opc 0x%x) as failed, rc: %d.\n",
+		myrank, parent_rpc_priv->crp_pub.cr_opc, failed_rc);
 }
 
-static inline void
-corpc_del_child_rpc(struct crt_rpc_priv *parent_rpc_priv,
-		    struct crt_rpc_priv *child_rpc_priv)
+/*
+ * Returns true for the only caller which should complete the corpc on this
+ * node, that is the drainer seeing all replies or crt_corpc_req_hdlr failing
+ * to forward on the root.
+ */
+static inline bool
+crt_corpc_claim_done(struct crt_corpc_info *co_info)
 {
-	pthread_spin_lock(&parent_rpc_priv->crp_lock);
-	corpc_del_child_rpc_locked(parent_rpc_priv, child_rpc_priv);
-	pthread_spin_unlock(&parent_rpc_priv->crp_lock);
+	return __atomic_exchange_n(&co_info->co_done, 1, __ATOMIC_ACQ_REL) == 0;
 }
 
-static inline void
-crt_corpc_fail_parent_rpc(struct crt_rpc_priv *parent_rpc_priv, int failed_rc)
+/* corpc handling finished on this node */
+static void
+crt_corpc_complete(struct crt_rpc_priv *parent_rpc_priv)
 {
-	crt_rank_t	 myrank;
+	struct crt_corpc_info	*co_info;
+	int			 co_rc;
+	int			 rc;
 
-	crt_group_rank(NULL, &myrank);
+	co_info = parent_rpc_priv->crp_corpc_info;
+	if (!crt_corpc_claim_done(co_info))
+		return;
 
-	parent_rpc_priv->crp_reply_hdr.cch_co_rc = failed_rc;
-	C_ERROR("myrank %d, set parent rpc (opc 0x%x) as failed, rc: %d.\n",
-		myrank, parent_rpc_priv->crp_pub.cr_opc, failed_rc);
+	crt_corpc_pipe_unregister(co_info);
+	co_rc = __atomic_load_n(&co_info->co_rc, __ATOMIC_ACQUIRE);
+	if (co_info->co_grp_priv->gp_self == co_info->co_root) {
+		crt_rpc_complete(parent_rpc_priv, co_rc);
+	} else {
+		if (co_rc != 0)
+			crt_corpc_fail_parent_rpc(parent_rpc_priv, co_rc);
+		rc = crt_hg_reply_send(parent_rpc_priv);
+		if (rc != 0)
+			C_ERROR("crt_hg_reply_send failed, rc: %d,opc: 0x%x.\n",
+				rc, parent_rpc_priv->crp_pub.cr_opc);
+		/*
+		 * on root node, don't need to free chained bulk handle as it is
+		 * created and passed in by user.
+		 */
+		rc = crt_corpc_free_chained_bulk(
+			parent_rpc_priv->crp_coreq_hdr.coh_bulk_hdl);
+		if (rc != 0)
+			C_ERROR("crt_corpc_free_chainded_bulk failed, rc: %d, "
+				"opc: 0x%x.\n", rc,
+				parent_rpc_priv->crp_pub.cr_opc);
+	}
+	/* the group is not used by this corpc any more */
+	if (parent_rpc_priv->crp_flags & CRT_RPC_FLAG_GRP_DESTROY)
+		crt_grp_corpc_destroy(co_info->co_grp_priv);
+	/* correspond to addref in crt_corpc_req_hdlr */
+	crt_req_decref(&parent_rpc_priv->crp_pub);
 }
 
-static inline void
-crt_corpc_fail_child_rpc(struct crt_rpc_priv *parent_rpc_priv,
-			 uint32_t failed_num, int failed_rc)
+/* max number of replies handed to the aggregate callbacks at once */
+#define CRT_CORPC_AGG_BATCH	(32)
+
+/* aggregate child replies to the parent and release them */
+static void
+crt_corpc_aggregate(struct crt_rpc_priv *parent_rpc_priv,
+		    struct crt_rpc_priv **srcs, int nr)
 {
 	struct crt_corpc_info	*co_info;
-	uint32_t		 wait_num;
-	uint32_t		 done_num;
-	bool			 req_done = false;
+	struct crt_corpc_ops	*co_ops;
+	crt_rpc_t		*parent_rpc;
+	crt_rpc_t		*sources[CRT_CORPC_AGG_BATCH];
+	int			 start = 0;
+	int			 i, rc;
 
-	C_ASSERT(parent_rpc_priv != NULL);
+	C_ASSERT(nr > 0 && nr <= CRT_CORPC_AGG_BATCH);
 	co_info = parent_rpc_priv->crp_corpc_info;
-	C_ASSERT(co_info != NULL);
+	co_ops = parent_rpc_priv->crp_opc_info->coi_co_ops;
+	parent_rpc = &parent_rpc_priv->crp_pub;
+
+	if (co_ops == NULL)
+		goto bypass_aggregate;
+
+	if (co_info->co_root_excluded == 1 && co_info->co_child_ack_num == 0 &&
+	    parent_rpc->cr_output_size > 0) {
+		/* when root excluded, copy first reply's content to parent. */
+		memcpy(parent_rpc->cr_output, srcs[0]->crp_pub.cr_output,
+		       parent_rpc->cr_output_size);
+		start = 1;
+	}
+	for (i = start; i < nr; i++)
+		sources[i - start] = &srcs[i]->crp_pub;
+
+	if (nr == start)
+		goto bypass_aggregate;
+
+	if (co_ops->co_red_nr > 0)
+		crt_corpc_reduce(co_ops->co_reds, co_ops->co_red_nr, sources,
+				 nr - start, parent_rpc);
 
-	pthread_spin_lock(&parent_rpc_priv->crp_lock);
+	if (co_ops->co_aggregate_batch != NULL) {
+		rc = co_ops->co_aggregate_batch(sources, nr - start, parent_rpc,
+						co_info->co_priv);
+		if (rc != 0)
+			C_ERROR("co_ops->co_aggregate_batch failed, rc: %d, "
+				"opc: 0x%x.\n", rc, parent_rpc->cr_opc);
+	} else if (co_ops->co_aggregate != NULL) {
+		for (i = 0; i < nr - start; i++) {
+			rc = co_ops->co_aggregate(sources[i], parent_rpc,
+						  co_info->co_priv);
+			if (rc != 0)
+				C_ERROR("co_ops->co_aggregate failed, rc: %d, "
+					"opc: 0x%x.\n", rc, parent_rpc->cr_opc);
+		}
+	}
+
+bypass_aggregate:
+	co_info->co_child_ack_num += nr;
+	C_DEBUG("parent rpc %p, %d child rpcs aggregated, ack_num %d.\n",
+		parent_rpc_priv, nr, co_info->co_child_ack_num);
+	for (i = 0; i < nr; i++) {
+		/* decref corresponds to the addref in corpc_add_child_rpc */
+		rc = crt_req_decref(&srcs[i]->crp_pub);
+		if (rc != 0)
+			C_ERROR("crt_req_decref failed, opc: 0x%x.\n, rc: %d.",
+				srcs[i]->crp_pub.cr_opc, rc);
+	}
+}
+
+/*
+ * Account and aggregate everything pushed to the parent, until nothing is
+ * pending. Only one thread drains at a time so the aggregation runs without
+ * lock, the others pushing meanwhile are picked up by the next round.
+ */
+static void
+crt_corpc_reply_drain(struct crt_rpc_priv *parent_rpc_priv)
+{
+	struct crt_corpc_info	*co_info;
+	struct crt_rpc_priv	*srcs[CRT_CORPC_AGG_BATCH];
+	struct crt_rpc_priv	*head, *fifo, *item, *next, *tmp, *tmp_next;
+	uint32_t		 wait_num, done_num, units;
+	bool			 aggregate;
+	bool			 req_done = false;
+	int			 nr;
+
+	co_info = parent_rpc_priv->crp_corpc_info;
+	aggregate = (parent_rpc_priv->crp_opc_info->coi_co_ops != NULL);
 
 	wait_num = co_info->co_child_num;
 	/* the extra +1 is for local RPC handler */
 	if (co_info->co_root_excluded == 0)
 		wait_num++;
+	else
+		co_info->co_local_done = 1;
 
-	done_num = co_info->co_child_ack_num + co_info->co_child_failed_num;
-	done_num += failed_num;
-	C_ASSERT(done_num <= wait_num);
-	co_info->co_rc = failed_rc;
-	co_info->co_child_failed_num += failed_num;
-	if (wait_num == done_num)
-		req_done = true;
-	crt_corpc_fail_parent_rpc(parent_rpc_priv, failed_rc);
+	do {
+		head = __atomic_exchange_n(&co_info->co_reply_head, NULL,
+					   __ATOMIC_ACQUIRE);
+		units = __atomic_exchange_n(&co_info->co_fail_tokens, 0,
+					    __ATOMIC_ACQUIRE);
+
+		/* the stack is newest first, restore the order of arrival */
+		fifo = NULL;
+		while (head != NULL) {
+			next = head->crp_reply_next;
+			head->crp_reply_next = fifo;
+			fifo = head;
+			head = next;
+			units++;
+		}
+
+		nr = 0;
+		for (item = fifo; item != NULL; item = next) {
+			next = item->crp_reply_next;
+			item->crp_reply_next = NULL;
+
+			if (item == parent_rpc_priv) {
+				C_ASSERT(co_info->co_root_excluded == 0);
+				co_info->co_local_done = 1;
+				co_info->co_child_ack_num++;
+				/* aggregate previously replied RPCs */
+				crt_list_for_each_entry_safe(tmp, tmp_next,
+						&co_info->co_replied_rpcs,
+						crp_parent_link) {
+					crt_list_del_init(&tmp->crp_parent_link);
+					srcs[nr++] = tmp;
+					if (nr < CRT_CORPC_AGG_BATCH)
+						continue;
+					crt_corpc_aggregate(parent_rpc_priv,
+							    srcs, nr);
+					nr = 0;
+				}
+			} else if (aggregate && co_info->co_local_done == 0) {
+				crt_list_add_tail(&item->crp_parent_link,
+						  &co_info->co_replied_rpcs);
+				C_DEBUG("parent rpc %p, child rpc %p move to "
+					"replied rpcs.\n", parent_rpc_priv,
+					item);
+			} else {
+				srcs[nr++] = item;
+				if (nr < CRT_CORPC_AGG_BATCH)
+					continue;
+				crt_corpc_aggregate(parent_rpc_priv, srcs, nr);
+				nr = 0;
+			}
+		}
+		if (nr > 0)
+			crt_corpc_aggregate(parent_rpc_priv, srcs, nr);
+
+		done_num = co_info->co_child_ack_num +
+			   __atomic_load_n(&co_info->co_child_failed_num,
+					   __ATOMIC_ACQUIRE);
+		C_ASSERT(wait_num >= done_num);
+		if (wait_num == done_num)
+			req_done = true;
+		/*
+		 * units is zero when a pusher announced itself but did not
+		 * publish yet, it does right after.
+		 */
+	} while (units == 0 ||
+		 __atomic_sub_fetch(&co_info->co_reply_pending, units,
+				    __ATOMIC_ACQ_REL) != 0);
+
+	if (req_done)
+		crt_corpc_complete(parent_rpc_priv);
+}
+
+/*
+ * Hand a child reply, the local reply (child_rpc_priv == parent_rpc_priv) or
+ * a failure token (child_rpc_priv == NULL) over to the parent. The pusher
+ * finding nothing pending drains, so the callers never wait on each other.
+ */
+static void
+crt_corpc_reply_push(struct crt_rpc_priv *parent_rpc_priv,
+		     struct crt_rpc_priv *child_rpc_priv)
+{
+	struct crt_corpc_info	*co_info;
+	struct crt_rpc_priv	*head;
+	uint32_t		 pending;
+
+	co_info = parent_rpc_priv->crp_corpc_info;
+
+	pending = __atomic_fetch_add(&co_info->co_reply_pending, 1,
+				     __ATOMIC_ACQ_REL);
+	if (child_rpc_priv == NULL) {
+		__atomic_add_fetch(&co_info->co_fail_tokens, 1,
+				   __ATOMIC_RELEASE);
+	} else {
+		head = __atomic_load_n(&co_info->co_reply_head,
+				       __ATOMIC_RELAXED);
+		do {
+			child_rpc_priv->crp_reply_next = head;
+		} while (!__atomic_compare_exchange_n(&co_info->co_reply_head,
+				&head, child_rpc_priv, true /* weak */,
+				__ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+
+	if (pending == 0)
+		crt_corpc_reply_drain(parent_rpc_priv);
+}
+
+static inline void
+crt_corpc_fail_child_rpc(struct crt_rpc_priv *parent_rpc_priv,
+			 uint32_t failed_num, int failed_rc)
+{
+	struct crt_corpc_info	*co_info;
 
-	pthread_spin_unlock(&parent_rpc_priv->crp_lock);
+	C_ASSERT(parent_rpc_priv != NULL);
+	co_info = parent_rpc_priv->crp_corpc_info;
+	C_ASSERT(co_info != NULL);
 
-	if (req_done == true)
-		crt_rpc_complete(parent_rpc_priv, co_info->co_rc);
+	__atomic_store_n(&co_info->co_rc, failed_rc, __ATOMIC_RELEASE);
+	crt_corpc_fail_parent_rpc(parent_rpc_priv, failed_rc);
+	__atomic_add_fetch(&co_info->co_child_failed_num, failed_num,
+			   __ATOMIC_RELEASE);
+
+	crt_corpc_reply_push(parent_rpc_priv, NULL);
 }
 
 int
@@ -563,13 +1414,7 @@ crt_corpc_reply_hdlr(const struct crt_cb_info *cb_info)
 	struct crt_corpc_info	*co_info;
 	struct crt_rpc_priv	*child_rpc_priv;
 	crt_rpc_t		*child_req;
-	struct crt_opc_info	*opc_info;
-	struct crt_corpc_ops	*co_ops;
-	crt_rank_t		 myrank;
-	bool			 req_done = false;
-	bool			 am_root = false;
-	uint32_t		 wait_num, done_num;
-	int			 rc = 0;
+	int			 rc;
 
 	child_req = cb_info->cci_rpc;
 	parent_rpc_priv = (struct crt_rpc_priv *)cb_info->cci_arg;
@@ -578,154 +1423,33 @@ crt_corpc_reply_hdlr(const struct crt_cb_info *cb_info)
 	co_info = parent_rpc_priv->crp_corpc_info;
 	C_ASSERT(co_info != NULL);
 	C_ASSERT(parent_rpc_priv->crp_pub.cr_opc == child_req->cr_opc);
-	opc_info = parent_rpc_priv->crp_opc_info;
-	C_ASSERT(opc_info != NULL);
-
-	pthread_spin_lock(&parent_rpc_priv->crp_lock);
-
-	wait_num = co_info->co_child_num;
-	/* the extra +1 is for local RPC handler */
-	if (co_info->co_root_excluded == 0) {
-		wait_num++;
-	} else {
-		C_ASSERT(parent_rpc_priv != child_rpc_priv);
-		co_info->co_local_done = 1;
-	}
+	C_ASSERT(parent_rpc_priv->crp_opc_info != NULL);
+	C_ASSERT(co_info->co_root_excluded == 0 ||
+		 parent_rpc_priv != child_rpc_priv);
 
 	rc = cb_info->cci_rc;
 	if (rc != 0) {
 		C_ERROR("RPC(opc: 0x%x) error, rc: %d.\n",
 			child_req->cr_opc, rc);
-		co_info->co_rc = rc;
+		__atomic_store_n(&co_info->co_rc, rc, __ATOMIC_RELEASE);
 	}
 	/* propagate failure rc to parent */
-	if (child_rpc_priv->crp_reply_hdr.cch_co_rc != 0)
+	if (child_rpc_priv != parent_rpc_priv &&
+	    child_rpc_priv->crp_reply_hdr.cch_co_rc != 0)
 		crt_corpc_fail_parent_rpc(parent_rpc_priv,
 			child_rpc_priv->crp_reply_hdr.cch_co_rc);
 
-	co_ops = opc_info->coi_co_ops;
-	if (co_ops == NULL) {
-		co_info->co_child_ack_num++;
-		if (parent_rpc_priv != child_rpc_priv)
-			corpc_del_child_rpc_locked(parent_rpc_priv,
-						   child_rpc_priv);
-		goto bypass_aggregate;
-	}
-
-	if (parent_rpc_priv == child_rpc_priv) {
-		struct crt_rpc_priv	*tmp_rpc_priv, *next;
+	/* the aggregation happens in whichever thread drains */
+	crt_corpc_reply_push(parent_rpc_priv, child_rpc_priv);
 
-		co_info->co_local_done = 1;
-		/* aggregate previously replied RPCs */
-		crt_list_for_each_entry_safe(tmp_rpc_priv, next,
-				&co_info->co_replied_rpcs, crp_parent_link) {
-			C_ASSERT(tmp_rpc_priv != parent_rpc_priv);
-			C_ASSERT(co_ops->co_aggregate != NULL);
-			rc = co_ops->co_aggregate(&tmp_rpc_priv->crp_pub,
-						  &parent_rpc_priv->crp_pub,
-						  co_info->co_priv);
-			if (rc != 0) {
-				C_ERROR("co_ops->co_aggregate failed, rc: %d, "
-					"opc: 0x%x.\n", rc, child_req->cr_opc);
-				rc = 0;
-			}
-			co_info->co_child_ack_num++;
-			C_DEBUG("parent rpc %p, child rpc %p, wait_num %d, "
-				"ack_num %d.\n", parent_rpc_priv,
-				child_rpc_priv, wait_num,
-				co_info->co_child_ack_num);
-			corpc_del_child_rpc_locked(parent_rpc_priv,
-						   tmp_rpc_priv);
-		}
-	}
-
-	/* reply aggregate */
-	if (co_info->co_local_done == 1) {
-		if (child_rpc_priv != parent_rpc_priv) {
-			if (co_info->co_root_excluded == 1 &&
-			    co_info->co_child_ack_num == 0 &&
-			    parent_rpc_priv->crp_pub.cr_output_size > 0) {
-				/*
-				 * when root excluded, copy first reply's
-				 * content to parent.
-				 */
-				memcpy(parent_rpc_priv->crp_pub.cr_output,
-				       child_rpc_priv->crp_pub.cr_output,
-				       parent_rpc_priv->crp_pub.cr_output_size);
-			} else {
-				C_ASSERT(co_ops->co_aggregate != NULL);
-				rc = co_ops->co_aggregate(child_req,
-					&parent_rpc_priv->crp_pub,
-					co_info->co_priv);
-				if (rc != 0) {
-					C_ERROR("co_ops->co_aggregate failed, "
-						"rc: %d, opc: 0x%x.\n",
-						rc, child_req->cr_opc);
-					rc = 0;
-				}
-			}
-		}
-		co_info->co_child_ack_num++;
-		C_DEBUG("parent rpc %p, child rpc %p, wait_num %d, "
-			"ack_num %d.\n", parent_rpc_priv, child_rpc_priv,
-			wait_num, co_info->co_child_ack_num);
-		if (parent_rpc_priv != child_rpc_priv)
-			corpc_del_child_rpc_locked(parent_rpc_priv,
-						   child_rpc_priv);
-	} else {
-		C_ASSERT(wait_num > co_info->co_child_ack_num);
-		crt_list_move_tail(&child_rpc_priv->crp_parent_link,
-				   &co_info->co_replied_rpcs);
-		C_DEBUG("parent rpc %p, child rpc %p move to replided rpcs.\n",
-			parent_rpc_priv, child_rpc_priv);
-	}
-
-bypass_aggregate:
-	done_num = co_info->co_child_ack_num + co_info->co_child_failed_num;
-	C_ASSERT(wait_num >= done_num);
-	if (wait_num == done_num)
-		req_done = true;
-
-	pthread_spin_unlock(&parent_rpc_priv->crp_lock);
-
-	if (req_done == false)
-		C_GOTO(out, rc);
-
-	/* corpc handling finished on this node */
-	myrank = co_info->co_grp_priv->gp_self;
-	am_root = (myrank == co_info->co_root);
-	if (am_root) {
-		crt_rpc_complete(parent_rpc_priv, co_info->co_rc);
-	} else {
-		if (co_info->co_rc != 0)
-			crt_corpc_fail_parent_rpc(parent_rpc_priv,
-						  co_info->co_rc);
-		rc = crt_hg_reply_send(parent_rpc_priv);
-		if (rc != 0)
-			C_ERROR("crt_hg_reply_send failed, rc: %d,opc: 0x%x.\n",
-				rc, parent_rpc_priv->crp_pub.cr_opc);
-		/*
-		 * on root node, don't need to free chained bulk handle as it is
-		 * created and passed in by user.
-		 */
-		rc = crt_corpc_free_chained_bulk(
-			parent_rpc_priv->crp_coreq_hdr.coh_bulk_hdl);
-		if (rc != 0)
-			C_ERROR("crt_corpc_free_chainded_bulk failed, rc: %d, "
-				"opc: 0x%x.\n", rc,
-				parent_rpc_priv->crp_pub.cr_opc);
-	}
-	/* correspond to addref in crt_reply_send */
-	crt_req_decref(&parent_rpc_priv->crp_pub);
-
-out:
-	return rc;
+	return 0;
 }
 
 int
 crt_corpc_req_hdlr(crt_rpc_t *req)
 {
 	struct crt_corpc_info	*co_info;
+	struct crt_tree_children *children = NULL;
 	crt_rank_list_t		*children_rank_list = NULL;
 	crt_rank_t		 grp_rank;
 	struct crt_rpc_priv	*rpc_priv, *child_rpc_priv;
@@ -743,16 +1467,22 @@ crt_corpc_req_hdlr(crt_rpc_t *req)
 	grp_rank = co_info->co_grp_priv->gp_self;
 	am_root = (grp_rank == co_info->co_root);
 
-	/* corresponds to decref in crt_corpc_reply_hdlr */
+	/* corresponds to decref in crt_corpc_complete */
+	crt_req_addref(&rpc_priv->crp_pub);
+	/*
+	 * the children may all reply and complete the corpc in another thread
+	 * before the forwarding returns, keep the RPC until then.
+	 */
 	crt_req_addref(&rpc_priv->crp_pub);
 
-	rc = crt_tree_get_children(co_info->co_grp_priv, co_info->co_grp_ver,
-				   co_info->co_excluded_ranks,
-				   co_info->co_tree_topo, co_info->co_root,
-				   co_info->co_grp_priv->gp_self,
-				   &children_rank_list);
+	rc = crt_tree_children_lookup(co_info->co_grp_priv,
+				      co_info->co_grp_ver,
+				      co_info->co_excluded_ranks,
+				      co_info->co_tree_topo, co_info->co_root,
+				      co_info->co_grp_priv->gp_self,
+				      &children);
 	if (rc != 0) {
-		C_ERROR("crt_tree_get_children(group %s, opc 0x%x) failed, "
+		C_ERROR("crt_tree_children_lookup(group %s, opc 0x%x) failed, "
 			"rc: %d.\n", co_info->co_grp_priv->gp_pub.cg_grpid,
 			req->cr_opc, rc);
 		crt_corpc_fail_parent_rpc(rpc_priv, rc);
@@ -760,6 +1490,7 @@ crt_corpc_req_hdlr(crt_rpc_t *req)
 		C_GOTO(forward_failed, rc);
 	}
 
+	children_rank_list = children->tc_children;
 	co_info->co_child_num = (children_rank_list == NULL) ? 0 :
 				children_rank_list->rl_nr.num;
 	co_info->co_child_ack_num = 0;
@@ -768,6 +1499,45 @@ crt_corpc_req_hdlr(crt_rpc_t *req)
 		co_info->co_grp_priv->gp_pub.cg_grpid, grp_rank,
 		co_info->co_child_num);
 
+	/* the bulk is here already, let the children pipeline pulling it */
+	if (co_info->co_pipe == NULL && co_info->co_child_num > 0 &&
+	    req->cr_co_bulk_hdl != CRT_BULK_NULL &&
+	    crt_gdata.cg_corpc_chunk_size > 0) {
+		crt_size_t	bulk_len = 0;
+
+		rc = crt_bulk_get_len(req->cr_co_bulk_hdl, &bulk_len);
+		if (rc == 0 && bulk_len > crt_gdata.cg_corpc_chunk_size)
+			rc = crt_corpc_pipe_create(rpc_priv, req->cr_co_bulk_hdl,
+						   bulk_len, CRT_BULK_NULL,
+						   &co_info->co_pipe);
+		/* not fatal, the children pull the bulk at once */
+		if (rc != 0)
+			C_ERROR("cannot pipeline the bulk, rc: %d, "
+				"opc: 0x%x.\n", rc, req->cr_opc);
+		rc = 0;
+	}
+
+	/*
+	 * encode the input once for all children if not received encoded, the
+	 * root or without CRT_HG_LOWLEVEL_UNPACK.
+	 */
+	if (co_info->co_child_num > 1 && rpc_priv->crp_co_body == NULL &&
+	    req->cr_input != NULL) {
+		crt_size_t	body_len;
+
+		rc = crt_proc_input_encode(rpc_priv, &co_info->co_body,
+					   &co_info->co_body_size, &body_len);
+		if (rc == 0) {
+			rpc_priv->crp_co_body = co_info->co_body;
+			rpc_priv->crp_co_body_len = body_len;
+		} else {
+			/* not fatal, encoded per child then */
+			C_ERROR("crt_proc_input_encode failed, rc: %d, "
+				"opc: 0x%x.\n", rc, req->cr_opc);
+			rc = 0;
+		}
+	}
+
 	/* firstly forward RPC to children if any */
 	for (i = 0; i < co_info->co_child_num; i++) {
 		crt_rpc_t	*child_rpc;
@@ -799,7 +1569,8 @@ crt_corpc_req_hdlr(crt_rpc_t *req)
 		if (rc != 0) {
 			C_ERROR("crt_req_send(opc: 0x%x) failed, tgt_ep: %d, "
 				"rc: %d.\n", req->cr_opc, tgt_ep.ep_rank, rc);
-			corpc_del_child_rpc(rpc_priv, child_rpc_priv);
+			/* roll back the addref in corpc_add_child_rpc */
+			crt_req_decref(child_rpc);
 			crt_corpc_fail_child_rpc(rpc_priv,
 				co_info->co_child_num - i, rc);
 			C_GOTO(forward_failed, rc);
@@ -808,19 +1579,27 @@ crt_corpc_req_hdlr(crt_rpc_t *req)
 	}
 
 forward_failed:
+	crt_tree_children_decref(co_info->co_grp_priv, children);
 	if (am_root && (get_children_failed ||
 		(co_info->co_child_num > 0 && child_req_sent == false) ||
 		(co_info->co_child_num == 0 && co_info->co_root_excluded))) {
 		C_ASSERT(rc != 0);
 		C_ERROR("rpc: 0x%x failed, rc: %d.\n", req->cr_opc, rc);
-		crt_rpc_complete(rpc_priv, rc);
-		/* roll back the add ref above */
-		crt_req_decref(&rpc_priv->crp_pub);
+		/* unless the drainer did, when all children failed */
+		if (crt_corpc_claim_done(co_info)) {
+			crt_rpc_complete(rpc_priv, rc);
+			/* roll back the add ref above */
+			crt_req_decref(&rpc_priv->crp_pub);
+		}
 		C_GOTO(out, rc);
 	}
 
 	/* invoke RPC handler on local node */
 	if (co_info->co_root_excluded == 0) {
+		/* invoked in crt_corpc_pipe_get_cb once the bulk landed */
+		if (co_info->co_pipe != NULL &&
+		    crt_corpc_pipe_defer_hdlr(co_info->co_pipe))
+			C_GOTO(out, rc = 0);
 		rc = crt_rpc_common_hdlr(rpc_priv);
 		if (rc != 0)
 			C_ERROR("crt_rpc_common_hdlr (opc: 0x%x) failed, "
@@ -828,5 +1607,6 @@ forward_failed:
 	}
 
 out:
+	crt_req_decref(&rpc_priv->crp_pub);
 	return rc;
 }
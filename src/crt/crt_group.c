@@ -39,6 +39,9 @@
  * This file is part of CaRT. It implements the main group APIs.
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <crt_internal.h>
 
 /* global CRT group list */
@@ -46,116 +49,145 @@ CRT_LIST_HEAD(crt_grp_list);
 /* protect global group list */
 pthread_rwlock_t crt_grp_list_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 
-static void crt_li_destroy(struct crt_lookup_item *li);
-
-static struct crt_lookup_item *
-li_link2ptr(crt_list_t *rlink)
+static inline uint32_t
+crt_lc_roundup(uint32_t num)
 {
-	C_ASSERT(rlink != NULL);
-	return container_of(rlink, struct crt_lookup_item, li_link);
+	uint32_t	pow2 = 1;
+
+	while (pow2 < num)
+		pow2 <<= 1;
+	return pow2;
 }
 
-static int
-li_op_key_get(struct chash_table *hhtab, crt_list_t *rlink, void **key_pp)
+/* LRU nodes of the slots, follow the slots when the cache is capped */
+static inline struct crt_lc_lru **
+crt_lc_addrs_lru(struct crt_lc_addrs *addrs)
 {
-	struct crt_lookup_item *li = li_link2ptr(rlink);
-
-	*key_pp = (void *)&li->li_rank;
-	return sizeof(li->li_rank);
+	return (struct crt_lc_lru **)&addrs->la_addr[addrs->la_ctx_num *
+						     addrs->la_tag_num];
 }
 
-static uint32_t
-li_op_key_hash(struct chash_table *hhtab, const void *key, unsigned int ksize)
+static inline size_t
+crt_lc_addrs_size(struct crt_grp_priv *grp_priv, uint32_t ctx_num,
+		  uint32_t tag_num)
 {
-	C_ASSERT(ksize == sizeof(crt_rank_t));
+	size_t	slot_size = sizeof(na_addr_t);
 
-	return (unsigned int)(*(const uint32_t *)key %
-		(1U << CRT_LOOKUP_CACHE_BITS));
+	if (grp_priv->gp_lc_addr_max != 0)
+		slot_size += sizeof(struct crt_lc_lru *);
+	return sizeof(struct crt_lc_addrs) + ctx_num * tag_num * slot_size;
 }
 
-static bool
-li_op_key_cmp(struct chash_table *hhtab, crt_list_t *rlink,
-	  const void *key, unsigned int ksize)
+/* slot of (\a ctx_idx, \a tag), NULL if \a addrs does not cover it */
+static inline na_addr_t *
+crt_lc_addrs_slot(struct crt_lc_addrs *addrs, int ctx_idx, uint32_t tag)
 {
-	struct crt_lookup_item *li = li_link2ptr(rlink);
-
-	C_ASSERT(ksize == sizeof(crt_rank_t));
-
-	return li->li_rank == *(crt_rank_t *)key;
+	if (addrs == NULL || ctx_idx >= addrs->la_ctx_num ||
+	    tag >= addrs->la_tag_num)
+		return NULL;
+	return &addrs->la_addr[ctx_idx * addrs->la_tag_num + tag];
 }
 
 static void
-li_op_rec_addref(struct chash_table *hhtab, crt_list_t *rlink)
+crt_lc_addrs_free(struct crt_grp_priv *grp_priv, struct crt_lc_addrs *addrs)
 {
-	struct crt_lookup_item *li = li_link2ptr(rlink);
+	struct crt_lc_addrs	*prev;
 
-	C_ASSERT(li->li_initialized);
-	pthread_mutex_lock(&li->li_mutex);
-	li_link2ptr(rlink)->li_ref++;
-	pthread_mutex_unlock(&li->li_mutex);
+	while (addrs != NULL) {
+		prev = addrs->la_prev;
+		C_FREE(addrs, crt_lc_addrs_size(grp_priv, addrs->la_ctx_num,
+						 addrs->la_tag_num));
+		addrs = prev;
+	}
 }
 
-static bool
-li_op_rec_decref(struct chash_table *hhtab, crt_list_t *rlink)
+/*
+ * grow the address slots of \a li to cover (\a ctx_idx, \a tag), with
+ * gp_lc_mutex held. The replaced array is kept in la_prev as lock-free
+ * readers may still use it.
+ */
+static int
+crt_lc_addrs_grow(struct crt_grp_priv *grp_priv, struct crt_lookup_item *li,
+		  int ctx_idx, uint32_t tag)
 {
-	struct crt_lookup_item *li = li_link2ptr(rlink);
+	struct crt_lc_addrs	*old = li->li_addrs;
+	struct crt_lc_addrs	*addrs;
+	uint32_t		 ctx_num, tag_num;
+	uint32_t		 i, j;
+
+	ctx_num = crt_lc_roundup(ctx_idx + 1);
+	tag_num = max(crt_lc_roundup(tag + 1), CRT_LC_TAG_NUM_MIN);
+	if (old != NULL) {
+		ctx_num = max(ctx_num, old->la_ctx_num);
+		tag_num = max(tag_num, old->la_tag_num);
+	}
+
+	C_ALLOC(addrs, crt_lc_addrs_size(grp_priv, ctx_num, tag_num));
+	if (addrs == NULL)
+		return -CER_NOMEM;
+	addrs->la_ctx_num = ctx_num;
+	addrs->la_tag_num = tag_num;
+	addrs->la_prev = old;
+	for (i = 0; old != NULL && i < old->la_ctx_num; i++) {
+		for (j = 0; j < old->la_tag_num; j++) {
+			addrs->la_addr[i * tag_num + j] =
+				old->la_addr[i * old->la_tag_num + j];
+			if (grp_priv->gp_lc_addr_max != 0)
+				crt_lc_addrs_lru(addrs)[i * tag_num + j] =
+				crt_lc_addrs_lru(old)[i * old->la_tag_num + j];
+		}
+	}
+	__atomic_store_n(&li->li_addrs, addrs, __ATOMIC_RELEASE);
 
-	li->li_ref--;
-	return li->li_ref == 0;
+	return 0;
 }
 
-static void
-li_op_rec_free(struct chash_table *hhtab, crt_list_t *rlink)
+static hg_class_t *
+crt_lc_hg_class(int ctx_idx)
 {
-	crt_li_destroy(li_link2ptr(rlink));
-}
+	struct crt_context	*ctx;
 
-static chash_table_ops_t lookup_table_ops = {
-	.hop_key_get		= li_op_key_get,
-	.hop_key_hash		= li_op_key_hash,
-	.hop_key_cmp		= li_op_key_cmp,
-	.hop_rec_addref		= li_op_rec_addref,
-	.hop_rec_decref		= li_op_rec_decref,
-	.hop_rec_free		= li_op_rec_free,
-};
+	ctx = crt_context_lookup(ctx_idx);
+	C_ASSERT(ctx != NULL);
+	return ctx->cc_hg_ctx.chc_hgcla;
+}
 
+/* free the least recently used address, with gp_lc_mutex held */
 static void
-crt_li_destroy(struct crt_lookup_item *li)
+crt_lc_addr_evict(struct crt_grp_priv *grp_priv)
 {
-	C_ASSERT(li != NULL);
-
-	C_ASSERT(li->li_ref == 0);
-	C_ASSERT(li->li_initialized == 1);
-
-	C_ASSERT(li->li_base_phy_addr != NULL);
-	free(li->li_base_phy_addr);
-
-	/*
-	struct crt_context	*ctx;
-	hg_return_t		hg_ret;
-	int			i;
-
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		if (li->li_tag_addr[i] == NULL)
-			continue;
-		ctx = li->li_grp_priv->gp_ctx;
-		hg_ret = HG_Addr_free(ctx->dc_hg_ctx.chc_hgcla,
-				      li->li_tag_addr[i]);
-		if (hg_ret != HG_SUCCESS)
-			C_ERROR("HG_Addr_free failed, hg_ret: %d.\n", hg_ret);
-	}
-	*/
-
-	pthread_mutex_destroy(&li->li_mutex);
-
-	C_FREE_PTR(li);
+	struct crt_lc_lru	*node;
+	struct crt_lc_addrs	*addrs;
+	na_addr_t		*slot;
+	na_addr_t		 addr;
+	hg_return_t		 hg_ret;
+
+	C_ASSERT(!crt_list_empty(&grp_priv->gp_lc_lru));
+	node = crt_list_entry(grp_priv->gp_lc_lru.next, struct crt_lc_lru,
+			      ll_link);
+	addrs = grp_priv->gp_lookup_cache[node->ll_rank].li_addrs;
+	slot = crt_lc_addrs_slot(addrs, node->ll_ctx_idx, node->ll_tag);
+	C_ASSERT(slot != NULL && *slot != NULL);
+
+	addr = *slot;
+	__atomic_store_n(slot, NULL, __ATOMIC_RELEASE);
+	crt_lc_addrs_lru(addrs)[slot - addrs->la_addr] = NULL;
+	/* requests using it hold their own references */
+	hg_ret = HG_Addr_free(crt_lc_hg_class(node->ll_ctx_idx), addr);
+	if (hg_ret != HG_SUCCESS)
+		C_ERROR("HG_Addr_free failed, hg_ret: %d.\n", hg_ret);
+
+	crt_list_del(&node->ll_link);
+	C_FREE_PTR(node);
+	grp_priv->gp_lc_addr_num--;
 }
 
 static int
 crt_grp_lc_create(struct crt_grp_priv *grp_priv)
 {
-	struct chash_table	**htables;
-	int			  rc, i;
+	struct crt_lookup_item	*cache;
+	crt_rank_t		 i;
+	int			 rc = 0;
 
 	C_ASSERT(grp_priv != NULL);
 	if (grp_priv->gp_primary == 0) {
@@ -163,21 +195,28 @@ crt_grp_lc_create(struct crt_grp_priv *grp_priv)
 		C_GOTO(out, rc = -CER_NO_PERM);
 	}
 
-	C_ALLOC(htables, CRT_SRV_CONTEXT_NUM * sizeof(struct chash_table *));
-	if (htables == NULL)
+	C_ALLOC(cache, grp_priv->gp_size * sizeof(struct crt_lookup_item));
+	if (cache == NULL)
 		C_GOTO(out, rc = -CER_NOMEM);
 
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		rc = chash_table_create(DHASH_FT_NOLOCK, CRT_LOOKUP_CACHE_BITS,
-					NULL, &lookup_table_ops, &htables[i]);
-		if (rc != 0) {
-			C_ERROR("chash_table_create_inplace failed, rc: %d.\n",
-				rc);
-			C_GOTO(out, rc);
-		}
-		C_ASSERT(htables[i] != NULL);
-	}
-	grp_priv->gp_lookup_cache = htables;
+	grp_priv->gp_lc_addr_max = 0;
+	crt_getenv_int(CRT_LC_ADDR_MAX_ENV, &grp_priv->gp_lc_addr_max);
+	grp_priv->gp_lc_addr_num = 0;
+	CRT_INIT_LIST_HEAD(&grp_priv->gp_lc_lru);
+	pthread_mutex_init(&grp_priv->gp_lc_mutex, NULL);
+	grp_priv->gp_uri_fetch_max = CRT_URI_FETCH_MAX_DEFAULT;
+	crt_getenv_int(CRT_URI_FETCH_MAX_ENV, &grp_priv->gp_uri_fetch_max);
+	CRT_INIT_LIST_HEAD(&grp_priv->gp_uri_waiters);
+	grp_priv->gp_uri_fetching = 0;
+	grp_priv->gp_uri_table_asked = 0;
+	/* URI slots of the mapped attach info file, not touched until used */
+	if (grp_priv->gp_attach_info != NULL) {
+		for (i = 0; i < grp_priv->gp_size; i++)
+			cache[i].li_base_phy_addr =
+				crt_attach_info_uri(grp_priv->gp_attach_info,
+						    i);
+	}
+	grp_priv->gp_lookup_cache = cache;
 
 out:
 	if (rc != 0)
@@ -185,219 +224,1139 @@ out:
 	return rc;
 }
 
+/* whether \a uri is a slot of the mapped attach info file */
+static inline bool
+crt_grp_attach_info_uri(struct crt_grp_priv *grp_priv, char *uri)
+{
+	char	*base = (char *)grp_priv->gp_attach_info;
+
+	return base != NULL && uri >= base &&
+	       uri < base + grp_priv->gp_attach_info_len;
+}
+
 static int
 crt_grp_lc_destroy(struct crt_grp_priv *grp_priv)
 {
-	int	rc, i;
+	struct crt_lookup_item	*li;
+	struct crt_lc_lru	*node, *next;
+	uint32_t		 i;
 
 	C_ASSERT(grp_priv != NULL);
 
 	if (grp_priv->gp_lookup_cache == NULL)
 		return 0;
 
-	for (i = 0; i < CRT_SRV_CONTEXT_NUM; i++) {
-		rc = chash_table_destroy(grp_priv->gp_lookup_cache[i],
-					 true /* force */);
-		if (rc != 0) {
-			C_ERROR("chash_table_destroy_inplace failed, rc: %d.\n",
-				rc);
-			C_GOTO(out, rc);
+	/*
+	 * the connected HG addrs are not freed, as the HG classes may be
+	 * finalized already.
+	 */
+	for (i = 0; i < grp_priv->gp_size; i++) {
+		li = &grp_priv->gp_lookup_cache[i];
+		if (li->li_base_phy_addr != NULL &&
+		    !crt_grp_attach_info_uri(grp_priv, li->li_base_phy_addr))
+			free(li->li_base_phy_addr);
+		crt_lc_addrs_free(grp_priv, li->li_addrs);
+	}
+	crt_list_for_each_entry_safe(node, next, &grp_priv->gp_lc_lru,
+				     ll_link) {
+		crt_list_del(&node->ll_link);
+		C_FREE_PTR(node);
+	}
+	pthread_mutex_destroy(&grp_priv->gp_lc_mutex);
+	C_FREE(grp_priv->gp_lookup_cache,
+	       grp_priv->gp_size * sizeof(struct crt_lookup_item));
+
+	return 0;
+}
+
+/* free the addresses \a ctx connected to in the lookup cache of \a grp_priv */
+static void
+crt_grp_lc_ctx_purge_grp(struct crt_grp_priv *grp_priv,
+			 struct crt_context *ctx)
+{
+	struct crt_lc_addrs	*addrs;
+	struct crt_lc_lru	*node;
+	na_addr_t		*slot;
+	hg_return_t		 hg_ret;
+	crt_rank_t		 rank;
+	uint32_t		 tag;
+
+	if (grp_priv == NULL || grp_priv->gp_lookup_cache == NULL)
+		return;
+
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	for (rank = 0; rank < grp_priv->gp_size; rank++) {
+		addrs = grp_priv->gp_lookup_cache[rank].li_addrs;
+		for (tag = 0; addrs != NULL && tag < addrs->la_tag_num;
+		     tag++) {
+			slot = crt_lc_addrs_slot(addrs, ctx->cc_idx, tag);
+			if (slot == NULL || *slot == NULL)
+				continue;
+			hg_ret = HG_Addr_free(ctx->cc_hg_ctx.chc_hgcla, *slot);
+			if (hg_ret != HG_SUCCESS)
+				C_ERROR("HG_Addr_free failed, hg_ret: %d.\n",
+					hg_ret);
+			__atomic_store_n(slot, NULL, __ATOMIC_RELEASE);
+			if (grp_priv->gp_lc_addr_max == 0)
+				continue;
+			node = crt_lc_addrs_lru(addrs)[slot - addrs->la_addr];
+			crt_lc_addrs_lru(addrs)[slot - addrs->la_addr] = NULL;
+			crt_list_del(&node->ll_link);
+			C_FREE_PTR(node);
+			grp_priv->gp_lc_addr_num--;
 		}
 	}
-	C_FREE(grp_priv->gp_lookup_cache,
-	       CRT_SRV_CONTEXT_NUM * sizeof(struct chash_table *));
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+}
 
-out:
-	return rc;
+/*
+ * free the cached addresses of \a ctx before its HG class goes away, so the
+ * eviction never meets them and a later context of the same index starts
+ * with an empty cache.
+ */
+void
+crt_grp_lc_ctx_purge(struct crt_context *ctx)
+{
+	struct crt_grp_gdata	*grp_gdata = crt_gdata.cg_grp;
+	struct crt_grp_priv	*grp_priv;
+
+	if (grp_gdata == NULL)
+		return;
+
+	crt_grp_lc_ctx_purge_grp(grp_gdata->gg_cli_pri_grp, ctx);
+	crt_grp_lc_ctx_purge_grp(grp_gdata->gg_srv_pri_grp, ctx);
+	pthread_rwlock_rdlock(&grp_gdata->gg_rwlock);
+	crt_list_for_each_entry(grp_priv, &grp_gdata->gg_srv_grps_attached,
+				gp_link)
+		crt_grp_lc_ctx_purge_grp(grp_priv, ctx);
+	pthread_rwlock_unlock(&grp_gdata->gg_rwlock);
 }
 
+/* calculate the URI of \a tag, it listens on the base port plus the tag */
 static int
-crt_conn_tag(struct crt_hg_context *hg_ctx, crt_phy_addr_t base_addr,
-	     uint32_t tag, na_addr_t *na_addr)
-{
-	hg_class_t	*hg_class;
-	hg_context_t	*hg_context;
-	hg_addr_t	tmp_addr;
-	uint32_t	ctx_idx;
-	char		*tmp_addrstr;
-	bool		allocated = false;
+crt_grp_tag_uri(crt_phy_addr_t base_addr, uint32_t tag, char *uri)
+{
 	char		*pchar;
 	int		port;
-	int		rc = 0;
+
+	C_ASSERT(base_addr != NULL && strlen(base_addr) > 0);
+	C_ASSERT(uri != NULL);
 
 	if (tag >= CRT_SRV_CONTEXT_NUM) {
 		C_ERROR("invalid tag %d (CRT_SRV_CONTEXT_NUM %d).\n",
 			tag, CRT_SRV_CONTEXT_NUM);
-		C_GOTO(out, rc = -CER_INVAL);
+		return -CER_INVAL;
 	}
 
-	C_ASSERT(hg_ctx != NULL);
-	C_ASSERT(base_addr != NULL && strlen(base_addr) > 0);
-	C_ASSERT(na_addr != NULL);
+	strncpy(uri, base_addr, CRT_ADDR_STR_MAX_LEN - 1);
+	uri[CRT_ADDR_STR_MAX_LEN - 1] = '\0';
+	if (tag == 0)
+		return 0;
 
-	hg_class = hg_ctx->chc_hgcla;
-	hg_context = hg_ctx->chc_hgctx;
-	C_ASSERT(hg_class != NULL);
-	C_ASSERT(hg_context != NULL);
+	pchar = strrchr(uri, ':');
+	if (pchar == NULL) {
+		C_ERROR("bad format of base_addr %s.\n", uri);
+		return -CER_INVAL;
+	}
+	pchar++;
+	port = atoi(pchar);
+	port += tag;
+	snprintf(pchar, 16, "%d", port);
+	C_DEBUG("base uri(%s), tag(%d) uri(%s).\n", base_addr, tag, uri);
 
-	ctx_idx = tag;
-	if (ctx_idx == 0) {
-		tmp_addrstr = base_addr;
-	} else {
-		C_ALLOC(tmp_addrstr, CRT_ADDR_STR_MAX_LEN);
-		if (tmp_addrstr == NULL)
-			C_GOTO(out, rc = -CER_NOMEM);
-		allocated = true;
-		/* calculate the ctx_idx's listening address and connect */
-		strncpy(tmp_addrstr, base_addr, CRT_ADDR_STR_MAX_LEN);
-		pchar = strrchr(tmp_addrstr, ':');
-		if (pchar == NULL) {
-			C_ERROR("bad format of base_addr %s.\n", tmp_addrstr);
-			C_GOTO(out, rc = -CER_INVAL);
-		}
-		pchar++;
-		port = atoi(pchar);
-		port += ctx_idx;
-		snprintf(pchar, 16, "%d", port);
-		C_DEBUG("base uri(%s), tag(%d) uri(%s).\n",
-			base_addr, tag, tmp_addrstr);
+	return 0;
+}
+
+/*
+ * cache the base URI of \a rank, shared by all contexts. The cache takes over
+ * \a uri (allocated by malloc), or frees it if the rank is already cached.
+ */
+static void
+crt_grp_lc_uri_insert(struct crt_grp_priv *grp_priv, crt_rank_t rank,
+		      char *uri)
+{
+	struct crt_lookup_item	*li = &grp_priv->gp_lookup_cache[rank];
+
+	C_ASSERT(uri != NULL);
+
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	if (li->li_base_phy_addr == NULL) {
+		__atomic_store_n(&li->li_base_phy_addr, uri, __ATOMIC_RELEASE);
+		uri = NULL;
 	}
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
 
-	rc = crt_hg_addr_lookup_wait(hg_class, hg_context, tmp_addrstr,
-				     &tmp_addr);
-	if (rc == 0) {
-		C_DEBUG("Connect to %s succeed.\n", tmp_addrstr);
-		C_ASSERT(tmp_addr != NULL);
-		*na_addr = tmp_addr;
-	} else {
-		C_ERROR("Could not connect to %s, rc: %d.\n", tmp_addrstr, rc);
-		C_GOTO(out, rc);
+	/* race condition, the other one wins */
+	if (uri != NULL)
+		free(uri);
+}
+
+/* lookup the base URI of \a rank, lookup it through PMIx or PSR if not cached */
+int
+crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, crt_rank_t rank,
+		  crt_phy_addr_t *base_addr)
+{
+	struct crt_lookup_item	*li;
+	char			*uri;
+	int			rc = 0;
+
+	C_ASSERT(grp_priv != NULL);
+	C_ASSERT(grp_priv->gp_primary != 0);
+	C_ASSERT(rank < grp_priv->gp_size);
+	C_ASSERT(base_addr != NULL);
+
+	li = &grp_priv->gp_lookup_cache[rank];
+	uri = __atomic_load_n(&li->li_base_phy_addr, __ATOMIC_ACQUIRE);
+	if (uri == NULL) {
+		rc = crt_grp_uri_lookup(grp_priv, rank, &uri);
+		if (rc != 0) {
+			C_ERROR("crt_grp_uri_lookup failed, rc: %d.\n", rc);
+			C_GOTO(out, rc);
+		}
+		C_ASSERT(uri != NULL);
+		crt_grp_lc_uri_insert(grp_priv, rank, uri);
+		uri = __atomic_load_n(&li->li_base_phy_addr, __ATOMIC_ACQUIRE);
 	}
+	C_ASSERT(uri != NULL && strlen(uri) > 0);
+	*base_addr = uri;
 
 out:
-	if (allocated)
-		C_FREE(tmp_addrstr, CRT_ADDR_STR_MAX_LEN);
-	if (rc != 0)
-		C_ERROR("crt_conn_tag (base_addr %s, tag %d) failed, rc: %d.\n",
-			base_addr, tag, rc);
 	return rc;
 }
 
 /*
- * lookup addr cache.
- * if (na_addr == NULL) then means caller only want to lookup the base_addr, or
- * will establish the connection and return the connect addr to na_addr.
+ * Non-blocking lookup of the connected address of (\a rank, \a tag) in the
+ * cache of \a ctx_idx. Returns zero with \a na_addr set (if not NULL), or
+ * -CER_AGAIN if it is not connected yet, in which case \a base_addr (if not
+ * NULL) is set to the cached base URI, or to NULL when the URI itself is not
+ * known yet.
+ *
+ * If the cache is capped (gp_lc_addr_max != 0), the address may be evicted
+ * any time, so \a na_addr is a new reference to release by HG_Addr_free.
  */
 int
-crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, int ctx_idx,
-		  struct crt_hg_context *hg_ctx, crt_rank_t rank, uint32_t tag,
-		  crt_phy_addr_t *base_addr, na_addr_t *na_addr)
+crt_grp_lc_addr_get(struct crt_grp_priv *grp_priv, int ctx_idx,
+		    crt_rank_t rank, uint32_t tag, crt_phy_addr_t *base_addr,
+		    na_addr_t *na_addr)
 {
 	struct crt_lookup_item	*li;
-	bool			found = false;
-	crt_list_t		*rlink;
-	int			rc = 0;
+	struct crt_lc_addrs	*addrs;
+	struct crt_lc_lru	*node;
+	na_addr_t		*slot;
+	na_addr_t		 addr = NULL;
+	hg_return_t		 hg_ret;
+	int			 rc = 0;
 
 	C_ASSERT(grp_priv != NULL);
 	C_ASSERT(grp_priv->gp_primary != 0);
 	C_ASSERT(rank < grp_priv->gp_size);
 	C_ASSERT(tag < CRT_SRV_CONTEXT_NUM);
-	C_ASSERT(base_addr != NULL || na_addr != NULL);
-	if (na_addr != NULL)
-		C_ASSERT(hg_ctx != NULL);
 	C_ASSERT(ctx_idx >= 0 && ctx_idx < CRT_SRV_CONTEXT_NUM);
 
-lookup_again:
-	pthread_rwlock_rdlock(&grp_priv->gp_rwlock);
-	rlink = chash_rec_find(grp_priv->gp_lookup_cache[ctx_idx],
-			       (void *)&rank, sizeof(rank));
-	if (rlink != NULL) {
-		li = li_link2ptr(rlink);
-		C_ASSERT(li->li_grp_priv == grp_priv);
-		C_ASSERT(li->li_rank == rank);
-		C_ASSERT(li->li_base_phy_addr != NULL &&
-			 strlen(li->li_base_phy_addr) > 0);
-		C_ASSERT(li->li_initialized != 0);
-
-		found = true;
-		if (base_addr != NULL)
-			*base_addr = li->li_base_phy_addr;
-		if (na_addr == NULL) {
-			C_ASSERT(base_addr != NULL);
-			pthread_rwlock_unlock(&grp_priv->gp_rwlock);
-			chash_rec_decref(grp_priv->gp_lookup_cache[ctx_idx],
-					 rlink);
-			C_GOTO(out, rc);
-		}
-		if (li->li_tag_addr[tag] != NULL) {
-			*na_addr = li->li_tag_addr[tag];
-			pthread_rwlock_unlock(&grp_priv->gp_rwlock);
-			chash_rec_decref(grp_priv->gp_lookup_cache[ctx_idx],
-					 rlink);
-			C_GOTO(out, rc);
+	li = &grp_priv->gp_lookup_cache[rank];
+	if (base_addr != NULL)
+		*base_addr = __atomic_load_n(&li->li_base_phy_addr,
+					     __ATOMIC_ACQUIRE);
+
+	if (grp_priv->gp_lc_addr_max == 0 || na_addr == NULL) {
+		/* paired with the release stores in crt_grp_lc_addr_insert */
+		addrs = __atomic_load_n(&li->li_addrs, __ATOMIC_ACQUIRE);
+		slot = crt_lc_addrs_slot(addrs, ctx_idx, tag);
+		if (slot != NULL)
+			addr = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+		if (addr == NULL)
+			C_GOTO(out, rc = -CER_AGAIN);
+		if (na_addr != NULL)
+			*na_addr = addr;
+		C_GOTO(out, rc);
+	}
+
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	addrs = li->li_addrs;
+	slot = crt_lc_addrs_slot(addrs, ctx_idx, tag);
+	if (slot == NULL || *slot == NULL) {
+		pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+		C_GOTO(out, rc = -CER_AGAIN);
+	}
+	hg_ret = HG_Addr_dup(crt_lc_hg_class(ctx_idx), *slot, na_addr);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("HG_Addr_dup failed, hg_ret: %d.\n", hg_ret);
+		rc = -CER_HG;
+	}
+	node = crt_lc_addrs_lru(addrs)[slot - addrs->la_addr];
+	crt_list_move_tail(&node->ll_link, &grp_priv->gp_lc_lru);
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+
+out:
+	return rc;
+}
+
+/*
+ * cache the connected address of (\a rank, \a tag) for \a ctx_idx. If another
+ * lookup raced ahead, \a na_addr is freed and replaced with the cached one.
+ */
+static int
+crt_grp_lc_addr_insert(struct crt_grp_priv *grp_priv, int ctx_idx,
+		       struct crt_hg_context *hg_ctx, crt_rank_t rank,
+		       uint32_t tag, na_addr_t *na_addr)
+{
+	struct crt_lookup_item	*li = &grp_priv->gp_lookup_cache[rank];
+	struct crt_lc_lru	*node = NULL;
+	na_addr_t		*slot;
+	hg_return_t		 hg_ret;
+	int			 rc = 0;
+
+	C_ASSERT(na_addr != NULL && *na_addr != NULL);
+
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	slot = crt_lc_addrs_slot(li->li_addrs, ctx_idx, tag);
+	if (slot == NULL) {
+		rc = crt_lc_addrs_grow(grp_priv, li, ctx_idx, tag);
+		if (rc != 0)
+			C_GOTO(unlock, rc);
+		slot = crt_lc_addrs_slot(li->li_addrs, ctx_idx, tag);
+		C_ASSERT(slot != NULL);
+	}
+	if (*slot != NULL) {
+		hg_ret = HG_Addr_free(hg_ctx->chc_hgcla, *na_addr);
+		if (hg_ret != HG_SUCCESS)
+			C_ERROR("HG_Addr_free failed, hg_ret: %d.\n", hg_ret);
+		*na_addr = *slot;
+		C_GOTO(unlock, rc);
+	}
+
+	if (grp_priv->gp_lc_addr_max != 0) {
+		C_ALLOC_PTR(node);
+		if (node == NULL)
+			C_GOTO(unlock, rc = -CER_NOMEM);
+		if (grp_priv->gp_lc_addr_num >= grp_priv->gp_lc_addr_max)
+			crt_lc_addr_evict(grp_priv);
+		/* eviction does not move the slots */
+		node->ll_rank = rank;
+		node->ll_ctx_idx = ctx_idx;
+		node->ll_tag = tag;
+		crt_list_add_tail(&node->ll_link, &grp_priv->gp_lc_lru);
+		crt_lc_addrs_lru(li->li_addrs)[slot - li->li_addrs->la_addr] =
+			node;
+		grp_priv->gp_lc_addr_num++;
+	}
+	__atomic_store_n(slot, *na_addr, __ATOMIC_RELEASE);
+
+unlock:
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+	if (rc != 0)
+		HG_Addr_free(hg_ctx->chc_hgcla, *na_addr);
+	return rc;
+}
+
+static void crt_grp_connect_slot_done(struct crt_grp_conn_slot *slot, int rc);
+
+static void
+crt_grp_addr_pend_done(struct crt_addr_pend *pend, int rc)
+{
+	struct crt_context	*ctx = pend->cap_ctx;
+	struct crt_rpc_priv	*rpc_priv, *next;
+	struct crt_grp_conn_slot *slot, *slot_next;
+	crt_list_t		 reqs;
+	crt_list_t		 conns;
+
+	/* the waiters were failed when detached, the context may be gone */
+	if (__atomic_load_n(&pend->cap_detached, __ATOMIC_ACQUIRE))
+		C_GOTO(out, rc);
+
+	CRT_INIT_LIST_HEAD(&reqs);
+	CRT_INIT_LIST_HEAD(&conns);
+	pthread_mutex_lock(&ctx->cc_addr_mutex);
+	if (pend->cap_detached) {
+		pthread_mutex_unlock(&ctx->cc_addr_mutex);
+		C_GOTO(out, rc);
+	}
+	crt_list_del(&pend->cap_link);
+	crt_list_splice_init(&pend->cap_reqs, &reqs);
+	crt_list_splice_init(&pend->cap_conns, &conns);
+	crt_list_for_each_entry(rpc_priv, &reqs, crp_epi_link)
+		rpc_priv->crp_addr_pend = NULL;
+	pthread_mutex_unlock(&ctx->cc_addr_mutex);
+
+	if (rc != 0)
+		C_ERROR("resolving rank %d tag %d failed, rc: %d.\n",
+			pend->cap_rank, pend->cap_tag, rc);
+
+	crt_list_for_each_entry_safe(rpc_priv, next, &reqs, crp_epi_link) {
+		crt_list_del_init(&rpc_priv->crp_epi_link);
+		crt_req_addr_resolved(rpc_priv, rc);
+	}
+	crt_list_for_each_entry_safe(slot, slot_next, &conns, cs_link) {
+		crt_list_del_init(&slot->cs_link);
+		crt_grp_connect_slot_done(slot, rc);
+	}
+
+out:
+	C_FREE_PTR(pend);
+}
+
+static hg_return_t
+crt_grp_addr_lookup_cb(const struct hg_cb_info *cb_info)
+{
+	struct crt_addr_pend	*pend = cb_info->arg;
+	struct crt_context	*ctx = pend->cap_ctx;
+	na_addr_t		 addr;
+	int			 rc;
+
+	if (cb_info->ret != HG_SUCCESS) {
+		C_ERROR("HG_Addr_lookup %s failed, hg_ret: %d.\n",
+			pend->cap_uri, cb_info->ret);
+		C_GOTO(out, rc = -CER_HG);
+	}
+
+	addr = cb_info->info.lookup.addr;
+	if (__atomic_load_n(&pend->cap_detached, __ATOMIC_ACQUIRE)) {
+		HG_Addr_free(pend->cap_hgcla, addr);
+		C_GOTO(out, rc = -CER_CANCELED);
+	}
+	C_DEBUG("Connect to %s succeed.\n", pend->cap_uri);
+	rc = crt_grp_lc_addr_insert(pend->cap_grp_priv, ctx->cc_idx,
+				    &ctx->cc_hg_ctx, pend->cap_rank,
+				    pend->cap_tag, &addr);
+
+out:
+	crt_grp_addr_pend_done(pend, rc);
+	return HG_SUCCESS;
+}
+
+/* start connecting to \a base_addr plus the tag, completes in the callback */
+static int
+crt_grp_addr_pend_connect(struct crt_addr_pend *pend, crt_phy_addr_t base_addr)
+{
+	struct crt_context	*ctx = pend->cap_ctx;
+	hg_return_t		 hg_ret;
+	int			 rc;
+
+	rc = crt_grp_tag_uri(base_addr, pend->cap_tag, pend->cap_uri);
+	if (rc != 0)
+		C_GOTO(out, rc);
+
+	hg_ret = HG_Addr_lookup(ctx->cc_hg_ctx.chc_hgctx,
+				crt_grp_addr_lookup_cb, pend, pend->cap_uri,
+				HG_OP_ID_IGNORE);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("HG_Addr_lookup %s failed, hg_ret: %d.\n",
+			pend->cap_uri, hg_ret);
+		rc = -CER_HG;
+	}
+
+out:
+	return rc;
+}
+
+/* URI table fetch in flight, see crt_grp_uri_fetch */
+struct crt_uri_fetch {
+	struct crt_grp_priv	*uf_grp_priv;
+	struct crt_context	*uf_ctx;
+	/* ranks asked for, NULL for the whole table */
+	crt_rank_list_t		*uf_ranks;
+	/* buffer for the table pushed by bulk, if too large to be inline */
+	crt_iov_t		 uf_iov;
+	crt_bulk_t		 uf_bulk;
+};
+
+static void crt_grp_uri_fetch(struct crt_grp_priv *grp_priv,
+			      struct crt_context *ctx);
+
+/*
+ * a URI table fetch completed with \a rc, connect the waiters whose URI is
+ * known now and fail the others if the fetch failed. Waiters not covered by
+ * the fetch wait for the next one.
+ */
+static void
+crt_grp_uri_fetch_done(struct crt_grp_priv *grp_priv, struct crt_context *ctx,
+		       int rc)
+{
+	struct crt_addr_pend	*pend, *next;
+	crt_phy_addr_t		 base_addr;
+	crt_list_t		 waiters;
+	bool			 more = false;
+	int			 rc2;
+
+	CRT_INIT_LIST_HEAD(&waiters);
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	crt_list_splice_init(&grp_priv->gp_uri_waiters, &waiters);
+	grp_priv->gp_uri_fetching = 0;
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+
+	crt_list_for_each_entry_safe(pend, next, &waiters, cap_uri_link) {
+		base_addr = __atomic_load_n(
+			&grp_priv->gp_lookup_cache[pend->cap_rank].li_base_phy_addr,
+			__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&pend->cap_detached, __ATOMIC_ACQUIRE))
+			base_addr = NULL;
+		else if (base_addr == NULL && rc == 0)
+			continue;
+		crt_list_del_init(&pend->cap_uri_link);
+		rc2 = (base_addr == NULL) ? (rc ? rc : -CER_CANCELED) :
+		      crt_grp_addr_pend_connect(pend, base_addr);
+		if (rc2 != 0)
+			crt_grp_addr_pend_done(pend, rc2);
+	}
+	if (crt_list_empty(&waiters))
+		return;
+
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	crt_list_splice_init(&waiters, &grp_priv->gp_uri_waiters);
+	if (!grp_priv->gp_uri_fetching) {
+		grp_priv->gp_uri_fetching = 1;
+		more = true;
+	}
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+	if (more)
+		crt_grp_uri_fetch(grp_priv, ctx);
+}
+
+static void
+crt_uri_fetch_free(struct crt_uri_fetch *fetch)
+{
+	if (fetch->uf_bulk != CRT_BULK_NULL)
+		crt_bulk_free(fetch->uf_bulk);
+	if (fetch->uf_iov.iov_buf != NULL)
+		C_FREE(fetch->uf_iov.iov_buf, fetch->uf_iov.iov_buf_len);
+	if (fetch->uf_ranks != NULL)
+		crt_rank_list_free(fetch->uf_ranks);
+	C_FREE_PTR(fetch);
+}
+
+static int
+crt_grp_uri_fetch_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_uri_fetch		*fetch = cb_info->cci_arg;
+	struct crt_grp_priv		*grp_priv = fetch->uf_grp_priv;
+	struct crt_uri_table_out	*ut_out;
+	char				*table, *end, *uri;
+	crt_rank_t			 rank;
+	uint32_t			 i, num;
+	size_t				 len;
+	int				 rc = cb_info->cci_rc;
+
+	if (rc != 0) {
+		C_ERROR("URI_TABLE request failed, rc: %d.\n", rc);
+		C_GOTO(out, rc);
+	}
+	ut_out = crt_reply_get(cb_info->cci_rpc);
+	C_ASSERT(ut_out != NULL);
+	if (ut_out->ut_rc != 0) {
+		C_ERROR("URI_TABLE reply rc: %d.\n", ut_out->ut_rc);
+		C_GOTO(out, rc = ut_out->ut_rc);
+	}
+
+	if (ut_out->ut_table.iov_len > 0) {
+		table = ut_out->ut_table.iov_buf;
+		end = table + ut_out->ut_table.iov_len;
+	} else {
+		C_ASSERT(ut_out->ut_size <= fetch->uf_iov.iov_buf_len);
+		table = fetch->uf_iov.iov_buf;
+		end = table + ut_out->ut_size;
+	}
+	num = (fetch->uf_ranks == NULL) ? grp_priv->gp_size :
+	      fetch->uf_ranks->rl_nr.num;
+	for (i = 0; i < num; i++) {
+		len = strnlen(table, end - table);
+		if (table + len == end) {
+			C_ERROR("truncated URI table, %d of %d URIs.\n",
+				i, num);
+			C_GOTO(out, rc = -CER_PROTO);
 		}
+		rank = (fetch->uf_ranks == NULL) ? i :
+		       fetch->uf_ranks->rl_ranks[i];
+		uri = strndup(table, len);
+		if (uri == NULL)
+			C_GOTO(out, rc = -CER_NOMEM);
+		crt_grp_lc_uri_insert(grp_priv, rank, uri);
+		table += len + 1;
 	}
-	pthread_rwlock_unlock(&grp_priv->gp_rwlock);
-
-	if (found) {
-		C_ASSERT(na_addr != NULL);
-		C_ASSERT(li != NULL);
-		pthread_mutex_lock(&li->li_mutex);
-		if (li->li_tag_addr[tag] != NULL) {
-			*na_addr = li->li_tag_addr[tag];
-			pthread_mutex_unlock(&li->li_mutex);
-			chash_rec_decref(grp_priv->gp_lookup_cache[ctx_idx],
-					 rlink);
+
+out:
+	crt_grp_uri_fetch_done(grp_priv, fetch->uf_ctx, rc);
+	crt_uri_fetch_free(fetch);
+	return 0;
+}
+
+/* take the ranks of the first \a num waiters, called with gp_lc_mutex held */
+static int
+crt_uri_fetch_ranks(struct crt_uri_fetch *fetch, uint32_t num)
+{
+	struct crt_grp_priv	*grp_priv = fetch->uf_grp_priv;
+	struct crt_addr_pend	*pend;
+	crt_rank_list_t		*ranks;
+	uint32_t		 i = 0;
+
+	C_ALLOC_PTR(ranks);
+	if (ranks == NULL)
+		return -CER_NOMEM;
+	C_ALLOC(ranks->rl_ranks, num * sizeof(crt_rank_t));
+	if (ranks->rl_ranks == NULL) {
+		C_FREE_PTR(ranks);
+		return -CER_NOMEM;
+	}
+	crt_list_for_each_entry(pend, &grp_priv->gp_uri_waiters,
+				cap_uri_link) {
+		if (i == num)
+			break;
+		ranks->rl_ranks[i++] = pend->cap_rank;
+	}
+	ranks->rl_nr.num = i;
+	fetch->uf_ranks = ranks;
+	return 0;
+}
+
+/*
+ * ask the PSR for the URIs of the waiting entries by one URI_TABLE RPC. The
+ * first fetch of a group no larger than gp_uri_fetch_max asks the whole table,
+ * later ones ask up to CRT_URI_FETCH_BATCH ranks of the waiters.
+ */
+static void
+crt_grp_uri_fetch(struct crt_grp_priv *grp_priv, struct crt_context *ctx)
+{
+	struct crt_uri_fetch		*fetch;
+	struct crt_uri_table_in		*ut_in;
+	struct crt_addr_pend		*pend;
+	crt_sg_list_t			 sgl;
+	crt_rpc_t			*rpc_req;
+	crt_endpoint_t			 svr_ep;
+	uint32_t			 num = 0;
+	int				 rc = 0;
+
+	C_ALLOC_PTR(fetch);
+	if (fetch == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+	fetch->uf_grp_priv = grp_priv;
+	fetch->uf_ctx = ctx;
+
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	if (!grp_priv->gp_uri_table_asked &&
+	    grp_priv->gp_size <= grp_priv->gp_uri_fetch_max) {
+		grp_priv->gp_uri_table_asked = 1;
+		num = grp_priv->gp_size;
+	} else {
+		crt_list_for_each_entry(pend, &grp_priv->gp_uri_waiters,
+					cap_uri_link)
+			num++;
+		num = min(num, CRT_URI_FETCH_BATCH);
+		rc = crt_uri_fetch_ranks(fetch, num);
+	}
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+	if (rc != 0)
+		C_GOTO(out, rc);
+
+	if ((uint64_t)num * CRT_ADDR_STR_MAX_LEN > CRT_URI_TABLE_INLINE_MAX) {
+		/* each URI is shorter than CRT_ADDR_STR_MAX_LEN */
+		fetch->uf_iov.iov_buf_len = num * CRT_ADDR_STR_MAX_LEN;
+		C_ALLOC(fetch->uf_iov.iov_buf, fetch->uf_iov.iov_buf_len);
+		if (fetch->uf_iov.iov_buf == NULL)
+			C_GOTO(out, rc = -CER_NOMEM);
+		sgl.sg_nr.num = 1;
+		sgl.sg_iovs = &fetch->uf_iov;
+		rc = crt_bulk_create(ctx, &sgl, CRT_BULK_RW, &fetch->uf_bulk);
+		if (rc != 0) {
+			C_ERROR("crt_bulk_create failed, rc: %d.\n", rc);
 			C_GOTO(out, rc);
 		}
-		rc = crt_conn_tag(hg_ctx, li->li_base_phy_addr, tag,
-				  &li->li_tag_addr[tag]);
-		if (rc == 0) {
-			C_ASSERT(li->li_tag_addr[tag] != NULL);
-			*na_addr = li->li_tag_addr[tag];
-		}
-		pthread_mutex_unlock(&li->li_mutex);
-		chash_rec_decref(grp_priv->gp_lookup_cache[ctx_idx], rlink);
-		C_GOTO(out, rc);
 	}
 
-	C_ASSERT(found == false);
-	C_ALLOC_PTR(li);
-	if (li == NULL)
-		C_GOTO(out, rc = -CER_NOMEM);
-	CRT_INIT_LIST_HEAD(&li->li_link);
-	li->li_grp_priv = grp_priv;
-	li->li_rank = rank;
-	rc = crt_grp_uri_lookup(grp_priv, rank, &li->li_base_phy_addr);
+	svr_ep.ep_grp = &grp_priv->gp_pub;
+	svr_ep.ep_rank = grp_priv->gp_psr_rank;
+	svr_ep.ep_tag = 0;
+	rc = crt_req_create(ctx, svr_ep, CRT_OPC_URI_TABLE, &rpc_req);
 	if (rc != 0) {
-		C_ERROR("crt_grp_uri_lookup failed, rc: %d.\n", rc);
-		C_FREE_PTR(li);
+		C_ERROR("crt_req_create URI_TABLE failed, rc: %d.\n", rc);
 		C_GOTO(out, rc);
 	}
-	C_ASSERT(li->li_base_phy_addr != NULL);
-	li->li_initialized = 1;
-	pthread_mutex_init(&li->li_mutex, NULL);
-
-	pthread_rwlock_wrlock(&grp_priv->gp_rwlock);
-	rlink = chash_rec_find(grp_priv->gp_lookup_cache[ctx_idx],
-			       (void *)&rank, sizeof(rank));
-	if (rlink != NULL) {
-		/* race condition, goto above path to lookup again */
-		crt_li_destroy(li);
-		pthread_rwlock_unlock(&grp_priv->gp_rwlock);
-		chash_rec_decref(grp_priv->gp_lookup_cache[ctx_idx], rlink);
-		goto lookup_again;
-	}
-	rc = chash_rec_insert(grp_priv->gp_lookup_cache[ctx_idx], &rank,
-			      sizeof(rank), &li->li_link, true /* exclusive */);
-	pthread_rwlock_unlock(&grp_priv->gp_rwlock);
+	ut_in = crt_req_get(rpc_req);
+	C_ASSERT(ut_in != NULL);
+	ut_in->ut_grp_id = grp_priv->gp_pub.cg_grpid;
+	ut_in->ut_ranks = fetch->uf_ranks;
+	ut_in->ut_bulk = fetch->uf_bulk;
+	rc = crt_req_send(rpc_req, crt_grp_uri_fetch_cb, fetch);
+	if (rc != 0) {
+		C_ERROR("crt_req_send URI_TABLE failed, rc: %d.\n", rc);
+		C_GOTO(out, rc);
+	}
+	C_DEBUG("fetching %d URIs of group %s from rank %d.\n", num,
+		grp_priv->gp_pub.cg_grpid, grp_priv->gp_psr_rank);
+
+out:
+	if (rc != 0) {
+		if (fetch != NULL)
+			crt_uri_fetch_free(fetch);
+		crt_grp_uri_fetch_done(grp_priv, ctx, rc);
+	}
+}
+
+/* wait for the URI of \a pend to be fetched from the PSR */
+static int
+crt_grp_uri_wait(struct crt_addr_pend *pend)
+{
+	struct crt_grp_priv	*grp_priv = pend->cap_grp_priv;
+	crt_phy_addr_t		 base_addr;
+	bool			 start = false;
+
+	pthread_mutex_lock(&grp_priv->gp_lc_mutex);
+	/* inserted by a fetch completed meanwhile */
+	base_addr = grp_priv->gp_lookup_cache[pend->cap_rank].li_base_phy_addr;
+	if (base_addr == NULL) {
+		crt_list_add_tail(&pend->cap_uri_link,
+				  &grp_priv->gp_uri_waiters);
+		if (!grp_priv->gp_uri_fetching) {
+			grp_priv->gp_uri_fetching = 1;
+			start = true;
+		}
+	}
+	pthread_mutex_unlock(&grp_priv->gp_lc_mutex);
+
+	if (base_addr != NULL)
+		return crt_grp_addr_pend_connect(pend, base_addr);
+	if (start)
+		crt_grp_uri_fetch(grp_priv, pend->cap_ctx);
+	return 0;
+}
+
+/*
+ * start resolving the address of the pending entry. Unknown URIs of attached
+ * groups are fetched from the PSR by URI_TABLE RPCs, shared by all waiting
+ * entries, others are looked up in place: the PSR's own URI, or for a local
+ * group the URI collected by the rank assignment fence, which PMIx_Get reads
+ * from the client's cache without asking the PMIx server.
+ */
+static int
+crt_grp_addr_pend_start(struct crt_addr_pend *pend)
+{
+	struct crt_grp_priv		*grp_priv = pend->cap_grp_priv;
+	struct crt_context		*ctx = pend->cap_ctx;
+	crt_phy_addr_t			 base_addr;
+	int				 rc;
+
+	rc = crt_grp_lc_addr_get(grp_priv, ctx->cc_idx, pend->cap_rank,
+				 pend->cap_tag, &base_addr, NULL /* na_addr */);
 	if (rc == 0) {
-		goto lookup_again;
+		/* connected by others meanwhile */
+		crt_grp_addr_pend_done(pend, 0);
+		C_GOTO(out, rc);
+	}
+	if (base_addr != NULL)
+		C_GOTO(out, rc = crt_grp_addr_pend_connect(pend, base_addr));
+
+	if (grp_priv->gp_local == 0 && pend->cap_rank != grp_priv->gp_psr_rank)
+		C_GOTO(out, rc = crt_grp_uri_wait(pend));
+
+	rc = crt_grp_lc_lookup(grp_priv, pend->cap_rank, &base_addr);
+	if (rc == 0)
+		rc = crt_grp_addr_pend_connect(pend, base_addr);
+
+out:
+	return rc;
+}
+
+/*
+ * queue \a rpc_priv or \a slot on the pending entry of (\a rank, \a tag),
+ * creating and starting the entry if it is not pending yet.
+ */
+static int
+crt_grp_addr_pend_join(struct crt_context *ctx, struct crt_grp_priv *grp_priv,
+		       crt_rank_t rank, uint32_t tag,
+		       struct crt_rpc_priv *rpc_priv,
+		       struct crt_grp_conn_slot *slot)
+{
+	struct crt_addr_pend	*pend;
+	uint64_t		 deadline;
+	int			 rc = 0;
+
+	deadline = crt_req_deadline(rpc_priv);
+
+	pthread_mutex_lock(&ctx->cc_addr_mutex);
+	crt_list_for_each_entry(pend, &ctx->cc_addr_pend_list, cap_link) {
+		if (pend->cap_grp_priv == grp_priv &&
+		    pend->cap_rank == rank && pend->cap_tag == tag) {
+			/* crt_grp_addr_pend_expire rescans if extended */
+			pend->cap_deadline = max(pend->cap_deadline, deadline);
+			C_GOTO(join, rc);
+		}
+	}
+
+	C_ALLOC_PTR(pend);
+	if (pend == NULL) {
+		pthread_mutex_unlock(&ctx->cc_addr_mutex);
+		C_GOTO(out, rc = -CER_NOMEM);
+	}
+	pend->cap_ctx = ctx;
+	pend->cap_grp_priv = grp_priv;
+	pend->cap_rank = rank;
+	pend->cap_tag = tag;
+	CRT_INIT_LIST_HEAD(&pend->cap_reqs);
+	CRT_INIT_LIST_HEAD(&pend->cap_conns);
+	CRT_INIT_LIST_HEAD(&pend->cap_uri_link);
+	pend->cap_hgcla = ctx->cc_hg_ctx.chc_hgcla;
+	pend->cap_deadline = deadline;
+	crt_list_add_tail(&pend->cap_link, &ctx->cc_addr_pend_list);
+	if (deadline < ctx->cc_addr_pend_next)
+		__atomic_store_n(&ctx->cc_addr_pend_next, deadline,
+				 __ATOMIC_RELAXED);
+	rc = 1;
+
+join:
+	if (rpc_priv != NULL) {
+		crt_list_add_tail(&rpc_priv->crp_epi_link, &pend->cap_reqs);
+		rpc_priv->crp_addr_pend = pend;
 	} else {
-		C_ERROR("chash_rec_insert failed, rc: %d.\n", rc);
-		pthread_mutex_destroy(&li->li_mutex);
-		C_FREE_PTR(li);
+		crt_list_add_tail(&slot->cs_link, &pend->cap_conns);
 	}
+	pthread_mutex_unlock(&ctx->cc_addr_mutex);
+	if (rc == 0)
+		C_GOTO(out, rc);
+
+	rc = crt_grp_addr_pend_start(pend);
+	if (rc != 0)
+		/* fails all waiters queued meanwhile, including this one */
+		crt_grp_addr_pend_done(pend, rc);
+	rc = 0;
+
+out:
+	return rc;
+}
+
+/*
+ * queue \a rpc_priv until the address of its target endpoint is resolved,
+ * requests to the same endpoint share one resolution. The request is sent
+ * or completed with error through crt_req_addr_resolved.
+ */
+int
+crt_grp_addr_pend(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_grp_priv	*grp_priv;
+	crt_endpoint_t		*tgt_ep = &rpc_priv->crp_pub.cr_ep;
+
+	if (tgt_ep->ep_grp == NULL)
+		grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
+	else
+		grp_priv = container_of(tgt_ep->ep_grp, struct crt_grp_priv,
+					gp_pub);
+
+	return crt_grp_addr_pend_join(rpc_priv->crp_pub.cr_ctx, grp_priv,
+				      tgt_ep->ep_rank, tgt_ep->ep_tag,
+				      rpc_priv, NULL /* slot */);
+}
+
+/*
+ * remove \a rpc_priv from the pending queue, returns -CER_NONEXIST if it is
+ * not waiting for an address.
+ */
+int
+crt_grp_addr_unpend(struct crt_rpc_priv *rpc_priv)
+{
+	struct crt_context	*ctx = rpc_priv->crp_pub.cr_ctx;
+	int			 rc = 0;
+
+	pthread_mutex_lock(&ctx->cc_addr_mutex);
+	if (rpc_priv->crp_addr_pend == NULL) {
+		rc = -CER_NONEXIST;
+	} else {
+		crt_list_del_init(&rpc_priv->crp_epi_link);
+		rpc_priv->crp_addr_pend = NULL;
+	}
+	pthread_mutex_unlock(&ctx->cc_addr_mutex);
+
+	return rc;
+}
+
+/*
+ * take \a pend off its context with cc_addr_mutex held, moving its waiters to
+ * \a reqs and \a conns. The lookup or URI fetch in flight still owns the entry
+ * and frees it through crt_grp_addr_pend_done.
+ */
+static void
+crt_grp_addr_pend_detach(struct crt_addr_pend *pend, crt_list_t *reqs,
+			 crt_list_t *conns)
+{
+	struct crt_rpc_priv	*rpc_priv;
+
+	crt_list_for_each_entry(rpc_priv, &pend->cap_reqs, crp_epi_link)
+		rpc_priv->crp_addr_pend = NULL;
+	crt_list_splice_init(&pend->cap_reqs, reqs);
+	crt_list_splice_init(&pend->cap_conns, conns);
+	crt_list_del_init(&pend->cap_link);
+	__atomic_store_n(&pend->cap_detached, true, __ATOMIC_RELEASE);
+}
+
+static void
+crt_grp_addr_pend_fail(crt_list_t *reqs, crt_list_t *conns, int rc)
+{
+	struct crt_rpc_priv		*rpc_priv, *next;
+	struct crt_grp_conn_slot	*slot, *slot_next;
+
+	crt_list_for_each_entry_safe(rpc_priv, next, reqs, crp_epi_link) {
+		crt_list_del_init(&rpc_priv->crp_epi_link);
+		crt_rpc_complete(rpc_priv, rc);
+		crt_req_decref(&rpc_priv->crp_pub);
+	}
+	crt_list_for_each_entry_safe(slot, slot_next, conns, cs_link) {
+		crt_list_del_init(&slot->cs_link);
+		crt_grp_connect_slot_done(slot, rc);
+	}
+}
+
+/*
+ * fail the waiters of the entries of \a ctx past their deadline with
+ * -CER_TIMEDOUT, HG_Addr_lookup itself never times out. Called by every
+ * crt_progress.
+ */
+void
+crt_grp_addr_pend_expire(struct crt_context *ctx, uint64_t ts_now)
+{
+	struct crt_addr_pend	*pend, *next;
+	crt_list_t		 reqs;
+	crt_list_t		 conns;
+	uint64_t		 pend_next = UINT64_MAX;
+
+	if (ts_now < __atomic_load_n(&ctx->cc_addr_pend_next,
+				     __ATOMIC_RELAXED))
+		return;
+
+	CRT_INIT_LIST_HEAD(&reqs);
+	CRT_INIT_LIST_HEAD(&conns);
+	pthread_mutex_lock(&ctx->cc_addr_mutex);
+	crt_list_for_each_entry_safe(pend, next, &ctx->cc_addr_pend_list,
+				     cap_link) {
+		if (pend->cap_deadline > ts_now) {
+			pend_next = min(pend_next, pend->cap_deadline);
+			continue;
+		}
+		C_ERROR("resolving rank %d tag %d timed out.\n",
+			pend->cap_rank, pend->cap_tag);
+		crt_grp_addr_pend_detach(pend, &reqs, &conns);
+	}
+	__atomic_store_n(&ctx->cc_addr_pend_next, pend_next, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&ctx->cc_addr_mutex);
+
+	crt_grp_addr_pend_fail(&reqs, &conns, -CER_TIMEDOUT);
+}
+
+/*
+ * fail all requests and connections waiting for addresses of \a ctx with
+ * -CER_CANCELED, for a forced context destroy. The lookups still in flight
+ * free their detached entries.
+ */
+void
+crt_grp_addr_pend_abort(struct crt_context *ctx)
+{
+	struct crt_addr_pend	*pend, *next;
+	crt_list_t		 reqs;
+	crt_list_t		 conns;
+
+	CRT_INIT_LIST_HEAD(&reqs);
+	CRT_INIT_LIST_HEAD(&conns);
+	pthread_mutex_lock(&ctx->cc_addr_mutex);
+	crt_list_for_each_entry_safe(pend, next, &ctx->cc_addr_pend_list,
+				     cap_link)
+		crt_grp_addr_pend_detach(pend, &reqs, &conns);
+	__atomic_store_n(&ctx->cc_addr_pend_next, UINT64_MAX,
+			 __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&ctx->cc_addr_mutex);
+
+	crt_grp_addr_pend_fail(&reqs, &conns, -CER_CANCELED);
+}
+
+static void
+crt_grp_connect_put(struct crt_grp_connect *conn)
+{
+	bool	last;
+
+	pthread_mutex_lock(&conn->gc_mutex);
+	conn->gc_active--;
+	last = (conn->gc_active == 0);
+	pthread_mutex_unlock(&conn->gc_mutex);
+	if (!last)
+		return;
+
+	if (conn->gc_cb != NULL)
+		conn->gc_cb(&conn->gc_grp_priv->gp_pub, conn->gc_arg,
+			    conn->gc_rc);
+
+	if (conn->gc_ranks != NULL)
+		C_FREE(conn->gc_ranks, conn->gc_rank_num * sizeof(crt_rank_t));
+	C_FREE(conn->gc_tags, conn->gc_tag_num * sizeof(uint32_t));
+	pthread_mutex_destroy(&conn->gc_mutex);
+	C_FREE(conn, sizeof(*conn) +
+	       conn->gc_slot_num * sizeof(struct crt_grp_conn_slot));
+}
+
+/*
+ * issue the next pairs on \a slot, until one is in flight (completing in
+ * crt_grp_connect_slot_done) or all pairs are issued.
+ */
+static void
+crt_grp_connect_next(struct crt_grp_connect *conn,
+		     struct crt_grp_conn_slot *slot)
+{
+	crt_rank_t	rank;
+	uint32_t	tag;
+	uint64_t	idx;
+	bool		again;
+	int		rc;
+
+	while (1) {
+		pthread_mutex_lock(&conn->gc_mutex);
+		if (conn->gc_next == conn->gc_total) {
+			pthread_mutex_unlock(&conn->gc_mutex);
+			break;
+		}
+		idx = conn->gc_next++;
+		slot->cs_issuing = 1;
+		slot->cs_done = 0;
+		pthread_mutex_unlock(&conn->gc_mutex);
+
+		rank = idx / conn->gc_tag_num;
+		if (conn->gc_ranks != NULL)
+			rank = conn->gc_ranks[rank];
+		tag = conn->gc_tags[idx % conn->gc_tag_num];
+
+		rc = crt_grp_lc_addr_get(conn->gc_grp_priv,
+					 conn->gc_ctx->cc_idx, rank, tag,
+					 NULL /* base_addr */,
+					 NULL /* na_addr */);
+		if (rc == -CER_AGAIN)
+			rc = crt_grp_addr_pend_join(conn->gc_ctx,
+						    conn->gc_grp_priv, rank,
+						    tag, NULL /* rpc_priv */,
+						    slot);
+		else
+			slot->cs_done = 1;
+
+		pthread_mutex_lock(&conn->gc_mutex);
+		if (rc != 0 && conn->gc_rc == 0)
+			conn->gc_rc = rc;
+		slot->cs_issuing = 0;
+		again = (rc != 0 || slot->cs_done);
+		pthread_mutex_unlock(&conn->gc_mutex);
+		if (!again)
+			return;
+	}
+
+	crt_grp_connect_put(conn);
+}
+
+static void
+crt_grp_connect_slot_done(struct crt_grp_conn_slot *slot, int rc)
+{
+	struct crt_grp_connect	*conn = slot->cs_conn;
+	bool			 issuing;
+
+	pthread_mutex_lock(&conn->gc_mutex);
+	if (rc != 0 && conn->gc_rc == 0)
+		conn->gc_rc = rc;
+	/* the context is being destroyed, do not issue the remaining pairs */
+	if (rc == -CER_CANCELED)
+		conn->gc_next = conn->gc_total;
+	issuing = slot->cs_issuing;
+	/* completed in place, crt_grp_connect_next goes on with the slot */
+	if (issuing)
+		slot->cs_done = 1;
+	pthread_mutex_unlock(&conn->gc_mutex);
+
+	if (!issuing)
+		crt_grp_connect_next(conn, slot);
+}
+
+int
+crt_group_connect(crt_context_t crt_ctx, crt_group_t *grp,
+		  crt_rank_list_t *rank_list, uint32_t *tags,
+		  uint32_t tag_num, crt_grp_connect_cb_t cb, void *arg)
+{
+	struct crt_context	*ctx = crt_ctx;
+	struct crt_grp_priv	*grp_priv;
+	struct crt_grp_connect	*conn;
+	uint32_t		 slot_num;
+	uint32_t		 rank_num;
+	uint32_t		 i;
+	int			 rc = 0;
+
+	if (crt_ctx == CRT_CONTEXT_NULL) {
+		C_ERROR("invalid parameter, NULL crt_ctx.\n");
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+	if (tags != NULL && tag_num == 0) {
+		C_ERROR("invalid parameter, zero tag_num.\n");
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+	if (grp == NULL)
+		grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
+	else
+		grp_priv = container_of(grp, struct crt_grp_priv, gp_pub);
+	if (grp_priv->gp_primary == 0) {
+		C_ERROR("group %s is not a primary group.\n",
+			grp_priv->gp_pub.cg_grpid);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+
+	rank_num = (rank_list == NULL) ? grp_priv->gp_size :
+		   rank_list->rl_nr.num;
+	if (tags == NULL)
+		tag_num = 1;
+	for (i = 0; rank_list != NULL && i < rank_num; i++) {
+		if (rank_list->rl_ranks[i] >= grp_priv->gp_size) {
+			C_ERROR("invalid rank %d (group size %d).\n",
+				rank_list->rl_ranks[i], grp_priv->gp_size);
+			C_GOTO(out, rc = -CER_INVAL);
+		}
+	}
+	for (i = 0; tags != NULL && i < tag_num; i++) {
+		if (tags[i] >= CRT_SRV_CONTEXT_NUM) {
+			C_ERROR("invalid tag %d (CRT_SRV_CONTEXT_NUM %d).\n",
+				tags[i], CRT_SRV_CONTEXT_NUM);
+			C_GOTO(out, rc = -CER_INVAL);
+		}
+	}
+
+	slot_num = min((uint64_t)rank_num * tag_num,
+		       CRT_GROUP_CONNECT_WINDOW);
+	C_ALLOC(conn, sizeof(*conn) +
+		slot_num * sizeof(struct crt_grp_conn_slot));
+	if (conn == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+	C_ALLOC(conn->gc_tags, tag_num * sizeof(uint32_t));
+	if (conn->gc_tags == NULL) {
+		C_FREE(conn, sizeof(*conn) +
+		       slot_num * sizeof(struct crt_grp_conn_slot));
+		C_GOTO(out, rc = -CER_NOMEM);
+	}
+	if (rank_list != NULL && rank_num > 0) {
+		C_ALLOC(conn->gc_ranks, rank_num * sizeof(crt_rank_t));
+		if (conn->gc_ranks == NULL) {
+			C_FREE(conn->gc_tags, tag_num * sizeof(uint32_t));
+			C_FREE(conn, sizeof(*conn) +
+			       slot_num * sizeof(struct crt_grp_conn_slot));
+			C_GOTO(out, rc = -CER_NOMEM);
+		}
+		memcpy(conn->gc_ranks, rank_list->rl_ranks,
+		       rank_num * sizeof(crt_rank_t));
+	}
+	if (tags != NULL)
+		memcpy(conn->gc_tags, tags, tag_num * sizeof(uint32_t));
+	conn->gc_ctx = ctx;
+	conn->gc_grp_priv = grp_priv;
+	conn->gc_rank_num = rank_num;
+	conn->gc_tag_num = tag_num;
+	conn->gc_total = (uint64_t)rank_num * tag_num;
+	conn->gc_cb = cb;
+	conn->gc_arg = arg;
+	conn->gc_slot_num = slot_num;
+	pthread_mutex_init(&conn->gc_mutex, NULL);
+	for (i = 0; i < slot_num; i++) {
+		CRT_INIT_LIST_HEAD(&conn->gc_slots[i].cs_link);
+		conn->gc_slots[i].cs_conn = conn;
+	}
+
+	/* one reference per slot, plus one held until all slots start */
+	conn->gc_active = slot_num + 1;
+	for (i = 0; i < slot_num; i++)
+		crt_grp_connect_next(conn, &conn->gc_slots[i]);
+	crt_grp_connect_put(conn);
 
 out:
 	return rc;
@@ -506,19 +1465,15 @@ crt_grp_priv_create(struct crt_grp_priv **grp_priv_created,
 	}
 
 	grp_priv->gp_status = CRT_GRP_CREATING;
-	CRT_INIT_LIST_HEAD(&grp_priv->gp_child_rpcs);
 	grp_priv->gp_priv = priv;
 
 	if (!primary_grp) {
 		C_ASSERT(grp_priv->gp_membs != NULL);
-		grp_priv->gp_parent_rpc = NULL;
-		/* TODO tree children num */
-		grp_priv->gp_child_num = membs->rl_nr.num;
-		grp_priv->gp_child_ack_num = 0;
 		grp_priv->gp_failed_ranks = NULL;
 		grp_priv->gp_create_cb = grp_create_cb;
 	}
 
+	crt_tree_cache_init(grp_priv);
 	pthread_rwlock_init(&grp_priv->gp_rwlock, NULL);
 
 	*grp_priv_created = grp_priv;
@@ -575,71 +1530,107 @@ crt_grp_priv_destroy(struct crt_grp_priv *grp_priv)
 	pthread_rwlock_unlock(&crt_grp_list_rwlock);
 
 	/* destroy the grp_priv */
+	crt_tree_cache_fini(grp_priv);
 	crt_rank_list_free(grp_priv->gp_membs);
 	crt_rank_list_free(grp_priv->gp_failed_ranks);
 	if (grp_priv->gp_psr_phy_addr != NULL)
 		free(grp_priv->gp_psr_phy_addr);
+	if (grp_priv->gp_attach_info != NULL)
+		munmap(grp_priv->gp_attach_info, grp_priv->gp_attach_info_len);
 	pthread_rwlock_destroy(&grp_priv->gp_rwlock);
 	free(grp_priv->gp_pub.cg_grpid);
 
 	C_FREE_PTR(grp_priv);
 }
 
-struct gc_req {
-	crt_list_t	 gc_link;
-	crt_rpc_t	*gc_rpc;
-};
-
-static inline int
-gc_add_child_rpc(struct crt_grp_priv *grp_priv, crt_rpc_t *gc_rpc)
+/* set the size and the logical self rank of a sub-group from its members */
+static int
+crt_grp_self_init(struct crt_grp_priv *grp_priv)
 {
-	struct gc_req	*gc_req_item;
-	int		rc = 0;
+	crt_rank_t	pri_rank;
+	int		rc;
 
-	C_ASSERT(grp_priv != NULL);
-	C_ASSERT(gc_rpc != NULL);
+	C_ASSERT(grp_priv->gp_membs != NULL &&
+		 grp_priv->gp_membs->rl_nr.num > 0 &&
+		 grp_priv->gp_membs->rl_ranks != NULL);
 
-	C_ALLOC_PTR(gc_req_item);
-	if (gc_req_item == NULL)
-		C_GOTO(out, rc = -CER_NOMEM);
+	rc = crt_group_rank(NULL, &pri_rank);
+	C_ASSERT(rc == 0);
+	grp_priv->gp_size = grp_priv->gp_membs->rl_nr.num;
+	rc = crt_idx_in_sorted_rank_list(grp_priv->gp_membs, pri_rank,
+					 &grp_priv->gp_self, true /* input */);
+	if (rc != 0) {
+		C_ERROR("crt_idx_in_sorted_rank_list(rank %d, group %s) failed, "
+			"rc: %d.\n", pri_rank, grp_priv->gp_pub.cg_grpid, rc);
+		rc = -CER_OOG;
+	}
 
-	CRT_INIT_LIST_HEAD(&gc_req_item->gc_link);
-	gc_req_item->gc_rpc = gc_rpc;
+	return rc;
+}
+
+/*
+ * create the sub-group on a member receiving the GRP_CREATE corpc, before the
+ * corpc is forwarded over the new group's tree. The members are piggybacked by
+ * the corpc header (CRT_RPC_FLAG_MEMBS_INLINE).
+ */
+int
+crt_grp_corpc_create(struct crt_rpc_priv *rpc_priv,
+		     struct crt_grp_priv **grp_result)
+{
+	struct crt_grp_priv		*grp_priv = NULL;
+	struct crt_grp_create_in	*gc_in;
+	struct crt_corpc_hdr		*co_hdr;
+	int				 rc = 0;
+
+	C_ASSERT(rpc_priv != NULL && grp_result != NULL);
+	if (rpc_priv->crp_pub.cr_opc != CRT_OPC_GRP_CREATE) {
+		C_ERROR("opc 0x%x cannot create group.\n",
+			rpc_priv->crp_pub.cr_opc);
+		C_GOTO(out, rc = -CER_PROTO);
+	}
+	gc_in = crt_req_get(&rpc_priv->crp_pub);
+	C_ASSERT(gc_in != NULL);
+	co_hdr = &rpc_priv->crp_coreq_hdr;
+	if (co_hdr->coh_inline_ranks == NULL ||
+	    co_hdr->coh_inline_ranks->rl_nr.num == 0) {
+		C_ERROR("group %s created without members.\n",
+			gc_in->gc_grp_id);
+		C_GOTO(out, rc = -CER_PROTO);
+	}
 
-	rc = crt_req_addref(gc_rpc);
-	C_ASSERT(rc == 0);
+	rc = crt_grp_lookup_create(gc_in->gc_grp_id, co_hdr->coh_inline_ranks,
+				   NULL /* grp_create_cb */, NULL /* priv */,
+				   &grp_priv);
+	if (rc != 0) {
+		C_ERROR("crt_grp_lookup_create (%s) failed, rc: %d.\n",
+			gc_in->gc_grp_id, rc);
+		C_GOTO(out, rc);
+	}
+	grp_priv->gp_int_grpid = co_hdr->coh_int_grpid;
+	grp_priv->gp_ctx = rpc_priv->crp_pub.cr_ctx;
+	rc = crt_grp_self_init(grp_priv);
+	if (rc != 0) {
+		crt_grp_priv_destroy(grp_priv);
+		C_GOTO(out, rc);
+	}
 
-	pthread_rwlock_wrlock(&grp_priv->gp_rwlock);
-	crt_list_add_tail(&gc_req_item->gc_link, &grp_priv->gp_child_rpcs);
-	pthread_rwlock_unlock(&grp_priv->gp_rwlock);
+	*grp_result = grp_priv;
 
 out:
 	return rc;
 }
 
-static inline void
-gc_del_child_rpc(struct crt_grp_priv *grp_priv, crt_rpc_t *gc_rpc)
+/* destroy the sub-group once the GRP_DESTROY corpc finished on this node */
+void
+crt_grp_corpc_destroy(struct crt_grp_priv *grp_priv)
 {
-	struct gc_req	*gc, *gc_next;
-	int		rc = 0;
-
 	C_ASSERT(grp_priv != NULL);
-	C_ASSERT(gc_rpc != NULL);
-
-	pthread_rwlock_wrlock(&grp_priv->gp_rwlock);
-	crt_list_for_each_entry_safe(gc, gc_next, &grp_priv->gp_child_rpcs,
-				      gc_link) {
-		if (gc->gc_rpc == gc_rpc) {
-			crt_list_del_init(&gc->gc_link);
-			/* decref corresponds to the addref in
-			 * gc_add_child_rpc */
-			rc = crt_req_decref(gc_rpc);
-			C_ASSERT(rc == 0);
-			C_FREE_PTR(gc);
-			break;
-		}
+	if (grp_priv->gp_primary) {
+		C_ERROR("cannot destroy primary group.\n");
+		return;
 	}
-	pthread_rwlock_unlock(&grp_priv->gp_rwlock);
+
+	crt_grp_priv_destroy(grp_priv);
 }
 
 int
@@ -659,48 +1650,17 @@ crt_hdlr_grp_create(crt_rpc_t *rpc_req)
 	rc = crt_group_rank(NULL, &pri_rank);
 	C_ASSERT(rc == 0);
 
-	/*
-	 * the grp_priv->gp_membs will be duplicated from gc_membs and sorted
-	 * unique after returns succeed. (crt_rank_list_dup_sort_uniq).
-	 */
-	rc = crt_grp_lookup_create(gc_in->gc_grp_id, gc_in->gc_membs,
-				   NULL /* grp_create_cb */, NULL /* priv */,
-				   &grp_priv);
-	if (rc == 0) {
-		C_ASSERT(grp_priv != NULL);
-		grp_priv->gp_status = CRT_GRP_NORMAL;
-		grp_priv->gp_ctx = rpc_req->cr_ctx;
-		grp_priv->gp_int_grpid = gc_in->gc_int_grpid;
-	} else if (rc == -CER_EXIST) {
-		C_ASSERT(grp_priv != NULL);
-		if (pri_rank == gc_in->gc_initiate_rank &&
-		    grp_priv->gp_status == CRT_GRP_CREATING) {
-			grp_priv->gp_status = CRT_GRP_NORMAL;
-			grp_priv->gp_ctx = rpc_req->cr_ctx;
-			rc = 0;
-		} else {
-			C_ERROR("crt_grp_lookup_create (%s) failed, existed.\n",
-				gc_in->gc_grp_id);
-			C_GOTO(out, rc);
-		}
-	} else {
-		C_ERROR("crt_grp_lookup_create (%s) failed, rc: %d.\n",
-			gc_in->gc_grp_id, rc);
-		C_GOTO(out, rc);
-	}
-
-	/* assign the size and logical rank number for the subgrp */
-	C_ASSERT(grp_priv->gp_membs != NULL &&
-		 grp_priv->gp_membs->rl_nr.num > 0 &&
-		 grp_priv->gp_membs->rl_ranks != NULL);
-	grp_priv->gp_size = grp_priv->gp_membs->rl_nr.num;
-	rc = crt_idx_in_rank_list(grp_priv->gp_membs, pri_rank,
-				  &grp_priv->gp_self, true /* input */);
-	if (rc != 0) {
-		C_ERROR("crt_idx_in_rank_list(rank %d, group %s) failed, "
-			"rc: %d.\n", pri_rank, gc_in->gc_grp_id, rc);
-		rc = -CER_OOG;
+	/* created by crt_group_create or crt_grp_corpc_create already */
+	pthread_rwlock_rdlock(&crt_grp_list_rwlock);
+	grp_priv = crt_grp_lookup_locked(gc_in->gc_grp_id);
+	pthread_rwlock_unlock(&crt_grp_list_rwlock);
+	if (grp_priv == NULL) {
+		C_ERROR("group %s non-exist.\n", gc_in->gc_grp_id);
+		C_GOTO(out, rc = -CER_NONEXIST);
 	}
+	/* the initiator's group turns normal in gc_rpc_cb */
+	if (pri_rank != gc_in->gc_initiate_rank)
+		grp_priv->gp_status = CRT_GRP_NORMAL;
 
 out:
 	gc_out->gc_rank = pri_rank;
@@ -717,46 +1677,49 @@ out:
 	return rc;
 }
 
+/* keep the first failure of the subtree in the reply */
+static int
+crt_grp_create_corpc_aggregate(crt_rpc_t *source, crt_rpc_t *result,
+			       void *priv)
+{
+	struct crt_grp_create_out	*out_source, *out_result;
+
+	out_source = crt_reply_get(source);
+	out_result = crt_reply_get(result);
+	C_ASSERT(out_source != NULL && out_result != NULL);
+
+	if (out_source->gc_rc != 0 && out_result->gc_rc == 0) {
+		out_result->gc_rc = out_source->gc_rc;
+		out_result->gc_rank = out_source->gc_rank;
+	}
+
+	return 0;
+}
+
+struct crt_corpc_ops crt_grp_create_co_ops = {
+	.co_aggregate = crt_grp_create_corpc_aggregate,
+};
+
 static int
 gc_rpc_cb(const struct crt_cb_info *cb_info)
 {
 	struct crt_grp_priv		*grp_priv;
-	crt_rpc_t			*gc_req;
-	struct crt_grp_create_in	*gc_in;
 	struct crt_grp_create_out	*gc_out;
-	crt_rank_t			 my_rank;
-	bool				 gc_done = false;
-	int				 rc = 0;
+	int				 rc;
 
-	gc_req = cb_info->cci_rpc;
-	gc_in = crt_req_get(gc_req);
-	gc_out = crt_reply_get(gc_req);
-	rc = cb_info->cci_rc;
 	grp_priv = (struct crt_grp_priv *)cb_info->cci_arg;
-	C_ASSERT(grp_priv != NULL && gc_in != NULL && gc_out != NULL);
+	gc_out = crt_reply_get(cb_info->cci_rpc);
+	C_ASSERT(grp_priv != NULL && gc_out != NULL);
 
-	crt_group_rank(NULL, &my_rank);
-	if (rc != 0)
+	rc = cb_info->cci_rc;
+	if (rc != 0) {
 		C_ERROR("RPC error, rc: %d.\n", rc);
-	if (gc_out->gc_rc)
+	} else if (gc_out->gc_rc != 0) {
 		C_ERROR("group create failed at rank %d, rc: %d.\n",
 			gc_out->gc_rank, gc_out->gc_rc);
-
-	/* TODO error handling */
-
-	pthread_rwlock_wrlock(&grp_priv->gp_rwlock);
-	if (rc != 0 || gc_out->gc_rc != 0)
-		grp_priv->gp_rc = (rc == 0) ? gc_out->gc_rc : rc;
-	grp_priv->gp_child_ack_num++;
-	C_ASSERT(grp_priv->gp_child_ack_num <= grp_priv->gp_child_num);
-	if (grp_priv->gp_child_ack_num == grp_priv->gp_child_num)
-		gc_done = true;
-	pthread_rwlock_unlock(&grp_priv->gp_rwlock);
-
-	gc_del_child_rpc(grp_priv, gc_req);
-
-	if (!gc_done)
-		C_GOTO(out, rc);
+		rc = gc_out->gc_rc;
+	}
+	grp_priv->gp_rc = rc;
 
 	if (grp_priv->gp_create_cb != NULL)
 		grp_priv->gp_create_cb(&grp_priv->gp_pub, grp_priv->gp_priv,
@@ -769,23 +1732,30 @@ gc_rpc_cb(const struct crt_cb_info *cb_info)
 		grp_priv->gp_status = CRT_GRP_NORMAL;
 	}
 
-out:
-	return rc;
+	return 0;
 }
 
+/*
+ * The group is created by a GRP_CREATE corpc over the new group's own tree
+ * (the members are piggybacked, see crt_grp_corpc_create), and the replies
+ * are aggregated on the way back, so it takes a number of hops logarithmic
+ * in the group size.
+ */
 int
 crt_group_create(crt_group_id_t grp_id, crt_rank_list_t *member_ranks,
 		 bool populate_now, crt_grp_create_cb_t grp_create_cb,
 		 void *priv)
 {
-	crt_context_t		 crt_ctx;
-	struct crt_grp_priv	*grp_priv = NULL;
-	bool			 gc_req_sent = false;
-	crt_rank_t		 myrank;
-	uint32_t		 grp_size;
-	bool			 in_grp = false;
-	int			 i;
-	int			 rc = 0;
+	crt_context_t			 crt_ctx;
+	struct crt_grp_priv		*grp_priv = NULL;
+	struct crt_grp_create_in	*gc_in;
+	crt_rpc_t			*gc_rpc;
+	bool				 gc_req_sent = false;
+	crt_rank_t			 myrank;
+	uint32_t			 grp_size;
+	bool				 in_grp = false;
+	int				 i;
+	int				 rc = 0;
 
 	if (!crt_initialized()) {
 		C_ERROR("CRT not initialized.\n");
@@ -833,54 +1803,44 @@ crt_group_create(crt_group_id_t grp_id, crt_rank_list_t *member_ranks,
 				   &grp_priv);
 	if (rc != 0) {
 		C_ERROR("crt_grp_lookup_create failed, rc: %d.\n", rc);
+		/* do not destroy the existed group */
+		grp_priv = NULL;
 		C_GOTO(out, rc);
 	}
 	grp_priv->gp_int_grpid = crt_get_subgrp_id();
 	grp_priv->gp_ctx = crt_ctx;
+	rc = crt_grp_self_init(grp_priv);
+	if (rc != 0)
+		C_GOTO(out, rc);
 
 	/* TODO handle the populate_now == false */
 
-	/* send RPC one by one now */
-	for (i = 0; i < member_ranks->rl_nr.num; i++) {
-		crt_rpc_t			*gc_rpc;
-		struct crt_grp_create_in	*gc_in;
-		crt_endpoint_t			 tgt_ep;
-
-		tgt_ep.ep_grp = NULL;
-		tgt_ep.ep_rank = member_ranks->rl_ranks[i];
-		tgt_ep.ep_tag = 0;
-		rc = crt_req_create(crt_ctx, tgt_ep, CRT_OPC_GRP_CREATE,
-				    &gc_rpc);
-		if (rc != 0) {
-			C_ERROR("crt_req_create(CRT_OPC_GRP_CREATE) failed, "
-				"tgt_ep: %d, rc: %d.\n", tgt_ep.ep_rank, rc);
-			grp_priv->gp_child_ack_num +=
-				grp_priv->gp_child_num - i;
-			grp_priv->gp_rc = rc;
-			C_GOTO(out, rc);
-		}
-
-		gc_in = crt_req_get(gc_rpc);
-		C_ASSERT(gc_in != NULL);
-		gc_in->gc_grp_id = grp_id;
-		gc_in->gc_int_grpid = grp_priv->gp_int_grpid;
-		gc_in->gc_membs = member_ranks;
-		crt_group_rank(NULL, &gc_in->gc_initiate_rank);
+	rc = crt_corpc_req_create(crt_ctx, &grp_priv->gp_pub,
+				  NULL /* excluded_ranks */, CRT_OPC_GRP_CREATE,
+				  CRT_BULK_NULL, NULL /* priv */,
+				  CRT_RPC_FLAG_MEMBS_INLINE,
+				  crt_tree_topo(CRT_TREE_KNOMIAL,
+						CRT_GRP_TREE_RATIO),
+				  &gc_rpc);
+	if (rc != 0) {
+		C_ERROR("crt_corpc_req_create(CRT_OPC_GRP_CREATE) failed, "
+			"rc: %d.\n", rc);
+		C_GOTO(out, rc);
+	}
 
-		rc = crt_req_send(gc_rpc, gc_rpc_cb, grp_priv);
-		if (rc != 0) {
-			C_ERROR("crt_req_send(CRT_OPC_GRP_CREATE) failed, "
-				"tgt_ep: %d, rc: %d.\n", tgt_ep.ep_rank, rc);
-			grp_priv->gp_child_ack_num +=
-				grp_priv->gp_child_num - i;
-			grp_priv->gp_rc = rc;
-			C_GOTO(out, rc);
-		}
-		rc = gc_add_child_rpc(grp_priv, gc_rpc);
-		C_ASSERT(rc == 0);
+	gc_in = crt_req_get(gc_rpc);
+	C_ASSERT(gc_in != NULL);
+	gc_in->gc_grp_id = grp_priv->gp_pub.cg_grpid;
+	gc_in->gc_int_grpid = grp_priv->gp_int_grpid;
+	gc_in->gc_membs = NULL;
+	gc_in->gc_initiate_rank = myrank;
 
-		gc_req_sent =  true;
-	}
+	/* from here on the result is reported by gc_rpc_cb */
+	gc_req_sent = true;
+	rc = crt_req_send(gc_rpc, gc_rpc_cb, grp_priv);
+	if (rc != 0)
+		C_ERROR("crt_req_send(CRT_OPC_GRP_CREATE) failed, rc: %d.\n",
+			rc);
 
 out:
 	if (gc_req_sent == false) {
@@ -958,7 +1918,6 @@ crt_hdlr_grp_destroy(crt_rpc_t *rpc_req)
 	struct crt_grp_priv		*grp_priv = NULL;
 	struct crt_grp_destroy_in	*gd_in;
 	struct crt_grp_destroy_out	*gd_out;
-	crt_rank_t			my_rank;
 	int				rc = 0;
 
 	C_ASSERT(rpc_req != NULL);
@@ -973,14 +1932,13 @@ crt_hdlr_grp_destroy(crt_rpc_t *rpc_req)
 		pthread_rwlock_unlock(&crt_grp_list_rwlock);
 		C_GOTO(out, rc = -CER_NONEXIST);
 	}
+	/*
+	 * the group is still needed to forward the corpc, it is destroyed by
+	 * crt_grp_corpc_destroy when the whole subtree replied.
+	 */
+	grp_priv->gp_status = CRT_GRP_DESTROYING;
 	pthread_rwlock_unlock(&crt_grp_list_rwlock);
 
-	rc = crt_group_rank(NULL, &my_rank);
-	C_ASSERT(rc == 0);
-	/* for gd_initiate_rank, destroy the group in gd_rpc_cb */
-	if (my_rank != gd_in->gd_initiate_rank)
-		crt_grp_priv_destroy(grp_priv);
-
 out:
 	crt_group_rank(NULL, &gd_out->gd_rank);
 	gd_out->gd_rc = rc;
@@ -991,68 +1949,70 @@ out:
 	return rc;
 }
 
+/* keep the first failure of the subtree in the reply */
+static int
+crt_grp_destroy_corpc_aggregate(crt_rpc_t *source, crt_rpc_t *result,
+				void *priv)
+{
+	struct crt_grp_destroy_out	*out_source, *out_result;
+
+	out_source = crt_reply_get(source);
+	out_result = crt_reply_get(result);
+	C_ASSERT(out_source != NULL && out_result != NULL);
+
+	if (out_source->gd_rc != 0 && out_result->gd_rc == 0) {
+		out_result->gd_rc = out_source->gd_rc;
+		out_result->gd_rank = out_source->gd_rank;
+	}
+
+	return 0;
+}
+
+struct crt_corpc_ops crt_grp_destroy_co_ops = {
+	.co_aggregate = crt_grp_destroy_corpc_aggregate,
+};
+
 static int
 gd_rpc_cb(const struct crt_cb_info *cb_info)
 {
 	struct crt_grp_priv		*grp_priv;
-	crt_rpc_t			*gd_req;
-	struct crt_grp_destroy_in	*gd_in;
 	struct crt_grp_destroy_out	*gd_out;
-	crt_rank_t			 my_rank;
-	bool				 gd_done = false;
-	int				 rc = 0;
+	int				 rc;
 
-	gd_req = cb_info->cci_rpc;
-	gd_in = crt_req_get(gd_req);
-	gd_out = crt_reply_get(gd_req);
-	rc = cb_info->cci_rc;
 	grp_priv = (struct crt_grp_priv *)cb_info->cci_arg;
-	C_ASSERT(grp_priv != NULL && gd_in != NULL && gd_out != NULL);
+	gd_out = crt_reply_get(cb_info->cci_rpc);
+	C_ASSERT(grp_priv != NULL && gd_out != NULL);
 
-	crt_group_rank(NULL, &my_rank);
-	if (rc != 0)
+	rc = cb_info->cci_rc;
+	if (rc != 0) {
 		C_ERROR("RPC error, rc: %d.\n", rc);
-	if (gd_out->gd_rc)
-		C_ERROR("group create failed at rank %d, rc: %d.\n",
+	} else if (gd_out->gd_rc != 0) {
+		C_ERROR("group destroy failed at rank %d, rc: %d.\n",
 			gd_out->gd_rank, gd_out->gd_rc);
+		rc = gd_out->gd_rc;
+	}
+	grp_priv->gp_rc = rc;
 
-	pthread_rwlock_wrlock(&grp_priv->gp_rwlock);
-	if (rc != 0 || gd_out->gd_rc != 0)
-		grp_priv->gp_rc = (rc == 0) ? gd_out->gd_rc : rc;
-	grp_priv->gp_child_ack_num++;
-	C_ASSERT(grp_priv->gp_child_ack_num <= grp_priv->gp_child_num);
-	if (grp_priv->gp_child_ack_num == grp_priv->gp_child_num)
-		gd_done = true;
-	pthread_rwlock_unlock(&grp_priv->gp_rwlock);
-
-	gc_del_child_rpc(grp_priv, gd_req);
-
-	if (!gd_done)
-		C_GOTO(out, rc);
-
+	/*
+	 * the local group is freed by crt_grp_corpc_destroy after this returns
+	 * (CRT_RPC_FLAG_GRP_DESTROY).
+	 */
 	if (grp_priv->gp_destroy_cb != NULL)
-		grp_priv->gp_destroy_cb(grp_priv->gp_destroy_cb_arg,
-					grp_priv->gp_rc);
+		grp_priv->gp_destroy_cb(grp_priv->gp_destroy_cb_arg, rc);
 
-	if (grp_priv->gp_rc != 0)
-		C_ERROR("group destroy failed, rc: %d.\n", grp_priv->gp_rc);
-	else
-		crt_grp_priv_destroy(grp_priv);
-
-out:
-	return rc;
+	return 0;
 }
 
 int
 crt_group_destroy(crt_group_t *grp, crt_grp_destroy_cb_t grp_destroy_cb,
 		  void *args)
 {
-	struct crt_grp_priv	*grp_priv = NULL;
-	crt_rank_list_t	*member_ranks;
-	crt_context_t		 crt_ctx;
-	bool			 gd_req_sent = false;
-	int			 i;
-	int			 rc = 0;
+	struct crt_grp_priv		*grp_priv = NULL;
+	struct crt_grp_destroy_in	*gd_in;
+	crt_rpc_t			*gd_rpc;
+	crt_context_t			 crt_ctx;
+	bool				 gd_req_sent = false;
+	int				 rc = 0;
 
 	if (!crt_initialized()) {
 		C_ERROR("CRT not initialized.\n");
@@ -1080,11 +2040,8 @@ crt_group_destroy(crt_group_t *grp, crt_grp_destroy_cb_t grp_destroy_cb,
 		C_GOTO(out, rc = -CER_BUSY);
 	}
 	C_ASSERT(grp_priv->gp_rc == 0);
-	member_ranks = grp_priv->gp_membs;
-	C_ASSERT(member_ranks != NULL);
+	C_ASSERT(grp_priv->gp_membs != NULL);
 	grp_priv->gp_status = CRT_GRP_DESTROYING;
-	grp_priv->gp_child_num = member_ranks->rl_nr.num;
-	grp_priv->gp_child_ack_num = 0;
 	grp_priv->gp_destroy_cb = grp_destroy_cb;
 	grp_priv->gp_destroy_cb_arg = args;
 	pthread_rwlock_unlock(&crt_grp_list_rwlock);
@@ -1092,43 +2049,30 @@ crt_group_destroy(crt_group_t *grp, crt_grp_destroy_cb_t grp_destroy_cb,
 	crt_ctx = grp_priv->gp_ctx;
 	C_ASSERT(crt_ctx != NULL);
 
-	/* send RPC one by one now */
-	for (i = 0; i < member_ranks->rl_nr.num; i++) {
-		crt_rpc_t			*gd_rpc;
-		struct crt_grp_destroy_in	*gd_in;
-		crt_endpoint_t			 tgt_ep;
-
-		tgt_ep.ep_grp = NULL;
-		tgt_ep.ep_rank = member_ranks->rl_ranks[i];
-		tgt_ep.ep_tag = 0;
-		rc = crt_req_create(crt_ctx, tgt_ep, CRT_OPC_GRP_DESTROY,
-				    &gd_rpc);
-		if (rc != 0) {
-			C_ERROR("crt_req_create(CRT_OPC_GRP_DESTROY) failed, "
-				"tgt_ep: %d, rc: %d.\n", tgt_ep.ep_rank, rc);
-			grp_priv->gp_child_ack_num +=
-				grp_priv->gp_child_num - i;
-			grp_priv->gp_rc = rc;
-			C_GOTO(out, rc);
-		}
-
-		gd_in = crt_req_get(gd_rpc);
-		C_ASSERT(gd_in != NULL);
-		gd_in->gd_grp_id = grp->cg_grpid;
-		crt_group_rank(NULL, &gd_in->gd_initiate_rank);
+	rc = crt_corpc_req_create(crt_ctx, grp, NULL /* excluded_ranks */,
+				  CRT_OPC_GRP_DESTROY, CRT_BULK_NULL,
+				  NULL /* priv */, CRT_RPC_FLAG_GRP_DESTROY,
+				  crt_tree_topo(CRT_TREE_KNOMIAL,
+						CRT_GRP_TREE_RATIO),
+				  &gd_rpc);
+	if (rc != 0) {
+		C_ERROR("crt_corpc_req_create(CRT_OPC_GRP_DESTROY) failed, "
+			"rc: %d.\n", rc);
+		grp_priv->gp_status = CRT_GRP_NORMAL;
+		C_GOTO(out, rc);
+	}
 
-		rc = crt_req_send(gd_rpc, gd_rpc_cb, grp_priv);
-		if (rc != 0) {
-			C_ERROR("crt_req_send(CRT_OPC_GRP_DESTROY) failed, "
-				"tgt_ep: %d, rc: %d.\n", tgt_ep.ep_rank, rc);
-			grp_priv->gp_child_ack_num +=
-				grp_priv->gp_child_num - i;
-			grp_priv->gp_rc = rc;
-			C_GOTO(out, rc);
-		}
+	gd_in = crt_req_get(gd_rpc);
+	C_ASSERT(gd_in != NULL);
+	gd_in->gd_grp_id = grp->cg_grpid;
+	crt_group_rank(NULL, &gd_in->gd_initiate_rank);
 
-		gd_req_sent =  true;
-	}
+	/* from here on the result is reported by gd_rpc_cb */
+	gd_req_sent = true;
+	rc = crt_req_send(gd_rpc, gd_rpc_cb, grp_priv);
+	if (rc != 0)
+		C_ERROR("crt_req_send(CRT_OPC_GRP_DESTROY) failed, rc: %d.\n",
+			rc);
 
 out:
 	if (gd_req_sent == false) {
@@ -1256,6 +2200,10 @@ crt_primary_grp_init(crt_group_id_t cli_grpid, crt_group_id_t srv_grpid)
 			pmix_gdata->pg_univ_size * sizeof(struct crt_rank_map));
 		if (grp_priv->gp_rank_map == NULL)
 			C_GOTO(out, rc = -CER_NOMEM);
+		C_ALLOC(grp_priv->gp_pmix_ranks,
+			pmix_gdata->pg_univ_size * sizeof(uint32_t));
+		if (grp_priv->gp_pmix_ranks == NULL)
+			C_GOTO(out, rc = -CER_NOMEM);
 
 		rc = crt_pmix_assign_rank(grp_priv);
 		if (rc != 0)
@@ -1313,8 +2261,7 @@ out:
 			grp_priv->gp_self);
 	} else {
 		C_ERROR("crt_primary_grp_init failed, rc: %d.\n", rc);
-		if (grp_priv != NULL)
-			crt_grp_priv_destroy(grp_priv);
+		crt_grp_priv_destroy(grp_priv);
 	}
 
 	return rc;
@@ -1344,6 +2291,11 @@ crt_primary_grp_fini(void)
 		       pmix_gdata->pg_univ_size * sizeof(struct crt_rank_map));
 		grp_priv->gp_rank_map = NULL;
 	}
+	if (grp_priv->gp_pmix_ranks != NULL) {
+		C_FREE(grp_priv->gp_pmix_ranks,
+		       pmix_gdata->pg_univ_size * sizeof(uint32_t));
+		grp_priv->gp_pmix_ranks = NULL;
+	}
 
 	if (crt_is_service()) {
 		rc = crt_grp_lc_destroy(grp_priv);
@@ -1371,8 +2323,6 @@ int
 crt_hdlr_uri_lookup(crt_rpc_t *rpc_req)
 {
 	struct crt_grp_priv		*grp_priv;
-	struct crt_context		*crt_ctx;
-	struct crt_hg_context		*hg_ctx;
 	struct crt_uri_lookup_in	*ul_in;
 	struct crt_uri_lookup_out	*ul_out;
 	int				rc = 0;
@@ -1398,11 +2348,7 @@ crt_hdlr_uri_lookup(crt_rpc_t *rpc_req)
 		C_GOTO(out, rc = 0);
 	}
 
-	crt_ctx = (struct crt_context *)rpc_req->cr_ctx;
-	hg_ctx = &crt_ctx->cc_hg_ctx;
-	rc = crt_grp_lc_lookup(grp_priv, crt_ctx->cc_idx, hg_ctx,
-			       ul_in->ul_rank, 0 /* tag */,
-			       &ul_out->ul_uri, NULL /* na_addr */);
+	rc = crt_grp_lc_lookup(grp_priv, ul_in->ul_rank, &ul_out->ul_uri);
 	if (rc != 0)
 		C_ERROR("crt_grp_lc_lookup rank %d failed, rc: %d.\n",
 			ul_in->ul_rank, rc);
@@ -1416,6 +2362,161 @@ out:
 	return rc;
 }
 
+static int
+crt_uri_table_push_cb(const struct crt_bulk_cb_info *cb_info)
+{
+	struct crt_bulk_desc		*bulk_desc = cb_info->bci_bulk_desc;
+	crt_rpc_t			*rpc_req = bulk_desc->bd_rpc;
+	struct crt_uri_table_out	*ut_out;
+	char				*table = cb_info->bci_arg;
+	int				 rc;
+
+	ut_out = crt_reply_get(rpc_req);
+	C_ASSERT(ut_out != NULL);
+	if (cb_info->bci_rc != 0) {
+		C_ERROR("URI table bulk transfer failed, rc: %d.\n",
+			cb_info->bci_rc);
+		ut_out->ut_rc = cb_info->bci_rc;
+	}
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		C_ERROR("crt_reply_send failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_req->cr_opc);
+
+	crt_bulk_free(bulk_desc->bd_local_hdl);
+	C_FREE(table, bulk_desc->bd_len);
+	crt_req_decref(rpc_req);
+	return 0;
+}
+
+/*
+ * reply the URIs of the ranks asked (or of all ranks), NUL terminated and
+ * packed back to back. Tables larger than CRT_URI_TABLE_INLINE_MAX are pushed
+ * to the client's bulk buffer, -CER_TRUNC with the table size is replied if
+ * there is no buffer or it is too small.
+ */
+int
+crt_hdlr_uri_table(crt_rpc_t *rpc_req)
+{
+	struct crt_grp_priv		*grp_priv;
+	struct crt_uri_table_in		*ut_in;
+	struct crt_uri_table_out	*ut_out;
+	struct crt_bulk_desc		 bulk_desc;
+	crt_sg_list_t			 sgl;
+	crt_iov_t			 iov;
+	crt_bulk_t			 local_bulk = CRT_BULK_NULL;
+	crt_size_t			 bulk_len;
+	crt_phy_addr_t			 uri;
+	crt_rank_t			 rank;
+	char				*table = NULL;
+	size_t				 size = 0, len;
+	uint32_t			 i, num;
+	int				 rc = 0;
+
+	C_ASSERT(rpc_req != NULL);
+	ut_in = crt_req_get(rpc_req);
+	ut_out = crt_reply_get(rpc_req);
+	C_ASSERT(ut_in != NULL && ut_out != NULL);
+
+	if (!crt_is_service()) {
+		C_ERROR("crt_hdlr_uri_table invalid on client.\n");
+		C_GOTO(out, rc = -CER_PROTO);
+	}
+	grp_priv = crt_gdata.cg_grp->gg_srv_pri_grp;
+	if (strncmp(ut_in->ut_grp_id, grp_priv->gp_pub.cg_grpid,
+		    CRT_GROUP_ID_MAX_LEN) != 0) {
+		C_ERROR("ut_grp_id %s mismatch with gg_srv_pri_grp %s.\n",
+			ut_in->ut_grp_id, grp_priv->gp_pub.cg_grpid);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+
+	num = (ut_in->ut_ranks == NULL) ? grp_priv->gp_size :
+	      ut_in->ut_ranks->rl_nr.num;
+	for (i = 0; i < num; i++) {
+		rank = (ut_in->ut_ranks == NULL) ? i :
+		       ut_in->ut_ranks->rl_ranks[i];
+		if (rank >= grp_priv->gp_size) {
+			C_ERROR("invalid rank %d, group size %d.\n",
+				rank, grp_priv->gp_size);
+			C_GOTO(out, rc = -CER_INVAL);
+		}
+		rc = crt_grp_lc_lookup(grp_priv, rank, &uri);
+		if (rc != 0) {
+			C_ERROR("crt_grp_lc_lookup rank %d failed, rc: %d.\n",
+				rank, rc);
+			C_GOTO(out, rc);
+		}
+		size += strlen(uri) + 1;
+	}
+	ut_out->ut_size = size;
+	if (size > CRT_URI_TABLE_INLINE_MAX) {
+		if (ut_in->ut_bulk == CRT_BULK_NULL)
+			C_GOTO(out, rc = -CER_TRUNC);
+		rc = crt_bulk_get_len(ut_in->ut_bulk, &bulk_len);
+		if (rc != 0)
+			C_GOTO(out, rc);
+		if (bulk_len < size)
+			C_GOTO(out, rc = -CER_TRUNC);
+	}
+
+	if (size == 0)
+		C_GOTO(out, rc = 0);
+	C_ALLOC(table, size);
+	if (table == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+	for (i = 0, len = 0; i < num; i++) {
+		rank = (ut_in->ut_ranks == NULL) ? i :
+		       ut_in->ut_ranks->rl_ranks[i];
+		/* cached URIs are never replaced */
+		uri = grp_priv->gp_lookup_cache[rank].li_base_phy_addr;
+		strcpy(table + len, uri);
+		len += strlen(uri) + 1;
+	}
+
+	if (size <= CRT_URI_TABLE_INLINE_MAX) {
+		crt_iov_set(&ut_out->ut_table, table, size);
+		C_GOTO(out, rc = 0);
+	}
+
+	iov.iov_buf = table;
+	iov.iov_buf_len = size;
+	iov.iov_len = size;
+	sgl.sg_nr.num = 1;
+	sgl.sg_iovs = &iov;
+	rc = crt_bulk_create(rpc_req->cr_ctx, &sgl, CRT_BULK_RO, &local_bulk);
+	if (rc != 0) {
+		C_ERROR("crt_bulk_create failed, rc: %d.\n", rc);
+		C_GOTO(out, rc);
+	}
+	rc = crt_req_addref(rpc_req);
+	C_ASSERT(rc == 0);
+	bulk_desc.bd_rpc = rpc_req;
+	bulk_desc.bd_bulk_op = CRT_BULK_PUT;
+	bulk_desc.bd_remote_hdl = ut_in->ut_bulk;
+	bulk_desc.bd_remote_off = 0;
+	bulk_desc.bd_local_hdl = local_bulk;
+	bulk_desc.bd_local_off = 0;
+	bulk_desc.bd_len = size;
+	rc = crt_bulk_transfer(&bulk_desc, crt_uri_table_push_cb, table, NULL);
+	if (rc == 0)
+		/* replied by crt_uri_table_push_cb */
+		return 0;
+	C_ERROR("crt_bulk_transfer failed, rc: %d.\n", rc);
+	crt_req_decref(rpc_req);
+
+out:
+	ut_out->ut_rc = rc;
+	rc = crt_reply_send(rpc_req);
+	if (rc != 0)
+		C_ERROR("crt_reply_send failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_req->cr_opc);
+	if (local_bulk != CRT_BULK_NULL)
+		crt_bulk_free(local_bulk);
+	if (table != NULL)
+		C_FREE(table, size);
+	return rc;
+}
+
 int
 crt_grp_uri_lookup(struct crt_grp_priv *grp_priv, crt_rank_t rank, char **uri)
 {
@@ -1493,6 +2594,13 @@ crt_grp_uri_lookup(struct crt_grp_priv *grp_priv, crt_rank_t rank, char **uri)
 			}
 		}
 		crt_req_decref(rpc_req);
+	} else if (rank == grp_priv->gp_self) {
+		*uri = strndup(crt_gdata.cg_addr, CRT_ADDR_STR_MAX_LEN);
+		if (*uri == NULL)
+			rc = -CER_NOMEM;
+	} else if (grp_priv->gp_pmix_ranks != NULL) {
+		/* collected by the fence of crt_pmix_assign_rank */
+		rc = crt_pmix_uri_get(grp_priv, rank, uri);
 	} else {
 		/* server side directly lookup through PMIx */
 		rc = crt_pmix_uri_lookup(grp_id, rank, uri);
@@ -1643,8 +2751,7 @@ crt_grp_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp)
 out:
 	if (rc != 0) {
 		C_ERROR("crt_grp_attach, failed, rc: %d.\n", rc);
-		if (grp_priv != NULL)
-			crt_grp_priv_destroy(grp_priv);
+		crt_grp_priv_destroy(grp_priv);
 	}
 	return rc;
 }
@@ -1861,33 +2968,32 @@ crt_grp_attach_info_filename(struct crt_grp_priv *grp_priv)
 }
 
 /**
- * Save attach info to file with the name "/tmp/grpid.attach_info".
- * The format of the file is:
- * line 1: the process set name
- * line 2: process set size
- * line 3: starting from this line, each line contains a rank (uri, pair) like:
- *         0 tcp://192.168.0.1:1234
- *
- * An example file named service_set.attach_info:
+ * Save attach info to file with the name "/tmp/prefix_grpid.attach_info_tmp",
+ * in the binary format of struct crt_attach_info: a header with the group
+ * name and size, followed by one fixed length URI slot per rank, e.g. for a
+ * group of 5 ranks:
  * ========================
- * service_set
- * 5
- * 0 tcp://192.168.0.1:1234
- * 1 tcp://192.168.0.1:1238
- * 2 tcp://192.168.0.1:1232
- * 3 tcp://192.168.0.1:1231
- * 4 tcp://192.168.0.1:1244
+ * magic, version, size 5, slot_len 128, "service_set"
+ * slot 0: tcp://192.168.0.1:1234
+ * slot 1: tcp://192.168.0.1:1238
+ * ...
+ * slot 4: tcp://192.168.0.1:1244
  * ========================
+ * The file is written to a temporary file and renamed, so a loading client
+ * either sees the complete file or no file.
  */
 int
 crt_grp_save_attach_info(struct crt_grp_priv *grp_priv)
 {
-	FILE		*fp = NULL;
-	char		*filename = NULL;
-	bool		allow_singleton = false;
-	crt_group_id_t	grpid;
-	crt_rank_t	rank;
-	int		rc = 0;
+	FILE			*fp = NULL;
+	char			*filename = NULL;
+	char			*tmp_name = NULL;
+	struct crt_attach_info	 info;
+	char			 slot[CRT_ADDR_STR_MAX_LEN];
+	bool			 allow_singleton = false;
+	crt_group_id_t		 grpid;
+	crt_rank_t		 rank;
+	int			 rc = 0;
 
 	C_ASSERT(grp_priv != NULL);
 	if (grp_priv->gp_primary == 0 || grp_priv->gp_local == 0) {
@@ -1910,23 +3016,27 @@ crt_grp_save_attach_info(struct crt_grp_priv *grp_priv)
 	filename = crt_grp_attach_info_filename(grp_priv);
 	if (filename == NULL)
 		C_GOTO(out, rc = -CER_NOMEM);
+	rc = asprintf(&tmp_name, "%s.%d", filename, getpid());
+	if (rc == -1) {
+		tmp_name = NULL;
+		C_GOTO(out, rc = -CER_NOMEM);
+	}
 
-	fp = fopen(filename, "w");
+	fp = fopen(tmp_name, "w");
 	if (fp == NULL) {
 		C_ERROR("cannot create file %s(%s).\n",
-			filename, strerror(errno));
-		C_GOTO(out, rc = crt_errno2cer(errno));
-	}
-	rc = fprintf(fp, "%s %s\n", "name", grpid);
-	if (rc < 0) {
-		C_ERROR("write to file %s failed (%s).\n",
-			filename, strerror(errno));
+			tmp_name, strerror(errno));
 		C_GOTO(out, rc = crt_errno2cer(errno));
 	}
-	rc = fprintf(fp, "%s %d\n", "size", grp_priv->gp_size);
-	if (rc < 0) {
+	memset(&info, 0, sizeof(info));
+	info.ai_magic = CRT_ATTACH_INFO_MAGIC;
+	info.ai_version = CRT_ATTACH_INFO_VERSION;
+	info.ai_size = grp_priv->gp_size;
+	info.ai_slot_len = CRT_ADDR_STR_MAX_LEN;
+	strncpy(info.ai_grpid, grpid, CRT_GROUP_ID_MAX_LEN - 1);
+	if (fwrite(&info, sizeof(info), 1, fp) != 1) {
 		C_ERROR("write to file %s failed (%s).\n",
-			filename, strerror(errno));
+			tmp_name, strerror(errno));
 		C_GOTO(out, rc = crt_errno2cer(errno));
 	}
 	/* save all address URIs in the primary group */
@@ -1934,9 +3044,7 @@ crt_grp_save_attach_info(struct crt_grp_priv *grp_priv)
 		crt_phy_addr_t	addr_uri;
 
 		addr_uri = NULL;
-		rc = crt_grp_lc_lookup(grp_priv, 0 /* ctx_idx */,
-				       NULL /* hg_ctx */, rank, 0 /* tag */,
-				       &addr_uri, NULL /* na_addr */);
+		rc = crt_grp_lc_lookup(grp_priv, rank, &addr_uri);
 		if (rc != 0) {
 			C_ERROR("crt_grp_lc_lookup(grp %s, rank %d) failed, "
 				"rc: %d.\n", grpid, rank, rc);
@@ -1944,41 +3052,58 @@ crt_grp_save_attach_info(struct crt_grp_priv *grp_priv)
 		}
 		C_ASSERT(addr_uri != NULL);
 
-		rc = fprintf(fp, "%d %s\n", rank, addr_uri);
-		if (rc < 0) {
+		memset(slot, 0, sizeof(slot));
+		strncpy(slot, addr_uri, CRT_ADDR_STR_MAX_LEN - 1);
+		if (fwrite(slot, sizeof(slot), 1, fp) != 1) {
 			C_ERROR("write to file %s failed (%s).\n",
-				filename, strerror(errno));
+				tmp_name, strerror(errno));
 			C_GOTO(out, rc = crt_errno2cer(errno));
 		}
-		rc = 0;
 	}
 
 	if (fclose(fp) != 0) {
 		C_ERROR("file %s closing failed (%s).\n",
-			filename, strerror(errno));
+			tmp_name, strerror(errno));
 		fp = NULL;
 		C_GOTO(out, rc = crt_errno2cer(errno));
 	}
 	fp = NULL;
 
+	if (rename(tmp_name, filename) != 0) {
+		C_ERROR("rename %s to %s failed (%s).\n",
+			tmp_name, filename, strerror(errno));
+		C_GOTO(out, rc = crt_errno2cer(errno));
+	}
+
 out:
-	if (filename != NULL)
-		free(filename);
 	if (fp != NULL)
 		fclose(fp);
+	if (rc != 0 && tmp_name != NULL)
+		unlink(tmp_name);
+	if (tmp_name != NULL)
+		free(tmp_name);
+	if (filename != NULL)
+		free(filename);
 	return rc;
 }
 
+/*
+ * map the attach info file saved by crt_grp_save_attach_info, the lookup
+ * cache created later points to its URI slots (see crt_grp_lc_create), so
+ * every rank's URI is known without parsing the file or asking the PSR.
+ */
 int
 crt_grp_load_attach_info(struct crt_grp_priv *grp_priv)
 {
-	char		*filename;
-	FILE		*fp = NULL;
-	crt_rank_t	rank;
-	crt_rank_t	psr_rank;
-	crt_group_id_t	grpid, grpname = NULL;
-	crt_phy_addr_t	addr_str = NULL;
-	int		rc = 0;
+	char			*filename;
+	struct crt_attach_info	*info = MAP_FAILED;
+	struct stat		 st;
+	crt_rank_t		 psr_rank;
+	crt_group_id_t		 grpid;
+	const char		*uri;
+	uint32_t		 i;
+	int			 fd = -1;
+	int			 rc = 0;
 
 	C_ASSERT(grp_priv != NULL);
 
@@ -1987,59 +3112,79 @@ crt_grp_load_attach_info(struct crt_grp_priv *grp_priv)
 	if (filename == NULL)
 		C_GOTO(out, rc = -CER_NOMEM);
 
-	fp = fopen(filename, "r");
-	if (fp == NULL) {
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
 		C_ERROR("open file %s failed (%s).\n",
 			filename, strerror(errno));
 		C_GOTO(out, rc = crt_errno2cer(errno));
 	}
-
-	C_ALLOC(grpname, CRT_GROUP_ID_MAX_LEN);
-	if (grpname == NULL)
-		C_GOTO(out, rc = -CER_NOMEM);
-	rc = fscanf(fp, "%*s%s", grpname);
-	if (rc == EOF) {
-		C_ERROR("read from file %s failed (%s).\n",
+	if (fstat(fd, &st) != 0) {
+		C_ERROR("stat file %s failed (%s).\n",
 			filename, strerror(errno));
 		C_GOTO(out, rc = crt_errno2cer(errno));
 	}
-	if (strncmp(grpname, grpid, CRT_GROUP_ID_MAX_LEN != 0)) {
-		C_ERROR("grpname %s in file mismatch with grpid %s.\n",
-			grpname, grpid);
+	if (st.st_size < sizeof(*info)) {
+		C_ERROR("file %s too short, size %zu.\n",
+			filename, (size_t)st.st_size);
 		C_GOTO(out, rc = -CER_INVAL);
 	}
-
-	rc = fscanf(fp, "%*s%d", &grp_priv->gp_size);
-	if (rc == EOF) {
-		C_ERROR("read from file %s failed (%s).\n",
+	info = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (info == MAP_FAILED) {
+		C_ERROR("mmap file %s failed (%s).\n",
 			filename, strerror(errno));
 		C_GOTO(out, rc = crt_errno2cer(errno));
 	}
+
+	if (info->ai_magic != CRT_ATTACH_INFO_MAGIC ||
+	    info->ai_version != CRT_ATTACH_INFO_VERSION) {
+		C_ERROR("file %s bad magic 0x%x or version %d.\n",
+			filename, info->ai_magic, info->ai_version);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+	if (strncmp(info->ai_grpid, grpid, CRT_GROUP_ID_MAX_LEN) != 0) {
+		C_ERROR("grpname %.*s in file mismatch with grpid %s.\n",
+			CRT_GROUP_ID_MAX_LEN, info->ai_grpid, grpid);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+	if (info->ai_size == 0 || info->ai_slot_len != CRT_ADDR_STR_MAX_LEN ||
+	    st.st_size != sizeof(*info) +
+			  (size_t)info->ai_size * info->ai_slot_len) {
+		C_ERROR("file %s bad size %d, slot_len %d, file size %zu.\n",
+			filename, info->ai_size, info->ai_slot_len,
+			(size_t)st.st_size);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+	/* every slot must hold a non-empty URI terminated within the slot */
+	for (i = 0; i < info->ai_size; i++) {
+		uri = crt_attach_info_uri(info, i);
+		if (uri[0] == '\0' ||
+		    memchr(uri, '\0', info->ai_slot_len) == NULL) {
+			C_ERROR("file %s bad URI slot of rank %d.\n",
+				filename, i);
+			C_GOTO(out, rc = -CER_INVAL);
+		}
+	}
+	grp_priv->gp_size = info->ai_size;
+
 	/** pick a random rank between 0 and size - 1 as the PSR */
 	psr_rank = rand() % grp_priv->gp_size;
-	C_ALLOC(addr_str, CRT_ADDR_STR_MAX_LEN);
-	if (addr_str == NULL)
+	grp_priv->gp_psr_rank = psr_rank;
+	grp_priv->gp_psr_phy_addr = strndup(crt_attach_info_uri(info, psr_rank),
+					    CRT_ADDR_STR_MAX_LEN - 1);
+	if (grp_priv->gp_psr_phy_addr == NULL)
 		C_GOTO(out, rc = -CER_NOMEM);
-	for (rank = 0; rank <= psr_rank; rank++) {
-		rc = fscanf(fp, "%d %s", &grp_priv->gp_psr_rank,
-			    (char *)addr_str);
-		if (rc == EOF)
-			break;
-	}
-	rc = 0;
-	C_ASSERT(grp_priv->gp_psr_rank == psr_rank);
-	grp_priv->gp_psr_phy_addr = addr_str;
+
+	grp_priv->gp_attach_info = info;
+	grp_priv->gp_attach_info_len = st.st_size;
 
 out:
-	if (fp)
-		fclose(fp);
+	if (fd >= 0)
+		close(fd);
 	if (filename != NULL)
 		free(filename);
-	if (grpname != NULL)
-		C_FREE(grpname, CRT_GROUP_ID_MAX_LEN);
 	if (rc != 0) {
-		if (addr_str != NULL)
-			C_FREE(addr_str, CRT_ADDR_STR_MAX_LEN);
+		if (info != MAP_FAILED)
+			munmap(info, st.st_size);
 		C_ERROR("crt_grp_load_attach_info (grpid %s) failed, rc: %d.\n",
 			grpid, rc);
 	}
@@ -62,8 +62,8 @@ struct crt_rank_map {
 	enum crt_rank_status	rm_status; /* health status */
 };
 
-/* (1 << CRT_LOOKUP_CACHE_BITS) is the number of buckets of lookup hash table */
-#define CRT_LOOKUP_CACHE_BITS	(4)
+/* minimal number of tag slots per context in the lookup cache */
+#define CRT_LC_TAG_NUM_MIN	(4)
 
 struct crt_grp_priv {
 	crt_list_t		 gp_link; /* link to crt_grp_list */
@@ -101,27 +101,54 @@ struct crt_grp_priv {
 	crt_rank_t		 gp_psr_rank;
 	/* PSR phy addr address in attached group */
 	crt_phy_addr_t		 gp_psr_phy_addr;
-	/* address lookup cache, only valid for primary group */
-	struct chash_table     **gp_lookup_cache;
+	/* address lookup cache indexed by rank, only valid for primary group */
+	struct crt_lookup_item	*gp_lookup_cache;
+	/* max number of cached connected addresses, zero for no limit */
+	uint32_t		 gp_lc_addr_max;
+	/* number of cached connected addresses, only counted if capped */
+	uint32_t		 gp_lc_addr_num;
+	/* cached connected addresses in LRU order, only used if capped */
+	crt_list_t		 gp_lc_lru;
+	/* serializes the lookup cache updates (readers are lock-free) */
+	pthread_mutex_t		 gp_lc_mutex;
+	/*
+	 * mapped attach info file of singleton client, the cached URIs point
+	 * into its URI slots
+	 */
+	struct crt_attach_info	*gp_attach_info;
+	size_t			 gp_attach_info_len;
+	/* max group size for fetching the whole URI table at once */
+	uint32_t		 gp_uri_fetch_max;
+	/* entries waiting for URIs, linked by crt_addr_pend::cap_uri_link */
+	crt_list_t		 gp_uri_waiters;
+	/* URI_TABLE RPC in flight / whole table asked already */
+	uint32_t		 gp_uri_fetching:1,
+				 gp_uri_table_asked:1;
 	uint32_t		 gp_primary:1, /* flag of primary group */
 				 gp_local:1, /* flag of local group, false means
 					      * attached remote group */
 				 gp_service:1; /* flag of service group */
 
+	/*
+	 * memoized tree children lists (struct crt_tree_children) in MRU
+	 * order, see crt_tree_children_lookup
+	 */
+	crt_list_t		 gp_tree_cache;
+	uint32_t		 gp_tree_cache_num;
+	pthread_mutex_t		 gp_tree_cache_mutex;
+
 	/* rank map array, only needed for local primary group */
 	struct crt_rank_map	*gp_rank_map;
+	/* PMIx global rank of each rank, the reverse of gp_rank_map */
+	uint32_t		*gp_pmix_ranks;
 	/* pmix errhdlr ref, used for PMIx_Deregister_event_handler */
 	size_t			 gp_errhdlr_ref;
 
-	/* TODO: reuse crt_corpc_info here */
 	/*
 	 * Some temporary info used for group creating/destroying, valid when
-	 * gp_status is CRT_GRP_CREATING or CRT_GRP_DESTROYING.
+	 * gp_status is CRT_GRP_CREATING or CRT_GRP_DESTROYING. Both propagate
+	 * as a corpc over the group's tree, see crt_group_create.
 	 */
-	struct crt_rpc_priv	*gp_parent_rpc; /* parent RPC, NULL on root */
-	crt_list_t		 gp_child_rpcs; /* child RPCs list */
-	uint32_t		 gp_child_num;
-	uint32_t		 gp_child_ack_num;
 	int			 gp_rc; /* temporary recoded return code */
 	crt_rank_list_t		*gp_failed_ranks; /* failed ranks */
 
@@ -132,22 +159,34 @@ struct crt_grp_priv {
 	pthread_rwlock_t	gp_rwlock; /* protect all fields above */
 };
 
-/* lookup cache item for one target */
+/*
+ * connected addresses of one rank, slot (ctx_idx * la_tag_num + tag). Grown
+ * lazily with gp_lc_mutex held, the replaced array is kept in la_prev (freed
+ * with the group) as lock-free readers may still use it. If the cache is
+ * capped, an array of struct crt_lc_lru pointers follows the slots.
+ */
+struct crt_lc_addrs {
+	uint32_t		 la_ctx_num;
+	uint32_t		 la_tag_num;
+	struct crt_lc_addrs	*la_prev;
+	na_addr_t		 la_addr[0];
+};
+
+/* LRU node of one cached connected address */
+struct crt_lc_lru {
+	/* link to crt_grp_priv::gp_lc_lru */
+	crt_list_t		 ll_link;
+	crt_rank_t		 ll_rank;
+	uint32_t		 ll_ctx_idx;
+	uint32_t		 ll_tag;
+};
+
+/* lookup cache item for one rank, shared by all contexts */
 struct crt_lookup_item {
-	/* link to crt_grp_priv::gp_lookup_cache[ctx_idx] */
-	crt_list_t		 li_link;
-	/* point back to grp_priv */
-	struct crt_grp_priv	*li_grp_priv;
-	/* rank of the target */
-	crt_rank_t		 li_rank;
-	/* base phy addr published through PMIx */
+	/* base phy addr published through PMIx, NULL until resolved */
 	crt_phy_addr_t		 li_base_phy_addr;
-	/* connected HG addr */
-	na_addr_t		 li_tag_addr[CRT_SRV_CONTEXT_NUM];
-	/* reference count */
-	uint32_t		 li_ref;
-	uint32_t		 li_initialized:1;
-	pthread_mutex_t		 li_mutex;
+	/* connected HG addrs, NULL until the first connection */
+	struct crt_lc_addrs	*li_addrs;
 };
 
 /* structure of global group data */
@@ -175,22 +214,136 @@ struct crt_grp_gdata {
 	pthread_rwlock_t	 gg_rwlock;
 };
 
+/* requests waiting for the address of one endpoint, see crt_grp_addr_pend */
+struct crt_addr_pend {
+	/* link to crt_context::cc_addr_pend_list */
+	crt_list_t		 cap_link;
+	struct crt_context	*cap_ctx;
+	struct crt_grp_priv	*cap_grp_priv;
+	crt_rank_t		 cap_rank;
+	uint32_t		 cap_tag;
+	/* queued requests, linked by crt_rpc_priv::crp_epi_link */
+	crt_list_t		 cap_reqs;
+	/* crt_group_connect slots, struct crt_grp_conn_slot */
+	crt_list_t		 cap_conns;
+	/* link to crt_grp_priv::gp_uri_waiters */
+	crt_list_t		 cap_uri_link;
+	/* URI being connected, kept for HG_Addr_lookup */
+	char			 cap_uri[CRT_ADDR_STR_MAX_LEN];
+	/* HG class of cap_ctx, frees the address looked up once detached */
+	hg_class_t		*cap_hgcla;
+	/* waiters fail with -CER_TIMEDOUT after it (us) */
+	uint64_t		 cap_deadline;
+	/*
+	 * taken off cap_ctx by timeout or forced destroy, the entry is freed
+	 * by the lookup in flight and must not touch cap_ctx any more
+	 */
+	bool			 cap_detached;
+};
+
+/* branch ratio of the knomial tree creating/destroying sub-groups */
+#define CRT_GRP_TREE_RATIO		(4)
+
+/* max number of ranks asked by one URI_TABLE RPC for waiting entries */
+#define CRT_URI_FETCH_BATCH		(256)
+
+/* max number of address lookups in flight per crt_group_connect */
+#define CRT_GROUP_CONNECT_WINDOW	(64)
+
+/* one (rank, tag) pair being connected by crt_group_connect */
+struct crt_grp_conn_slot {
+	/* link to crt_addr_pend::cap_conns */
+	crt_list_t		 cs_link;
+	struct crt_grp_connect	*cs_conn;
+	/* being issued by crt_grp_connect_next / completed while issuing */
+	uint32_t		 cs_issuing:1,
+				 cs_done:1;
+};
+
+/* crt_group_connect in progress, each slot connects one pair at a time */
+struct crt_grp_connect {
+	struct crt_context	*gc_ctx;
+	struct crt_grp_priv	*gc_grp_priv;
+	/* ranks to connect, NULL for all ranks of the group */
+	crt_rank_t		*gc_ranks;
+	uint32_t		 gc_rank_num;
+	uint32_t		*gc_tags;
+	uint32_t		 gc_tag_num;
+	/* pair index is (rank index * gc_tag_num + tag index) */
+	uint64_t		 gc_next;
+	uint64_t		 gc_total;
+	/* slots not finished yet, plus one while starting */
+	uint32_t		 gc_active;
+	/* first error */
+	int			 gc_rc;
+	crt_grp_connect_cb_t	 gc_cb;
+	void			*gc_arg;
+	/* protects the fields above and the slot flags */
+	pthread_mutex_t		 gc_mutex;
+	uint32_t		 gc_slot_num;
+	struct crt_grp_conn_slot gc_slots[0];
+};
+
 int crt_hdlr_grp_create(crt_rpc_t *rpc_req);
 int crt_hdlr_grp_destroy(crt_rpc_t *rpc_req);
 int crt_hdlr_uri_lookup(crt_rpc_t *rpc_req);
+int crt_hdlr_uri_table(crt_rpc_t *rpc_req);
+int crt_grp_corpc_create(struct crt_rpc_priv *rpc_priv,
+			 struct crt_grp_priv **grp_priv);
+void crt_grp_corpc_destroy(struct crt_grp_priv *grp_priv);
+extern struct crt_corpc_ops crt_grp_create_co_ops;
+extern struct crt_corpc_ops crt_grp_destroy_co_ops;
 int crt_grp_attach(crt_group_id_t srv_grpid, crt_group_t **attached_grp);
 int crt_grp_detach(crt_group_t *attached_grp);
 int crt_grp_uri_lookup(struct crt_grp_priv *grp_priv, crt_rank_t rank,
 		       char **uri);
-int crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, int ctx_idx,
-		      struct crt_hg_context *hg_ctx, crt_rank_t rank,
-		      uint32_t tag, crt_phy_addr_t *base_addr,
-		      na_addr_t *na_addr);
+int crt_grp_lc_lookup(struct crt_grp_priv *grp_priv, crt_rank_t rank,
+		      crt_phy_addr_t *base_addr);
+int crt_grp_lc_addr_get(struct crt_grp_priv *grp_priv, int ctx_idx,
+			crt_rank_t rank, uint32_t tag,
+			crt_phy_addr_t *base_addr, na_addr_t *na_addr);
+int crt_grp_addr_pend(struct crt_rpc_priv *rpc_priv);
+int crt_grp_addr_unpend(struct crt_rpc_priv *rpc_priv);
+void crt_grp_addr_pend_expire(struct crt_context *ctx, uint64_t ts_now);
+void crt_grp_addr_pend_abort(struct crt_context *ctx);
+void crt_grp_lc_ctx_purge(struct crt_context *ctx);
 struct crt_grp_priv *crt_grp_lookup_int_grpid(uint64_t int_grpid);
 int crt_grp_init(crt_group_id_t cli_grpid, crt_group_id_t srv_grpid);
 int crt_grp_fini(void);
 
 #define CRT_ALLOW_SINGLETON_ENV		"CRT_ALLOW_SINGLETON"
+/* max number of connected addresses cached per primary group */
+#define CRT_LC_ADDR_MAX_ENV		"CRT_LC_ADDR_MAX"
+/* max attached group size for fetching its whole URI table at once */
+#define CRT_URI_FETCH_MAX_ENV		"CRT_URI_FETCH_MAX"
+#define CRT_URI_FETCH_MAX_DEFAULT	(16384)
+
+#define CRT_ATTACH_INFO_MAGIC		(0x43525441) /* "CRTA" */
+#define CRT_ATTACH_INFO_VERSION		(1)
+
+/*
+ * binary attach info file of a primary service group, saved by the servers
+ * and mapped by singleton clients. The header is followed by gp_size URI
+ * slots of ai_slot_len bytes indexed by rank, each holds a NUL terminated URI
+ * so the rank's URI is at a fixed offset and needs no parsing.
+ */
+struct crt_attach_info {
+	uint32_t		ai_magic;
+	uint32_t		ai_version;
+	/* group size, number of URI slots */
+	uint32_t		ai_size;
+	/* length of each URI slot, CRT_ADDR_STR_MAX_LEN */
+	uint32_t		ai_slot_len;
+	char			ai_grpid[CRT_GROUP_ID_MAX_LEN];
+	char			ai_uris[0];
+};
+
+static inline char *
+crt_attach_info_uri(struct crt_attach_info *info, crt_rank_t rank)
+{
+	return info->ai_uris + (size_t)rank * info->ai_slot_len;
+}
+
 int crt_grp_save_attach_info(struct crt_grp_priv *grp_priv);
 int crt_grp_load_attach_info(struct crt_grp_priv *grp_priv);
 
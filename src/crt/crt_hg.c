@@ -162,6 +162,45 @@ out:
 	return rc;
 }
 
+/* register the RPC IDs shared by all opcodes to \a hg_class */
+static int
+crt_hg_reg_rpcids(hg_class_t *hg_class)
+{
+	hg_return_t	hg_ret;
+	int		rc;
+
+	rc = crt_hg_reg(hg_class, CRT_HG_RPCID,
+			(crt_proc_cb_t)crt_proc_in_common,
+			(crt_proc_cb_t)crt_proc_out_common,
+			(crt_hg_rpc_cb_t)crt_rpc_handler_common);
+	if (rc != 0) {
+		C_ERROR("crt_hg_reg(rpcid: 0x%x), failed rc: %d.\n",
+			CRT_HG_RPCID, rc);
+		C_GOTO(out, rc);
+	}
+
+	rc = crt_hg_reg(hg_class, CRT_HG_ONEWAY_RPCID,
+			(crt_proc_cb_t)crt_proc_in_common,
+			(crt_proc_cb_t)crt_proc_out_common,
+			(crt_hg_rpc_cb_t)crt_rpc_handler_common);
+	if (rc != 0) {
+		C_ERROR("crt_hg_reg(rpcid: 0x%x), failed rc: %d.\n",
+			CRT_HG_ONEWAY_RPCID, rc);
+		C_GOTO(out, rc);
+	}
+	/* the origin completes as soon as a one-way request is sent */
+	hg_ret = HG_Registered_disable_response(hg_class, CRT_HG_ONEWAY_RPCID,
+						HG_TRUE);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("HG_Registered_disable_response failed, hg_ret: %d.\n",
+			hg_ret);
+		rc = -CER_HG;
+	}
+
+out:
+	return rc;
+}
+
 /* be called only in crt_init */
 int
 crt_hg_init(crt_phy_addr_t *addr, bool server)
@@ -212,14 +251,9 @@ crt_hg_init(crt_phy_addr_t *addr, bool server)
 
 	crt_gdata.cg_hg = hg_gdata;
 
-	/* register the CRT_HG_RPCID */
-	rc = crt_hg_reg(crt_gdata.cg_hg->chg_hgcla, CRT_HG_RPCID,
-			(crt_proc_cb_t)crt_proc_in_common,
-			(crt_proc_cb_t)crt_proc_out_common,
-			(crt_hg_rpc_cb_t)crt_rpc_handler_common);
+	/* register the CRT_HG_RPCID and CRT_HG_ONEWAY_RPCID */
+	rc = crt_hg_reg_rpcids(crt_gdata.cg_hg->chg_hgcla);
 	if (rc != 0) {
-		C_ERROR("crt_hg_reg(rpcid: 0x%x), failed rc: %d.\n",
-			CRT_HG_RPCID, rc);
 		HG_Finalize(hg_class);
 		NA_Finalize(na_class);
 		C_GOTO(out, rc = -CER_HG);
@@ -308,6 +342,10 @@ crt_hg_ctx_init(struct crt_hg_context *hg_ctx, int idx)
 		/* register crt_ctx to get it in crt_rpc_handler_common */
 		hg_ret = HG_Register_data(crt_gdata.cg_hg->chg_hgcla,
 					  CRT_HG_RPCID, crt_ctx, NULL);
+		if (hg_ret == HG_SUCCESS)
+			hg_ret = HG_Register_data(crt_gdata.cg_hg->chg_hgcla,
+						  CRT_HG_ONEWAY_RPCID, crt_ctx,
+						  NULL);
 		if (hg_ret != HG_SUCCESS) {
 			C_ERROR("HG_Register_data failed, hg_ret: %d.\n",
 				hg_ret);
@@ -362,14 +400,9 @@ crt_hg_ctx_init(struct crt_hg_context *hg_ctx, int idx)
 			C_GOTO(out, rc = -CER_HG);
 		}
 
-		/* register the shared RPCID to every hg_class */
-		rc = crt_hg_reg(hg_class, CRT_HG_RPCID,
-				(crt_proc_cb_t)crt_proc_in_common,
-				(crt_proc_cb_t)crt_proc_out_common,
-				(crt_hg_rpc_cb_t)crt_rpc_handler_common);
+		/* register the shared RPCIDs to every hg_class */
+		rc = crt_hg_reg_rpcids(hg_class);
 		if (rc != 0) {
-			C_ERROR("crt_hg_reg(rpcid: 0x%x), failed rc: %d.\n",
-				CRT_HG_RPCID, rc);
 			HG_Context_destroy(hg_context);
 			HG_Finalize(hg_class);
 			NA_Finalize(na_class);
@@ -379,6 +412,10 @@ crt_hg_ctx_init(struct crt_hg_context *hg_ctx, int idx)
 		/* register crt_ctx to get it in crt_rpc_handler_common */
 		hg_ret = HG_Register_data(hg_class, CRT_HG_RPCID, crt_ctx,
 					  NULL);
+		if (hg_ret == HG_SUCCESS)
+			hg_ret = HG_Register_data(hg_class,
+						  CRT_HG_ONEWAY_RPCID,
+						  crt_ctx, NULL);
 		if (hg_ret != HG_SUCCESS) {
 			C_ERROR("HG_Register_data failed, hg_ret: %d.\n",
 				hg_ret);
@@ -394,6 +431,7 @@ crt_hg_ctx_init(struct crt_hg_context *hg_ctx, int idx)
 	}
 
 	hg_ctx->chc_hgctx = hg_context;
+	hg_ctx->chc_spin_us = crt_gdata.cg_progress_spin_us;
 	/* TODO: need to create separate bulk class and bulk context? */
 	hg_ctx->chc_bulkcla = hg_ctx->chc_hgcla;
 	hg_ctx->chc_bulkctx = hg_ctx->chc_hgctx;
@@ -491,7 +529,7 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 	C_ASSERT(hg_ctx->chc_hgcla == hg_info->hg_class);
 	C_ASSERT(hg_ctx->chc_hgctx == hg_info->context);
 
-	C_ALLOC_PTR(rpc_priv);
+	rpc_priv = crt_rpc_pool_alloc(crt_ctx, sizeof(*rpc_priv));
 	if (rpc_priv == NULL)
 		C_GOTO(out, hg_ret = HG_NOMEM_ERROR);
 
@@ -504,7 +542,7 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 	rc = crt_hg_unpack_header(rpc_priv, &proc);
 	if (rc != 0) {
 		C_ERROR("crt_hg_unpack_header failed, rc: %d.\n", rc);
-		C_FREE_PTR(rpc_priv);
+		crt_rpc_pool_free(crt_ctx, rpc_priv, sizeof(*rpc_priv));
 		C_GOTO(out, hg_ret = HG_OTHER_ERROR);
 	}
 	if (rpc_priv->crp_flags & CRT_RPC_FLAG_COLL) {
@@ -514,10 +552,10 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 	C_ASSERT(proc != NULL);
 	opc = rpc_priv->crp_req_hdr.cch_opc;
 
-	opc_info = crt_opc_lookup(crt_gdata.cg_opc_map, opc, CRT_UNLOCK);
+	opc_info = crt_opc_lookup(crt_gdata.cg_opc_map, opc);
 	if (opc_info == NULL) {
 		C_ERROR("opc: 0x%x, lookup failed.\n", opc);
-		C_FREE_PTR(rpc_priv);
+		crt_rpc_pool_free(crt_ctx, rpc_priv, sizeof(*rpc_priv));
 		crt_hg_unpack_cleanup(proc);
 		C_GOTO(out, hg_ret = HG_NO_MATCH);
 	}
@@ -542,6 +580,17 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 		rc = crt_hg_unpack_body(rpc_priv, proc);
 		if (rc == 0) {
 			rpc_priv->crp_input_got = 1;
+#if CRT_HG_LOWLEVEL_UNPACK
+			/*
+			 * the decoded input refers to the input buffer, keep
+			 * the handle until crt_hg_req_destroy as HG_Get_input
+			 * would do
+			 */
+			if (opc_info->coi_iov_inplace) {
+				HG_Ref_incr(hg_hdl);
+				rpc_priv->crp_hdl_ref = 1;
+			}
+#endif
 			rpc_pub->cr_ep.ep_rank =
 					rpc_priv->crp_req_hdr.cch_rank;
 			rpc_pub->cr_ep.ep_grp = NULL;
@@ -555,7 +604,7 @@ crt_rpc_handler_common(hg_handle_t hg_hdl)
 		crt_hg_unpack_cleanup(proc);
 	}
 
-	if (opc_info->coi_rpc_cb == NULL) {
+	if (opc_info->coi_rpc_cb == NULL && opc_info->coi_vec_cb == NULL) {
 		C_ERROR("NULL crp_hg_hdl, opc: 0x%x.\n", opc);
 		hg_ret = HG_NO_MATCH;
 		rc = -CER_UNREG;
@@ -596,17 +645,23 @@ crt_hg_req_create(struct crt_hg_context *hg_ctx, int ctx_idx,
 	else
 		grp_priv = container_of(tgt_ep.ep_grp, struct crt_grp_priv,
 					gp_pub);
-	rc = crt_grp_lc_lookup(grp_priv, ctx_idx, hg_ctx, tgt_ep.ep_rank,
-			       tgt_ep.ep_tag, NULL /* base_addr */,
-			       &rpc_priv->crp_na_addr);
+	/* never blocks, -CER_AGAIN if the address is not resolved yet */
+	rc = crt_grp_lc_addr_get(grp_priv, ctx_idx, tgt_ep.ep_rank,
+				 tgt_ep.ep_tag, NULL /* base_addr */,
+				 &rpc_priv->crp_na_addr);
 	if (rc != 0) {
-		C_ERROR("crt_grp_lc_lookup failed, rc: %d, opc: 0x%x.\n",
-			rc, rpc_priv->crp_pub.cr_opc);
+		if (rc != -CER_AGAIN)
+			C_ERROR("crt_grp_lc_addr_get failed, rc: %d, "
+				"opc: 0x%x.\n", rc, rpc_priv->crp_pub.cr_opc);
 		C_GOTO(out, rc);
 	}
+	/* a capped cache hands out references, see crt_grp_lc_addr_get */
+	rpc_priv->crp_na_addr_ref = (grp_priv->gp_lc_addr_max != 0);
 
 	hg_ret = HG_Create(hg_ctx->chc_hgctx, rpc_priv->crp_na_addr,
-			   CRT_HG_RPCID, &rpc_priv->crp_hg_hdl);
+			   (rpc_priv->crp_flags & CRT_RPC_FLAG_ONEWAY) ?
+			   CRT_HG_ONEWAY_RPCID : CRT_HG_RPCID,
+			   &rpc_priv->crp_hg_hdl);
 	if (hg_ret != HG_SUCCESS) {
 		C_ERROR("HG_Create failed, hg_ret: %d, opc: 0x%x.\n",
 			hg_ret, rpc_priv->crp_pub.cr_opc);
@@ -620,10 +675,16 @@ out:
 int
 crt_hg_req_destroy(struct crt_rpc_priv *rpc_priv)
 {
-	hg_return_t	hg_ret = HG_SUCCESS;
-	int		rc = 0;
+	struct crt_context	*ctx;
+	hg_return_t		hg_ret = HG_SUCCESS;
+	int			rc = 0;
 
 	C_ASSERT(rpc_priv != NULL);
+	if (rpc_priv->crp_flags & CRT_RPC_FLAG_BATCHED) {
+		/* packed and unpacked by crt_batch.c rather than by HG */
+		crt_batch_req_fini(rpc_priv);
+		C_GOTO(fini, rc);
+	}
 	if (rpc_priv->crp_output_got != 0) {
 		hg_ret = HG_Free_output(rpc_priv->crp_hg_hdl,
 					&rpc_priv->crp_pub.cr_output);
@@ -641,39 +702,74 @@ crt_hg_req_destroy(struct crt_rpc_priv *rpc_priv)
 				rpc_priv->crp_pub.cr_opc);
 	}
 
+fini:
 	crt_rpc_priv_fini(rpc_priv);
 
-	if (!rpc_priv->crp_coll &&
-	    (!CRT_HG_LOWLEVEL_UNPACK || (rpc_priv->crp_input_got == 0))) {
-		/* HACK alert:  Do we need to provide a low-level interface
-		 * for HG_Free_input since we do low level packing.   Without
-		 * calling HG_Get_input, we don't take a reference on the
-		 * handle calling destroy here can result in the handle
-		 * getting freed before mercury is done with it
-		 */
+	/*
+	 * the reference taken when unpacking the input is dropped whether or
+	 * not the request is collective
+	 */
+	if (rpc_priv->crp_hg_hdl != NULL &&
+	    (rpc_priv->crp_hdl_ref ||
+	     (!rpc_priv->crp_coll &&
+	      (!CRT_HG_LOWLEVEL_UNPACK || rpc_priv->crp_input_got == 0)))) {
 		hg_ret = HG_Destroy(rpc_priv->crp_hg_hdl);
 		if (hg_ret != HG_SUCCESS) {
 			C_ERROR("HG_Destroy failed, hg_ret: %d, opc: 0x%x.\n",
 				hg_ret, rpc_priv->crp_pub.cr_opc);
 		}
 	}
+	if (rpc_priv->crp_na_addr_ref) {
+		ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+		hg_ret = HG_Addr_free(ctx->cc_hg_ctx.chc_hgcla,
+				      rpc_priv->crp_na_addr);
+		if (hg_ret != HG_SUCCESS)
+			C_ERROR("HG_Addr_free failed, hg_ret: %d, opc: 0x%x.\n",
+				hg_ret, rpc_priv->crp_pub.cr_opc);
+	}
 
 	crt_rpc_priv_free(rpc_priv);
 
 	return rc;
 }
 
-struct crt_hg_send_cbinfo {
-	struct crt_rpc_priv	*rsc_rpc_priv;
-	crt_cb_t		rsc_cb;
-	void			*rsc_arg;
-};
+/*
+ * Release the output of a completed request and reset its HG handle to be
+ * forwarded again, to the same address with the same RPC ID.
+ */
+int
+crt_hg_req_reset(struct crt_rpc_priv *rpc_priv)
+{
+	hg_return_t	hg_ret;
+	int		rc = 0;
+
+	C_ASSERT(rpc_priv != NULL && rpc_priv->crp_hg_hdl != NULL);
+	if (rpc_priv->crp_output_got != 0) {
+		hg_ret = HG_Free_output(rpc_priv->crp_hg_hdl,
+					&rpc_priv->crp_pub.cr_output);
+		if (hg_ret != HG_SUCCESS)
+			C_ERROR("HG_Free_output failed, hg_ret: %d, "
+				"opc: 0x%x.\n", hg_ret,
+				rpc_priv->crp_pub.cr_opc);
+		rpc_priv->crp_output_got = 0;
+	}
+
+	hg_ret = HG_Reset(rpc_priv->crp_hg_hdl, rpc_priv->crp_na_addr,
+			  (rpc_priv->crp_flags & CRT_RPC_FLAG_ONEWAY) ?
+			  CRT_HG_ONEWAY_RPCID : CRT_HG_RPCID);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("HG_Reset failed, hg_ret: %d, opc: 0x%x.\n",
+			hg_ret, rpc_priv->crp_pub.cr_opc);
+		rc = -CER_HG;
+	}
+
+	return rc;
+}
 
 /* the common completion callback for sending RPC request */
 static hg_return_t
 crt_hg_req_send_cb(const struct hg_cb_info *hg_cbinfo)
 {
-	struct crt_hg_send_cbinfo	*req_cbinfo;
 	struct crt_cb_info		crt_cbinfo;
 	crt_rpc_t			*rpc_pub;
 	struct crt_rpc_priv		*rpc_priv;
@@ -681,26 +777,28 @@ crt_hg_req_send_cb(const struct hg_cb_info *hg_cbinfo)
 	hg_return_t			hg_ret = HG_SUCCESS;
 	int				rc = 0;
 
-	req_cbinfo = (struct crt_hg_send_cbinfo *)hg_cbinfo->arg;
-	C_ASSERT(req_cbinfo != NULL);
+	/* the rpc_priv itself carries the completion callback and its arg */
+	rpc_priv = (struct crt_rpc_priv *)hg_cbinfo->arg;
+	C_ASSERT(rpc_priv != NULL);
 	C_ASSERT(hg_cbinfo->type == HG_CB_FORWARD);
 
-	rpc_priv = req_cbinfo->rsc_rpc_priv;
-	C_ASSERT(rpc_priv != NULL);
 	rpc_pub = &rpc_priv->crp_pub;
 	opc = rpc_pub->cr_opc;
 
+	/*
+	 * the timeout already completed the request, whether the forward got
+	 * canceled or the reply came in too late, do not complete it again.
+	 */
+	if (rpc_priv->crp_state == RPC_TIMEOUT) {
+		C_DEBUG("timed out rpc_priv %p forward done (hg_ret %d), "
+			"opc: 0x%x.\n", rpc_priv, hg_cbinfo->ret, opc);
+		C_GOTO(timeout_abort, rc);
+	}
+
 	if (hg_cbinfo->ret != HG_SUCCESS) {
 		if (hg_cbinfo->ret == HG_CANCELED) {
-			if (rpc_priv->crp_state == RPC_TIMEOUT) {
-				C_DEBUG("timed out rpc_priv %p being canceled, "
-					"opc: 0x%x.\n", rpc_priv, opc);
-				C_GOTO(timeout_abort, rc);
-			} else {
-				C_DEBUG("request being canceled, opc: 0x%x.\n",
-					opc);
-				rc = -CER_CANCELED;
-			}
+			C_DEBUG("request being canceled, opc: 0x%x.\n", opc);
+			rc = -CER_CANCELED;
 		} else {
 			C_ERROR("hg_cbinfo->ret: %d.\n", hg_cbinfo->ret);
 			rc = -CER_HG;
@@ -708,13 +806,14 @@ crt_hg_req_send_cb(const struct hg_cb_info *hg_cbinfo)
 		}
 	}
 
-	if (req_cbinfo->rsc_cb == NULL) {
+	if (rpc_priv->crp_complete_cb == NULL) {
 		rpc_priv->crp_state = (hg_cbinfo->ret == HG_CANCELED) ?
 				      RPC_CANCELED : RPC_COMPLETED;
 		C_GOTO(out, hg_ret);
 	}
 
-	if (rc == 0) {
+	/* a one-way request completes once sent, there is no output */
+	if (rc == 0 && !(rpc_priv->crp_flags & CRT_RPC_FLAG_ONEWAY)) {
 		rpc_priv->crp_state = RPC_REPLY_RECVED;
 		/* HG_Free_output in crt_hg_req_destroy */
 		hg_ret = HG_Get_output(hg_cbinfo->info.forward.handle,
@@ -729,24 +828,23 @@ crt_hg_req_send_cb(const struct hg_cb_info *hg_cbinfo)
 	}
 
 	crt_cbinfo.cci_rpc = rpc_pub;
-	crt_cbinfo.cci_arg = req_cbinfo->rsc_arg;
+	crt_cbinfo.cci_arg = rpc_priv->crp_arg;
 	crt_cbinfo.cci_rc = rc;
 
-
-	C_ASSERT(req_cbinfo->rsc_cb != NULL);
-	rc = req_cbinfo->rsc_cb(&crt_cbinfo);
+	rc = rpc_priv->crp_complete_cb(&crt_cbinfo);
 	if (rc != 0)
-		C_ERROR("req_cbinfo->rsc_cb returned %d.\n", rc);
+		C_ERROR("crp_complete_cb returned %d.\n", rc);
 
 	rpc_priv->crp_state = (hg_cbinfo->ret == HG_CANCELED) ?
 			      RPC_CANCELED : RPC_COMPLETED;
 
 out:
-	crt_context_req_untrack(rpc_pub);
+	if (!(rpc_priv->crp_flags & CRT_RPC_FLAG_ONEWAY))
+		crt_context_req_untrack(rpc_pub);
 
 timeout_abort:
-	C_FREE_PTR(req_cbinfo);
-
+	/* from here on crt_req_reset() may reuse the handle */
+	__atomic_store_n(&rpc_priv->crp_fwd_inflight, 0, __ATOMIC_RELEASE);
 	/* corresponding to the refcount taken in crt_rpc_priv_init(). */
 	rc = crt_req_decref(rpc_pub);
 	if (rc != 0)
@@ -758,34 +856,25 @@ timeout_abort:
 int
 crt_hg_req_send(struct crt_rpc_priv *rpc_priv)
 {
-	struct crt_hg_send_cbinfo	*cb_info;
 	hg_return_t			hg_ret = HG_SUCCESS;
 	void				*hg_in_struct;
 	int				rc = 0;
 
 	C_ASSERT(rpc_priv != NULL);
 
-	C_ALLOC_PTR(cb_info);
-	if (cb_info == NULL)
-		C_GOTO(out, rc = -CER_NOMEM);
-
 	hg_in_struct = &rpc_priv->crp_pub.cr_input;
 
-	cb_info->rsc_rpc_priv = rpc_priv;
-	cb_info->rsc_cb = rpc_priv->crp_complete_cb;
-	cb_info->rsc_arg = rpc_priv->crp_arg;
-
-	hg_ret = HG_Forward(rpc_priv->crp_hg_hdl, crt_hg_req_send_cb, cb_info,
+	__atomic_store_n(&rpc_priv->crp_fwd_inflight, 1, __ATOMIC_RELEASE);
+	hg_ret = HG_Forward(rpc_priv->crp_hg_hdl, crt_hg_req_send_cb, rpc_priv,
 			    hg_in_struct);
 	if (hg_ret != HG_SUCCESS) {
 		C_ERROR("HG_Forward failed, hg_ret: %d, opc: 0x%x.\n",
 			hg_ret, rpc_priv->crp_pub.cr_opc);
-		C_FREE_PTR(cb_info);
+		__atomic_store_n(&rpc_priv->crp_fwd_inflight, 0,
+				 __ATOMIC_RELEASE);
 		rc = -CER_HG;
 	}
 
-
-out:
 	return rc;
 }
 
@@ -814,16 +903,14 @@ out:
 static hg_return_t
 crt_hg_reply_send_cb(const struct hg_cb_info *hg_cbinfo)
 {
-	struct crt_hg_send_cbinfo	*req_cbinfo;
 	struct crt_rpc_priv		*rpc_priv;
 	hg_return_t			hg_ret = HG_SUCCESS;
 	crt_opcode_t			opc;
 	int				rc = 0;
 
-	req_cbinfo = (struct crt_hg_send_cbinfo *)hg_cbinfo->arg;
-	C_ASSERT(req_cbinfo != NULL && req_cbinfo->rsc_rpc_priv != NULL);
+	rpc_priv = (struct crt_rpc_priv *)hg_cbinfo->arg;
+	C_ASSERT(rpc_priv != NULL);
 
-	rpc_priv = req_cbinfo->rsc_rpc_priv;
 	opc = rpc_priv->crp_pub.cr_opc;
 	hg_ret = hg_cbinfo->ret;
 	if (hg_ret != HG_SUCCESS)
@@ -835,40 +922,31 @@ crt_hg_reply_send_cb(const struct hg_cb_info *hg_cbinfo)
 	if (rc != 0)
 		C_ERROR("crt_req_decref failed, rc: %d, opc: 0x%x.\n", rc, opc);
 
-	C_FREE_PTR(req_cbinfo);
 	return hg_ret;
 }
 
 int
 crt_hg_reply_send(struct crt_rpc_priv *rpc_priv)
 {
-	struct crt_hg_send_cbinfo	*cb_info;
 	hg_return_t			hg_ret = HG_SUCCESS;
 	void				*hg_out_struct;
 	int				rc = 0;
 
 	C_ASSERT(rpc_priv != NULL);
 
-	C_ALLOC_PTR(cb_info);
-	if (cb_info == NULL)
-		C_GOTO(out, rc = -CER_NOMEM);
-
 	hg_out_struct = &rpc_priv->crp_pub.cr_output;
 
-	cb_info->rsc_rpc_priv = rpc_priv;
-
 	rc = crt_req_addref(&rpc_priv->crp_pub);
 	if (rc != 0) {
 		C_ERROR("crt_req_addref(rpc_priv: %p) failed, rc: %d.\n",
 			rpc_priv, rc);
 		C_GOTO(out, rc);
 	}
-	hg_ret = HG_Respond(rpc_priv->crp_hg_hdl, crt_hg_reply_send_cb, cb_info,
+	hg_ret = HG_Respond(rpc_priv->crp_hg_hdl, crt_hg_reply_send_cb, rpc_priv,
 			    hg_out_struct);
 	if (hg_ret != HG_SUCCESS) {
 		C_ERROR("HG_Respond failed, hg_ret: %d, opc: 0x%x.\n",
 			hg_ret, rpc_priv->crp_pub.cr_opc);
-		C_FREE_PTR(cb_info);
 		/* should success as addref above */
 		rc = crt_req_decref(&rpc_priv->crp_pub);
 		C_ASSERT(rc == 0);
@@ -910,6 +988,30 @@ crt_hg_trigger(struct crt_hg_context *hg_ctx)
 	return 0;
 }
 
+/*
+ * Progress without blocking for up to \a spin_us micro-seconds, returns zero
+ * as soon as some operation progressed, -CER_TIMEDOUT if none did.
+ */
+static int
+crt_hg_progress_spin(hg_context_t *hg_context, uint64_t spin_us)
+{
+	hg_return_t	hg_ret;
+	uint64_t	end;
+
+	end = crt_timeus_secdiff(0) + spin_us;
+	do {
+		hg_ret = HG_Progress(hg_context, 0);
+		if (hg_ret == HG_SUCCESS)
+			return 0;
+		if (hg_ret != HG_TIMEOUT) {
+			C_ERROR("HG_Progress failed, hg_ret: %d.\n", hg_ret);
+			return -CER_HG;
+		}
+	} while (crt_timeus_secdiff(0) < end);
+
+	return -CER_TIMEDOUT;
+}
+
 int
 crt_hg_progress(struct crt_hg_context *hg_ctx, int64_t timeout)
 {
@@ -917,6 +1019,7 @@ crt_hg_progress(struct crt_hg_context *hg_ctx, int64_t timeout)
 	hg_class_t		*hg_class;
 	hg_return_t		hg_ret = HG_SUCCESS;
 	unsigned int		hg_timeout;
+	uint64_t		spin_us;
 	int			rc;
 
 	C_ASSERT(hg_ctx != NULL);
@@ -924,21 +1027,43 @@ crt_hg_progress(struct crt_hg_context *hg_ctx, int64_t timeout)
 	hg_class = hg_ctx->chc_hgcla;
 	C_ASSERT(hg_context != NULL && hg_class != NULL);
 
+	rc = crt_hg_trigger(hg_ctx);
+	if (rc != 0)
+		return rc;
+
 	/**
-	 * Mercury only supports milli-second timeout and uses an unsigned int
+	 * Busy poll first: a zero timeout only polls once, a timeout shorter
+	 * than the millisecond granularity of Mercury is polled in whole, and
+	 * otherwise poll up to the context's spinning time before blocking.
 	 */
-	if (timeout < 0) {
-		hg_timeout = UINT32_MAX;
-	} else {
-		hg_timeout = timeout / 1000;
-		if (hg_timeout == 0)
-			hg_timeout = 1;
-
+	if (timeout == 0)
+		spin_us = 0;
+	else if (timeout > 0 && timeout < 1000)
+		spin_us = timeout;
+	else if (timeout > 0)
+		spin_us = min((uint64_t)timeout, hg_ctx->chc_spin_us);
+	else
+		spin_us = hg_ctx->chc_spin_us;
+
+	if (timeout == 0 || spin_us > 0) {
+		rc = crt_hg_progress_spin(hg_context, spin_us);
+		if (rc == 0)
+			C_GOTO(trigger, rc);
+		if (rc != -CER_TIMEDOUT || timeout == 0 ||
+		    (uint64_t)timeout == spin_us)
+			C_GOTO(out, rc);
+		if (timeout > 0)
+			timeout -= spin_us;
 	}
 
-	rc = crt_hg_trigger(hg_ctx);
-	if (rc != 0)
-		return rc;
+	/**
+	 * Mercury only supports milli-second timeout and uses an unsigned int,
+	 * round up to not return before \a timeout.
+	 */
+	if (timeout < 0)
+		hg_timeout = UINT32_MAX;
+	else
+		hg_timeout = (timeout + 999) / 1000;
 
 	/** progress RPC execution */
 	hg_ret = HG_Progress(hg_context, hg_timeout);
@@ -949,6 +1074,7 @@ crt_hg_progress(struct crt_hg_context *hg_ctx, int64_t timeout)
 		C_GOTO(out, rc = -CER_HG);
 	}
 
+trigger:
 	/* some RPCs have progressed, call Trigger again */
 	rc = crt_hg_trigger(hg_ctx);
 
@@ -1097,8 +1223,13 @@ out:
 	return rc;
 }
 
+/*
+ * bulk operation, allocated from the context's RPC pool with a private copy
+ * of the caller's bulk descriptor.
+ */
 struct crt_hg_bulk_cbinfo {
-	struct crt_bulk_desc	*bci_desc;
+	struct crt_bulk_desc	bci_desc;
+	struct crt_context	*bci_ctx;
 	crt_bulk_cb_t		bci_cb;
 	void			*bci_arg;
 };
@@ -1117,9 +1248,9 @@ crt_hg_bulk_transfer_cb(const struct hg_cb_info *hg_cbinfo)
 	C_ASSERT(hg_cbinfo != NULL);
 	bulk_cbinfo = (struct crt_hg_bulk_cbinfo *)hg_cbinfo->arg;
 	C_ASSERT(bulk_cbinfo != NULL);
-	bulk_desc = bulk_cbinfo->bci_desc;
-	C_ASSERT(bulk_desc != NULL);
-	ctx = (struct crt_context *)bulk_desc->bd_rpc->cr_ctx;
+	bulk_desc = &bulk_cbinfo->bci_desc;
+	ctx = bulk_cbinfo->bci_ctx;
+	C_ASSERT(ctx != NULL);
 	hg_ctx = &ctx->cc_hg_ctx;
 	C_ASSERT(hg_ctx != NULL);
 	C_ASSERT(hg_cbinfo->type == HG_CB_BULK);
@@ -1153,8 +1284,7 @@ crt_hg_bulk_transfer_cb(const struct hg_cb_info *hg_cbinfo)
 		C_ERROR("bulk_cbinfo->bci_cb failed, rc: %d.\n", rc);
 
 out:
-	C_FREE_PTR(bulk_cbinfo);
-	C_FREE_PTR(bulk_desc);
+	crt_rpc_pool_free(ctx, bulk_cbinfo, sizeof(*bulk_cbinfo));
 	return hg_ret;
 }
 
@@ -1166,7 +1296,6 @@ crt_hg_bulk_transfer(struct crt_bulk_desc *bulk_desc, crt_bulk_cb_t complete_cb,
 	struct crt_hg_context		*hg_ctx;
 	struct crt_hg_bulk_cbinfo	*bulk_cbinfo;
 	hg_bulk_op_t			hg_bulk_op;
-	struct crt_bulk_desc		*bulk_desc_dup;
 	struct crt_rpc_priv		*rpc_priv;
 	hg_return_t			hg_ret = HG_SUCCESS;
 	int				rc = 0;
@@ -1179,17 +1308,12 @@ crt_hg_bulk_transfer(struct crt_bulk_desc *bulk_desc, crt_bulk_cb_t complete_cb,
 	hg_ctx = &ctx->cc_hg_ctx;
 	C_ASSERT(hg_ctx != NULL && hg_ctx->chc_bulkctx != NULL);
 
-	C_ALLOC_PTR(bulk_cbinfo);
+	bulk_cbinfo = crt_rpc_pool_alloc(ctx, sizeof(*bulk_cbinfo));
 	if (bulk_cbinfo == NULL)
 		C_GOTO(out, rc = -CER_NOMEM);
-	C_ALLOC_PTR(bulk_desc_dup);
-	if (bulk_desc_dup == NULL) {
-		C_FREE_PTR(bulk_cbinfo);
-		C_GOTO(out, rc = -CER_NOMEM);
-	}
-	crt_bulk_desc_dup(bulk_desc_dup, bulk_desc);
+	crt_bulk_desc_dup(&bulk_cbinfo->bci_desc, bulk_desc);
 
-	bulk_cbinfo->bci_desc = bulk_desc_dup;
+	bulk_cbinfo->bci_ctx = ctx;
 	bulk_cbinfo->bci_cb = complete_cb;
 	bulk_cbinfo->bci_arg = arg;
 
@@ -1205,8 +1329,7 @@ crt_hg_bulk_transfer(struct crt_bulk_desc *bulk_desc, crt_bulk_cb_t complete_cb,
 			opid != NULL ? (hg_op_id_t *)opid : HG_OP_ID_IGNORE);
 	if (hg_ret != HG_SUCCESS) {
 		C_ERROR("HG_Bulk_transfer failed, hg_ret: %d.\n", hg_ret);
-		C_FREE_PTR(bulk_cbinfo);
-		C_FREE_PTR(bulk_desc_dup);
+		crt_rpc_pool_free(ctx, bulk_cbinfo, sizeof(*bulk_cbinfo));
 		rc = -CER_HG;
 	}
 
@@ -56,6 +56,8 @@
 
 /** the shared HG RPC ID used for all CRT opc */
 #define CRT_HG_RPCID	(0xDA036868)
+/* RPC ID of one-way requests, registered with the response disabled */
+#define CRT_HG_ONEWAY_RPCID	(0xDA036869)
 
 struct crt_rpc_priv;
 struct crt_common_hdr;
@@ -69,6 +71,8 @@ struct crt_hg_context {
 	hg_context_t		*chc_hgctx; /* HG context */
 	hg_class_t		*chc_bulkcla; /* bulk class */
 	hg_context_t		*chc_bulkctx; /* bulk context */
+	/* busy polling time (us) before blocking in crt_hg_progress */
+	uint32_t		chc_spin_us;
 };
 
 /** HG level global data */
@@ -85,6 +89,7 @@ int crt_hg_ctx_fini(struct crt_hg_context *hg_ctx);
 int crt_hg_req_create(struct crt_hg_context *hg_ctx, int ctx_idx,
 		      crt_endpoint_t tgt_ep, struct crt_rpc_priv *rpc_priv);
 int crt_hg_req_destroy(struct crt_rpc_priv *rpc_priv);
+int crt_hg_req_reset(struct crt_rpc_priv *rpc_priv);
 int crt_hg_req_send(struct crt_rpc_priv *rpc_priv);
 int crt_hg_reply_send(struct crt_rpc_priv *rpc_priv);
 int crt_hg_req_cancel(struct crt_rpc_priv *rpc_priv);
@@ -99,8 +104,11 @@ int crt_proc_common_hdr(crt_proc_t proc, struct crt_common_hdr *hdr);
 int crt_proc_corpc_hdr(crt_proc_t proc, struct crt_corpc_hdr *hdr);
 int crt_hg_unpack_header(struct crt_rpc_priv *rpc_priv, crt_proc_t *proc);
 void crt_hg_unpack_cleanup(crt_proc_t proc);
-int crt_proc_internal(struct crf_field *drf, crt_proc_t proc, void *data);
+int crt_proc_internal(struct crf_field *drf, crt_proc_t proc, void *data,
+		      bool iov_inplace);
 int crt_proc_input(struct crt_rpc_priv *rpc_priv, crt_proc_t proc);
+int crt_proc_input_encode(struct crt_rpc_priv *rpc_priv, void **buf,
+			  crt_size_t *buf_size, crt_size_t *len);
 int crt_proc_output(struct crt_rpc_priv *rpc_priv, crt_proc_t proc);
 int crt_hg_unpack_body(struct crt_rpc_priv *rpc_priv, crt_proc_t proc);
 int crt_proc_in_common(crt_proc_t proc, crt_rpc_input_t *data);
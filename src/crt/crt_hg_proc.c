@@ -385,6 +385,55 @@ crt_proc_crt_iov_t(crt_proc_t proc, crt_iov_t *div)
 	return 0;
 }
 
+/*
+ * crt_proc_crt_iov_t of the opcodes registered with CRT_RPC_FEAT_IOV_INPLACE,
+ * a decoded iov refers to the data in the received buffer rather than a copy
+ * of it, so it is only valid as long as the RPC.
+ */
+static int
+crt_proc_crt_iov_inplace(crt_proc_t proc, crt_iov_t *div)
+{
+	crt_proc_op_t	proc_op;
+	hg_return_t	hg_ret;
+	int		rc;
+
+	rc = crt_proc_get_op(proc, &proc_op);
+	if (rc != 0)
+		return -CER_HG;
+	if (proc_op == CRT_PROC_ENCODE)
+		return crt_proc_crt_iov_t(proc, div);
+	/* nothing was allocated */
+	if (proc_op == CRT_PROC_FREE)
+		return 0;
+
+	rc = crt_proc_uint64_t(proc, &div->iov_len);
+	if (rc != 0)
+		return -CER_HG;
+
+	rc = crt_proc_uint64_t(proc, &div->iov_buf_len);
+	if (rc != 0)
+		return -CER_HG;
+
+	if (div->iov_buf_len < div->iov_len) {
+		C_ERROR("invalid iov buf len "CF_U64" < iov len "CF_U64"\n",
+			div->iov_buf_len, div->iov_len);
+		return -CER_HG;
+	}
+	/* only the data was sent, the buffer is no longer than the data */
+	div->iov_buf_len = div->iov_len;
+	if (div->iov_len == 0) {
+		div->iov_buf = NULL;
+		return 0;
+	}
+	div->iov_buf = hg_proc_save_ptr(proc, div->iov_len);
+	if (div->iov_buf == NULL)
+		return -CER_HG;
+	/* covers the data by the checksum */
+	hg_ret = hg_proc_restore_ptr(proc, div->iov_buf, div->iov_len);
+
+	return (hg_ret == HG_SUCCESS) ? 0 : -CER_HG;
+}
+
 struct crt_msg_field CMF_UUID =
 	DEFINE_CRT_MSG("crt_uuid", 0, sizeof(uuid_t),
 		       crt_proc_uuid_t);
@@ -492,6 +541,11 @@ crt_proc_corpc_hdr(crt_proc_t proc, struct crt_corpc_hdr *hdr)
 		C_GOTO(out, rc = -CER_HG);
 	}
 	hg_ret = hg_proc_hg_uint32_t(hg_proc, &hdr->coh_padding);
+	if (hg_ret != HG_SUCCESS) {
+		C_ERROR("hg proc error, hg_ret: %d.\n", hg_ret);
+		C_GOTO(out, rc = -CER_HG);
+	}
+	hg_ret = hg_proc_hg_uint64_t(hg_proc, &hdr->coh_bulk_pipe);
 	if (hg_ret != HG_SUCCESS) {
 		C_ERROR("hg proc error, hg_ret: %d.\n", hg_ret);
 		rc = -CER_HG;
@@ -661,16 +715,21 @@ crt_hg_unpack_cleanup(crt_proc_t proc)
 #endif
 }
 
+/* \a iov_inplace selects crt_proc_crt_iov_inplace for the crt_iov_t fields */
 int
 crt_proc_internal(struct crf_field *crf,
-			 crt_proc_t proc, void *data)
+			 crt_proc_t proc, void *data, bool iov_inplace)
 {
+	crt_proc_cb_t cmf_proc;
 	int rc = 0;
 	void *ptr = data;
 	int i;
 	int j;
 
 	for (i = 0; i < crf->crf_count; i++) {
+		cmf_proc = crf->crf_msg[i]->cmf_proc;
+		if (iov_inplace && cmf_proc == (crt_proc_cb_t)crt_proc_crt_iov_t)
+			cmf_proc = (crt_proc_cb_t)crt_proc_crt_iov_inplace;
 		if (crf->crf_msg[i]->cmf_flags & CMF_ARRAY_FLAG) {
 			struct crt_array *array = ptr;
 			hg_proc_op_t	 proc_op;
@@ -710,7 +769,7 @@ crt_proc_internal(struct crf_field *crf,
 			}
 			array_ptr = array->da_arrays;
 			for (j = 0; j < array->da_count; j++) {
-				rc = crf->crf_msg[i]->cmf_proc(proc, array_ptr);
+				rc = cmf_proc(proc, array_ptr);
 				if (rc != 0) {
 					C_ERROR("cmf_proc failed, i %d, "
 						"rc %d.\n", i, rc);
@@ -727,7 +786,7 @@ crt_proc_internal(struct crf_field *crf,
 			}
 			ptr = (char *)ptr + sizeof(struct crt_array);
 		} else {
-			rc = crf->crf_msg[i]->cmf_proc(proc, ptr);
+			rc = cmf_proc(proc, ptr);
 
 			ptr = (char *)ptr + crf->crf_msg[i]->cmf_size;
 		}
@@ -747,7 +806,61 @@ crt_proc_input(struct crt_rpc_priv *rpc_priv, crt_proc_t proc)
 
 	C_ASSERT(crf != NULL);
 	return crt_proc_internal(&crf->crf_fields[CRT_IN],
-				 proc, rpc_priv->crp_pub.cr_input);
+				 proc, rpc_priv->crp_pub.cr_input,
+				 rpc_priv->crp_opc_info->coi_iov_inplace);
+}
+
+/*
+ * Encode the input of \a rpc_priv into a buffer of its own, \a len returns the
+ * encoded size. The caller frees the buffer by C_FREE(*buf, *buf_size).
+ */
+int
+crt_proc_input_encode(struct crt_rpc_priv *rpc_priv, void **buf,
+		      crt_size_t *buf_size, crt_size_t *len)
+{
+	struct crt_context	*ctx;
+	hg_proc_t		 proc;
+	hg_return_t		 hg_ret;
+	hg_size_t		 size, used;
+	void			*ptr;
+	int			 rc;
+
+	C_ASSERT(rpc_priv != NULL && buf != NULL && buf_size != NULL &&
+		 len != NULL);
+	ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+	/* a guess, the variable sized fields are encoded again if beyond it */
+	size = max(2 * rpc_priv->crp_pub.cr_input_size, 4096);
+	while (1) {
+		C_ALLOC(ptr, size);
+		if (ptr == NULL)
+			return -CER_NOMEM;
+		hg_ret = hg_proc_create(ctx->cc_hg_ctx.chc_hgcla, ptr, size,
+					HG_ENCODE, HG_NOHASH, &proc);
+		if (hg_ret != HG_SUCCESS) {
+			C_ERROR("hg_proc_create failed, hg_ret: %d.\n", hg_ret);
+			C_FREE(ptr, size);
+			return -CER_HG;
+		}
+		rc = crt_proc_input(rpc_priv, proc);
+		/* mercury spills to an extra buffer once the given one is full */
+		used = hg_proc_get_size_used(proc);
+		hg_proc_free(proc);
+		if (rc != 0 || used <= size)
+			break;
+		C_FREE(ptr, size);
+		size = used;
+	}
+	if (rc != 0) {
+		C_ERROR("crt_proc_input failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+		C_FREE(ptr, size);
+		return rc;
+	}
+
+	*buf = ptr;
+	*buf_size = size;
+	*len = used;
+	return 0;
 }
 
 int
@@ -757,7 +870,8 @@ crt_proc_output(struct crt_rpc_priv *rpc_priv, crt_proc_t proc)
 
 	C_ASSERT(crf != NULL);
 	return crt_proc_internal(&crf->crf_fields[CRT_OUT],
-				 proc, rpc_priv->crp_pub.cr_output);
+				 proc, rpc_priv->crp_pub.cr_output,
+				 rpc_priv->crp_opc_info->coi_iov_inplace);
 }
 
 int
@@ -767,10 +881,14 @@ crt_hg_unpack_body(struct crt_rpc_priv *rpc_priv, crt_proc_t proc)
 
 #if CRT_HG_LOWLEVEL_UNPACK
 	hg_return_t	hg_ret;
+	hg_size_t	body_off;
+	void		*in_buf;
+	hg_size_t	in_buf_size;
 
 	C_ASSERT(rpc_priv != NULL && proc != HG_PROC_NULL);
 
 	/* Decode input parameters */
+	body_off = hg_proc_get_size_used(proc);
 	rc = crt_proc_input(rpc_priv, proc);
 	if (rc != 0) {
 		C_ERROR("crt_hg_unpack_body failed, rc: %d, opc: 0x%x.\n",
@@ -778,6 +896,15 @@ crt_hg_unpack_body(struct crt_rpc_priv *rpc_priv, crt_proc_t proc)
 		C_GOTO(out, rc);
 	}
 
+	/* a corpc forwards the encoded body as is, see crt_proc_in_common */
+	if ((rpc_priv->crp_flags & CRT_RPC_FLAG_COLL) &&
+	    HG_Core_get_input(rpc_priv->crp_hg_hdl, &in_buf,
+			      &in_buf_size) == HG_SUCCESS) {
+		rpc_priv->crp_co_body = (char *)in_buf + body_off;
+		rpc_priv->crp_co_body_len = hg_proc_get_size_used(proc) -
+					    body_off;
+	}
+
 	/* Flush proc */
 	hg_ret = hg_proc_flush(proc);
 	if (hg_ret != HG_SUCCESS) {
@@ -854,6 +981,16 @@ crt_proc_in_common(crt_proc_t proc, crt_rpc_input_t *data)
 		C_GOTO(out, rc);
 	}
 
+	/* a forwarded corpc, only the headers differ from its parent's */
+	if (proc_op == CRT_PROC_ENCODE && rpc_priv->crp_co_body != NULL) {
+		rc = crt_proc_raw(proc, (void *)rpc_priv->crp_co_body,
+				  rpc_priv->crp_co_body_len);
+		if (rc != 0)
+			C_ERROR("crt_proc_raw failed, rc: %d, opc: 0x%x.\n",
+				rc, rpc_priv->crp_pub.cr_opc);
+		C_GOTO(out, rc);
+	}
+
 	rc = crt_proc_input(rpc_priv, proc);
 	if (rc != 0) {
 		C_ERROR("unpack input fails for opc: %s\n",
@@ -196,6 +196,9 @@ static void data_init()
 	crt_gdata.cg_addr = NULL;
 	crt_gdata.cg_verbs = false;
 	crt_gdata.cg_multi_na = false;
+	crt_gdata.cg_progress_spin_us = 0;
+	crt_gdata.cg_corpc_chunk_size = CRT_CORPC_CHUNK_SIZE_DEFAULT;
+	crt_gdata.cg_corpc_chunk_window = CRT_CORPC_CHUNK_WINDOW_DEFAULT;
 
 	gdata_init_flag = 1;
 }
@@ -253,6 +256,15 @@ crt_init(crt_group_id_t cli_grpid, crt_group_id_t srv_grpid, uint32_t flags)
 		if (server == true)
 			crt_gdata.cg_multi_na = true;
 
+		crt_getenv_int(CRT_PROGRESS_SPIN_ENV,
+			       &crt_gdata.cg_progress_spin_us);
+		crt_getenv_int(CRT_CORPC_CHUNK_SIZE_ENV,
+			       &crt_gdata.cg_corpc_chunk_size);
+		crt_getenv_int(CRT_CORPC_CHUNK_WINDOW_ENV,
+			       &crt_gdata.cg_corpc_chunk_window);
+		if (crt_gdata.cg_corpc_chunk_window == 0)
+			crt_gdata.cg_corpc_chunk_window = 1;
+
 		if (!server) {
 			crt_getenv_bool(CRT_ALLOW_SINGLETON_ENV,
 					&allow_singleton);
@@ -55,11 +55,11 @@ void crt_debug_fini(void);
 /** crt_register.c */
 int crt_opc_map_create(unsigned int bits);
 void crt_opc_map_destroy(struct crt_opc_map *map);
-struct crt_opc_info *crt_opc_lookup(struct crt_opc_map *map, crt_opcode_t opc,
-				    int locked);
+struct crt_opc_info *crt_opc_lookup(struct crt_opc_map *map,
+				    crt_opcode_t opc);
 int crt_rpc_reg_internal(crt_opcode_t opc, struct crt_req_format *drf,
-			 crt_rpc_cb_t rpc_handler,
-			 struct crt_corpc_ops *co_ops);
+			 crt_rpc_cb_t rpc_handler, struct crt_opc_vec *vec,
+			 struct crt_corpc_ops *co_ops, uint32_t feats);
 
 /** crt_context.c */
 /* return value of crt_context_req_track */
@@ -73,6 +73,13 @@ bool crt_context_empty(int locked);
 void crt_context_req_untrack(crt_rpc_t *req);
 crt_context_t crt_context_lookup(int ctx_idx);
 void crt_rpc_complete(struct crt_rpc_priv *rpc_priv, int rc);
+void *crt_rpc_pool_alloc(struct crt_context *ctx, crt_size_t size);
+void crt_rpc_pool_free(struct crt_context *ctx, void *ptr, crt_size_t size);
+struct crt_epi_table *crt_epi_table_alloc(uint32_t cap);
+void crt_epi_table_free(struct crt_epi_table *tab);
+struct crt_ep_inflight *crt_epi_lookup(struct crt_context *ctx,
+				       crt_endpoint_t *ep);
+int crt_epi_insert(struct crt_context *ctx, struct crt_ep_inflight *epi);
 
 /** some simple helper functions */
 
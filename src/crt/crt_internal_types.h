@@ -50,7 +50,7 @@
 
 #include <crt_util/list.h>
 #include <crt_util/hash.h>
-#include <crt_util/heap.h>
+#include <crt_util/wheel.h>
 
 #include <crt_hg.h>
 
@@ -67,6 +67,11 @@ struct crt_gdata {
 	bool			cg_verbs; /* CCI verbs transport flag */
 	/* multiple NA addr flag, true for server when using CCI plugin */
 	bool			cg_multi_na;
+	/* default progress busy polling time (us) of new contexts */
+	uint32_t		cg_progress_spin_us;
+	/* chunk size and window of pipelined collective bulk, see crt_rpc.h */
+	uint32_t		cg_corpc_chunk_size;
+	uint32_t		cg_corpc_chunk_window;
 
 	/* CaRT contexts list */
 	crt_list_t		cg_ctx_list;
@@ -95,9 +100,73 @@ extern struct crt_gdata		crt_gdata;
 # define CRT_SRV_CONTEXT_NUM		(256)
 #endif
 
-/* (1 << CRT_EPI_TABLE_BITS) is the number of buckets of epi hash table */
-#define CRT_EPI_TABLE_BITS		(3)
+/* (1 << CRT_EPI_TABLE_BITS) is the initial number of slots of epi index */
+#define CRT_EPI_TABLE_BITS		(6)
+/*
+ * Per-endpoint flow-control window (number of inflight RPCs), adapted by
+ * AIMD: grows by one every window of fast replies, halves on timeout or when
+ * the smoothed RTT exceeds CRT_EPI_RTT_CONGEST times the minimal RTT.
+ */
 #define CRT_MAX_INFLIGHT_PER_EP_CTX	(32)
+#define CRT_EPI_WINDOW_MIN		(1)
+#define CRT_EPI_WINDOW_MAX		(1024)
+#define CRT_EPI_RTT_CONGEST		(4)
+
+/* tick of the RPC timeout wheel in micro-second */
+#define CRT_TIMEOUT_TICK_US		(1000)
+
+/*
+ * Per-context object pool for RPC descriptors and input/output buffers.
+ * Objects are grouped in power-of-two size classes from
+ * (1 << CRT_RPC_POOL_MIN_SHIFT) to (1 << CRT_RPC_POOL_MAX_SHIFT) bytes, larger
+ * requests bypass the pool. Each class caches at most CRT_RPC_POOL_MAX_FREE
+ * free objects.
+ */
+#define CRT_RPC_POOL_MIN_SHIFT		(6)
+#define CRT_RPC_POOL_MAX_SHIFT		(14)
+#define CRT_RPC_POOL_CLASS_NUM		\
+	(CRT_RPC_POOL_MAX_SHIFT - CRT_RPC_POOL_MIN_SHIFT + 1)
+#define CRT_RPC_POOL_MAX_FREE		(256)
+
+/* free object of the pool, overlays the first bytes of the cached object */
+struct crt_rpc_pool_obj {
+	struct crt_rpc_pool_obj	*po_next;
+};
+
+struct crt_rpc_pool_class {
+	struct crt_rpc_pool_obj	*pc_free; /* cached free objects */
+	uint32_t		 pc_free_num;
+};
+
+struct crt_rpc_pool {
+	struct crt_rpc_pool_class cp_class[CRT_RPC_POOL_CLASS_NUM];
+	uint64_t		 cp_hit; /* allocation served from cache */
+	uint64_t		 cp_miss; /* allocation went to the heap */
+	/* pooled objects handed out and not returned yet */
+	uint64_t		 cp_busy;
+	/*
+	 * the context was destroyed while RPCs still held objects, it is freed
+	 * with the last of them, see crt_rpc_pool_free().
+	 */
+	bool			 cp_dead;
+	/* protects the free lists and counters */
+	pthread_spinlock_t	 cp_lock;
+};
+
+/*
+ * Open-addressing (linear probing) index of crt_ep_inflight, keyed by
+ * (group, rank, tag). Lookups are lock-free, insertions serialize on
+ * crt_context::cc_mutex. The entries are only removed when destroying the
+ * context, and a grown index keeps the retired smaller one in et_prev (freed
+ * with the context) so concurrent readers never see freed memory.
+ */
+struct crt_epi_table {
+	/* number of slots, power of two */
+	uint32_t		 et_cap;
+	/* retired smaller index */
+	struct crt_epi_table	*et_prev;
+	struct crt_ep_inflight	*et_slots[0];
+};
 
 /* crt_context */
 struct crt_context {
@@ -105,19 +174,56 @@ struct crt_context {
 	int			 cc_idx; /* context index */
 	struct crt_hg_context	 cc_hg_ctx; /* HG context */
 	void			*cc_pool; /* pool for ES on server stack */
-	/* in-flight endpoint tracking hash table */
-	struct chash_table	 cc_epi_table;
-	/* binheap for inflight RPC timeout tracking */
-	struct crt_binheap	 cc_bh_timeout;
-	/* mutex to protect cc_epi_table */
+	/* in-flight endpoint tracking index */
+	struct crt_epi_table	*cc_epi_table;
+	/* number of entries in cc_epi_table */
+	uint32_t		 cc_epi_num;
+	/* timing wheel for inflight RPC timeout tracking */
+	struct crt_twheel	 cc_timeout_wheel;
+	/*
+	 * lower bound (us) of the next RPC timeout, UINT64_MAX if none,
+	 * lets crt_progress skip the wheel lock. Read without lock, only
+	 * updated with cc_timeout_mutex held.
+	 */
+	uint64_t		 cc_timeout_next;
+	/* mutex to protect cc_timeout_wheel and cc_timeout_next */
+	pthread_mutex_t		 cc_timeout_mutex;
+	/* mutex to serialize cc_epi_table insertion */
 	pthread_mutex_t		 cc_mutex;
+	/* open batches of coalesced requests, one per endpoint */
+	crt_list_t		 cc_batch_list;
+	/* number of batches in cc_batch_list, read without lock */
+	uint32_t		 cc_batch_num;
+	/* mutex to protect cc_batch_list */
+	pthread_mutex_t		 cc_batch_mutex;
+	/* vectors of requests pending a vectored handler, one per opcode */
+	crt_list_t		 cc_vec_list;
+	/*
+	 * lower bound (us) of the next vector dispatch, UINT64_MAX if none.
+	 * Read without lock, only updated with cc_vec_mutex held.
+	 */
+	uint64_t		 cc_vec_next;
+	/* mutex to protect cc_vec_list and cc_vec_next */
+	pthread_mutex_t		 cc_vec_mutex;
+	/* endpoints being resolved, struct crt_addr_pend */
+	crt_list_t		 cc_addr_pend_list;
+	/*
+	 * lower bound (us) of the next crt_addr_pend deadline, UINT64_MAX if
+	 * none. Read without lock, only updated with cc_addr_mutex held.
+	 */
+	uint64_t		 cc_addr_pend_next;
+	/*
+	 * mutex to protect cc_addr_pend_list, cc_addr_pend_next and the
+	 * requests queued on it
+	 */
+	pthread_mutex_t		 cc_addr_mutex;
+	/* pool for RPC descriptors and input/output buffers */
+	struct crt_rpc_pool	 cc_rpc_pool;
 };
 
 /* in-flight RPC req list, be tracked per endpoint for every crt_context */
 struct crt_ep_inflight {
-	/* link to crt_context::cc_epi_table */
-	crt_list_t		epi_link;
-	/* endpoint address */
+	/* endpoint address, key of crt_context::cc_epi_table */
 	crt_endpoint_t		epi_ep;
 	struct crt_context	*epi_ctx;
 
@@ -130,7 +236,16 @@ struct crt_ep_inflight {
 	crt_list_t		epi_req_waitq;
 	int64_t			epi_req_wait_num;
 
-	unsigned int		epi_ref;
+	/* adaptive flow-control window, \see CRT_EPI_WINDOW_MIN/MAX */
+	int64_t			epi_window;
+	/* replies acked in current window, for additive increase */
+	int64_t			epi_window_acked;
+	/* smoothed and minimal reply latency in us */
+	uint64_t		epi_srtt_us;
+	uint64_t		epi_min_rtt_us;
+	/* time stamp (us) of last window decrease, at most once per RTT */
+	uint64_t		epi_decrease_ts;
+
 	unsigned int		epi_initialized:1;
 
 	/* mutex to protect ei_req_q and some counters */
@@ -142,6 +257,20 @@ struct crt_ep_inflight {
 #define CRT_ADDR_STR_MAX_LEN		(128)
 
 #define CRT_OPC_MAP_BITS	(12)
+/* initial number of slots of the opcode index, a power of two */
+#define CRT_OPC_TABLE_BITS	(6)
+
+/*
+ * Open addressing index of crt_opc_info by opcode, read without lock.
+ * Slots are only ever filled, and the index is replaced by a copy of twice
+ * the size when half full.
+ */
+struct crt_opc_table {
+	uint32_t		 cot_cap; /* number of slots, power of two */
+	/* retired smaller index */
+	struct crt_opc_table	*cot_prev;
+	struct crt_opc_info	*cot_slots[0];
+};
 
 /* opcode map (hash list) */
 struct crt_opc_map {
@@ -150,6 +279,20 @@ struct crt_opc_map {
 	unsigned int		com_pid;
 	unsigned int		com_bits;
 	crt_list_t		*com_hash;
+	/*
+	 * lock-free lookup index, updated with com_rwlock held in write mode
+	 * which still serializes the registrations.
+	 */
+	struct crt_opc_table	*com_table;
+	/* number of opcodes in com_table */
+	uint32_t		 com_num;
+};
+
+/* vectored handler of an opcode, \see crt_rpc_srv_register_vec */
+struct crt_opc_vec {
+	crt_rpc_vec_cb_t	ov_cb;
+	uint32_t		ov_max;
+	uint32_t		ov_wait_us;
 };
 
 struct crt_opc_info {
@@ -157,9 +300,20 @@ struct crt_opc_info {
 	crt_opcode_t		coi_opc;
 	unsigned int		coi_proc_init:1,
 				coi_rpccb_init:1,
-				coi_coops_init:1;
+				coi_coops_init:1,
+				/* CRT_RPC_FEAT_COALESCE */
+				coi_coalesce:1,
+				/* CRT_RPC_FEAT_ONEWAY */
+				coi_oneway:1,
+				/* CRT_RPC_FEAT_IOV_INPLACE */
+				coi_iov_inplace:1;
 
 	crt_rpc_cb_t		coi_rpc_cb;
+	/* vectored handler, used instead of coi_rpc_cb when set */
+	crt_rpc_vec_cb_t	coi_vec_cb;
+	/* max number of requests per vector and max wait (us) of a vector */
+	uint32_t		coi_vec_max;
+	uint32_t		coi_vec_wait_us;
 	struct crt_corpc_ops	*coi_co_ops;
 	crt_size_t		coi_input_size;
 	crt_size_t		coi_output_size;
@@ -208,16 +208,14 @@ crt_pmix_assign_rank(struct crt_grp_priv *grp_priv)
 	pmix_proc_t		*myproc = NULL;
 	struct crt_pmix_gdata	*pmix_gdata;
 	pmix_info_t		*info;
-	pmix_pdata_t		*pdata;
 	pmix_value_t		*val;
-	char			*unpublish_key[2];
+	pmix_value_t		 pval;
 	/*
 	pmix_persistence_t	 persistence;
 	pmix_data_range_t	 range;
 	*/
 	pmix_proc_t		 proc;
 	bool			 flag = true;
-	int			 nkeys = 1;
 	struct crt_rank_map	 *rank_map;
 	int			 i, rc = 0;
 
@@ -225,8 +223,6 @@ crt_pmix_assign_rank(struct crt_grp_priv *grp_priv)
 	C_ASSERT(crt_gdata.cg_grp != NULL);
 	pmix_gdata = crt_gdata.cg_grp->gg_pmix;
 	myproc = &pmix_gdata->pg_proc;
-	unpublish_key[0] = NULL;
-	unpublish_key[1] = NULL;
 	rank_map = grp_priv->gp_rank_map;
 	C_ASSERT(rank_map != NULL);
 
@@ -269,101 +265,74 @@ crt_pmix_assign_rank(struct crt_grp_priv *grp_priv)
 	}
 
 	/*
-	 * every process publishes its own address string using
-	 * (PMIx_rank, setname/addrString)
+	 * every process puts its own process set name, one fence with data
+	 * collection distributes all of them, so the rank map is built by
+	 * local PMIx_Get calls from the client cache instead of one blocking
+	 * PMIx_Lookup per process of the universe. PMIx_Put copies the value.
+	 * The URI rides on the same fence, see crt_pmix_uri_get.
 	 */
-	PMIX_INFO_CREATE(info, nkeys);
-	snprintf(info[0].key, PMIX_MAX_KEYLEN + 1, "%s-%d-psname",
-		myproc->nspace, myproc->rank);
-	unpublish_key[0] = strndup(info[0].key, PMIX_MAX_KEYLEN);
-	if (!unpublish_key[0]) {
-		PMIX_INFO_FREE(info, nkeys);
-		C_GOTO(out, rc = -CER_NOMEM);
+	pval.type = PMIX_STRING;
+	pval.data.string = grp_priv->gp_pub.cg_grpid;
+	rc = PMIx_Put(PMIX_GLOBAL, CRT_PMIX_PSNAME_KEY, &pval);
+	if (rc != PMIX_SUCCESS) {
+		C_ERROR("PMIx ns %s rank %d, PMIx_Put failed,rc: %d.\n",
+			myproc->nspace, myproc->rank, rc);
+		C_GOTO(out, rc = -CER_PMIX);
 	}
-	info[0].value.type = PMIX_STRING;
-	info[0].value.data.string = strndup(grp_priv->gp_pub.cg_grpid,
-					    CRT_GROUP_ID_MAX_LEN);
-	if (info[0].value.data.string == NULL) {
-		PMIX_INFO_FREE(info, 1);
-		free(unpublish_key[0]);
-		C_GOTO(out, rc = -CER_NOMEM);
+	pval.data.string = crt_gdata.cg_addr;
+	rc = PMIx_Put(PMIX_GLOBAL, CRT_PMIX_URI_KEY, &pval);
+	if (rc != PMIX_SUCCESS) {
+		C_ERROR("PMIx ns %s rank %d, PMIx_Put failed,rc: %d.\n",
+			myproc->nspace, myproc->rank, rc);
+		C_GOTO(out, rc = -CER_PMIX);
 	}
-
-	/*
-	persistence = PMIX_PERSIST_SESSION;
-	range = PMIX_RANGE_GLOBAL;
-	PMIX_INFO_LOAD(&info[1], PMIX_PERSISTENCE, &persistence,
-			PMIX_UINT);
-	PMIX_INFO_LOAD(&info[2], PMIX_RANGE, &range, PMIX_UINT);
-	*/
-	rc = PMIx_Publish(info, nkeys);
+	rc = PMIx_Commit();
 	if (rc != PMIX_SUCCESS) {
-		C_ERROR("PMIx ns %s rank %d, PMIx_Publish failed,rc: %d.\n",
+		C_ERROR("PMIx ns %s rank %d, PMIx_Commit failed,rc: %d.\n",
 			myproc->nspace, myproc->rank, rc);
-		PMIX_INFO_FREE(info, nkeys);
-		free(unpublish_key[0]);
 		C_GOTO(out, rc = -CER_PMIX);
 	}
-	PMIX_INFO_FREE(info, nkeys);
 
-	/* call fence to ensure the data is received */
+	/* the only collective exchange, see PMIX_COLLECT_DATA */
 	rc = crt_pmix_fence();
 	if (rc != 0) {
 		C_ERROR("PMIx ns %s rank %d, crt_pmix_fence failed,rc: %d.\n",
 			myproc->nspace, myproc->rank, rc);
-		free(unpublish_key[0]);
 		C_GOTO(out, rc);
 	}
 
-	/* loop over universe size, parse address string and set size */
-	PMIX_PDATA_CREATE(pdata, 1);
+	/* loop over universe size, compare the set name and set size */
+	PMIX_PROC_CONSTRUCT(&proc);
+	strncpy(proc.nspace, myproc->nspace, PMIX_MAX_NSLEN);
 	for (i = 0; i < pmix_gdata->pg_univ_size; i++) {
-		/* generate the key to query my process set name */
-		snprintf(pdata[0].key, PMIX_MAX_KEYLEN + 1, "%s-%d-psname",
-			 myproc->nspace, i);
-
-		rc = PMIx_Lookup(pdata, 1, NULL, 0);
-		if (rc != PMIX_SUCCESS) {
-			C_ERROR("PMIx ns %s rank %d, PMIx_Lookup %s failed, "
+		proc.rank = i;
+		rc = PMIx_Get(&proc, CRT_PMIX_PSNAME_KEY, NULL, 0, &val);
+		if (rc != PMIX_SUCCESS || val->type != PMIX_STRING) {
+			C_ERROR("PMIx ns %s rank %d, PMIx_Get rank %d failed, "
 				"rc: %d.\n", myproc->nspace, myproc->rank,
-				pdata[0].key, rc);
-			PMIX_PDATA_FREE(pdata, 1);
-			free(unpublish_key[0]);
+				i, rc);
+			if (rc == PMIX_SUCCESS)
+				PMIX_VALUE_RELEASE(val);
+			PMIX_PROC_DESTRUCT(&proc);
 			C_GOTO(out, rc = -CER_PMIX);
 		}
 
 		if (i == myproc->rank)
 			grp_priv->gp_self = grp_priv->gp_size;
 
-		if (strncmp(grp_priv->gp_pub.cg_grpid,
-			    pdata[0].value.data.string,
+		if (strncmp(grp_priv->gp_pub.cg_grpid, val->data.string,
 			    CRT_GROUP_ID_MAX_LEN) == 0) {
 			rank_map[i].rm_rank = grp_priv->gp_size;
 			rank_map[i].rm_status = CRT_RANK_ALIVE;
+			grp_priv->gp_pmix_ranks[grp_priv->gp_size] = i;
 			grp_priv->gp_size++;
 		} else {
 			rank_map[i].rm_status = CRT_RANK_NOENT;
 		}
+		PMIX_VALUE_RELEASE(val);
 	}
-	PMIX_PDATA_FREE(pdata, 1);
-
-	/* call fence before unpublish */
-	rc = crt_pmix_fence();
-	if (rc != 0) {
-		C_ERROR("PMIx ns %s rank %d, crt_pmix_fence failed,rc: %d.\n",
-			myproc->nspace, myproc->rank, rc);
-		free(unpublish_key[0]);
-		C_GOTO(out, rc);
-	}
-
-	rc = PMIx_Unpublish(unpublish_key, NULL, 0);
-	if (rc != PMIX_SUCCESS) {
-		C_ERROR("PMIx ns %s rank %d, PMIx_Unpublish failed, rc: %d.\n",
-			myproc->nspace, myproc->rank, rc);
-		free(unpublish_key[0]);
-		C_GOTO(out, rc = -CER_PMIX);
-	}
-	free(unpublish_key[0]);
+	PMIX_PROC_DESTRUCT(&proc);
+	rc = 0;
 
 out:
 	if (rc == 0)
@@ -508,6 +477,57 @@ out:
 	return rc;
 }
 
+/*
+ * get the URI of \a rank of the local primary group from the data collected
+ * by the fence of crt_pmix_assign_rank. PMIX_IMMEDIATE keeps PMIx_Get to the
+ * client's cache, so it does not block on the PMIx server and can be called
+ * on the send path.
+ */
+int
+crt_pmix_uri_get(struct crt_grp_priv *grp_priv, crt_rank_t rank, char **uri)
+{
+	pmix_proc_t	*myproc;
+	pmix_proc_t	 proc;
+	pmix_info_t	*info = NULL;
+	pmix_value_t	*val = NULL;
+	bool		 flag = true;
+	int		 rc = 0;
+
+	C_ASSERT(grp_priv != NULL && grp_priv->gp_pmix_ranks != NULL);
+	C_ASSERT(rank < grp_priv->gp_size && uri != NULL);
+	myproc = &crt_gdata.cg_grp->gg_pmix->pg_proc;
+
+	PMIX_INFO_CREATE(info, 1);
+	if (info == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+	PMIX_INFO_LOAD(&info[0], PMIX_IMMEDIATE, &flag, PMIX_BOOL);
+
+	PMIX_PROC_CONSTRUCT(&proc);
+	strncpy(proc.nspace, myproc->nspace, PMIX_MAX_NSLEN);
+	proc.rank = grp_priv->gp_pmix_ranks[rank];
+	rc = PMIx_Get(&proc, CRT_PMIX_URI_KEY, info, 1, &val);
+	PMIX_PROC_DESTRUCT(&proc);
+	if (rc != PMIX_SUCCESS || val->type != PMIX_STRING) {
+		C_ERROR("PMIx_Get %s of rank %d failed, rc: %d.\n",
+			CRT_PMIX_URI_KEY, rank, rc);
+		C_GOTO(out, rc = -CER_PMIX);
+	}
+	if (strlen(val->data.string) > CRT_ADDR_STR_MAX_LEN) {
+		C_ERROR("got bad uri %s.\n", val->data.string);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+	*uri = strdup(val->data.string);
+	if (*uri == NULL)
+		rc = -CER_NOMEM;
+
+out:
+	if (val != NULL)
+		PMIX_VALUE_RELEASE(val);
+	if (info != NULL)
+		PMIX_INFO_FREE(info, 1);
+	return rc;
+}
+
 /* PMIx attach to a primary group */
 int
 crt_pmix_attach(struct crt_grp_priv *grp_priv)
@@ -55,6 +55,10 @@ struct crt_pmix_gdata {
 	uint32_t		pg_num_apps;
 };
 
+/* key of the process set name put by every process, see crt_pmix_assign_rank */
+#define CRT_PMIX_PSNAME_KEY	"cart-psname"
+/* key of the URI put by every process, see crt_pmix_uri_get */
+#define CRT_PMIX_URI_KEY	"cart-uri"
 
 int crt_pmix_init(void);
 int crt_pmix_fini(void);
@@ -62,6 +66,8 @@ int crt_pmix_fence(void);
 int crt_pmix_assign_rank(struct crt_grp_priv *grp_priv);
 int crt_pmix_publish_self(struct crt_grp_priv *grp_priv);
 int crt_pmix_uri_lookup(crt_group_id_t srv_grpid, crt_rank_t rank, char **uri);
+int crt_pmix_uri_get(struct crt_grp_priv *grp_priv, crt_rank_t rank,
+		     char **uri);
 int crt_pmix_attach(struct crt_grp_priv *grp_priv);
 void crt_pmix_reg_event_hdlr(struct crt_grp_priv *grp_priv);
 void crt_pmix_dereg_event_hdlr(struct crt_grp_priv *grp_priv);
@@ -0,0 +1,258 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It implements the built-in reductions of
+ * collective RPC replies (struct crt_corpc_red), with GCC vector extensions so
+ * the loops use SIMD instructions whatever the target.
+ */
+
+#include <crt_internal.h>
+
+/*
+ * the widest vector of the target. A baseline x86_64 build (SSE2 only) uses
+ * 32 bytes vectors too and also compiles the reductions for AVX2, the clone is
+ * picked at load time, the default one splits each vector in two SSE2 halves.
+ */
+#if defined(__AVX512F__)
+#define CRT_RED_VEC_SIZE	(64)
+#elif defined(__AVX__)
+#define CRT_RED_VEC_SIZE	(32)
+#elif defined(__x86_64__) && (__GNUC__ >= 6)
+#define CRT_RED_VEC_SIZE	(32)
+#define CRT_RED_CLONES		__attribute__((target_clones("avx2", "default")))
+#else
+#define CRT_RED_VEC_SIZE	(16)
+#endif
+
+#ifndef CRT_RED_CLONES
+#define CRT_RED_CLONES
+#endif
+
+/*
+ * sources folded per pass over the result, saves loading and storing the
+ * result for each source while keeping few streams for the prefetcher.
+ */
+#define CRT_RED_SRC_GROUP	(8)
+/* vectors in flight, the operations of each source on a vector depend */
+#define CRT_RED_UNROLL		(4)
+
+typedef int32_t crt_red_vi32 __attribute__((vector_size(CRT_RED_VEC_SIZE)));
+typedef uint32_t crt_red_vu32 __attribute__((vector_size(CRT_RED_VEC_SIZE)));
+typedef int64_t crt_red_vi64 __attribute__((vector_size(CRT_RED_VEC_SIZE)));
+typedef uint64_t crt_red_vu64 __attribute__((vector_size(CRT_RED_VEC_SIZE)));
+typedef double crt_red_vf64 __attribute__((vector_size(CRT_RED_VEC_SIZE)));
+
+/*
+ * mask ? a : b for each lane, the lanes of the mask (of type mt, the signed
+ * integer vector as wide as vt) being all ones or zero.
+ */
+#define CRT_RED_SELECT(vt, mt, mask, a, b)				\
+	((vt)((mt)(b) ^ (((mt)(a) ^ (mt)(b)) & (mask))))
+
+#define CRT_RED_SUM_V(vt, mt, a, b)	((a) + (b))
+#define CRT_RED_SUM_S(a, b)		((a) + (b))
+#define CRT_RED_MIN_V(vt, mt, a, b)	CRT_RED_SELECT(vt, mt, (a) < (b), a, b)
+#define CRT_RED_MIN_S(a, b)		((a) < (b) ? (a) : (b))
+#define CRT_RED_MAX_V(vt, mt, a, b)	CRT_RED_SELECT(vt, mt, (a) > (b), a, b)
+#define CRT_RED_MAX_S(a, b)		((a) > (b) ? (a) : (b))
+#define CRT_RED_BOR_V(vt, mt, a, b)	((a) | (b))
+#define CRT_RED_BOR_S(a, b)		((a) | (b))
+#define CRT_RED_BAND_V(vt, mt, a, b)	((a) & (b))
+#define CRT_RED_BAND_S(a, b)		((a) & (b))
+
+typedef void (*crt_red_fn_t)(void *result, const char **sources, int nr,
+			     uint32_t offset, uint32_t count);
+
+/*
+ * result[i] = result[i] OP source[offset + i] for the nr sources, a few
+ * vectors at a time, then a vector at a time, then the tail. The elements are
+ * aligned to their type, as fields of the output struct, but not necessarily
+ * to the vector size.
+ */
+#define CRT_RED_FN(op, OP, name, type, vt, mt)				\
+static void CRT_RED_CLONES						\
+crt_red_##op##_##name(void *result, const char **sources, int nr,	\
+		      uint32_t offset, uint32_t count)			\
+{									\
+	const uint32_t	 lanes = sizeof(vt) / sizeof(type);		\
+	type		*dst = result;					\
+	const type	*src;						\
+	vt		 a[CRT_RED_UNROLL], b;				\
+	uint32_t	 i = 0;						\
+	int		 j, u;						\
+									\
+	for (; i + CRT_RED_UNROLL * lanes <= count;			\
+	     i += CRT_RED_UNROLL * lanes) {				\
+		memcpy(a, dst + i, sizeof(a));				\
+		for (j = 0; j < nr; j++) {				\
+			src = (const type *)(sources[j] + offset) + i;	\
+			for (u = 0; u < CRT_RED_UNROLL; u++) {		\
+				memcpy(&b, src + u * lanes, sizeof(b));	\
+				a[u] = CRT_RED_##OP##_V(vt, mt, a[u], b); \
+			}						\
+		}							\
+		memcpy(dst + i, a, sizeof(a));				\
+	}								\
+	for (; i + lanes <= count; i += lanes) {			\
+		memcpy(a, dst + i, sizeof(a[0]));			\
+		for (j = 0; j < nr; j++) {				\
+			src = (const type *)(sources[j] + offset) + i;	\
+			memcpy(&b, src, sizeof(b));			\
+			a[0] = CRT_RED_##OP##_V(vt, mt, a[0], b);	\
+		}							\
+		memcpy(dst + i, a, sizeof(a[0]));			\
+	}								\
+	for (; i < count; i++) {					\
+		for (j = 0; j < nr; j++) {				\
+			src = (const type *)(sources[j] + offset);	\
+			dst[i] = CRT_RED_##OP##_S(dst[i], src[i]);	\
+		}							\
+	}								\
+}
+
+#define CRT_RED_FNS_INT(op, OP)						\
+	CRT_RED_FN(op, OP, i32, int32_t, crt_red_vi32, crt_red_vi32)	\
+	CRT_RED_FN(op, OP, u32, uint32_t, crt_red_vu32, crt_red_vi32)	\
+	CRT_RED_FN(op, OP, i64, int64_t, crt_red_vi64, crt_red_vi64)	\
+	CRT_RED_FN(op, OP, u64, uint64_t, crt_red_vu64, crt_red_vi64)
+
+#define CRT_RED_FNS(op, OP)						\
+	CRT_RED_FNS_INT(op, OP)						\
+	CRT_RED_FN(op, OP, f64, double, crt_red_vf64, crt_red_vi64)
+
+/* signed sums are done unsigned, to wrap around rather than overflow */
+CRT_RED_FN(sum, SUM, u32, uint32_t, crt_red_vu32, crt_red_vi32)
+CRT_RED_FN(sum, SUM, u64, uint64_t, crt_red_vu64, crt_red_vi64)
+CRT_RED_FN(sum, SUM, f64, double, crt_red_vf64, crt_red_vi64)
+CRT_RED_FNS(min, MIN)
+CRT_RED_FNS(max, MAX)
+CRT_RED_FNS_INT(bor, BOR)
+CRT_RED_FNS_INT(band, BAND)
+
+#define CRT_RED_ROW_INT(op)						\
+	[CRT_RED_INT32]		= crt_red_##op##_i32,			\
+	[CRT_RED_UINT32]	= crt_red_##op##_u32,			\
+	[CRT_RED_INT64]		= crt_red_##op##_i64,			\
+	[CRT_RED_UINT64]	= crt_red_##op##_u64
+
+#define CRT_RED_ROW(op)							\
+	CRT_RED_ROW_INT(op),						\
+	[CRT_RED_DOUBLE]	= crt_red_##op##_f64
+
+/* NULL for the invalid combinations */
+static const crt_red_fn_t
+crt_red_fns[CRT_RED_OP_MAX + 1][CRT_RED_TYPE_MAX + 1] = {
+	[CRT_RED_SUM]	= {
+		[CRT_RED_INT32]		= crt_red_sum_u32,
+		[CRT_RED_UINT32]	= crt_red_sum_u32,
+		[CRT_RED_INT64]		= crt_red_sum_u64,
+		[CRT_RED_UINT64]	= crt_red_sum_u64,
+		[CRT_RED_DOUBLE]	= crt_red_sum_f64,
+	},
+	[CRT_RED_MIN]	= { CRT_RED_ROW(min) },
+	[CRT_RED_MAX]	= { CRT_RED_ROW(max) },
+	[CRT_RED_BOR]	= { CRT_RED_ROW_INT(bor) },
+	[CRT_RED_BAND]	= { CRT_RED_ROW_INT(band) },
+};
+
+static const uint32_t crt_red_type_size[CRT_RED_TYPE_MAX + 1] = {
+	[CRT_RED_INT32]		= sizeof(int32_t),
+	[CRT_RED_UINT32]	= sizeof(uint32_t),
+	[CRT_RED_INT64]		= sizeof(int64_t),
+	[CRT_RED_UINT64]	= sizeof(uint64_t),
+	[CRT_RED_DOUBLE]	= sizeof(double),
+};
+
+int
+crt_corpc_red_check(struct crt_corpc_ops *co_ops, crt_size_t output_size)
+{
+	struct crt_corpc_red	*red;
+	crt_size_t		 end;
+	int			 i;
+
+	C_ASSERT(co_ops != NULL);
+	if (co_ops->co_red_nr < 0 ||
+	    (co_ops->co_red_nr > 0 && co_ops->co_reds == NULL)) {
+		C_ERROR("invalid co_reds %p, co_red_nr %d.\n",
+			co_ops->co_reds, co_ops->co_red_nr);
+		return -CER_INVAL;
+	}
+
+	for (i = 0; i < co_ops->co_red_nr; i++) {
+		red = &co_ops->co_reds[i];
+		if (red->cr_op < CRT_RED_OP_MIN || red->cr_op > CRT_RED_OP_MAX ||
+		    red->cr_type < CRT_RED_TYPE_MIN ||
+		    red->cr_type > CRT_RED_TYPE_MAX ||
+		    crt_red_fns[red->cr_op][red->cr_type] == NULL) {
+			C_ERROR("co_reds[%d] invalid, op %d, type %d.\n",
+				i, red->cr_op, red->cr_type);
+			return -CER_INVAL;
+		}
+		end = (crt_size_t)red->cr_offset +
+		      (crt_size_t)red->cr_count * crt_red_type_size[red->cr_type];
+		if (end > output_size) {
+			C_ERROR("co_reds[%d] ends at "CF_U64", beyond output "
+				"size "CF_U64".\n", i, end, output_size);
+			return -CER_INVAL;
+		}
+	}
+
+	return 0;
+}
+
+void
+crt_corpc_reduce(const struct crt_corpc_red *reds, int red_nr,
+		 crt_rpc_t **sources, int nr, crt_rpc_t *result)
+{
+	const char	*outputs[CRT_RED_SRC_GROUP];
+	crt_red_fn_t	 fn;
+	char		*dst;
+	int		 i, j, k;
+
+	/* one reduction at a time, its result stays in cache */
+	for (i = 0; i < red_nr; i++) {
+		fn = crt_red_fns[reds[i].cr_op][reds[i].cr_type];
+		dst = (char *)result->cr_output + reds[i].cr_offset;
+		for (j = 0; j < nr; j += k) {
+			for (k = 0; k < CRT_RED_SRC_GROUP && j + k < nr; k++)
+				outputs[k] = sources[j + k]->cr_output;
+			fn(dst, outputs, k, reds[i].cr_offset,
+			   reds[i].cr_count);
+		}
+	}
+}
@@ -42,6 +42,32 @@
 
 #include <crt_internal.h>
 
+static struct crt_opc_table *
+crt_opc_table_alloc(uint32_t cap)
+{
+	struct crt_opc_table	*tab;
+
+	C_ASSERT(cap != 0 && (cap & (cap - 1)) == 0);
+	C_ALLOC(tab, sizeof(*tab) + cap * sizeof(tab->cot_slots[0]));
+	if (tab != NULL)
+		tab->cot_cap = cap;
+
+	return tab;
+}
+
+static void
+crt_opc_table_free(struct crt_opc_table *tab)
+{
+	struct crt_opc_table	*prev;
+
+	while (tab != NULL) {
+		prev = tab->cot_prev;
+		C_FREE(tab, sizeof(*tab) + tab->cot_cap *
+			    sizeof(tab->cot_slots[0]));
+		tab = prev;
+	}
+}
+
 int
 crt_opc_map_create(unsigned int bits)
 {
@@ -60,6 +86,9 @@ crt_opc_map_create(unsigned int bits)
 	}
 	for (i = 0; i < (1 << bits); i++)
 		CRT_INIT_LIST_HEAD(&map->com_hash[i]);
+	map->com_table = crt_opc_table_alloc(1U << CRT_OPC_TABLE_BITS);
+	if (map->com_table == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
 
 	rc = pthread_rwlock_init(&map->com_rwlock, NULL);
 	if (rc != 0) {
@@ -106,6 +135,7 @@ crt_opc_map_destroy(struct crt_opc_map *map)
 	C_FREE(map->com_hash, sizeof(map->com_hash[0]) * map->com_bits);
 
 skip:
+	crt_opc_table_free(map->com_table);
 	if (map->com_lock_init && map->com_pid == getpid())
 		pthread_rwlock_destroy(&map->com_rwlock);
 
@@ -136,38 +166,87 @@ crt_opc_info_init(struct crt_opc_info *info)
 	*/
 }
 
+/* the opcodes are mostly contiguous, multiplying keeps them apart */
+static inline uint32_t
+crt_opc_table_hash(crt_opcode_t opc)
+{
+	uint32_t	hash = opc * 0x9E3779B1U;
+
+	return hash ^ (hash >> 16);
+}
+
+/*
+ * Lookup the crt_opc_info of \a opc, lock-free. Slots are published with
+ * release semantic after the crt_opc_info is fully initialized, and never
+ * cleared until the map is destroyed, so the first empty slot terminates
+ * the probe.
+ */
 struct crt_opc_info *
-crt_opc_lookup(struct crt_opc_map *map, crt_opcode_t opc, int locked)
+crt_opc_lookup(struct crt_opc_map *map, crt_opcode_t opc)
 {
-	struct crt_opc_info *info = NULL;
-	unsigned int         hash;
+	struct crt_opc_table	*tab;
+	struct crt_opc_info	*info;
+	uint32_t		 mask;
+	uint32_t		 i;
+
+	tab = __atomic_load_n(&map->com_table, __ATOMIC_ACQUIRE);
+	mask = tab->cot_cap - 1;
+	for (i = crt_opc_table_hash(opc) & mask; ; i = (i + 1) & mask) {
+		info = __atomic_load_n(&tab->cot_slots[i], __ATOMIC_ACQUIRE);
+		if (info == NULL || info->coi_opc == opc)
+			return info;
+	}
+}
 
-	hash = crt_opc_hash(map, opc);
+static void
+crt_opc_table_put(struct crt_opc_table *tab, struct crt_opc_info *info)
+{
+	uint32_t	mask = tab->cot_cap - 1;
+	uint32_t	i;
 
-	if (locked == 0)
-		pthread_rwlock_rdlock(&map->com_rwlock);
+	for (i = crt_opc_table_hash(info->coi_opc) & mask;
+	     tab->cot_slots[i] != NULL; i = (i + 1) & mask)
+		;
+	__atomic_store_n(&tab->cot_slots[i], info, __ATOMIC_RELEASE);
+}
 
-	crt_list_for_each_entry(info, &map->com_hash[hash], coi_link) {
-		if (info->coi_opc == opc) {
-			if (locked == 0)
-				pthread_rwlock_unlock(&map->com_rwlock);
-			return info;
+/*
+ * Insert \a info to the index, grow the index when it becomes half full.
+ * Caller should hold crt_opc_map::com_rwlock in write mode.
+ */
+static int
+crt_opc_table_insert(struct crt_opc_map *map, struct crt_opc_info *info)
+{
+	struct crt_opc_table	*tab = map->com_table;
+	struct crt_opc_table	*new_tab;
+	uint32_t		 i;
+
+	if ((map->com_num + 1) * 2 > tab->cot_cap) {
+		new_tab = crt_opc_table_alloc(tab->cot_cap * 2);
+		if (new_tab == NULL)
+			return -CER_NOMEM;
+		for (i = 0; i < tab->cot_cap; i++) {
+			if (tab->cot_slots[i] != NULL)
+				crt_opc_table_put(new_tab, tab->cot_slots[i]);
 		}
-		if (info->coi_opc > opc)
-			break;
+		/* readers may still probe the old one, free it with the map */
+		new_tab->cot_prev = tab;
+		__atomic_store_n(&map->com_table, new_tab, __ATOMIC_RELEASE);
+		tab = new_tab;
 	}
 
-	if (locked == 0)
-		pthread_rwlock_unlock(&map->com_rwlock);
+	crt_opc_table_put(tab, info);
+	map->com_num++;
 
-	return NULL;
+	return 0;
 }
 
 static int
 crt_opc_reg(struct crt_opc_map *map, crt_opcode_t opc,
 	    struct crt_req_format *crf, crt_size_t input_size,
 	    crt_size_t output_size, crt_rpc_cb_t rpc_cb,
-	    struct crt_corpc_ops *co_ops, int locked)
+	    struct crt_opc_vec *vec, struct crt_corpc_ops *co_ops,
+	    uint32_t feats, int locked)
 {
 	struct crt_opc_info *info = NULL, *new_info;
 	unsigned int         hash;
@@ -196,13 +275,31 @@ crt_opc_reg(struct crt_opc_map *map, crt_opcode_t opc,
 				info->coi_output_size = output_size;
 			}
 			info->coi_crf = crf;
+			/*
+			 * the lookup is lock-free and the dispatch prefers
+			 * coi_vec_cb, set the new handler before clearing the
+			 * other one so that the opcode always has one
+			 */
 			if (rpc_cb != NULL) {
 				if (info->coi_rpc_cb != NULL)
 					C_DEBUG("re-reg rpc callback, "
 						"opc 0x%x.\n", opc);
 				else
 					info->coi_rpccb_init = 1;
-				info->coi_rpc_cb = rpc_cb;
+				__atomic_store_n(&info->coi_rpc_cb, rpc_cb,
+						 __ATOMIC_RELEASE);
+				__atomic_store_n(&info->coi_vec_cb, NULL,
+						 __ATOMIC_RELEASE);
+			} else if (vec != NULL) {
+				if (info->coi_vec_cb != NULL)
+					C_DEBUG("re-reg vectored callback, "
+						"opc 0x%x.\n", opc);
+				info->coi_vec_max = vec->ov_max;
+				info->coi_vec_wait_us = vec->ov_wait_us;
+				__atomic_store_n(&info->coi_vec_cb, vec->ov_cb,
+						 __ATOMIC_RELEASE);
+				__atomic_store_n(&info->coi_rpc_cb, NULL,
+						 __ATOMIC_RELEASE);
 			}
 			if (co_ops != NULL) {
 				if (info->coi_co_ops != NULL)
@@ -212,6 +309,11 @@ crt_opc_reg(struct crt_opc_map *map, crt_opcode_t opc,
 					info->coi_coops_init = 1;
 				info->coi_co_ops = co_ops;
 			}
+			info->coi_coalesce =
+				(feats & CRT_RPC_FEAT_COALESCE) != 0;
+			info->coi_oneway = (feats & CRT_RPC_FEAT_ONEWAY) != 0;
+			info->coi_iov_inplace =
+				(feats & CRT_RPC_FEAT_IOV_INPLACE) != 0;
 			C_GOTO(out, rc = 0);
 		}
 		if (info->coi_opc > opc)
@@ -231,11 +333,23 @@ crt_opc_reg(struct crt_opc_map *map, crt_opcode_t opc,
 	if (rpc_cb != NULL) {
 		new_info->coi_rpc_cb = rpc_cb;
 		new_info->coi_rpccb_init = 1;
+	} else if (vec != NULL) {
+		new_info->coi_vec_cb = vec->ov_cb;
+		new_info->coi_vec_max = vec->ov_max;
+		new_info->coi_vec_wait_us = vec->ov_wait_us;
 	}
 	if (co_ops != NULL) {
 		new_info->coi_co_ops = co_ops;
 		new_info->coi_coops_init = 1;
 	}
+	new_info->coi_coalesce = (feats & CRT_RPC_FEAT_COALESCE) != 0;
+	new_info->coi_oneway = (feats & CRT_RPC_FEAT_ONEWAY) != 0;
+	new_info->coi_iov_inplace = (feats & CRT_RPC_FEAT_IOV_INPLACE) != 0;
+	rc = crt_opc_table_insert(map, new_info);
+	if (rc != 0) {
+		C_FREE_PTR(new_info);
+		C_GOTO(out, rc);
+	}
 	crt_list_add_tail(&new_info->coi_link, &info->coi_link);
 
 out:
@@ -246,7 +360,8 @@ out:
 
 int
 crt_rpc_reg_internal(crt_opcode_t opc, struct crt_req_format *crf,
-		     crt_rpc_cb_t rpc_handler, struct crt_corpc_ops *co_ops)
+		     crt_rpc_cb_t rpc_handler, struct crt_opc_vec *vec,
+		     struct crt_corpc_ops *co_ops, uint32_t feats)
 {
 	crt_size_t		input_size = 0;
 	crt_size_t		output_size = 0;
@@ -284,8 +399,15 @@ crt_rpc_reg_internal(crt_opcode_t opc, struct crt_req_format *crf,
 	}
 
 reg_opc:
+	if (co_ops != NULL && co_ops->co_red_nr != 0) {
+		rc = crt_corpc_red_check(co_ops, output_size);
+		if (rc != 0)
+			C_GOTO(out, rc);
+	}
+
 	rc = crt_opc_reg(crt_gdata.cg_opc_map, opc, crf, input_size,
-			 output_size, rpc_handler, co_ops, CRT_UNLOCK);
+			 output_size, rpc_handler, vec, co_ops, feats,
+			 CRT_UNLOCK);
 	if (rc != 0)
 		C_ERROR("rpc (opc: 0x%x) register failed, rc: %d.\n", opc, rc);
 
@@ -300,7 +422,7 @@ crt_rpc_register(crt_opcode_t opc, struct crt_req_format *crf)
 		C_ERROR("opc 0x%x reserved.\n", opc);
 		return -CER_INVAL;
 	}
-	return crt_rpc_reg_internal(opc, crf, NULL, NULL);
+	return crt_rpc_reg_internal(opc, crf, NULL, NULL, NULL, 0);
 }
 
 int
@@ -316,7 +438,35 @@ crt_rpc_srv_register(crt_opcode_t opc, struct crt_req_format *crf,
 		return -CER_INVAL;
 	}
 
-	return crt_rpc_reg_internal(opc, crf, rpc_handler, NULL);
+	return crt_rpc_reg_internal(opc, crf, rpc_handler, NULL, NULL, 0);
+}
+
+int
+crt_rpc_srv_register_vec(crt_opcode_t opc, struct crt_req_format *crf,
+			 crt_rpc_vec_cb_t rpc_vec_handler, uint32_t max_batch,
+			 uint32_t max_wait_us)
+{
+	struct crt_opc_vec	vec;
+
+	if (crt_opcode_reserved(opc)) {
+		C_ERROR("opc 0x%x reserved.\n", opc);
+		return -CER_INVAL;
+	}
+	if (rpc_vec_handler == NULL) {
+		C_ERROR("invalid parameter NULL rpc_vec_handler.\n");
+		return -CER_INVAL;
+	}
+	if (max_batch > CRT_RPC_VEC_MAX) {
+		C_ERROR("invalid parameter max_batch %d, max %d.\n",
+			max_batch, CRT_RPC_VEC_MAX);
+		return -CER_INVAL;
+	}
+
+	vec.ov_cb = rpc_vec_handler;
+	vec.ov_max = max_batch != 0 ? max_batch : CRT_RPC_VEC_MAX_DEFAULT;
+	vec.ov_wait_us = max_wait_us;
+
+	return crt_rpc_reg_internal(opc, crf, NULL, &vec, NULL, 0);
 }
 
 int
@@ -331,6 +481,30 @@ crt_corpc_register(crt_opcode_t opc, struct crt_req_format *crf,
 		C_ERROR("invalid parameter NULL co_ops.\n");
 		return -CER_INVAL;
 	}
+	if (co_ops->co_aggregate == NULL && co_ops->co_aggregate_batch == NULL &&
+	    co_ops->co_red_nr == 0) {
+		C_ERROR("invalid parameter, co_ops aggregates nothing.\n");
+		return -CER_INVAL;
+	}
+
+	return crt_rpc_reg_internal(opc, crf, rpc_handler, NULL, co_ops, 0);
+}
+
+int
+crt_rpc_register_feats(crt_opcode_t opc, struct crt_req_format *crf,
+		       crt_rpc_cb_t rpc_handler, uint32_t feats)
+{
+	if (crt_opcode_reserved(opc)) {
+		C_ERROR("opc 0x%x reserved.\n", opc);
+		return -CER_INVAL;
+	}
+	if ((feats & ~(CRT_RPC_FEAT_COALESCE | CRT_RPC_FEAT_ONEWAY |
+		       CRT_RPC_FEAT_IOV_INPLACE)) ||
+	    ((feats & CRT_RPC_FEAT_COALESCE) &&
+	     (feats & CRT_RPC_FEAT_ONEWAY))) {
+		C_ERROR("invalid parameter, feats 0x%x.\n", feats);
+		return -CER_INVAL;
+	}
 
-	return crt_rpc_reg_internal(opc, crf, rpc_handler, co_ops);
+	return crt_rpc_reg_internal(opc, crf, rpc_handler, NULL, NULL, feats);
 }
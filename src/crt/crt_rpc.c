@@ -76,6 +76,36 @@ static struct crt_req_format CQF_CRT_GRP_DESTROY =
 	DEFINE_CRT_REQ_FMT("CRT_GRP_DESTROY", crt_grp_destroy_in_fields,
 			   crt_grp_destroy_out_fields);
 
+/* coalesced requests */
+static struct crt_msg_field *crt_rpc_batch_in_fields[] = {
+	&CMF_IOVEC,		/* cbi_body */
+	&CMF_UINT32,		/* cbi_num */
+};
+
+static struct crt_msg_field *crt_rpc_batch_out_fields[] = {
+	&CMF_IOVEC,		/* cbo_body */
+	&CMF_UINT32,		/* cbo_num */
+};
+
+static struct crt_req_format CQF_CRT_RPC_BATCH =
+	DEFINE_CRT_REQ_FMT("CRT_RPC_BATCH", crt_rpc_batch_in_fields,
+			   crt_rpc_batch_out_fields);
+
+/* wait for a pipelined collective bulk */
+static struct crt_msg_field *crt_corpc_bulk_wait_in_fields[] = {
+	&CMF_UINT64,		/* bw_pipe_id */
+	&CMF_UINT64,		/* bw_want */
+};
+
+static struct crt_msg_field *crt_corpc_bulk_wait_out_fields[] = {
+	&CMF_UINT64,		/* bw_ready */
+	&CMF_INT,		/* bw_rc */
+};
+
+static struct crt_req_format CQF_CRT_CORPC_BULK_WAIT =
+	DEFINE_CRT_REQ_FMT("CRT_CORPC_BULK_WAIT", crt_corpc_bulk_wait_in_fields,
+			   crt_corpc_bulk_wait_out_fields);
+
 /* uri lookup */
 static struct crt_msg_field *crt_uri_lookup_in_fields[] = {
 	&CMF_GRP_ID,		/* ul_grp_id */
@@ -91,31 +121,78 @@ static struct crt_req_format CQF_CRT_URI_LOOKUP =
 	DEFINE_CRT_REQ_FMT("CRT_URI_LOOKUP", crt_uri_lookup_in_fields,
 			   crt_uri_lookup_out_fields);
 
+/* batched uri lookup */
+static struct crt_msg_field *crt_uri_table_in_fields[] = {
+	&CMF_GRP_ID,		/* ut_grp_id */
+	&CMF_RANK_LIST,		/* ut_ranks */
+	&CMF_BULK,		/* ut_bulk */
+};
+
+static struct crt_msg_field *crt_uri_table_out_fields[] = {
+	&CMF_IOVEC,		/* ut_table */
+	&CMF_UINT64,		/* ut_size */
+	&CMF_INT,		/* ut_rc */
+};
+
+static struct crt_req_format CQF_CRT_URI_TABLE =
+	DEFINE_CRT_REQ_FMT("CRT_URI_TABLE", crt_uri_table_in_fields,
+			   crt_uri_table_out_fields);
+
 struct crt_internal_rpc crt_internal_rpcs[] = {
 	{
 		.ir_name	= "CRT_GRP_CREATE",
 		.ir_opc		= CRT_OPC_GRP_CREATE,
 		.ir_ver		= 1,
 		.ir_flags	= 0,
+		.ir_feats	= 0,
 		.ir_req_fmt	= &CQF_CRT_GRP_CREATE,
 		.ir_hdlr	= crt_hdlr_grp_create,
-		.ir_co_ops	= NULL,
+		.ir_co_ops	= &crt_grp_create_co_ops,
 	}, {
 		.ir_name	= "CRT_GRP_DESTROY",
 		.ir_opc		= CRT_OPC_GRP_DESTROY,
 		.ir_ver		= 1,
 		.ir_flags	= 0,
+		.ir_feats	= 0,
 		.ir_req_fmt	= &CQF_CRT_GRP_DESTROY,
 		.ir_hdlr	= crt_hdlr_grp_destroy,
+		.ir_co_ops	= &crt_grp_destroy_co_ops,
+	}, {
+		.ir_name	= "CRT_RPC_BATCH",
+		.ir_opc		= CRT_OPC_RPC_BATCH,
+		.ir_ver		= 1,
+		.ir_flags	= 0,
+		.ir_feats	= 0,
+		.ir_req_fmt	= &CQF_CRT_RPC_BATCH,
+		.ir_hdlr	= crt_hdlr_rpc_batch,
+		.ir_co_ops	= NULL,
+	}, {
+		.ir_name	= "CRT_CORPC_BULK_WAIT",
+		.ir_opc		= CRT_OPC_CORPC_BULK_WAIT,
+		.ir_ver		= 1,
+		.ir_flags	= 0,
+		.ir_feats	= 0,
+		.ir_req_fmt	= &CQF_CRT_CORPC_BULK_WAIT,
+		.ir_hdlr	= crt_hdlr_corpc_bulk_wait,
 		.ir_co_ops	= NULL,
 	}, {
 		.ir_name	= "CRT_URI_LOOKUP",
 		.ir_opc		= CRT_OPC_URI_LOOKUP,
 		.ir_ver		= 1,
 		.ir_flags	= 0,
+		.ir_feats	= 0,
 		.ir_req_fmt	= &CQF_CRT_URI_LOOKUP,
 		.ir_hdlr	= crt_hdlr_uri_lookup,
 		.ir_co_ops	= NULL,
+	}, {
+		.ir_name	= "CRT_URI_TABLE",
+		.ir_opc		= CRT_OPC_URI_TABLE,
+		.ir_ver		= 1,
+		.ir_flags	= 0,
+		.ir_feats	= 0,
+		.ir_req_fmt	= &CQF_CRT_URI_TABLE,
+		.ir_hdlr	= crt_hdlr_uri_table,
+		.ir_co_ops	= NULL,
 	}, {
 		.ir_opc		= 0
 	}
@@ -133,7 +210,8 @@ crt_internal_rpc_register(void)
 	for (rpc = crt_internal_rpcs; rpc->ir_opc != 0; rpc++) {
 		C_ASSERT(rpc->ir_hdlr != NULL);
 		rc = crt_rpc_reg_internal(rpc->ir_opc, rpc->ir_req_fmt,
-					   rpc->ir_hdlr, rpc->ir_co_ops);
+					   rpc->ir_hdlr, NULL, rpc->ir_co_ops,
+					   rpc->ir_feats);
 		if (rc) {
 			C_ERROR("opcode 0x%x registration failed, rc: %d.\n",
 				rpc->ir_opc, rc);
@@ -144,15 +222,18 @@ crt_internal_rpc_register(void)
 }
 
 int
-crt_rpc_priv_alloc(crt_opcode_t opc, struct crt_rpc_priv **priv_allocated)
+crt_rpc_priv_alloc(crt_context_t crt_ctx, crt_opcode_t opc,
+		   struct crt_rpc_priv **priv_allocated)
 {
+	struct crt_context	*ctx;
 	struct crt_rpc_priv	*rpc_priv;
 	struct crt_opc_info	*opc_info;
 	int			rc = 0;
 
-	C_ASSERT(priv_allocated != NULL);
+	C_ASSERT(crt_ctx != CRT_CONTEXT_NULL && priv_allocated != NULL);
+	ctx = (struct crt_context *)crt_ctx;
 
-	opc_info = crt_opc_lookup(crt_gdata.cg_opc_map, opc, CRT_UNLOCK);
+	opc_info = crt_opc_lookup(crt_gdata.cg_opc_map, opc);
 	if (opc_info == NULL) {
 		C_ERROR("opc: 0x%x, lookup failed.\n", opc);
 		C_GOTO(out, rc = -CER_UNREG);
@@ -160,11 +241,12 @@ crt_rpc_priv_alloc(crt_opcode_t opc, struct crt_rpc_priv **priv_allocated)
 	C_ASSERT(opc_info->coi_input_size <= CRT_MAX_INPUT_SIZE &&
 		 opc_info->coi_output_size <= CRT_MAX_OUTPUT_SIZE);
 
-	C_ALLOC_PTR(rpc_priv);
+	rpc_priv = crt_rpc_pool_alloc(ctx, sizeof(*rpc_priv));
 	if (rpc_priv == NULL)
 		C_GOTO(out, rc = -CER_NOMEM);
 
 	rpc_priv->crp_opc_info = opc_info;
+	rpc_priv->crp_pub.cr_ctx = crt_ctx;
 	*priv_allocated = rpc_priv;
 
 out:
@@ -178,13 +260,18 @@ crt_rpc_priv_free(struct crt_rpc_priv *rpc_priv)
 		return;
 
 	if (rpc_priv->crp_coll && rpc_priv->crp_corpc_info) {
+		crt_corpc_pipe_unregister(rpc_priv->crp_corpc_info);
+		if (rpc_priv->crp_corpc_info->co_body != NULL)
+			C_FREE(rpc_priv->crp_corpc_info->co_body,
+			       rpc_priv->crp_corpc_info->co_body_size);
 		crt_rank_list_free(
 			rpc_priv->crp_corpc_info->co_excluded_ranks);
 		C_FREE_PTR(rpc_priv->crp_corpc_info);
 	}
 
 	pthread_spin_destroy(&rpc_priv->crp_lock);
-	C_FREE_PTR(rpc_priv);
+	crt_rpc_pool_free(rpc_priv->crp_pub.cr_ctx, rpc_priv,
+			  sizeof(*rpc_priv));
 }
 
 int
@@ -199,7 +286,7 @@ crt_req_create_internal(crt_context_t crt_ctx, crt_endpoint_t tgt_ep,
 	C_ASSERT(crt_ctx != CRT_CONTEXT_NULL && req != NULL);
 	ctx = (struct crt_context *)crt_ctx;
 
-	rc = crt_rpc_priv_alloc(opc, &rpc_priv);
+	rc = crt_rpc_priv_alloc(crt_ctx, opc, &rpc_priv);
 	if (rc != 0) {
 		C_ERROR("crt_rpc_priv_alloc, rc: %d, opc: 0x%x.\n", rc, opc);
 		C_GOTO(out, rc);
@@ -216,11 +303,24 @@ crt_req_create_internal(crt_context_t crt_ctx, crt_endpoint_t tgt_ep,
 		C_GOTO(out, rc);
 	}
 
-	rc = crt_hg_req_create(&ctx->cc_hg_ctx, ctx->cc_idx, tgt_ep, rpc_priv);
-	if (rc != 0) {
-		C_ERROR("crt_hg_req_create failed, rc: %d, opc: 0x%x.\n",
-			rc, opc);
-		C_GOTO(out, rc);
+	if (!forward && rpc_priv->crp_opc_info->coi_oneway)
+		rpc_priv->crp_flags |= CRT_RPC_FLAG_ONEWAY;
+
+	/*
+	 * a request likely to be coalesced needs no HG handle of its own, it
+	 * is created at crt_req_send if the request turns out too large.
+	 */
+	if (forward || !rpc_priv->crp_opc_info->coi_coalesce) {
+		rc = crt_hg_req_create(&ctx->cc_hg_ctx, ctx->cc_idx, tgt_ep,
+				       rpc_priv);
+		/* address not resolved yet, crt_req_send queues the request */
+		if (rc == -CER_AGAIN)
+			rc = 0;
+		if (rc != 0) {
+			C_ERROR("crt_hg_req_create failed, rc: %d, "
+				"opc: 0x%x.\n", rc, opc);
+			C_GOTO(out, rc);
+		}
 	}
 
 	*req = rpc_pub;
@@ -330,9 +430,78 @@ out:
 	return rc;
 }
 
+/* track and send a request with its HG handle created */
+static int
+crt_req_hg_send(struct crt_rpc_priv *rpc_priv)
+{
+	int	rc;
+
+	if (rpc_priv->crp_flags & CRT_RPC_FLAG_ONEWAY) {
+		/* no reply to wait for, so no inflight window nor timeout */
+		rpc_priv->crp_state = RPC_REQ_SENT;
+		rc = crt_hg_req_send(rpc_priv);
+		if (rc != 0) {
+			C_ERROR("crt_hg_req_send failed, rc: %d, opc: 0x%x.\n",
+				rc, rpc_priv->crp_pub.cr_opc);
+			rpc_priv->crp_state = RPC_INITED;
+		}
+		return rc;
+	}
+
+	rc = crt_context_req_track(&rpc_priv->crp_pub);
+	if (rc == CRT_REQ_TRACK_IN_INFLIGHQ) {
+		/* tracked in crt_ep_inflight::epi_req_q */
+		/* set state before sending to avoid race with complete_cb */
+		rpc_priv->crp_state = RPC_REQ_SENT;
+		rc = crt_hg_req_send(rpc_priv);
+		if (rc != 0) {
+			C_ERROR("crt_hg_req_send failed, rc: %d, opc: 0x%x.\n",
+				rc, rpc_priv->crp_pub.cr_opc);
+			rpc_priv->crp_state = RPC_INITED;
+			crt_context_req_untrack(&rpc_priv->crp_pub);
+		}
+	} else if (rc == CRT_REQ_TRACK_IN_WAITQ) {
+		/* queued in crt_hg_context::dhc_req_q */
+		rc = 0;
+	} else {
+		C_ERROR("crt_req_track failed, rc: %d, opc: 0x%x.\n",
+			rc, rpc_priv->crp_pub.cr_opc);
+	}
+
+	return rc;
+}
+
+/*
+ * Send a request queued by crt_grp_addr_pend once the address of its target
+ * is resolved, or fail it with \a rc. Releases the reference of crt_req_send.
+ */
+void
+crt_req_addr_resolved(struct crt_rpc_priv *rpc_priv, int rc)
+{
+	struct crt_context	*ctx;
+	crt_rpc_t		*req = &rpc_priv->crp_pub;
+
+	if (rc == 0) {
+		ctx = (struct crt_context *)req->cr_ctx;
+		rc = crt_hg_req_create(&ctx->cc_hg_ctx, ctx->cc_idx,
+				       req->cr_ep, rpc_priv);
+		if (rc == -CER_AGAIN)
+			rc = -CER_UNREACH;
+	}
+	if (rc == 0)
+		rc = crt_req_hg_send(rpc_priv);
+	if (rc != 0) {
+		C_ERROR("rpc_priv %p (opc 0x%x, rank %d) failed, rc: %d.\n",
+			rpc_priv, req->cr_opc, req->cr_ep.ep_rank, rc);
+		crt_rpc_complete(rpc_priv, rc);
+		crt_req_decref(req);
+	}
+}
+
 int
 crt_req_send(crt_rpc_t *req, crt_cb_t complete_cb, void *arg)
 {
+	struct crt_context	*ctx;
 	struct crt_rpc_priv	*rpc_priv = NULL;
 	int			rc = 0;
 
@@ -357,26 +526,39 @@ crt_req_send(crt_rpc_t *req, crt_cb_t complete_cb, void *arg)
 		C_GOTO(out, rc);
 	}
 
-	rc = crt_context_req_track(req);
-	if (rc == CRT_REQ_TRACK_IN_INFLIGHQ) {
-		/* tracked in crt_ep_inflight::epi_req_q */
-		/* set state before sending to avoid race with complete_cb */
-		rpc_priv->crp_state = RPC_REQ_SENT;
-		rc = crt_hg_req_send(rpc_priv);
-		if (rc != 0) {
-			C_ERROR("crt_hg_req_send failed, rc: %d, opc: 0x%x.\n",
-				rc, rpc_priv->crp_pub.cr_opc);
-			rpc_priv->crp_state = RPC_INITED;
-			crt_context_req_untrack(req);
+	if (rpc_priv->crp_opc_info->coi_coalesce && !rpc_priv->crp_forward) {
+		rc = crt_batch_req_add(rpc_priv);
+		if (rc <= 0) {
+			if (rc != 0)
+				C_ERROR("crt_batch_req_add failed, rc: %d, "
+					"opc: 0x%x.\n", rc, req->cr_opc);
+			C_GOTO(out, rc);
 		}
-	} else if (rc == CRT_REQ_TRACK_IN_WAITQ) {
-		/* queued in crt_hg_context::dhc_req_q */
+		/* too large to be coalesced, send it by itself */
 		rc = 0;
-	} else {
-		C_ERROR("crt_req_track failed, rc: %d, opc: 0x%x.\n",
-			rc, rpc_priv->crp_pub.cr_opc);
 	}
 
+	if (rpc_priv->crp_hg_hdl == NULL) {
+		ctx = (struct crt_context *)req->cr_ctx;
+		rc = crt_hg_req_create(&ctx->cc_hg_ctx, ctx->cc_idx,
+				       req->cr_ep, rpc_priv);
+		if (rc == -CER_AGAIN) {
+			/* sent by crt_req_addr_resolved */
+			rc = crt_grp_addr_pend(rpc_priv);
+			if (rc != 0)
+				C_ERROR("crt_grp_addr_pend failed, rc: %d, "
+					"opc: 0x%x.\n", rc, req->cr_opc);
+			C_GOTO(out, rc);
+		}
+		if (rc != 0) {
+			C_ERROR("crt_hg_req_create failed, rc: %d, "
+				"opc: 0x%x.\n", rc, req->cr_opc);
+			C_GOTO(out, rc);
+		}
+	}
+
+	rc = crt_req_hg_send(rpc_priv);
+
 out:
 	/* internally destroy the req when failed */
 	if (rc != 0 && req != NULL)
@@ -408,6 +590,16 @@ crt_reply_send(crt_rpc_t *req)
 		if (rc != 0)
 			C_ERROR("crt_corpc_reply_hdlr failed, rc: %d, "
 				"opc: 0x%x.\n", rc, rpc_priv->crp_pub.cr_opc);
+	} else if (rpc_priv->crp_srv &&
+		   (rpc_priv->crp_flags & CRT_RPC_FLAG_ONEWAY)) {
+		/* the client does not wait for any reply */
+		rc = 0;
+	} else if (rpc_priv->crp_srv &&
+		   (rpc_priv->crp_flags & CRT_RPC_FLAG_BATCHED)) {
+		rc = crt_batch_reply_send(rpc_priv);
+		if (rc != 0)
+			C_ERROR("crt_batch_reply_send failed, rc: %d, "
+				"opc: 0x%x.\n", rc, rpc_priv->crp_pub.cr_opc);
 	} else {
 		rc = crt_hg_reply_send(rpc_priv);
 		if (rc != 0)
@@ -431,6 +623,22 @@ crt_req_abort(crt_rpc_t *req)
 	}
 
 	rpc_priv = container_of(req, struct crt_rpc_priv, crp_pub);
+	if (!rpc_priv->crp_srv &&
+	    (rpc_priv->crp_flags & CRT_RPC_FLAG_BATCHED)) {
+		rc = crt_batch_req_abort(rpc_priv);
+		if (rc != 0)
+			C_ERROR("crt_batch_req_abort failed, rc: %d, "
+				"opc: 0x%x.\n", rc, req->cr_opc);
+		C_GOTO(out, rc);
+	}
+
+	if (!rpc_priv->crp_srv && crt_grp_addr_unpend(rpc_priv) == 0) {
+		/* was waiting for the address, never reached HG */
+		crt_rpc_complete(rpc_priv, -CER_CANCELED);
+		crt_req_decref(req);
+		C_GOTO(out, rc);
+	}
+
 	rc = crt_hg_req_cancel(rpc_priv);
 	if (rc != 0) {
 		C_ERROR("crt_hg_req_cancel failed, rc: %d, opc: 0x%x.\n",
@@ -441,6 +649,90 @@ out:
 	return rc;
 }
 
+int
+crt_req_set_timeout(crt_rpc_t *req, uint32_t timeout_sec)
+{
+	uint64_t	timeout_ms = (uint64_t)timeout_sec * 1000;
+
+	/* saturate rather than wrap, UINT32_MAX ms is still over 49 days */
+	return crt_req_set_timeout_ms(req, timeout_ms > UINT32_MAX ?
+					   UINT32_MAX : timeout_ms);
+}
+
+int
+crt_req_set_timeout_ms(crt_rpc_t *req, uint32_t timeout_ms)
+{
+	struct crt_rpc_priv	*rpc_priv;
+	int			 rc = 0;
+
+	if (req == NULL) {
+		C_ERROR("invalid parameter (NULL req).\n");
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+
+	rpc_priv = container_of(req, struct crt_rpc_priv, crp_pub);
+	if (rpc_priv->crp_state != RPC_INITED) {
+		C_ERROR("rpc_priv %p (opc 0x%x) already sent, state %d.\n",
+			rpc_priv, req->cr_opc, rpc_priv->crp_state);
+		C_GOTO(out, rc = -CER_BUSY);
+	}
+
+	rpc_priv->crp_timeout_ms = timeout_ms;
+
+out:
+	return rc;
+}
+
+int
+crt_req_reset(crt_rpc_t *req)
+{
+	struct crt_rpc_priv	*rpc_priv;
+	int			 rc = 0;
+
+	if (req == NULL) {
+		C_ERROR("invalid parameter (NULL req).\n");
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+
+	rpc_priv = container_of(req, struct crt_rpc_priv, crp_pub);
+	if (rpc_priv->crp_srv || rpc_priv->crp_coll || rpc_priv->crp_forward ||
+	    rpc_priv->crp_hg_hdl == NULL ||
+	    (rpc_priv->crp_flags & CRT_RPC_FLAG_BATCHED)) {
+		C_ERROR("rpc_priv %p (opc 0x%x) cannot be reset.\n",
+			rpc_priv, req->cr_opc);
+		C_GOTO(out, rc = -CER_NO_PERM);
+	}
+	/*
+	 * a timed out request is completed before its forward is canceled,
+	 * the handle can only be reused once the forward called back.
+	 */
+	if (rpc_priv->crp_state != RPC_COMPLETED &&
+	    rpc_priv->crp_state != RPC_CANCELED &&
+	    (rpc_priv->crp_state != RPC_TIMEOUT ||
+	     __atomic_load_n(&rpc_priv->crp_fwd_inflight, __ATOMIC_ACQUIRE))) {
+		C_ERROR("rpc_priv %p (opc 0x%x) not completed, state %d.\n",
+			rpc_priv, req->cr_opc, rpc_priv->crp_state);
+		C_GOTO(out, rc = -CER_BUSY);
+	}
+
+	rc = crt_hg_req_reset(rpc_priv);
+	if (rc != 0)
+		C_GOTO(out, rc);
+
+	/* the address, HG handle and input/output buffers are kept */
+	crt_common_hdr_init(&rpc_priv->crp_req_hdr, req->cr_opc);
+	crt_common_hdr_init(&rpc_priv->crp_reply_hdr, req->cr_opc);
+	crt_twheel_node_init(&rpc_priv->crp_timeout_node);
+	rpc_priv->crp_complete_cb = NULL;
+	rpc_priv->crp_arg = NULL;
+	rpc_priv->crp_state = RPC_INITED;
+	/* as crt_req_create, the reference is released by crt_req_send */
+	crt_req_addref(req);
+
+out:
+	return rc;
+}
+
 static int
 crt_cb_common(const struct crt_cb_info *cb_info)
 {
@@ -505,21 +797,27 @@ crt_req_send_sync(crt_rpc_t *rpc, uint64_t timeout)
 static void
 crt_rpc_inout_buff_fini(struct crt_rpc_priv *rpc_priv)
 {
-	crt_rpc_t	*rpc_pub;
+	struct crt_context	*ctx;
+	crt_rpc_t		*rpc_pub;
 
 	C_ASSERT(rpc_priv != NULL);
 	rpc_pub = &rpc_priv->crp_pub;
+	ctx = (struct crt_context *)rpc_pub->cr_ctx;
 
 	if (rpc_pub->cr_input != NULL) {
 		C_ASSERT(rpc_pub->cr_input_size != 0);
 		if (!rpc_priv->crp_forward)
-			C_FREE(rpc_pub->cr_input, rpc_pub->cr_input_size);
+			crt_rpc_pool_free(ctx, rpc_pub->cr_input,
+					  rpc_pub->cr_input_size);
+		rpc_pub->cr_input = NULL;
 		rpc_pub->cr_input_size = 0;
 	}
 
 	if (rpc_pub->cr_output != NULL) {
 		C_ASSERT(rpc_pub->cr_output_size != 0);
-		C_FREE(rpc_pub->cr_output, rpc_pub->cr_output_size);
+		crt_rpc_pool_free(ctx, rpc_pub->cr_output,
+				  rpc_pub->cr_output_size);
+		rpc_pub->cr_output = NULL;
 		rpc_pub->cr_output_size = 0;
 	}
 }
@@ -527,12 +825,15 @@ crt_rpc_inout_buff_fini(struct crt_rpc_priv *rpc_priv)
 static int
 crt_rpc_inout_buff_init(struct crt_rpc_priv *rpc_priv)
 {
+	struct crt_context	*ctx;
 	crt_rpc_t		*rpc_pub;
 	struct crt_opc_info	*opc_info;
 	int			rc = 0;
 
 	C_ASSERT(rpc_priv != NULL);
 	rpc_pub = &rpc_priv->crp_pub;
+	ctx = (struct crt_context *)rpc_pub->cr_ctx;
+	C_ASSERT(ctx != NULL);
 	C_ASSERT(rpc_pub->cr_input == NULL);
 	C_ASSERT(rpc_pub->cr_output == NULL);
 	rpc_priv = container_of(rpc_pub, struct crt_rpc_priv, crp_pub);
@@ -545,7 +846,8 @@ crt_rpc_inout_buff_init(struct crt_rpc_priv *rpc_priv)
 	 * See crt_corpc_req_hdlr().
 	 */
 	if (opc_info->coi_input_size > 0 && !rpc_priv->crp_forward) {
-		C_ALLOC(rpc_pub->cr_input, opc_info->coi_input_size);
+		rpc_pub->cr_input = crt_rpc_pool_alloc(ctx,
+					opc_info->coi_input_size);
 		if (rpc_pub->cr_input == NULL) {
 			C_ERROR("cannot allocate memory(size "CF_U64") for "
 				"cr_input.\n", opc_info->coi_input_size);
@@ -554,7 +856,8 @@ crt_rpc_inout_buff_init(struct crt_rpc_priv *rpc_priv)
 		rpc_pub->cr_input_size = opc_info->coi_input_size;
 	}
 	if (opc_info->coi_output_size > 0) {
-		C_ALLOC(rpc_pub->cr_output, opc_info->coi_output_size);
+		rpc_pub->cr_output = crt_rpc_pool_alloc(ctx,
+					opc_info->coi_output_size);
 		if (rpc_pub->cr_output == NULL) {
 			C_ERROR("cannot allocate memory(size "CF_U64") for "
 				"cr_putput.\n", opc_info->coi_input_size);
@@ -579,6 +882,8 @@ crt_rpc_priv_init(struct crt_rpc_priv *rpc_priv, crt_context_t crt_ctx,
 	CRT_INIT_LIST_HEAD(&rpc_priv->crp_epi_link);
 	CRT_INIT_LIST_HEAD(&rpc_priv->crp_tmp_link);
 	CRT_INIT_LIST_HEAD(&rpc_priv->crp_parent_link);
+	crt_twheel_node_init(&rpc_priv->crp_timeout_node);
+	rpc_priv->crp_timeout_ms = 0;
 	rpc_priv->crp_complete_cb = NULL;
 	rpc_priv->crp_arg = NULL;
 	if (!srv_flag) {
@@ -607,6 +912,12 @@ void
 crt_rpc_priv_fini(struct crt_rpc_priv *rpc_priv)
 {
 	C_ASSERT(rpc_priv != NULL);
+	/* the server-side carrier owns the batch, see crt_hdlr_rpc_batch */
+	if (rpc_priv->crp_srv && rpc_priv->crp_batch != NULL &&
+	    rpc_priv->crp_pub.cr_opc == CRT_OPC_RPC_BATCH) {
+		crt_batch_free(rpc_priv->crp_batch);
+		rpc_priv->crp_batch = NULL;
+	}
 	crt_rpc_inout_buff_fini(rpc_priv);
 }
 
@@ -615,87 +926,204 @@ crt_handle_rpc(void *arg)
 {
 	struct crt_rpc_priv	*rpc_priv = arg;
 	crt_rpc_t		*rpc_pub;
+	int			 rc;
 
 	C_ASSERT(rpc_priv != NULL);
 	C_ASSERT(rpc_priv->crp_opc_info != NULL);
 	C_ASSERT(rpc_priv->crp_opc_info->coi_rpc_cb != NULL);
 	rpc_pub = &rpc_priv->crp_pub;
-	rpc_priv->crp_opc_info->coi_rpc_cb(rpc_pub);
+	rc = rpc_priv->crp_opc_info->coi_rpc_cb(rpc_pub);
+	/* a failed coalesced request must not hold back the batch's reply */
+	if (rc != 0 && (rpc_priv->crp_flags & CRT_RPC_FLAG_BATCHED))
+		crt_batch_reply_skip(rpc_priv, rc);
 	crt_req_decref(rpc_pub);
 }
 
-int
-crt_rpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
+static void
+crt_rpc_vec_handle(void *arg)
 {
-	struct crt_context	*crt_ctx;
-	int			 rc = 0;
+	struct crt_rpc_vec	*vec = arg;
+	struct crt_rpc_priv	*rpc_priv;
+	uint32_t		 i;
+	int			 rc;
 
-	C_ASSERT(rpc_priv != NULL);
-	crt_ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+	C_ASSERT(vec != NULL && vec->crv_num > 0);
+	rc = vec->crv_opc_info->coi_vec_cb(vec->crv_reqs, vec->crv_num);
+	if (rc != 0)
+		C_ERROR("coi_vec_cb failed, rc: %d, opc: 0x%x, num: %d.\n",
+			rc, vec->crv_opc_info->coi_opc, vec->crv_num);
+	for (i = 0; i < vec->crv_num; i++) {
+		rpc_priv = container_of(vec->crv_reqs[i], struct crt_rpc_priv,
+					crp_pub);
+		if (rc != 0 && (rpc_priv->crp_flags & CRT_RPC_FLAG_BATCHED))
+			crt_batch_reply_skip(rpc_priv, rc);
+		crt_req_decref(vec->crv_reqs[i]);
+	}
+	C_FREE(vec, sizeof(*vec) + vec->crv_max * sizeof(crt_rpc_t *));
+}
 
-	if (crt_ctx->cc_pool != NULL) {
-		rc = ABT_thread_create(*(ABT_pool *)crt_ctx->cc_pool,
-				       crt_handle_rpc, rpc_priv,
+static void
+crt_rpc_vec_run(struct crt_context *ctx, struct crt_rpc_vec *vec)
+{
+	int	rc;
+
+	if (ctx->cc_pool != NULL) {
+		rc = ABT_thread_create(*(ABT_pool *)ctx->cc_pool,
+				       crt_rpc_vec_handle, vec,
 				       ABT_THREAD_ATTR_NULL, NULL);
-	} else {
-		rc = rpc_priv->crp_opc_info->coi_rpc_cb(&rpc_priv->crp_pub);
-		if (rc != 0)
-			C_ERROR("coi_rpc_cb failed, rc: %d, opc: 0x%x.\n",
-				rc, rpc_priv->crp_pub.cr_opc);
+		if (rc == 0)
+			return;
+		C_ERROR("ABT_thread_create failed, rc: %d, opc: 0x%x, "
+			"handle the vector inline.\n", rc,
+			vec->crv_opc_info->coi_opc);
 	}
-
-	return rc;
+	crt_rpc_vec_handle(vec);
 }
 
+/*
+ * Add a request to the pending vector of its opcode, the vector takes the
+ * reference the caller leaves to the handler (see crt_rpc_handler_common).
+ */
 static int
-timeout_bp_node_enter(struct crt_binheap *h, struct crt_binheap_node *e)
+crt_rpc_vec_queue(struct crt_rpc_priv *rpc_priv)
 {
-	struct crt_rpc_priv	*rpc_priv;
+	struct crt_context	*ctx;
+	struct crt_opc_info	*opc_info;
+	struct crt_rpc_vec	*vec;
+	struct crt_rpc_vec	*full = NULL;
+	uint64_t		 deadline;
+	bool			 found = false;
 
-	C_ASSERT(h != NULL);
-	C_ASSERT(e != NULL);
+	ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
+	opc_info = rpc_priv->crp_opc_info;
 
-	rpc_priv = container_of(e, struct crt_rpc_priv, crp_timeout_bp_node);
+	pthread_mutex_lock(&ctx->cc_vec_mutex);
+	crt_list_for_each_entry(vec, &ctx->cc_vec_list, crv_link) {
+		if (vec->crv_opc_info == opc_info) {
+			found = true;
+			break;
+		}
+	}
+	if (!found) {
+		C_ALLOC(vec, sizeof(*vec) +
+			     opc_info->coi_vec_max * sizeof(crt_rpc_t *));
+		if (vec == NULL) {
+			pthread_mutex_unlock(&ctx->cc_vec_mutex);
+			return -CER_NOMEM;
+		}
+		vec->crv_opc_info = opc_info;
+		vec->crv_max = opc_info->coi_vec_max;
+		vec->crv_first_us = crt_timeus_secdiff(0);
+		crt_list_add_tail(&vec->crv_link, &ctx->cc_vec_list);
+		deadline = vec->crv_first_us + opc_info->coi_vec_wait_us;
+		if (deadline < ctx->cc_vec_next)
+			__atomic_store_n(&ctx->cc_vec_next, deadline,
+					 __ATOMIC_RELAXED);
+	}
+	/* without ABT the caller drops its reference once we return */
+	if (ctx->cc_pool == NULL)
+		crt_req_addref(&rpc_priv->crp_pub);
+	vec->crv_reqs[vec->crv_num++] = &rpc_priv->crp_pub;
+	if (vec->crv_num == vec->crv_max) {
+		/* cc_vec_next stays a valid lower bound */
+		crt_list_del(&vec->crv_link);
+		full = vec;
+	}
+	pthread_mutex_unlock(&ctx->cc_vec_mutex);
 
-	C_DEBUG("rpc_priv %p (opc 0x%x) entering the timeout binheap.\n",
-		rpc_priv, rpc_priv->crp_pub.cr_opc);
+	if (full != NULL)
+		crt_rpc_vec_run(ctx, full);
 
 	return 0;
 }
 
-static int
-timeout_bp_node_exit(struct crt_binheap *h, struct crt_binheap_node *e)
+/*
+ * Dispatch the pending vectors waited long enough, or all of them if \a force.
+ * Returns the number of vectors dispatched.
+ */
+int
+crt_rpc_vec_dispatch(struct crt_context *ctx, bool force)
 {
-	struct crt_rpc_priv	*rpc_priv;
+	struct crt_rpc_vec	*vec, *next;
+	crt_list_t		 ready;
+	uint64_t		 now, deadline;
+	uint64_t		 next_us = UINT64_MAX;
+	int			 num = 0;
+
+	C_ASSERT(ctx != NULL);
+	deadline = __atomic_load_n(&ctx->cc_vec_next, __ATOMIC_RELAXED);
+	if (deadline == UINT64_MAX)
+		return 0;
+	now = crt_timeus_secdiff(0);
+	if (!force && now < deadline)
+		return 0;
 
-	C_ASSERT(h != NULL);
-	C_ASSERT(e != NULL);
+	CRT_INIT_LIST_HEAD(&ready);
+	pthread_mutex_lock(&ctx->cc_vec_mutex);
+	crt_list_for_each_entry_safe(vec, next, &ctx->cc_vec_list, crv_link) {
+		deadline = vec->crv_first_us +
+			   vec->crv_opc_info->coi_vec_wait_us;
+		if (force || deadline <= now)
+			crt_list_move_tail(&vec->crv_link, &ready);
+		else
+			next_us = min(next_us, deadline);
+	}
+	__atomic_store_n(&ctx->cc_vec_next, next_us, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&ctx->cc_vec_mutex);
 
-	rpc_priv = container_of(e, struct crt_rpc_priv, crp_timeout_bp_node);
+	crt_list_for_each_entry_safe(vec, next, &ready, crv_link) {
+		crt_list_del(&vec->crv_link);
+		crt_rpc_vec_run(ctx, vec);
+		num++;
+	}
 
-	C_DEBUG("rpc_priv %p (opc 0x%x) exiting the timeout binheap.\n",
-		rpc_priv, rpc_priv->crp_pub.cr_opc);
+	return num;
+}
 
-	return 0;
+/* bound a progress \a timeout (us) by the next vector dispatch */
+int64_t
+crt_rpc_vec_timeout(struct crt_context *ctx, int64_t timeout)
+{
+	uint64_t	next_us;
+	uint64_t	now;
+
+	next_us = __atomic_load_n(&ctx->cc_vec_next, __ATOMIC_RELAXED);
+	if (next_us == UINT64_MAX || timeout == 0)
+		return timeout;
+	now = crt_timeus_secdiff(0);
+	if (next_us <= now)
+		return 0;
+	if (timeout < 0 || next_us - now < (uint64_t)timeout)
+		return next_us - now;
+	return timeout;
 }
 
-static bool
-timeout_bp_node_cmp(struct crt_binheap_node *a, struct crt_binheap_node *b)
+int
+crt_rpc_common_hdlr(struct crt_rpc_priv *rpc_priv)
 {
-	struct crt_rpc_priv	*rpc_priv_a;
-	struct crt_rpc_priv	*rpc_priv_b;
+	struct crt_context	*crt_ctx;
+	int			 rc = 0;
 
-	C_ASSERT(a != NULL);
-	C_ASSERT(b != NULL);
+	C_ASSERT(rpc_priv != NULL);
+	crt_ctx = (struct crt_context *)rpc_priv->crp_pub.cr_ctx;
 
-	rpc_priv_a = container_of(a, struct crt_rpc_priv, crp_timeout_bp_node);
-	rpc_priv_b = container_of(b, struct crt_rpc_priv, crp_timeout_bp_node);
+	if (rpc_priv->crp_opc_info->coi_vec_cb != NULL) {
+		rc = crt_rpc_vec_queue(rpc_priv);
+		if (rc != 0)
+			C_ERROR("crt_rpc_vec_queue failed, rc: %d, "
+				"opc: 0x%x.\n", rc, rpc_priv->crp_pub.cr_opc);
+	} else if (crt_ctx->cc_pool != NULL) {
+		rc = ABT_thread_create(*(ABT_pool *)crt_ctx->cc_pool,
+				       crt_handle_rpc, rpc_priv,
+				       ABT_THREAD_ATTR_NULL, NULL);
+	} else {
+		rc = rpc_priv->crp_opc_info->coi_rpc_cb(&rpc_priv->crp_pub);
+		if (rc != 0)
+			C_ERROR("coi_rpc_cb failed, rc: %d, opc: 0x%x.\n",
+				rc, rpc_priv->crp_pub.cr_opc);
+	}
+	if (rc != 0 && (rpc_priv->crp_flags & CRT_RPC_FLAG_BATCHED))
+		crt_batch_reply_skip(rpc_priv, rc);
 
-	return rpc_priv_a->crp_timeout_ts < rpc_priv_b->crp_timeout_ts;
+	return rc;
 }
-
-struct crt_binheap_ops crt_timeout_bh_ops = {
-	.hop_enter	= timeout_bp_node_enter,
-	.hop_exit	= timeout_bp_node_exit,
-	.hop_compare	= timeout_bp_node_cmp
-};
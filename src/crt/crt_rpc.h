@@ -43,20 +43,18 @@
 #ifndef __CRT_RPC_H__
 #define __CRT_RPC_H__
 
-#include <crt_util/heap.h>
 
 #define CRT_RPC_MAGIC			(0xAB0C01EC)
 #define CRT_RPC_VERSION			(0x00000001)
 
 /* default RPC timeout 60 second */
 #define CRT_DEFAULT_TIMEOUT_S	(60) /* second */
+#define CRT_DEFAULT_TIMEOUT_MS	(CRT_DEFAULT_TIMEOUT_S * 1000) /* milli-second */
 #define CRT_DEFAULT_TIMEOUT_US	(CRT_DEFAULT_TIMEOUT_S * 1e6) /* micro-second */
 
 /* uri lookup RPC timeout 500mS */
 #define CRT_URI_LOOKUP_TIMEOUT		(1000 * 500)
 
-extern struct crt_binheap_ops crt_timeout_bh_ops;
-
 enum crt_rpc_flags_internal {
 	/* flag of collective RPC (bcast) */
 	CRT_RPC_FLAG_COLL		= (1U << 16),
@@ -66,8 +64,31 @@ enum crt_rpc_flags_internal {
 	CRT_RPC_FLAG_PRIMARY_GRP	= (1U << 18),
 	/* group members piggyback */
 	CRT_RPC_FLAG_MEMBS_INLINE	= (1U << 19),
+	/* coalesced into a CRT_OPC_RPC_BATCH RPC */
+	CRT_RPC_FLAG_BATCHED		= (1U << 20),
+	/* one-way request, sent with CRT_HG_ONEWAY_RPCID and not replied */
+	CRT_RPC_FLAG_ONEWAY		= (1U << 21),
 };
 
+/* max number of requests coalesced into one CRT_OPC_RPC_BATCH RPC */
+#define CRT_BATCH_MAX_NUM		(32)
+/*
+ * size of the packed requests buffer, a request larger than it is sent by
+ * itself. Kept below the mercury eager message size.
+ */
+#define CRT_BATCH_BUF_SIZE		(4096)
+
+/*
+ * a collective bulk larger than one chunk is pipelined hop by hop, a rank
+ * forwards the corpc to its children before the bulk fully arrived and they
+ * pull it chunk by chunk as it lands, see crt_corpc_pipe. Zero chunk size
+ * disables it. The window bounds the chunks in flight per hop.
+ */
+#define CRT_CORPC_CHUNK_SIZE_ENV	"CRT_CORPC_CHUNK_SIZE"
+#define CRT_CORPC_CHUNK_SIZE_DEFAULT	(1U << 18)
+#define CRT_CORPC_CHUNK_WINDOW_ENV	"CRT_CORPC_CHUNK_WINDOW"
+#define CRT_CORPC_CHUNK_WINDOW_DEFAULT	(4)
+
 struct crt_corpc_hdr {
 	/* internal group ID */
 	uint64_t		 coh_int_grpid;
@@ -83,6 +104,8 @@ struct crt_corpc_hdr {
 	/* root rank of the tree, it is the logical rank within the group */
 	uint32_t		 coh_root;
 	uint32_t		 coh_padding;
+	/* sender's crt_corpc_pipe of coh_bulk_hdl, zero if not pipelined */
+	uint64_t		 coh_bulk_pipe;
 };
 
 /* CaRT layer common header */
@@ -112,6 +135,7 @@ typedef enum {
 } crt_rpc_state_t;
 
 struct crt_rpc_priv;
+struct crt_corpc_pipe;
 
 /* corpc info to track the tree topo and child RPCs info */
 struct crt_corpc_info {
@@ -122,19 +146,30 @@ struct crt_corpc_info {
 	crt_rank_t		 co_root;
 	/* the priv passed in crt_corpc_req_create */
 	void			*co_priv;
-	/* child RPCs list */
-	crt_list_t		 co_child_rpcs;
+	/*
+	 * child RPCs replied and failure tokens not yet accounted, pushed
+	 * without lock and drained by one thread at a time, see
+	 * crt_corpc_reply_push. co_reply_pending counts the pushed entries, the
+	 * pusher which bumps it from zero drains.
+	 */
+	struct crt_rpc_priv	*co_reply_head;
+	uint32_t		 co_reply_pending;
+	uint32_t		 co_fail_tokens;
 	/*
 	 * replied child RPC list, when a child RPC being replied and parent
 	 * RPC has not been locally handled, we can not aggregate the reply
 	 * as it possibly be over-written by local RPC handler. So when child
 	 * RPC being replied and parent RPC not finished, the child RPC is
-	 * queued at co_replied_rpcs.
+	 * queued at co_replied_rpcs. Only touched by the draining thread.
 	 */
 	crt_list_t		 co_replied_rpcs;
 	uint32_t		 co_child_num;
+	/* only touched by the draining thread */
 	uint32_t		 co_child_ack_num;
+	/* atomically updated */
 	uint32_t		 co_child_failed_num;
+	/* set by the one who completes the corpc on this node */
+	uint32_t		 co_done;
 	/*
 	 * co_local_done is the flag of local RPC finish handling
 	 * (local reply ready).
@@ -143,6 +178,60 @@ struct crt_corpc_info {
 	/* co_root_excluded is the flag of root in excluded rank list */
 				 co_root_excluded:1;
 	int			 co_rc;
+	/* the pipelined chained bulk, NULL if not pipelined */
+	struct crt_corpc_pipe	*co_pipe;
+	/* the input encoded once for all children, see crt_rpc_priv::crp_co_body */
+	void			*co_body;
+	crt_size_t		 co_body_size;
+};
+
+/*
+ * A set of small requests to one endpoint coalesced into a single
+ * CRT_OPC_RPC_BATCH RPC (the carrier), see crt_batch.c.
+ */
+struct crt_batch {
+	/* link to crt_context::cc_batch_list while open (client) */
+	crt_list_t		 cb_link;
+	/* target endpoint (client) */
+	crt_endpoint_t		 cb_ep;
+	/* the carrier RPC */
+	struct crt_rpc_priv	*cb_parent;
+	/* the coalesced requests, in packing order */
+	struct crt_rpc_priv	*cb_subs[CRT_BATCH_MAX_NUM];
+	uint32_t		 cb_num;
+	/* number of requests replied or failed (server) */
+	uint32_t		 cb_replied;
+	/* number of replies packed in cb_buf (server) */
+	uint32_t		 cb_reply_num;
+	/* smallest non-zero timeout of the requests (client) */
+	uint32_t		 cb_timeout_ms;
+	/* linked in crt_context::cc_batch_list (client) */
+	uint32_t		 cb_open:1;
+	/* packed requests (client) or replies (server) */
+	void			*cb_buf;
+	crt_size_t		 cb_buf_size;
+	crt_size_t		 cb_buf_len;
+	/* serialize the reply packing (server) */
+	pthread_mutex_t		 cb_mutex;
+};
+
+/* default and max number of requests handed to a vectored handler */
+#define CRT_RPC_VEC_MAX_DEFAULT		(64)
+#define CRT_RPC_VEC_MAX			(1024)
+
+/*
+ * Requests of one opcode gathered for a vectored handler call, see
+ * crt_rpc_srv_register_vec.
+ */
+struct crt_rpc_vec {
+	/* link to crt_context::cc_vec_list */
+	crt_list_t		 crv_link;
+	struct crt_opc_info	*crv_opc_info;
+	/* arrival time (us) of the first request */
+	uint64_t		 crv_first_us;
+	uint32_t		 crv_num;
+	uint32_t		 crv_max;
+	crt_rpc_t		*crv_reqs[0];
 };
 
 struct crt_rpc_priv {
@@ -150,12 +239,20 @@ struct crt_rpc_priv {
 	crt_list_t		crp_epi_link;
 	/* tmp_link used in crt_context_req_untrack */
 	crt_list_t		crp_tmp_link;
-	/* link to parent RPC crp_opc_info->co_child_rpcs/co_replied_rpcs */
+	/* link to parent RPC crp_corpc_info->co_replied_rpcs */
 	crt_list_t		crp_parent_link;
-	/* binheap node for timeout management, in crt_context::cc_bh_timeout */
-	struct crt_binheap_node	crp_timeout_bp_node;
-	/* time stamp to be timeout, the key of timeout binheap */
+	/* next in parent RPC crp_corpc_info->co_reply_head */
+	struct crt_rpc_priv	*crp_reply_next;
+	/* timer node, in crt_context::cc_timeout_wheel */
+	struct crt_twheel_node	crp_timeout_node;
+	/* time stamp (us) to be timeout */
 	uint64_t		crp_timeout_ts;
+	/* timeout in millisecond, zero for CRT_DEFAULT_TIMEOUT_MS */
+	uint32_t		crp_timeout_ms;
+	/* set while an HG_Forward on crp_hg_hdl has not called back yet */
+	uint32_t		crp_fwd_inflight;
+	/* time stamp (us) entering epi inflight queue, for RTT sampling */
+	uint64_t		crp_send_ts;
 	crt_cb_t		crp_complete_cb;
 	void			*crp_arg; /* argument for crp_complete_cb */
 	struct crt_ep_inflight	*crp_epi; /* point back to inflight ep */
@@ -164,6 +261,8 @@ struct crt_rpc_priv {
 	crt_rpc_state_t		crp_state; /* RPC state */
 	hg_handle_t		crp_hg_hdl;
 	na_addr_t		crp_na_addr;
+	/* waiting for the target address, queued by crp_epi_link */
+	struct crt_addr_pend	*crp_addr_pend;
 	/*
 	 * RPC request flag, see enum crt_rpc_flags/crt_rpc_flags_internal,
 	 * match with crp_req_hdr.cch_flags.
@@ -176,16 +275,38 @@ struct crt_rpc_priv {
 				crp_coll:1,
 				/* flag of forwarded rpc for corpc */
 				crp_forward:1,
-				/* flag of in timeout binheap */
-				crp_in_binheap:1;
+				/* crp_na_addr is a reference to release */
+				crp_na_addr_ref:1,
+				/* holds a reference on crp_hg_hdl to release */
+				crp_hdl_ref:1;
 	uint32_t		crp_refcount;
 	struct crt_opc_info	*crp_opc_info;
 	/* corpc info, only valid when (crp_coll == 1) */
 	struct crt_corpc_info	*crp_corpc_info;
+	/*
+	 * for a request with CRT_RPC_FLAG_BATCHED, the batch carrying it and
+	 * its index there. For the server-side carrier, its own batch.
+	 */
+	struct crt_batch	*crp_batch;
+	uint32_t		crp_batch_idx;
+	/* reply of the coalesced request packed (or failed) */
+	uint32_t		crp_batch_done:1;
+	/*
+	 * client-side carrier of a coalesced request, held while the output
+	 * decoded with CRT_RPC_FEAT_IOV_INPLACE refers to its reply buffer
+	 */
+	struct crt_rpc_priv	*crp_batch_carrier;
 	pthread_spinlock_t	crp_lock;
 	struct crt_common_hdr	crp_reply_hdr; /* common header for reply */
 	struct crt_common_hdr	crp_req_hdr; /* common header for request */
 	struct crt_corpc_hdr	crp_coreq_hdr; /* collective request header */
+	/*
+	 * encoded input of a corpc, the received one in the mercury input buffer
+	 * or crt_corpc_info::co_body. The children copy it as is rather than
+	 * encoding the input again each, only the headers are encoded per child.
+	 */
+	const void		*crp_co_body;
+	crt_size_t		 crp_co_body_len;
 };
 
 /* CRT internal opcode definitions, must be 0xFFFFxxxx.*/
@@ -193,10 +314,13 @@ enum {
 	CRT_OPC_INTERNAL_BASE	= 0xFFFF0000,
 	CRT_OPC_GRP_CREATE	= CRT_OPC_INTERNAL_BASE + 0x1,
 	CRT_OPC_GRP_DESTROY	= CRT_OPC_INTERNAL_BASE + 0x2,
+	CRT_OPC_RPC_BATCH	= CRT_OPC_INTERNAL_BASE + 0x3,
+	CRT_OPC_CORPC_BULK_WAIT	= CRT_OPC_INTERNAL_BASE + 0x4,
 
 	CRT_OPC_GRP_ATTACH	= CRT_OPC_INTERNAL_BASE + 0x100,
 	CRT_OPC_GRP_DETACH	= CRT_OPC_INTERNAL_BASE + 0x101,
 	CRT_OPC_URI_LOOKUP	= CRT_OPC_INTERNAL_BASE + 0x102,
+	CRT_OPC_URI_TABLE	= CRT_OPC_INTERNAL_BASE + 0x103,
 };
 
 /* CRT internal RPC definitions */
@@ -205,6 +329,7 @@ struct crt_grp_create_in {
 	crt_group_id_t		 gc_grp_id;
 	/* internal subgrp id */
 	uint64_t		 gc_int_grpid;
+	/* NULL, the members are piggybacked by crt_corpc_hdr::coh_inline_ranks */
 	crt_rank_list_t		*gc_membs;
 	/* the rank initiated the group create */
 	crt_rank_t		 gc_initiate_rank;
@@ -244,6 +369,59 @@ struct crt_uri_lookup_out {
 	int			 ul_rc;
 };
 
+/* URI table replied inline up to this size, pushed through bulk beyond it */
+#define CRT_URI_TABLE_INLINE_MAX	(2048)
+
+struct crt_uri_table_in {
+	crt_group_id_t		 ut_grp_id;
+	/* ranks to lookup, NULL for all ranks of the group */
+	crt_rank_list_t		*ut_ranks;
+	/* requester's buffer to push a large table into, can be NULL */
+	crt_bulk_t		 ut_bulk;
+};
+
+struct crt_uri_table_out {
+	/* NUL-terminated URIs back to back in ut_ranks order, if inline */
+	crt_iov_t		 ut_table;
+	/* size of the table, pushed through ut_bulk if ut_table is empty */
+	uint64_t		 ut_size;
+	int			 ut_rc;
+};
+
+struct crt_corpc_bulk_wait_in {
+	/* the parent's crt_corpc_pipe, crt_corpc_hdr::coh_bulk_pipe */
+	uint64_t		 bw_pipe_id;
+	/* reply once this many bytes of the bulk landed on the parent */
+	uint64_t		 bw_want;
+};
+
+struct crt_corpc_bulk_wait_out {
+	/* bytes landed on the parent, from the start of the bulk */
+	uint64_t		 bw_ready;
+	int			 bw_rc;
+};
+
+/*
+ * NB: crt_proc_internal walks the fields by their sizes without padding, so
+ * the iov goes ahead of the 32-bit count.
+ */
+struct crt_rpc_batch_in {
+	/* common header and input of each request, back to back */
+	crt_iov_t		 cbi_body;
+	/* number of requests packed in cbi_body */
+	uint32_t		 cbi_num;
+};
+
+struct crt_rpc_batch_out {
+	/*
+	 * index, status and (if status is zero) common header and output of
+	 * each reply, back to back, in the order of replying.
+	 */
+	crt_iov_t		 cbo_body;
+	/* number of replies packed in cbo_body */
+	uint32_t		 cbo_num;
+};
+
 /* CRT internal RPC format definitions */
 struct crt_internal_rpc {
 	/* Name of the RPC */
@@ -254,6 +432,8 @@ struct crt_internal_rpc {
 	int			 ir_ver;
 	/* Operation flags, TBD */
 	int			 ir_flags;
+	/* opcode features, \see enum crt_rpc_feats */
+	uint32_t		 ir_feats;
 	/* RPC request format */
 	struct crt_req_format	*ir_req_fmt;
 	/* RPC handler */
@@ -273,8 +453,21 @@ crt_common_hdr_init(struct crt_common_hdr *hdr, crt_opcode_t opc)
 	C_ASSERT(crt_group_rank(0, &hdr->cch_rank) == 0);
 }
 
+/* absolute time stamp (us) at which the RPC times out if sent now */
+static inline uint64_t
+crt_req_deadline(struct crt_rpc_priv *rpc_priv)
+{
+	uint32_t	timeout_ms = CRT_DEFAULT_TIMEOUT_MS;
+
+	if (rpc_priv != NULL && rpc_priv->crp_timeout_ms != 0)
+		timeout_ms = rpc_priv->crp_timeout_ms;
+
+	return crt_timeus_secdiff(0) + (uint64_t)timeout_ms * 1000;
+}
+
 /* crt_rpc.c */
-int crt_rpc_priv_alloc(crt_opcode_t opc, struct crt_rpc_priv **priv_allocated);
+int crt_rpc_priv_alloc(crt_context_t crt_ctx, crt_opcode_t opc,
+		       struct crt_rpc_priv **priv_allocated);
 void crt_rpc_priv_free(struct crt_rpc_priv *rpc_priv);
 int crt_rpc_priv_init(struct crt_rpc_priv *rpc_priv, crt_context_t crt_ctx,
 		       crt_opcode_t opc, bool srv_flag, bool forward);
@@ -284,10 +477,30 @@ int crt_req_create_internal(crt_context_t crt_ctx, crt_endpoint_t tgt_ep,
 int crt_internal_rpc_register(void);
 int crt_req_send_sync(crt_rpc_t *rpc, uint64_t timeout);
 int crt_rpc_common_hdlr(struct crt_rpc_priv *rpc_priv);
+void crt_req_addr_resolved(struct crt_rpc_priv *rpc_priv, int rc);
+int crt_rpc_vec_dispatch(struct crt_context *ctx, bool force);
+int64_t crt_rpc_vec_timeout(struct crt_context *ctx, int64_t timeout);
+
+/* crt_batch.c */
+int crt_batch_req_add(struct crt_rpc_priv *rpc_priv);
+int crt_batch_req_abort(struct crt_rpc_priv *rpc_priv);
+void crt_batch_req_fini(struct crt_rpc_priv *rpc_priv);
+void crt_batch_flush(struct crt_context *ctx);
+void crt_batch_free(struct crt_batch *batch);
+int crt_batch_reply_send(struct crt_rpc_priv *rpc_priv);
+void crt_batch_reply_skip(struct crt_rpc_priv *rpc_priv, int status);
+int crt_hdlr_rpc_batch(crt_rpc_t *rpc_req);
 
 /* crt_corpc.c */
 int crt_corpc_req_hdlr(crt_rpc_t *req);
 int crt_corpc_reply_hdlr(const struct crt_cb_info *cb_info);
 int crt_corpc_common_hdlr(struct crt_rpc_priv *rpc_priv);
+int crt_hdlr_corpc_bulk_wait(crt_rpc_t *rpc_req);
+void crt_corpc_pipe_unregister(struct crt_corpc_info *co_info);
+
+/* crt_reduce.c */
+int crt_corpc_red_check(struct crt_corpc_ops *co_ops, crt_size_t output_size);
+void crt_corpc_reduce(const struct crt_corpc_red *reds, int red_nr,
+		      crt_rpc_t **sources, int nr, crt_rpc_t *result);
 
 #endif /* __CRT_RPC_H__ */
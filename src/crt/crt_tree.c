@@ -61,7 +61,10 @@ crt_get_filtered_grp_rank_list(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 		*grp_self = self;
 		*allocated = false;
 	} else {
-		/* grp_priv->gp_membs/exclude_ranks already sorted and unique */
+		/*
+		 * grp_priv->gp_membs/exclude_ranks already sorted and unique,
+		 * so is the filtered list.
+		 */
 		rc = crt_rank_list_dup(&grp_rank_list, grp_priv->gp_membs,
 				       true /* input */);
 		if (rc != 0) {
@@ -82,22 +85,22 @@ crt_get_filtered_grp_rank_list(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 
 		*allocated = true;
 		*grp_size = grp_rank_list->rl_nr.num;
-		rc = crt_idx_in_rank_list(grp_rank_list,
-					  grp_priv->gp_membs->rl_ranks[root],
-					  grp_root, true /* input */);
+		rc = crt_idx_in_sorted_rank_list(grp_rank_list,
+					grp_priv->gp_membs->rl_ranks[root],
+					grp_root, true /* input */);
 		if (rc != 0) {
-			C_ERROR("crt_idx_in_rank_list (group %s, rank %d), "
-				"failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
-				root, rc);
+			C_ERROR("crt_idx_in_sorted_rank_list (group %s, "
+				"rank %d), failed, rc: %d.\n",
+				grp_priv->gp_pub.cg_grpid, root, rc);
 			C_GOTO(out, rc);
 		}
-		rc = crt_idx_in_rank_list(grp_rank_list,
-					  grp_priv->gp_membs->rl_ranks[self],
-					  grp_self, true /* input */);
+		rc = crt_idx_in_sorted_rank_list(grp_rank_list,
+					grp_priv->gp_membs->rl_ranks[self],
+					grp_self, true /* input */);
 		if (rc != 0) {
-			C_ERROR("crt_idx_in_rank_list (group %s, rank %d), "
-				"failed, rc: %d.\n", grp_priv->gp_pub.cg_grpid,
-				self, rc);
+			C_ERROR("crt_idx_in_sorted_rank_list (group %s, "
+				"rank %d), failed, rc: %d.\n",
+				grp_priv->gp_pub.cg_grpid, self, rc);
 			C_GOTO(out, rc);
 		}
 	}
@@ -195,6 +198,7 @@ crt_tree_get_children(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 	for (i = 0; i < nchildren; i++)
 		result_rank_list->rl_ranks[i] =
 			grp_rank_list->rl_ranks[tree_children[i]];
+	C_FREE(tree_children, nchildren * sizeof(uint32_t));
 
 	*children_rank_list = result_rank_list;
 
@@ -264,6 +268,203 @@ out:
 	return rc;
 }
 
+static inline uint64_t
+crt_tree_excl_hash(crt_rank_list_t *exclude_ranks)
+{
+	if (exclude_ranks == NULL || exclude_ranks->rl_nr.num == 0)
+		return 0;
+
+	return crt_hash_murmur64((unsigned char *)exclude_ranks->rl_ranks,
+				 exclude_ranks->rl_nr.num * sizeof(crt_rank_t),
+				 5381);
+}
+
+static inline bool
+crt_tree_excl_identical(crt_rank_list_t *excl1, crt_rank_list_t *excl2)
+{
+	uint32_t	num1, num2;
+
+	num1 = (excl1 == NULL) ? 0 : excl1->rl_nr.num;
+	num2 = (excl2 == NULL) ? 0 : excl2->rl_nr.num;
+	if (num1 != num2)
+		return false;
+
+	return num1 == 0 || memcmp(excl1->rl_ranks, excl2->rl_ranks,
+				   num1 * sizeof(crt_rank_t)) == 0;
+}
+
+static void
+crt_tree_children_free(struct crt_tree_children *tc)
+{
+	crt_rank_list_free(tc->tc_excluded);
+	crt_rank_list_free(tc->tc_children);
+	C_FREE_PTR(tc);
+}
+
+/* find the cached children and take a reference, with gp_tree_cache_mutex */
+static struct crt_tree_children *
+crt_tree_children_find_locked(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
+			      crt_rank_list_t *exclude_ranks, uint64_t hash,
+			      int tree_topo, crt_rank_t root, crt_rank_t self)
+{
+	struct crt_tree_children	*tc;
+
+	crt_list_for_each_entry(tc, &grp_priv->gp_tree_cache, tc_link) {
+		if (tc->tc_excl_hash != hash || tc->tc_grp_ver != grp_ver ||
+		    tc->tc_tree_topo != tree_topo || tc->tc_root != root ||
+		    tc->tc_self != self ||
+		    !crt_tree_excl_identical(tc->tc_excluded, exclude_ranks))
+			continue;
+		tc->tc_ref++;
+		if (tc != crt_list_entry(grp_priv->gp_tree_cache.next,
+					 struct crt_tree_children, tc_link))
+			crt_list_move(&tc->tc_link, &grp_priv->gp_tree_cache);
+		return tc;
+	}
+
+	return NULL;
+}
+
+/*
+ * query the children rank list like crt_tree_get_children, memoized per group
+ * as the same collective shape is forwarded over and over. The returned entry
+ * must be released by crt_tree_children_decref, its tc_children is NULL for a
+ * leaf.
+ *
+ * The excluded ranks are expected sorted and unique (crt_corpc_info_init),
+ * two equal sets in a different order only take two entries.
+ */
+int
+crt_tree_children_lookup(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
+			 crt_rank_list_t *exclude_ranks, int tree_topo,
+			 crt_rank_t root, crt_rank_t self,
+			 struct crt_tree_children **children)
+{
+	struct crt_tree_children	*tc = NULL, *found, *lru;
+	uint64_t			 hash;
+	int				 rc = 0;
+
+	C_ASSERT(grp_priv != NULL && children != NULL);
+
+	hash = crt_tree_excl_hash(exclude_ranks);
+	pthread_mutex_lock(&grp_priv->gp_tree_cache_mutex);
+	found = crt_tree_children_find_locked(grp_priv, grp_ver, exclude_ranks,
+					      hash, tree_topo, root, self);
+	pthread_mutex_unlock(&grp_priv->gp_tree_cache_mutex);
+	if (found != NULL)
+		C_GOTO(out, rc);
+
+	C_ALLOC_PTR(tc);
+	if (tc == NULL)
+		C_GOTO(out, rc = -CER_NOMEM);
+	CRT_INIT_LIST_HEAD(&tc->tc_link);
+	tc->tc_excl_hash = hash;
+	tc->tc_grp_ver = grp_ver;
+	tc->tc_tree_topo = tree_topo;
+	tc->tc_root = root;
+	tc->tc_self = self;
+	rc = crt_rank_list_dup(&tc->tc_excluded, exclude_ranks,
+			       true /* input */);
+	if (rc != 0) {
+		C_FREE_PTR(tc);
+		C_GOTO(out, rc);
+	}
+	rc = crt_tree_get_children(grp_priv, grp_ver, exclude_ranks, tree_topo,
+				   root, self, &tc->tc_children);
+	if (rc != 0) {
+		crt_tree_children_free(tc);
+		C_GOTO(out, rc);
+	}
+
+	pthread_mutex_lock(&grp_priv->gp_tree_cache_mutex);
+	/* someone else may have computed the same shape meanwhile */
+	found = crt_tree_children_find_locked(grp_priv, grp_ver, exclude_ranks,
+					      hash, tree_topo, root, self);
+	if (found == NULL) {
+		/* one reference for the cache and one for the caller */
+		tc->tc_ref = 2;
+		crt_list_add(&tc->tc_link, &grp_priv->gp_tree_cache);
+		grp_priv->gp_tree_cache_num++;
+		found = tc;
+		tc = NULL;
+		if (grp_priv->gp_tree_cache_num > CRT_TREE_CACHE_MAX) {
+			lru = crt_list_entry(grp_priv->gp_tree_cache.prev,
+					     struct crt_tree_children, tc_link);
+			crt_list_del_init(&lru->tc_link);
+			grp_priv->gp_tree_cache_num--;
+			if (--lru->tc_ref == 0)
+				tc = lru;
+		}
+	}
+	pthread_mutex_unlock(&grp_priv->gp_tree_cache_mutex);
+	if (tc != NULL)
+		crt_tree_children_free(tc);
+
+out:
+	if (rc == 0)
+		*children = found;
+	return rc;
+}
+
+void
+crt_tree_children_decref(struct crt_grp_priv *grp_priv,
+			 struct crt_tree_children *children)
+{
+	bool	free_it;
+
+	if (children == NULL)
+		return;
+
+	pthread_mutex_lock(&grp_priv->gp_tree_cache_mutex);
+	C_ASSERT(children->tc_ref > 0);
+	free_it = (--children->tc_ref == 0);
+	pthread_mutex_unlock(&grp_priv->gp_tree_cache_mutex);
+
+	if (free_it)
+		crt_tree_children_free(children);
+}
+
+void
+crt_tree_cache_init(struct crt_grp_priv *grp_priv)
+{
+	CRT_INIT_LIST_HEAD(&grp_priv->gp_tree_cache);
+	grp_priv->gp_tree_cache_num = 0;
+	pthread_mutex_init(&grp_priv->gp_tree_cache_mutex, NULL);
+}
+
+/*
+ * drop all memoized children lists of the group, must be called whenever
+ * gp_membs changes without bumping the group version. The entries still in
+ * use are freed by their last crt_tree_children_decref.
+ */
+void
+crt_tree_cache_invalidate(struct crt_grp_priv *grp_priv)
+{
+	struct crt_tree_children	*tc, *next;
+	crt_list_t			 free_list;
+
+	CRT_INIT_LIST_HEAD(&free_list);
+	pthread_mutex_lock(&grp_priv->gp_tree_cache_mutex);
+	crt_list_for_each_entry_safe(tc, next, &grp_priv->gp_tree_cache,
+				     tc_link) {
+		crt_list_del_init(&tc->tc_link);
+		if (--tc->tc_ref == 0)
+			crt_list_add(&tc->tc_link, &free_list);
+	}
+	grp_priv->gp_tree_cache_num = 0;
+	pthread_mutex_unlock(&grp_priv->gp_tree_cache_mutex);
+
+	crt_list_for_each_entry_safe(tc, next, &free_list, tc_link)
+		crt_tree_children_free(tc);
+}
+
+void
+crt_tree_cache_fini(struct crt_grp_priv *grp_priv)
+{
+	crt_tree_cache_invalidate(grp_priv);
+	pthread_mutex_destroy(&grp_priv->gp_tree_cache_mutex);
+}
+
 struct crt_topo_ops *crt_tops[] = {
 	NULL,			/* CRT_TREE_INVALID */
 	&crt_flat_ops,		/* CRT_TREE_FLAT */
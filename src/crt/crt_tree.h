@@ -58,6 +58,39 @@ int crt_tree_get_parent(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
 			crt_rank_t grp_root, crt_rank_t grp_self,
 			crt_rank_t *parent_rank);
 
+/* max number of memoized children lists per group */
+#define CRT_TREE_CACHE_MAX	(32)
+
+/*
+ * Memoized children of one tree shape in a group, keyed by the group version,
+ * tree topo, root, self and the excluded ranks. It is immutable once cached,
+ * and freed when the last reference is dropped.
+ */
+struct crt_tree_children {
+	/* link to crt_grp_priv::gp_tree_cache, in MRU order */
+	crt_list_t		 tc_link;
+	uint64_t		 tc_excl_hash;
+	crt_rank_list_t		*tc_excluded;
+	uint32_t		 tc_grp_ver;
+	int			 tc_tree_topo;
+	crt_rank_t		 tc_root;
+	crt_rank_t		 tc_self;
+	/* protected by crt_grp_priv::gp_tree_cache_mutex */
+	uint32_t		 tc_ref;
+	/* children rank list (primary rank), NULL for leaf */
+	crt_rank_list_t		*tc_children;
+};
+
+int crt_tree_children_lookup(struct crt_grp_priv *grp_priv, uint32_t grp_ver,
+			     crt_rank_list_t *exclude_ranks, int tree_topo,
+			     crt_rank_t grp_root, crt_rank_t grp_self,
+			     struct crt_tree_children **children);
+void crt_tree_children_decref(struct crt_grp_priv *grp_priv,
+			      struct crt_tree_children *children);
+void crt_tree_cache_init(struct crt_grp_priv *grp_priv);
+void crt_tree_cache_invalidate(struct crt_grp_priv *grp_priv);
+void crt_tree_cache_fini(struct crt_grp_priv *grp_priv);
+
 /*
  * all specific tree type's calculations are based on group rank number.
  * some different types of rank:
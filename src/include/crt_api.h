@@ -43,6 +43,7 @@
 #define __CRT_API_H__
 
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
 #include <uuid/uuid.h>
@@ -134,6 +135,48 @@ crt_context_idx(crt_context_t crt_ctx, int *ctx_idx);
 int
 crt_context_num(int *ctx_num);
 
+/**
+ * Query the statistics of the context's RPC object pool, which recycles the
+ * RPC descriptors and input/output buffers.
+ *
+ * \param crt_ctx [IN]          CRT transport context
+ * \param stats [OUT]           pointer to the returned pool statistics
+ *
+ * \return                      zero on success, negative value if error
+ */
+int
+crt_context_pool_query(crt_context_t crt_ctx, struct crt_pool_stats *stats);
+
+/**
+ * Query the flow-control state of an endpoint in a context. The number of
+ * inflight RPCs to each endpoint is limited by a window that adapts to the
+ * measured reply latency and timeouts.
+ *
+ * \param crt_ctx [IN]          CRT transport context
+ * \param ep [IN]               endpoint address
+ * \param stats [OUT]           pointer to the returned flow-control state
+ *
+ * \return                      zero on success, negative value if error,
+ *                              -CER_NONEXIST if no RPC was ever sent to
+ *                              the endpoint through the context
+ */
+int
+crt_ep_flow_query(crt_context_t crt_ctx, crt_endpoint_t *ep,
+		  struct crt_ep_flow_stats *stats);
+
+/**
+ * Set how long crt_progress() on the context busy polls for the network
+ * before blocking, trading CPU for lower latency. The default is zero (block
+ * immediately), or the value of ENV CRT_PROGRESS_SPIN_US at crt_init.
+ *
+ * \param crt_ctx [IN]          CRT transport context
+ * \param spin_us [IN]          busy polling time in micro-second
+ *
+ * \return                      zero on success, negative value if error
+ */
+int
+crt_context_set_progress_spin(crt_context_t crt_ctx, uint32_t spin_us);
+
 /**
  * Finalize CRT transport layer.
  *
@@ -154,7 +197,11 @@ crt_finalize(void);
  *				if \a timeout > 0 when there is no operation to
  *				progress. Can return when one or more operation
  *				progressed.
- *				zero means no waiting and -1 waits indefinitely.
+ *				zero means polling once without waiting and
+ *				-1 waits indefinitely. The waiting busy polls
+ *				for the context's spinning time first, \see
+ *				crt_context_set_progress_spin, timeouts below
+ *				one milli-second are always busy polled.
  * \param cond_cb	[IN]	optional progress condition callback.
  *				CRT internally calls this function, when it
  *				returns non-zero then stops the progressing or
@@ -245,6 +292,60 @@ crt_req_decref(crt_rpc_t *req);
 int
 crt_req_send(crt_rpc_t *req, crt_cb_t complete_cb, void *arg);
 
+/**
+ * Set the timeout of a RPC request, by default the request times out after
+ * 60 seconds. The timer starts when the request is put on the wire, i.e. the
+ * time queued for the endpoint's flow-control window is not counted.
+ *
+ * \param req [IN]              pointer to RPC request, should be called
+ *                              before crt_req_send
+ * \param timeout_sec [IN]      timeout in second, zero for the default
+ *
+ * \return                      zero on success, negative value if error
+ */
+int
+crt_req_set_timeout(crt_rpc_t *req, uint32_t timeout_sec);
+
+/**
+ * Set the timeout of a RPC request in milliseconds, \see crt_req_set_timeout.
+ * The effective resolution is that of the progress loop, i.e. a request may
+ * complete with -CER_TIMEDOUT up to one crt_progress pass late.
+ *
+ * \param req [IN]              pointer to RPC request, should be called
+ *                              before crt_req_send
+ * \param timeout_ms [IN]       timeout in millisecond, zero for the default
+ *
+ * \return                      zero on success, negative value if error
+ */
+int
+crt_req_set_timeout_ms(crt_rpc_t *req, uint32_t timeout_ms);
+
+/**
+ * Reset a completed RPC request to send it again, saving the address lookup
+ * and the HG handle creation of crt_req_create. The target endpoint, the
+ * opcode, the timeout and the input buffer are kept, only the input is
+ * encoded again by crt_req_send.
+ *
+ * The caller should hold a reference to keep \a req over its completion
+ * (\see crt_req_addref), and call this after the completion callback
+ * returned. Like crt_req_create, the reset request holds another reference
+ * which is released by crt_req_send.
+ *
+ * A request completed with -CER_TIMEDOUT can be reset as well, but its
+ * forward is only canceled at the timeout, the reset returns -CER_BUSY until
+ * a later crt_progress ran the cancellation.
+ *
+ * \param req [IN]              pointer to the completed RPC request
+ *
+ * \return                      zero on success, negative value if error,
+ *                              -CER_BUSY if \a req is not completed yet or
+ *                              its timed out forward is not canceled yet,
+ *                              -CER_NO_PERM for a collective, coalesced or
+ *                              server-side request.
+ */
+int
+crt_req_reset(crt_rpc_t *req);
+
 /**
  * Send a RPC reply.
  *
@@ -300,7 +401,9 @@ int
 crt_req_abort(crt_rpc_t *req);
 
 /**
- * Abort all in-flight RPC requests targeting to an endpoint.
+ * Abort all in-flight RPC requests targeting to an endpoint, in all contexts.
+ * The endpoint is matched by its group, rank and tag, the requests to other
+ * tags of the same rank are not affected.
  *
  * \param ep [IN]		endpoint address
  *
@@ -341,6 +444,54 @@ int
 crt_rpc_srv_register(crt_opcode_t opc, struct crt_req_format *drf,
 		crt_rpc_cb_t rpc_handler);
 
+/**
+ * Dynamically register a RPC at server-side with a vectored handler.
+ *
+ * Requests of the opcode received by a context are gathered and handed to
+ * \a rpc_vec_handler together, so that it can serve them with one backend
+ * operation. A vector is dispatched when it holds \a max_batch requests, or
+ * by crt_progress once its first request waited \a max_wait_us.
+ *
+ * \param opc [IN]              unique opcode for the RPC
+ * \param drf [IN]		pointer to the request format, which
+ *                              describe the request format and provide
+ *                              callback to pack/unpack each items in the
+ *                              request.
+ * \param rpc_vec_handler [IN]  pointer to the vectored RPC handler, which
+ *                              should reply to every request passed in.
+ *                              Will return -CER_INVAL if pass in NULL.
+ * \param max_batch [IN]        max number of requests per handler call, zero
+ *                              for the default (64), at most 1024.
+ * \param max_wait_us [IN]      max time in micro-seconds a request waits for
+ *                              others, zero to dispatch the requests gathered
+ *                              by each crt_progress call.
+ *
+ * \return                      zero on success, negative value if error
+ */
+int
+crt_rpc_srv_register_vec(crt_opcode_t opc, struct crt_req_format *drf,
+			 crt_rpc_vec_cb_t rpc_vec_handler, uint32_t max_batch,
+			 uint32_t max_wait_us);
+
+/**
+ * Dynamically register a RPC with optional features.
+ *
+ * \param opc [IN]              unique opcode for the RPC
+ * \param drf [IN]		pointer to the request format, which
+ *                              describe the request format and provide
+ *                              callback to pack/unpack each items in the
+ *                              request.
+ * \param rpc_handler [IN]      pointer to RPC handler, NULL at client-side.
+ * \param feats [IN]            bit mask of the RPC features, \see enum
+ *                              crt_rpc_feats. Client and server should
+ *                              register the opcode with the same features.
+ *
+ * \return                      zero on success, negative value if error
+ */
+int
+crt_rpc_register_feats(crt_opcode_t opc, struct crt_req_format *drf,
+		       crt_rpc_cb_t rpc_handler, uint32_t feats);
+
 /******************************************************************************
  * CRT bulk APIs.
  ******************************************************************************/
@@ -482,6 +633,56 @@ crt_tree_topo(enum crt_tree_type tree_type, uint32_t branch_ratio)
 	       (branch_ratio & ((1U << CRT_TREE_TYPE_SHIFT) - 1));
 };
 
+/* Operators of the built-in reductions, see struct crt_corpc_red */
+enum crt_red_op {
+	CRT_RED_INVALID		= 0,
+	CRT_RED_OP_MIN		= 1,
+	CRT_RED_SUM		= 1,
+	CRT_RED_MIN		= 2,
+	CRT_RED_MAX		= 3,
+	/* bitwise or/and, integer types only */
+	CRT_RED_BOR		= 4,
+	CRT_RED_BAND		= 5,
+	CRT_RED_OP_MAX		= 5,
+};
+
+/* Element types of the built-in reductions */
+enum crt_red_type {
+	CRT_RED_TYPE_INVALID	= 0,
+	CRT_RED_TYPE_MIN	= 1,
+	CRT_RED_INT32		= 1,
+	CRT_RED_UINT32		= 2,
+	CRT_RED_INT64		= 3,
+	CRT_RED_UINT64		= 4,
+	CRT_RED_DOUBLE		= 5,
+	CRT_RED_TYPE_MAX	= 5,
+};
+
+/*
+ * A built-in reduction of collective RPC replies, combines cr_count elements
+ * of type cr_type at cr_offset of the sources' output struct into the result
+ * with cr_op, using vectorized loops. On x86_64 the AVX2 version is picked
+ * at load time when the CPU has it, even without -mavx2. Describe it with
+ * CRT_CORPC_RED, for example for "uint64_t co_bytes[16];" in struct my_out:
+ *	CRT_CORPC_RED(CRT_RED_SUM, CRT_RED_UINT64, struct my_out, co_bytes, 16)
+ */
+struct crt_corpc_red {
+	enum crt_red_op		cr_op;
+	enum crt_red_type	cr_type;
+	/* offset of the first element in the output struct */
+	uint32_t		cr_offset;
+	/* number of elements */
+	uint32_t		cr_count;
+};
+
+#define CRT_CORPC_RED(op, type, out_struct, field, count)		\
+	{								\
+		.cr_op		= (op),					\
+		.cr_type	= (type),				\
+		.cr_offset	= offsetof(out_struct, field),		\
+		.cr_count	= (count),				\
+	}
+
 struct crt_corpc_ops {
 	/*
 	 * collective RPC reply aggregating callback.
@@ -496,6 +697,31 @@ struct crt_corpc_ops {
 	 * \return			zero on success, negative value if error
 	 */
 	int (*co_aggregate)(crt_rpc_t *source, crt_rpc_t *result, void *priv);
+	/*
+	 * optional, aggregates several replies at once. When provided it is
+	 * used instead of co_aggregate, with the replies ready at the same
+	 * time passed in order of arrival. Never called concurrently for the
+	 * same result.
+	 *
+	 * \param sources [IN]		the rpc structures of aggregating
+	 *				sources
+	 * \param nr [IN]		number of sources
+	 * \param result[IN]		the rpc structure of aggregating result
+	 * \param priv [IN]		same as for co_aggregate
+	 *
+	 * \return			zero on success, negative value if error
+	 */
+	int (*co_aggregate_batch)(crt_rpc_t **sources, int nr,
+				  crt_rpc_t *result, void *priv);
+	/*
+	 * optional built-in reductions of the replies, applied before
+	 * co_aggregate/co_aggregate_batch. Either of co_aggregate,
+	 * co_aggregate_batch or co_reds is needed. The elements are to be
+	 * fixed size fields of the output struct, checked at
+	 * crt_corpc_register.
+	 */
+	struct crt_corpc_red	*co_reds;
+	int			 co_red_nr;
 };
 
 /*
@@ -547,6 +773,47 @@ crt_group_create(crt_group_id_t grp_id, crt_rank_list_t *member_ranks,
 		 bool populate_now, crt_grp_create_cb_t grp_create_cb,
 		 void *priv);
 
+/*
+ * Group connect completion callback
+ *
+ * \param grp [IN]		the group passed to crt_group_connect.
+ * \param arg [IN]		the argument passed to crt_group_connect.
+ * \param status [IN]		zero if all endpoints are connected, otherwise
+ *				the first error.
+ *
+ * \return			zero on success, negative value if error
+ */
+typedef int (*crt_grp_connect_cb_t)(crt_group_t *grp, void *arg, int status);
+
+/*
+ * Resolve and connect the addresses of many endpoints of a primary group
+ * ahead of the first RPCs to them, so those RPCs skip the URI lookup and
+ * connection setup. The (rank, tag) pairs are connected concurrently with at
+ * most CRT_GROUP_CONNECT_WINDOW (64) lookups in flight. Requests sent
+ * meanwhile to a pair being connected wait for the same lookup.
+ *
+ * The lookups complete inside crt_progress of \a crt_ctx, and only populate
+ * the address cache used by that context.
+ *
+ * \param crt_ctx [IN]		CRT context to connect with.
+ * \param grp [IN]		primary group, NULL for the default service
+ *				primary group.
+ * \param rank_list [IN]	ranks to connect, NULL for all ranks.
+ * \param tags [IN]		tags (context indexes) to connect on each rank,
+ *				NULL for tag 0 only.
+ * \param tag_num [IN]		number of entries in \a tags.
+ * \param cb [IN]		completion callback, can be NULL.
+ * \param arg [IN]		argument passed to \a cb.
+ *
+ * \return			zero on success (\a cb is called exactly
+ *				once), negative value if error (\a cb is not
+ *				called).
+ */
+int
+crt_group_connect(crt_context_t crt_ctx, crt_group_t *grp,
+		  crt_rank_list_t *rank_list, uint32_t *tags, uint32_t tag_num,
+		  crt_grp_connect_cb_t cb, void *arg);
+
 /*
  * Lookup the group handle of one group ID (sub-group or primary group).
  *
@@ -663,7 +930,8 @@ crt_corpc_req_create(crt_context_t crt_ctx, crt_group_t *grp,
  *    aggregation needed.
  * 2) Can pass in a NULL drf or rpc_handler if it was registered already, this
  *    routine only overwrite if they are non-NULL.
- * 3) A NULL co_ops will be treated as invalid argument.
+ * 3) A NULL co_ops, or co_ops without any aggregate callback or valid built-in
+ *    reduction (crt_corpc_ops::co_reds), will be treated as invalid argument.
  *
  * \return			zero on success, negative value if error
  */
@@ -127,9 +127,37 @@ typedef struct {
 /* CaRT context handle */
 typedef void *crt_context_t;
 
+/* statistics of the per-context RPC object pool, /see crt_context_pool_query */
+struct crt_pool_stats {
+	/* number of allocations served from the cached free objects */
+	uint64_t	cps_hit;
+	/* number of allocations that went to the heap */
+	uint64_t	cps_miss;
+	/* number of free objects currently cached */
+	uint64_t	cps_cached;
+};
+
+/* flow-control state of an endpoint in a context, /see crt_ep_flow_query */
+struct crt_ep_flow_stats {
+	/* current number of inflight RPCs allowed */
+	uint64_t	cefs_window;
+	/* number of inflight RPCs */
+	uint64_t	cefs_inflight;
+	/* number of RPCs queued waiting for window */
+	uint64_t	cefs_wait_num;
+	/* smoothed and minimal reply latency in us, 0 if no sample yet */
+	uint64_t	cefs_srtt_us;
+	uint64_t	cefs_min_rtt_us;
+};
+
 /* Physical address string, e.g., "bmi+tcp://localhost:3344". */
 typedef crt_string_t crt_phy_addr_t;
 #define CRT_PHY_ADDR_ENV	"CRT_PHY_ADDR_STR"
+/*
+ * Default number of micro-seconds crt_progress() busy polls before blocking,
+ * \see crt_context_set_progress_spin
+ */
+#define CRT_PROGRESS_SPIN_ENV	"CRT_PROGRESS_SPIN_US"
 
 /*
  * RPC is identified by opcode. All the opcodes with the highest 16 bits as 1
@@ -179,6 +207,31 @@ enum crt_rpc_flags {
 	/* All other bits, are reserved for internal usage. */
 };
 
+/* per-opcode RPC features, given at registration time */
+enum crt_rpc_feats {
+	/*
+	 * coalesce small requests to the same endpoint into one message.
+	 * Queued requests go out when enough are collected, or at the latest
+	 * with the next crt_progress() of the context. The server handler
+	 * sees them as individual requests.
+	 */
+	CRT_RPC_FEAT_COALESCE		= (1U << 0),
+	/*
+	 * one-way request that never gets a reply. It is neither tracked
+	 * nor timed out, its completion callback is called once the request
+	 * is sent. crt_reply_send is a no-op at the server. Cannot be
+	 * combined with CRT_RPC_FEAT_COALESCE.
+	 */
+	CRT_RPC_FEAT_ONEWAY		= (1U << 1),
+	/*
+	 * decode the crt_iov_t fields of the input and output in place: a
+	 * received iov refers to the RPC's buffer rather than to a copy of
+	 * its own, with iov_buf_len equal to iov_len. It is only valid as
+	 * long as the RPC and must neither be freed nor grown.
+	 */
+	CRT_RPC_FEAT_IOV_INPLACE	= (1U << 2),
+};
+
 struct crt_rpc;
 
 typedef int (*crt_req_callback_t)(struct crt_rpc *rpc);
@@ -332,6 +385,12 @@ struct crt_bulk_cb_info {
 /* server-side RPC handler */
 typedef int (*crt_rpc_cb_t)(crt_rpc_t *rpc);
 
+/**
+ * server-side vectored RPC handler, called with \a n requests of the same
+ * opcode. It should crt_reply_send each of them.
+ */
+typedef int (*crt_rpc_vec_cb_t)(crt_rpc_t **reqs, int n);
+
 /**
  * completion callback for crt_req_send
  *
@@ -81,6 +81,16 @@ static inline int _crt_gettime(struct timespec *ts)
 #define _crt_gettime(ts) clock_gettime(CLOCK_MONOTONIC, ts)
 #endif
 
+/*
+ * Cheaper monotonic timer of lower resolution (a few milli-seconds), for the
+ * hot paths only needing coarse time, same base as _crt_gettime.
+ */
+#ifdef CLOCK_MONOTONIC_COARSE
+#define _crt_gettime_coarse(ts) clock_gettime(CLOCK_MONOTONIC_COARSE, ts)
+#else
+#define _crt_gettime_coarse(ts) _crt_gettime(ts)
+#endif
+
 #include <crt_api.h>
 #include <crt_util/clog.h>
 
@@ -274,9 +284,37 @@ bool crt_rank_in_rank_list(crt_rank_list_t *rank_list, crt_rank_t rank,
 			   bool input);
 int crt_idx_in_rank_list(crt_rank_list_t *rank_list, crt_rank_t rank,
 			 uint32_t *idx, bool input);
+int crt_idx_in_sorted_rank_list(crt_rank_list_t *rank_list, crt_rank_t rank,
+				uint32_t *idx, bool input);
+
+/* at most bits per rank of a rank set bitmap */
+#define CRT_RANK_SET_DENSITY	(64)
+/* fewer ranks are only binary searched */
+#define CRT_RANK_SET_BITMAP_MIN	(16)
+
+/*
+ * A set of ranks for membership tests. rs_ranks is sorted and unique, and
+ * rs_bits is a bitmap of [rs_base, rs_base + rs_nbits) when the ranks are
+ * dense enough, see crt_rank_set_init.
+ */
+struct crt_rank_set {
+	crt_rank_t	*rs_ranks;
+	uint32_t	 rs_nr;
+	/* size of rs_ranks if allocated by the set, 0 if referenced */
+	uint32_t	 rs_alloc_nr;
+	uint64_t	*rs_bits;
+	crt_rank_t	 rs_base;
+	uint32_t	 rs_nbits;
+};
+
+int crt_rank_set_init(struct crt_rank_set *set, const crt_rank_list_t *list,
+		      bool input);
+void crt_rank_set_fini(struct crt_rank_set *set);
+bool crt_rank_set_has(const struct crt_rank_set *set, crt_rank_t rank);
 int crt_sgl_init(crt_sg_list_t *sgl, unsigned int nr);
 void crt_sgl_fini(crt_sg_list_t *sgl, bool free_iovs);
 void crt_getenv_bool(const char *env, bool *bool_val);
+void crt_getenv_int(const char *env, unsigned *int_val);
 
 
 #if !defined(container_of)
@@ -428,6 +466,17 @@ crt_timeus_secdiff(unsigned sec_diff)
 	return us;
 }
 
+/* current time in us from the coarse timer, \see _crt_gettime_coarse */
+static inline uint64_t
+crt_timeus_coarse(void)
+{
+	struct timespec		now;
+
+	_crt_gettime_coarse(&now);
+
+	return now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
 /* Increment time by ns nanoseconds */
 static inline void
 crt_timeinc(struct timespec *now, uint64_t ns)
@@ -0,0 +1,179 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* CaRT (Collective and RPC Transport) timing wheel APIs. */
+
+#ifndef __CRT_WHEEL_H__
+#define __CRT_WHEEL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <crt_util/list.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Hierarchical timing wheel
+ *
+ * The timing wheel tracks a large set of timers with O(1) arming and
+ * cancelling. Time is counted in ticks of a user specified granularity, each
+ * of the CRT_TWHEEL_LEVELS levels has CRT_TWHEEL_SIZE slots and covers
+ * CRT_TWHEEL_SIZE times the span of the level below. A timer is hashed into
+ * the lowest level that covers its deadline, and cascades to lower levels as
+ * the wheel turns. Timers beyond the span of the highest level are parked in
+ * it and re-hashed until they get in range.
+ *
+ * Users embed a struct crt_twheel_node in every object to be tracked. The
+ * wheel has no internal lock, users should protect it with their own lock.
+ */
+
+#define CRT_TWHEEL_BITS		(8)
+#define CRT_TWHEEL_SIZE		(1U << CRT_TWHEEL_BITS)
+#define CRT_TWHEEL_MASK		(CRT_TWHEEL_SIZE - 1)
+#define CRT_TWHEEL_LEVELS	(3)
+
+/** Timing wheel node, embedded in the tracked object. */
+struct crt_twheel_node {
+	/* link to the slot, or to the expired list */
+	crt_list_t		tn_link;
+	/* deadline in ticks */
+	uint64_t		tn_expire;
+};
+
+/** Timing wheel. */
+struct crt_twheel {
+	/* tick granularity in the user's time unit, e.g. micro-second */
+	uint64_t		tw_tick;
+	/* current tick, timers earlier than it already expired */
+	uint64_t		tw_now;
+	/* number of armed timers */
+	uint64_t		tw_count;
+	crt_list_t		tw_slots[CRT_TWHEEL_LEVELS][CRT_TWHEEL_SIZE];
+};
+
+/**
+ * Initialize a timing wheel inplace.
+ *
+ * \param tw [IN]	The timing wheel
+ * \param tick [IN]	The tick granularity in user's time unit
+ * \param now [IN]	The current time in user's time unit
+ *
+ * \return		zero on success, negative value if error
+ */
+int crt_twheel_init(struct crt_twheel *tw, uint64_t tick, uint64_t now);
+
+/**
+ * Initialize a timing wheel node, should be called before the first arming.
+ *
+ * \param node [IN]	The timing wheel node
+ */
+static inline void
+crt_twheel_node_init(struct crt_twheel_node *node)
+{
+	CRT_INIT_LIST_HEAD(&node->tn_link);
+	node->tn_expire = 0;
+}
+
+/**
+ * Check if a timing wheel node is armed.
+ *
+ * \param node [IN]	The timing wheel node
+ *
+ * \return		true if armed, false otherwise
+ */
+static inline bool
+crt_twheel_armed(struct crt_twheel_node *node)
+{
+	return !crt_list_empty(&node->tn_link);
+}
+
+/**
+ * Arm a timer, it expires at the first crt_twheel_expire() called with a time
+ * not earlier than \a expire (rounded up to the tick granularity). A deadline
+ * in the past expires at the next tick.
+ *
+ * \param tw [IN]	The timing wheel
+ * \param node [IN]	The unarmed timing wheel node
+ * \param expire [IN]	The deadline in user's time unit
+ */
+void crt_twheel_arm(struct crt_twheel *tw, struct crt_twheel_node *node,
+		    uint64_t expire);
+
+/**
+ * Cancel an armed timer.
+ *
+ * \param tw [IN]	The timing wheel
+ * \param node [IN]	The armed timing wheel node
+ */
+void crt_twheel_cancel(struct crt_twheel *tw, struct crt_twheel_node *node);
+
+/**
+ * Get a lower bound of the next expiring time, i.e. crt_twheel_expire() finds
+ * nothing expired before it. It is exact if the next timer is in level 0,
+ * otherwise the time of the next cascading.
+ *
+ * \param tw [IN]	The timing wheel
+ *
+ * \return		the time in user's time unit, UINT64_MAX if no timer
+ *			is armed
+ */
+uint64_t crt_twheel_next(struct crt_twheel *tw);
+
+/**
+ * Turn the wheel to \a now, and move all the expired timers to \a expired
+ * through crt_twheel_node::tn_link. The wheel forgets the moved nodes, user
+ * should remove them from \a expired by crt_list_del_init() before arming
+ * them again.
+ *
+ * \param tw [IN]	The timing wheel
+ * \param now [IN]	The current time in user's time unit
+ * \param expired [OUT]	The list to append the expired nodes to
+ *
+ * \return		number of expired timers
+ */
+int crt_twheel_expire(struct crt_twheel *tw, uint64_t now,
+		      crt_list_t *expired);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __CRT_WHEEL_H__ */
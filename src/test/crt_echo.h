@@ -53,6 +53,19 @@
 
 #define ECHO_OPC_CHECKIN    (0xA1)
 #define ECHO_OPC_BULK_TEST  (0xA2)
+/* checkin with request coalescing, \see CRT_RPC_FEAT_COALESCE */
+#define ECHO_OPC_CHECKIN_COALESCE (0xA3)
+/* coalesced checkin served by a vectored handler */
+#define ECHO_OPC_CHECKIN_VEC (0xA4)
+/* max requests per vector and max wait of ECHO_OPC_CHECKIN_VEC */
+#define ECHO_VEC_MAX_BATCH	(16)
+#define ECHO_VEC_MAX_WAIT_US	(500)
+/* notification sent as normal and as one-way RPC, \see CRT_RPC_FEAT_ONEWAY */
+#define ECHO_OPC_NOTIFY		(0xA5)
+#define ECHO_OPC_NOTIFY_ONEWAY	(0xA6)
+/* a ECHO_OPC_NOTIFY of this age is replied after ECHO_SLOW_REPLY_MS */
+#define ECHO_NOTIFY_SLOW_AGE	(-1)
+#define ECHO_SLOW_REPLY_MS	(200)
 #define ECHO_OPC_SHUTDOWN   (0x100)
 #define ECHO_CORPC_EXAMPLE  (0x886)
 
@@ -72,6 +85,8 @@ extern struct gecho gecho;
 extern struct crt_corpc_ops echo_co_ops;
 
 int echo_srv_checkin(crt_rpc_t *rpc);
+int echo_srv_checkin_vec(crt_rpc_t **rpcs, int n);
+int echo_srv_notify(crt_rpc_t *rpc);
 int echo_srv_bulk_test(crt_rpc_t *rpc);
 int echo_srv_shutdown(crt_rpc_t *rpc);
 int echo_srv_corpc_example(crt_rpc_t *rpc);
@@ -184,16 +199,34 @@ echo_init(int server, bool tier2)
 	 * the same crt_rpc_srv_register.
 	 */
 	if (server == 0) {
-		rc = crt_rpc_register(ECHO_OPC_CHECKIN, &CQF_ECHO_PING_CHECK);
+		rc = crt_rpc_register_feats(ECHO_OPC_CHECKIN,
+					    &CQF_ECHO_PING_CHECK, NULL,
+					    CRT_RPC_FEAT_IOV_INPLACE);
 		assert(rc == 0);
 		rc = crt_rpc_register(ECHO_OPC_BULK_TEST, &CQF_ECHO_BULK_TEST);
 		assert(rc == 0);
 		rc = crt_rpc_register(ECHO_OPC_SHUTDOWN, NULL);
 		assert(rc == 0);
+		rc = crt_rpc_register_feats(ECHO_OPC_CHECKIN_COALESCE,
+					    &CQF_ECHO_PING_CHECK, NULL,
+					    CRT_RPC_FEAT_COALESCE |
+					    CRT_RPC_FEAT_IOV_INPLACE);
+		assert(rc == 0);
+		rc = crt_rpc_register_feats(ECHO_OPC_CHECKIN_VEC,
+					    &CQF_ECHO_PING_CHECK, NULL,
+					    CRT_RPC_FEAT_COALESCE);
+		assert(rc == 0);
+		rc = crt_rpc_register(ECHO_OPC_NOTIFY, &CQF_ECHO_PING_CHECK);
+		assert(rc == 0);
+		rc = crt_rpc_register_feats(ECHO_OPC_NOTIFY_ONEWAY,
+					    &CQF_ECHO_PING_CHECK, NULL,
+					    CRT_RPC_FEAT_ONEWAY);
+		assert(rc == 0);
 	} else {
-		rc = crt_rpc_srv_register(ECHO_OPC_CHECKIN,
-					  &CQF_ECHO_PING_CHECK,
-					  echo_srv_checkin);
+		rc = crt_rpc_register_feats(ECHO_OPC_CHECKIN,
+					    &CQF_ECHO_PING_CHECK,
+					    echo_srv_checkin,
+					    CRT_RPC_FEAT_IOV_INPLACE);
 		assert(rc == 0);
 		rc = crt_rpc_srv_register(ECHO_OPC_BULK_TEST,
 					  &CQF_ECHO_BULK_TEST,
@@ -202,6 +235,27 @@ echo_init(int server, bool tier2)
 		rc = crt_rpc_srv_register(ECHO_OPC_SHUTDOWN, NULL,
 					  echo_srv_shutdown);
 		assert(rc == 0);
+		rc = crt_rpc_register_feats(ECHO_OPC_CHECKIN_COALESCE,
+					    &CQF_ECHO_PING_CHECK,
+					    echo_srv_checkin,
+					    CRT_RPC_FEAT_COALESCE |
+					    CRT_RPC_FEAT_IOV_INPLACE);
+		assert(rc == 0);
+		rc = crt_rpc_srv_register_vec(ECHO_OPC_CHECKIN_VEC,
+					      &CQF_ECHO_PING_CHECK,
+					      echo_srv_checkin_vec,
+					      ECHO_VEC_MAX_BATCH,
+					      ECHO_VEC_MAX_WAIT_US);
+		assert(rc == 0);
+		rc = crt_rpc_srv_register(ECHO_OPC_NOTIFY,
+					  &CQF_ECHO_PING_CHECK,
+					  echo_srv_notify);
+		assert(rc == 0);
+		rc = crt_rpc_register_feats(ECHO_OPC_NOTIFY_ONEWAY,
+					    &CQF_ECHO_PING_CHECK,
+					    echo_srv_notify,
+					    CRT_RPC_FEAT_ONEWAY);
+		assert(rc == 0);
 		rc = crt_corpc_register(ECHO_CORPC_EXAMPLE,
 					&CQF_ECHO_CORPC_EXAMPLE,
 					echo_srv_corpc_example, &echo_co_ops);
@@ -0,0 +1,146 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of the CaRT echo example which is based on CaRT APIs.
+ *
+ * Counts the heap allocations of libcrt. The programs built with it link the
+ * libcrt and libcrt_util objects statically and wrap the libc allocating
+ * entry points with -Wl,--wrap (ECHO_ALLOC_WRAPPERS in SConscript), so every
+ * allocation CaRT makes is counted, including the ones through strdup or
+ * asprintf. Allocations inside mercury and the other shared libraries are
+ * not counted.
+ */
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "crt_echo_alloc.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+int __real_posix_memalign(void **memptr, size_t alignment, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+char *__real_strdup(const char *s);
+char *__real_strndup(const char *s, size_t n);
+int __real_vasprintf(char **strp, const char *fmt, va_list ap);
+
+static uint64_t echo_crt_alloc_num;
+
+static inline void
+echo_alloc_count(void)
+{
+	__atomic_add_fetch(&echo_crt_alloc_num, 1, __ATOMIC_RELAXED);
+}
+
+uint64_t
+echo_crt_allocs(void)
+{
+	return __atomic_load_n(&echo_crt_alloc_num, __ATOMIC_RELAXED);
+}
+
+void *
+__wrap_malloc(size_t size)
+{
+	echo_alloc_count();
+	return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+	echo_alloc_count();
+	return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+	echo_alloc_count();
+	return __real_realloc(ptr, size);
+}
+
+int
+__wrap_posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	echo_alloc_count();
+	return __real_posix_memalign(memptr, alignment, size);
+}
+
+void *
+__wrap_aligned_alloc(size_t alignment, size_t size)
+{
+	echo_alloc_count();
+	return __real_aligned_alloc(alignment, size);
+}
+
+char *
+__wrap_strdup(const char *s)
+{
+	echo_alloc_count();
+	return __real_strdup(s);
+}
+
+char *
+__wrap_strndup(const char *s, size_t n)
+{
+	echo_alloc_count();
+	return __real_strndup(s, n);
+}
+
+int
+__wrap_vasprintf(char **strp, const char *fmt, va_list ap)
+{
+	echo_alloc_count();
+	return __real_vasprintf(strp, fmt, ap);
+}
+
+int
+__wrap_asprintf(char **strp, const char *fmt, ...)
+{
+	va_list	ap;
+	int	rc;
+
+	echo_alloc_count();
+	va_start(ap, fmt);
+	rc = __real_vasprintf(strp, fmt, ap);
+	va_end(ap);
+
+	return rc;
+}
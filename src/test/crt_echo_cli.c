@@ -40,6 +40,7 @@
  */
 
 #include "crt_echo.h"
+#include "crt_echo_alloc.h"
 
 bool test_multi_tiers;
 
@@ -94,6 +95,520 @@ static int bulk_test_req_cb(const struct crt_cb_info *cb_info)
 	return 0;
 }
 
+/* number of RPCs for the steady-state allocation check */
+#define ECHO_STEADY_RPC_NUM	(32)
+
+/*
+ * Send checkin RPCs back to back to one endpoint. After the first (warm-up)
+ * round trip every descriptor, buffer and callback bookkeeping should be
+ * served from the context pool, i.e. the pool miss counter must not grow and
+ * libcrt must not allocate at all. The server checks its side, the age of
+ * these RPCs is their sequence number.
+ */
+static void
+steady_state_alloc_test(crt_rank_t myrank)
+{
+	crt_endpoint_t			svr_ep;
+	crt_rpc_t			*rpc_req;
+	struct crt_echo_checkin_req	*e_req;
+	struct crt_pool_stats		stats_warm, stats_end;
+	struct crt_ep_flow_stats	flow;
+	uint64_t			allocs_warm = 0, allocs_end;
+	char				name[64];
+	int				rc, i;
+
+	svr_ep.ep_grp = NULL;
+	svr_ep.ep_rank = 0;
+	svr_ep.ep_tag = 0;
+	snprintf(name, sizeof(name), "Guest_%d_steady@client-side", myrank);
+
+	for (i = 0; i < ECHO_STEADY_RPC_NUM; i++) {
+		rpc_req = NULL;
+		rc = crt_req_create(gecho.crt_ctx, svr_ep, ECHO_OPC_CHECKIN,
+				    &rpc_req);
+		assert(rc == 0 && rpc_req != NULL);
+
+		e_req = crt_req_get(rpc_req);
+		e_req->name = name;
+		e_req->age = i;
+		crt_iov_set(&e_req->raw_package, name, strlen(name) + 1);
+		e_req->days = myrank;
+		rc = crt_req_set_timeout_ms(rpc_req, 10 * 1000);
+		assert(rc == 0);
+
+		gecho.complete = 0;
+		rc = crt_req_send(rpc_req, client_cb_common, &gecho.complete);
+		assert(rc == 0);
+		rc = client_wait(120, 1000, &gecho.complete);
+		assert(rc == 0);
+
+		if (i == 0) {
+			rc = crt_context_pool_query(gecho.crt_ctx, &stats_warm);
+			assert(rc == 0);
+			allocs_warm = echo_crt_allocs();
+		}
+	}
+
+	allocs_end = echo_crt_allocs();
+	rc = crt_context_pool_query(gecho.crt_ctx, &stats_end);
+	assert(rc == 0);
+	printf("client(rank %d) %d steady-state RPCs, pool hit "CF_U64", "
+	       "miss "CF_U64", libcrt allocations "CF_U64".\n", myrank,
+	       ECHO_STEADY_RPC_NUM - 1, stats_end.cps_hit - stats_warm.cps_hit,
+	       stats_end.cps_miss - stats_warm.cps_miss,
+	       allocs_end - allocs_warm);
+	assert(stats_end.cps_miss == stats_warm.cps_miss);
+	assert(allocs_end == allocs_warm);
+
+	rc = crt_ep_flow_query(gecho.crt_ctx, &svr_ep, &flow);
+	assert(rc == 0);
+	printf("client(rank %d) flow to rank 0 tag 0: window "CF_U64", "
+	       "inflight "CF_U64", waiting "CF_U64", srtt "CF_U64" us, "
+	       "min rtt "CF_U64" us.\n", myrank, flow.cefs_window,
+	       flow.cefs_inflight, flow.cefs_wait_num, flow.cefs_srtt_us,
+	       flow.cefs_min_rtt_us);
+	assert(flow.cefs_window >= 1 && flow.cefs_srtt_us > 0);
+}
+
+/* number of checkin RPCs sent back to back for the coalescing check */
+#define ECHO_COALESCE_RPC_NUM	(48)
+
+static int
+checkin_burst_cb(const struct crt_cb_info *cb_info)
+{
+	struct crt_echo_checkin_reply	*e_reply;
+
+	assert(cb_info->cci_rc == 0);
+	e_reply = crt_reply_get(cb_info->cci_rpc);
+	assert(e_reply != NULL && e_reply->ret == 0);
+	(*(int *)cb_info->cci_arg)++;
+
+	return 0;
+}
+
+/*
+ * Send many small checkin RPCs of \a opc to one endpoint before progressing,
+ * they are coalesced into a few messages and each still gets its own reply.
+ * With ECHO_OPC_CHECKIN_VEC the server also handles them in vectors.
+ */
+static void
+checkin_burst_test(crt_rank_t myrank, crt_opcode_t opc)
+{
+	crt_endpoint_t			svr_ep;
+	crt_rpc_t			*rpc_req;
+	struct crt_echo_checkin_req	*e_req;
+	struct crt_pool_stats		stats_start, stats_end;
+	char				name[64];
+	int				completed = 0;
+	int				rc, i;
+
+	svr_ep.ep_grp = NULL;
+	svr_ep.ep_rank = 0;
+	svr_ep.ep_tag = 0;
+	snprintf(name, sizeof(name), "Guest_%d_burst@client-side", myrank);
+
+	rc = crt_context_pool_query(gecho.crt_ctx, &stats_start);
+	assert(rc == 0);
+	for (i = 0; i < ECHO_COALESCE_RPC_NUM; i++) {
+		rpc_req = NULL;
+		rc = crt_req_create(gecho.crt_ctx, svr_ep, opc, &rpc_req);
+		assert(rc == 0 && rpc_req != NULL);
+
+		e_req = crt_req_get(rpc_req);
+		e_req->name = name;
+		e_req->age = 32;
+		crt_iov_set(&e_req->raw_package, name, strlen(name) + 1);
+		e_req->days = i;
+
+		rc = crt_req_send(rpc_req, checkin_burst_cb, &completed);
+		assert(rc == 0);
+	}
+
+	while (completed < ECHO_COALESCE_RPC_NUM) {
+		rc = crt_progress(gecho.crt_ctx, 1000 * 1000, NULL, NULL);
+		assert(rc == 0 || rc == -CER_TIMEDOUT);
+	}
+	rc = crt_context_pool_query(gecho.crt_ctx, &stats_end);
+	assert(rc == 0);
+	printf("client(rank %d) %d coalesced checkin RPCs (opc 0x%x) completed, "
+	       "pool hit "CF_U64", miss "CF_U64".\n", myrank,
+	       ECHO_COALESCE_RPC_NUM, opc, stats_end.cps_hit - stats_start.cps_hit,
+	       stats_end.cps_miss - stats_start.cps_miss);
+}
+
+static int
+connect_warmup_cb(crt_group_t *grp, void *arg, int status)
+{
+	assert(status == 0);
+	*(int *)arg = 1;
+
+	return 0;
+}
+
+/*
+ * Connect every tag of every server rank with crt_group_connect, then time
+ * the first fan-out of checkin RPCs to all of them, which no longer pays for
+ * the URI lookups and connection setup one endpoint at a time.
+ */
+static void
+connect_warmup_test(crt_rank_t myrank, uint32_t grp_size_srv)
+{
+	crt_endpoint_t			svr_ep;
+	crt_rpc_t			*rpc_req;
+	struct crt_echo_checkin_req	*e_req;
+	uint32_t			tags[ECHO_EXTRA_CONTEXT_NUM + 1];
+	struct timespec			t1, t2, t3;
+	char				name[64];
+	int				connected = 0;
+	int				completed = 0;
+	int				total;
+	uint32_t			rank;
+	int				rc, i;
+
+	for (i = 0; i <= ECHO_EXTRA_CONTEXT_NUM; i++)
+		tags[i] = i;
+	total = grp_size_srv * (ECHO_EXTRA_CONTEXT_NUM + 1);
+	snprintf(name, sizeof(name), "Guest_%d_warmup@client-side", myrank);
+
+	rc = crt_gettime(&t1);
+	assert(rc == 0);
+	rc = crt_group_connect(gecho.crt_ctx, NULL /* grp */, NULL /* ranks */,
+			       tags, ECHO_EXTRA_CONTEXT_NUM + 1,
+			       connect_warmup_cb, &connected);
+	assert(rc == 0);
+	rc = client_wait(120, 1000, &connected);
+	assert(rc == 0);
+	rc = crt_gettime(&t2);
+	assert(rc == 0);
+
+	for (rank = 0; rank < grp_size_srv; rank++) {
+		for (i = 0; i <= ECHO_EXTRA_CONTEXT_NUM; i++) {
+			svr_ep.ep_grp = NULL;
+			svr_ep.ep_rank = rank;
+			svr_ep.ep_tag = i;
+			rc = crt_req_create(gecho.crt_ctx, svr_ep,
+					    ECHO_OPC_CHECKIN, &rpc_req);
+			assert(rc == 0 && rpc_req != NULL);
+
+			e_req = crt_req_get(rpc_req);
+			e_req->name = name;
+			e_req->age = 32;
+			crt_iov_set(&e_req->raw_package, name,
+				    strlen(name) + 1);
+			e_req->days = myrank;
+
+			rc = crt_req_send(rpc_req, checkin_burst_cb,
+					  &completed);
+			assert(rc == 0);
+		}
+	}
+	while (completed < total) {
+		rc = crt_progress(gecho.crt_ctx, 1000 * 1000, NULL, NULL);
+		assert(rc == 0 || rc == -CER_TIMEDOUT);
+	}
+	rc = crt_gettime(&t3);
+	assert(rc == 0);
+
+	printf("client(rank %d) connected %d endpoints in %.3e uS, first "
+	       "full fan-out in %.3e uS.\n", myrank, total,
+	       crt_time2us(crt_timediff(t1, t2)),
+	       crt_time2us(crt_timediff(t2, t3)));
+}
+
+/* number of RPCs per progress mode for the latency check */
+#define ECHO_LATENCY_RPC_NUM	(64)
+/* busy polling time of the spin-then-block mode */
+#define ECHO_LATENCY_SPIN_US	(100)
+
+enum echo_progress_mode {
+	ECHO_PROGRESS_BLOCK,	/* crt_progress blocks right away */
+	ECHO_PROGRESS_POLL,	/* crt_progress with zero timeout */
+	ECHO_PROGRESS_SPIN,	/* crt_progress spins then blocks */
+};
+
+/* average round trip (us) of checkin RPCs, progressed in mode \a mode */
+static double
+progress_latency_run(crt_rank_t myrank, enum echo_progress_mode mode)
+{
+	crt_endpoint_t			svr_ep;
+	crt_rpc_t			*rpc_req;
+	struct crt_echo_checkin_req	*e_req;
+	struct timespec			start, end;
+	char				name[64];
+	int				rc, i;
+
+	svr_ep.ep_grp = NULL;
+	svr_ep.ep_rank = 0;
+	svr_ep.ep_tag = 0;
+	snprintf(name, sizeof(name), "Guest_%d_latency@client-side", myrank);
+
+	rc = crt_context_set_progress_spin(gecho.crt_ctx,
+		mode == ECHO_PROGRESS_SPIN ? ECHO_LATENCY_SPIN_US : 0);
+	assert(rc == 0);
+
+	crt_gettime(&start);
+	for (i = 0; i < ECHO_LATENCY_RPC_NUM; i++) {
+		rpc_req = NULL;
+		rc = crt_req_create(gecho.crt_ctx, svr_ep, ECHO_OPC_CHECKIN,
+				    &rpc_req);
+		assert(rc == 0 && rpc_req != NULL);
+
+		e_req = crt_req_get(rpc_req);
+		e_req->name = name;
+		e_req->age = 32;
+		crt_iov_set(&e_req->raw_package, name, strlen(name) + 1);
+		e_req->days = myrank;
+
+		gecho.complete = 0;
+		rc = crt_req_send(rpc_req, client_cb_common, &gecho.complete);
+		assert(rc == 0);
+		while (gecho.complete == 0) {
+			rc = crt_progress(gecho.crt_ctx,
+					  mode == ECHO_PROGRESS_POLL ? 0 :
+					  1000 * 1000, NULL, NULL);
+			assert(rc == 0 || rc == -CER_TIMEDOUT);
+		}
+	}
+	crt_gettime(&end);
+
+	return crt_time2us(crt_timediff(start, end)) / ECHO_LATENCY_RPC_NUM;
+}
+
+static void
+progress_latency_test(crt_rank_t myrank)
+{
+	double	block_us, poll_us, spin_us;
+
+	block_us = progress_latency_run(myrank, ECHO_PROGRESS_BLOCK);
+	poll_us = progress_latency_run(myrank, ECHO_PROGRESS_POLL);
+	spin_us = progress_latency_run(myrank, ECHO_PROGRESS_SPIN);
+
+	printf("client(rank %d) checkin RPC round trip over %d RPCs: "
+	       "blocking %.1f us, zero-timeout polling %.1f us, "
+	       "spin %d us then blocking %.1f us.\n", myrank,
+	       ECHO_LATENCY_RPC_NUM, block_us, poll_us, ECHO_LATENCY_SPIN_US,
+	       spin_us);
+
+	/* back to the default mode for the following tests */
+	crt_context_set_progress_spin(gecho.crt_ctx, 0);
+}
+
+/* number of notifications per mode for the message rate check */
+#define ECHO_RATE_RPC_NUM	(1024)
+
+static int
+notify_rate_cb(const struct crt_cb_info *cb_info)
+{
+	assert(cb_info->cci_rc == 0);
+	(*(int *)cb_info->cci_arg)++;
+
+	return 0;
+}
+
+/* notifications of \a opc per second, sent back to back */
+static double
+notify_rate_run(crt_rank_t myrank, crt_opcode_t opc)
+{
+	crt_endpoint_t			svr_ep;
+	crt_rpc_t			*rpc_req;
+	struct crt_echo_checkin_req	*e_req;
+	struct timespec			start, end;
+	char				name[64];
+	int				completed = 0;
+	int				rc, i;
+
+	svr_ep.ep_grp = NULL;
+	svr_ep.ep_rank = 0;
+	svr_ep.ep_tag = 0;
+	snprintf(name, sizeof(name), "Guest_%d_notify@client-side", myrank);
+
+	crt_gettime(&start);
+	for (i = 0; i < ECHO_RATE_RPC_NUM; i++) {
+		rpc_req = NULL;
+		rc = crt_req_create(gecho.crt_ctx, svr_ep, opc, &rpc_req);
+		assert(rc == 0 && rpc_req != NULL);
+
+		e_req = crt_req_get(rpc_req);
+		e_req->name = name;
+		e_req->age = 32;
+		crt_iov_set(&e_req->raw_package, NULL, 0);
+		e_req->days = i;
+
+		rc = crt_req_send(rpc_req, notify_rate_cb, &completed);
+		assert(rc == 0);
+		/* keep the send queue short, as a real sender would */
+		rc = crt_progress(gecho.crt_ctx, 0, NULL, NULL);
+		assert(rc == 0 || rc == -CER_TIMEDOUT);
+	}
+	while (completed < ECHO_RATE_RPC_NUM) {
+		rc = crt_progress(gecho.crt_ctx, 1000 * 1000, NULL, NULL);
+		assert(rc == 0 || rc == -CER_TIMEDOUT);
+	}
+	crt_gettime(&end);
+
+	return ECHO_RATE_RPC_NUM * 1e6 / crt_time2us(crt_timediff(start, end));
+}
+
+/* message rate of one-way notifications against replied ones */
+static void
+oneway_rate_test(crt_rank_t myrank)
+{
+	double	rate, oneway_rate;
+
+	rate = notify_rate_run(myrank, ECHO_OPC_NOTIFY);
+	oneway_rate = notify_rate_run(myrank, ECHO_OPC_NOTIFY_ONEWAY);
+
+	printf("client(rank %d) notification rate over %d RPCs: "
+	       "%.0f msg/s replied, %.0f msg/s one-way (%.2fx).\n", myrank,
+	       ECHO_RATE_RPC_NUM, rate, oneway_rate, oneway_rate / rate);
+}
+
+/* number of notifications per mode for the request reuse check */
+#define ECHO_REUSE_RPC_NUM	(1024)
+
+/*
+ * average time (us) to send a notification and get its reply, either with
+ * a new request per send or with one request reset after each completion.
+ */
+static double
+req_reuse_run(crt_rank_t myrank, bool reuse)
+{
+	crt_endpoint_t			svr_ep;
+	crt_rpc_t			*rpc_req = NULL;
+	struct crt_echo_checkin_req	*e_req;
+	struct timespec			start, end;
+	char				name[64];
+	int				completed = 0;
+	int				rc, i;
+
+	svr_ep.ep_grp = NULL;
+	svr_ep.ep_rank = 0;
+	svr_ep.ep_tag = 0;
+	snprintf(name, sizeof(name), "Guest_%d_reuse@client-side", myrank);
+
+	crt_gettime(&start);
+	for (i = 0; i < ECHO_REUSE_RPC_NUM; i++) {
+		if (!reuse || rpc_req == NULL) {
+			rc = crt_req_create(gecho.crt_ctx, svr_ep,
+					    ECHO_OPC_NOTIFY, &rpc_req);
+			assert(rc == 0 && rpc_req != NULL);
+			/* keep it over the completion to reset it */
+			if (reuse)
+				crt_req_addref(rpc_req);
+		} else {
+			rc = crt_req_reset(rpc_req);
+			assert(rc == 0);
+		}
+
+		e_req = crt_req_get(rpc_req);
+		e_req->name = name;
+		e_req->age = 32;
+		crt_iov_set(&e_req->raw_package, NULL, 0);
+		e_req->days = i;
+
+		rc = crt_req_send(rpc_req, notify_rate_cb, &completed);
+		assert(rc == 0);
+		while (completed == i) {
+			rc = crt_progress(gecho.crt_ctx, 1000 * 1000, NULL,
+					  NULL);
+			assert(rc == 0 || rc == -CER_TIMEDOUT);
+		}
+	}
+	crt_gettime(&end);
+	if (reuse)
+		crt_req_decref(rpc_req);
+
+	return crt_time2us(crt_timediff(start, end)) / ECHO_REUSE_RPC_NUM;
+}
+
+static void
+req_reuse_test(crt_rank_t myrank)
+{
+	double	create_us, reuse_us;
+
+	create_us = req_reuse_run(myrank, false);
+	reuse_us = req_reuse_run(myrank, true);
+
+	printf("client(rank %d) notification round trip over %d RPCs: "
+	       "%.1f us with crt_req_create per send, %.1f us with "
+	       "crt_req_reset.\n", myrank, ECHO_REUSE_RPC_NUM, create_us,
+	       reuse_us);
+}
+
+static int
+req_timeout_cb(const struct crt_cb_info *cb_info)
+{
+	*(int *)cb_info->cci_arg = cb_info->cci_rc;
+
+	return 0;
+}
+
+/* reset a request which timed out and send it again */
+static void
+req_timeout_reuse_test(crt_rank_t myrank)
+{
+	crt_endpoint_t			svr_ep;
+	crt_rpc_t			*rpc_req = NULL;
+	struct crt_echo_checkin_req	*e_req;
+	char				name[64];
+	int				cb_rc;
+	int				busy = 0;
+	int				rc;
+
+	svr_ep.ep_grp = NULL;
+	svr_ep.ep_rank = 0;
+	svr_ep.ep_tag = 0;
+	snprintf(name, sizeof(name), "Guest_%d_timeout@client-side", myrank);
+
+	rc = crt_req_create(gecho.crt_ctx, svr_ep, ECHO_OPC_NOTIFY, &rpc_req);
+	assert(rc == 0 && rpc_req != NULL);
+	crt_req_addref(rpc_req);
+	rc = crt_req_set_timeout_ms(rpc_req, ECHO_SLOW_REPLY_MS / 10);
+	assert(rc == 0);
+
+	e_req = crt_req_get(rpc_req);
+	e_req->name = name;
+	e_req->age = ECHO_NOTIFY_SLOW_AGE;
+	crt_iov_set(&e_req->raw_package, NULL, 0);
+	e_req->days = 0;
+
+	cb_rc = 1;
+	rc = crt_req_send(rpc_req, req_timeout_cb, &cb_rc);
+	assert(rc == 0);
+	while (cb_rc == 1) {
+		rc = crt_progress(gecho.crt_ctx, 1000, NULL, NULL);
+		assert(rc == 0 || rc == -CER_TIMEDOUT);
+	}
+	assert(cb_rc == -CER_TIMEDOUT);
+
+	/* busy until the canceled forward called back */
+	while ((rc = crt_req_reset(rpc_req)) == -CER_BUSY) {
+		busy++;
+		rc = crt_progress(gecho.crt_ctx, 1000, NULL, NULL);
+		assert(rc == 0 || rc == -CER_TIMEDOUT);
+	}
+	assert(rc == 0);
+
+	e_req = crt_req_get(rpc_req);
+	e_req->age = 32;
+	e_req->days = 1;
+	rc = crt_req_set_timeout_ms(rpc_req, 0);
+	assert(rc == 0);
+
+	cb_rc = 1;
+	rc = crt_req_send(rpc_req, req_timeout_cb, &cb_rc);
+	assert(rc == 0);
+	while (cb_rc == 1) {
+		rc = crt_progress(gecho.crt_ctx, 1000 * 1000, NULL, NULL);
+		assert(rc == 0 || rc == -CER_TIMEDOUT);
+	}
+	assert(cb_rc == 0);
+	crt_req_decref(rpc_req);
+
+	printf("client(rank %d) timed out request resent after %d busy "
+	       "resets.\n", myrank, busy);
+}
+
 static void run_client(void)
 {
 	crt_group_t			*pri_local_grp = NULL;
@@ -111,6 +626,7 @@ static void run_client(void)
 	uint32_t			grp_size_srv = 0;
 	struct crt_echo_checkin_req	*e_req;
 	struct crt_echo_bulk_in_req	*e_bulk_req;
+	struct crt_pool_stats		pool_stats;
 	int				rc = 0, i;
 
 	rc = crt_group_rank(NULL, &myrank);
@@ -135,6 +651,8 @@ static void run_client(void)
 	       myrank, pri_local_grp->cg_grpid, grp_size_cli,
 	       pri_srv_grp->cg_grpid, grp_size_srv);
 
+	connect_warmup_test(myrank, grp_size_srv);
+
 	/* ============= test-1 ============ */
 
 	/* send checkin RPC to different contexts of server*/
@@ -189,6 +707,22 @@ static void run_client(void)
 		       myrank, svr_ep.ep_tag);
 	}
 
+	/* the later checkin RPCs should reuse the recycled descriptors */
+	rc = crt_context_pool_query(gecho.crt_ctx, &pool_stats);
+	assert(rc == 0);
+	printf("client(rank %d) rpc pool hit "CF_U64", miss "CF_U64", "
+	       "cached "CF_U64".\n", myrank, pool_stats.cps_hit,
+	       pool_stats.cps_miss, pool_stats.cps_cached);
+	assert(pool_stats.cps_hit > 0);
+
+	steady_state_alloc_test(myrank);
+	progress_latency_test(myrank);
+	checkin_burst_test(myrank, ECHO_OPC_CHECKIN_COALESCE);
+	checkin_burst_test(myrank, ECHO_OPC_CHECKIN_VEC);
+	oneway_rate_test(myrank);
+	req_reuse_test(myrank);
+	req_timeout_reuse_test(myrank);
+
 	/*
 	 * ============= test-2 ============
 	 * simple bulk transferring
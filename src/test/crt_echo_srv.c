@@ -40,6 +40,7 @@
  */
 
 #include "crt_echo_srv.h"
+#include "crt_echo_alloc.h"
 
 static int run_echo_srver(void)
 {
@@ -121,6 +122,11 @@ static int run_echo_srver(void)
 	if (mysize >= 8 && myrank == 4) {
 		crt_rpc_t				*corpc_req;
 		struct crt_echo_corpc_example_req	*corpc_in;
+		crt_bulk_t				 bulk_hdl;
+		crt_sg_list_t				 bulk_sgl;
+		crt_iov_t				 bulk_iov;
+		unsigned char				*bulk_buf;
+		int					 bulk_len, i;
 
 		rc = crt_group_create(grp_id, &grp_membs, 0, grp_create_cb,
 				      &myrank);
@@ -144,6 +150,42 @@ static int run_echo_srver(void)
 		sleep(1); /* just to ensure corpc handled */
 		C_ASSERT(gecho.complete == 1);
 
+		/*
+		 * chained bulk of a few CRT_CORPC_CHUNK_SIZE chunks, it is
+		 * pipelined down the tree.
+		 */
+		bulk_len = (1 << 20) + 1;
+		C_ALLOC(bulk_buf, bulk_len);
+		C_ASSERT(bulk_buf != NULL);
+		for (i = 0; i < bulk_len; i++)
+			bulk_buf[i] = (unsigned char)i;
+		bulk_iov.iov_buf = bulk_buf;
+		bulk_iov.iov_buf_len = bulk_len;
+		bulk_sgl.sg_nr.num = 1;
+		bulk_sgl.sg_iovs = &bulk_iov;
+		rc = crt_bulk_create(gecho.crt_ctx, &bulk_sgl, CRT_BULK_RO,
+				     &bulk_hdl);
+		C_ASSERT(rc == 0);
+
+		rc = crt_corpc_req_create(gecho.crt_ctx, example_grp_hdl,
+					  &excluded_membs, ECHO_CORPC_EXAMPLE,
+					  bulk_hdl, NULL, 0,
+					  crt_tree_topo(CRT_TREE_KNOMIAL, 2),
+					  &corpc_req);
+		C_ASSERT(rc == 0 && corpc_req != NULL);
+		corpc_in = crt_req_get(corpc_req);
+		C_ASSERT(corpc_in != NULL);
+		corpc_in->co_msg = "testing corpc with chained bulk";
+
+		gecho.complete = 0;
+		rc = crt_req_send(corpc_req, client_cb_common,
+				  &gecho.complete);
+		C_ASSERT(rc == 0);
+		sleep(1); /* just to ensure corpc handled */
+		C_ASSERT(gecho.complete == 1);
+		crt_bulk_free(bulk_hdl);
+		C_FREE(bulk_buf, bulk_len);
+
 		rc = crt_group_destroy(example_grp_hdl, grp_destroy_cb,
 				       &myrank);
 		printf("crt_group_destroy rc: %d, arg %p.\n", rc, &myrank);
@@ -162,6 +204,30 @@ out:
 }
 
 int g_roomno = 1082;
+
+/*
+ * libcrt allocations between two consecutive steady-state checkins (see
+ * steady_state_alloc_test() in the client). Other traffic in between can only
+ * add to a delta, so the minimum must be zero once the pools are warm.
+ */
+static uint64_t g_steady_last = UINT64_MAX;
+static uint64_t g_steady_min = UINT64_MAX;
+
+static void
+echo_srv_steady_track(struct crt_echo_checkin_req *e_req)
+{
+	uint64_t	allocs;
+
+	if (e_req->name == NULL || strstr(e_req->name, "_steady@") == NULL ||
+	    e_req->age < 1)
+		return;
+
+	allocs = echo_crt_allocs();
+	if (g_steady_last != UINT64_MAX && allocs - g_steady_last < g_steady_min)
+		g_steady_min = allocs - g_steady_last;
+	g_steady_last = allocs;
+}
+
 int echo_srv_checkin(crt_rpc_t *rpc_req)
 {
 	struct crt_echo_checkin_req	*e_req;
@@ -172,6 +238,7 @@ int echo_srv_checkin(crt_rpc_t *rpc_req)
 	/* CaRT internally already allocated the input/output buffer */
 	e_req = crt_req_get(rpc_req);
 	C_ASSERT(e_req != NULL);
+	echo_srv_steady_track(e_req);
 
 	printf("tier1 echo_srver recv'd checkin, opc: 0x%x.\n",
 		rpc_req->cr_opc);
@@ -197,16 +264,67 @@ int echo_srv_checkin(crt_rpc_t *rpc_req)
 	return rc;
 }
 
+int echo_srv_checkin_vec(crt_rpc_t **rpcs, int n)
+{
+	struct crt_echo_checkin_reply	*e_reply;
+	int				 i;
+	int				 rc = 0;
+
+	C_ASSERT(n > 0 && n <= ECHO_VEC_MAX_BATCH);
+	printf("tier1 echo_srver recv'd %d checkin in a vector, opc: 0x%x.\n",
+	       n, rpcs[0]->cr_opc);
+
+	/* one room block for the whole vector */
+	for (i = 0; i < n; i++) {
+		C_ASSERT(rpcs[i]->cr_opc == rpcs[0]->cr_opc);
+		e_reply = crt_reply_get(rpcs[i]);
+		C_ASSERT(e_reply != NULL);
+		e_reply->ret = 0;
+		e_reply->room_no = g_roomno + i;
+		rc = crt_reply_send(rpcs[i]);
+		if (rc != 0)
+			break;
+	}
+	g_roomno += n;
+
+	return rc;
+}
+
+/* number of notifications received, of both ECHO_OPC_NOTIFY* opcodes */
+static uint64_t g_notify_num;
+
+int echo_srv_notify(crt_rpc_t *rpc_req)
+{
+	struct crt_echo_checkin_req	*e_req;
+
+	__atomic_add_fetch(&g_notify_num, 1, __ATOMIC_RELAXED);
+
+	/* let the client time out, \see req_timeout_reuse_test */
+	e_req = crt_req_get(rpc_req);
+	if (e_req->age == ECHO_NOTIFY_SLOW_AGE)
+		usleep(ECHO_SLOW_REPLY_MS * 1000);
+
+	/* a no-op for ECHO_OPC_NOTIFY_ONEWAY */
+	return crt_reply_send(rpc_req);
+}
+
 int echo_srv_shutdown(crt_rpc_t *rpc_req)
 {
 	int rc = 0;
 
-	printf("tier1 echo_srver received shutdown request, opc: 0x%x.\n",
-	       rpc_req->cr_opc);
+	printf("tier1 echo_srver received shutdown request, opc: 0x%x, "
+	       "after "CF_U64" notifications.\n", rpc_req->cr_opc,
+	       __atomic_load_n(&g_notify_num, __ATOMIC_RELAXED));
 
 	assert(rpc_req->cr_input == NULL);
 	assert(rpc_req->cr_output == NULL);
 
+	if (g_steady_min != UINT64_MAX) {
+		printf("tier1 echo_srver steady-state checkins, min libcrt "
+		       "allocations per RPC "CF_U64".\n", g_steady_min);
+		assert(g_steady_min == 0);
+	}
+
 	rc = crt_reply_send(rpc_req);
 	printf("tier1 echo_srver done issuing shutdown responses.\n");
 
@@ -120,6 +120,23 @@ int echo_srv_corpc_example(crt_rpc_t *rpc_req)
 	crt_group_rank(NULL, &my_rank);
 	reply->co_result = my_rank;
 
+	/* the chained bulk has landed in whole before the handler is invoked */
+	if (rpc_req->cr_co_bulk_hdl != NULL) {
+		crt_sg_list_t	sgl;
+		crt_iov_t	iov;
+		crt_size_t	i;
+
+		sgl.sg_nr.num = 1;
+		sgl.sg_iovs = &iov;
+		rc = crt_bulk_access(rpc_req->cr_co_bulk_hdl, &sgl);
+		C_ASSERT(rc == 0);
+		for (i = 0; i < iov.iov_buf_len; i++)
+			C_ASSERT(((unsigned char *)iov.iov_buf)[i] ==
+				 (unsigned char)i);
+		printf("echo_srv_corpc_example, rank %d checked bulk of "
+		       CF_U64" bytes.\n", my_rank, iov.iov_buf_len);
+	}
+
 	rc = crt_reply_send(rpc_req);
 
 	printf("echo_srv_corpc_example, rank %d got msg %s, reply %d, rc %d.\n",
@@ -146,8 +163,30 @@ int corpc_example_aggregate(crt_rpc_t *source, crt_rpc_t *result, void *priv)
 	return 0;
 }
 
+int corpc_example_aggregate_batch(crt_rpc_t **sources, int nr,
+				  crt_rpc_t *result, void *priv)
+{
+	struct crt_echo_corpc_example_reply *reply_source, *reply_result;
+	crt_rank_t my_rank;
+	int i;
+
+	C_ASSERT(sources != NULL && nr > 0 && result != NULL);
+	reply_result = crt_reply_get(result);
+	for (i = 0; i < nr; i++) {
+		reply_source = crt_reply_get(sources[i]);
+		reply_result->co_result += reply_source->co_result;
+	}
+
+	crt_group_rank(NULL, &my_rank);
+	printf("corpc_example_aggregate_batch, rank %d, %d replies, "
+	       "aggregate result %d.\n", my_rank, nr, reply_result->co_result);
+
+	return 0;
+}
+
 struct crt_corpc_ops echo_co_ops = {
 	.co_aggregate = corpc_example_aggregate,
+	.co_aggregate_batch = corpc_example_aggregate_batch,
 };
 
 int bulk_test_cb(const struct crt_bulk_cb_info *cb_info)
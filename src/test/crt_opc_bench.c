@@ -0,0 +1,170 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Micro-benchmark of the opcode lookup done for every RPC sent or received,
+ * from several threads at once. It compares the lock-free crt_opc_lookup
+ * with the same lookup under the read lock of the opcode map, which is what
+ * the lookup used to take.
+ *
+ * usage: crt_opc_bench [threads] [lookups per thread] [opcodes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include <crt_internal.h>
+
+#define BENCH_OPC_BASE		(0x1000)
+
+struct bench_arg {
+	pthread_barrier_t	*ba_barrier;
+	int			 ba_lookups;
+	int			 ba_opc_num;
+	int			 ba_id;
+	bool			 ba_locked;
+};
+
+static void *
+bench_lookup(void *data)
+{
+	struct bench_arg	*arg = data;
+	struct crt_opc_map	*map = crt_gdata.cg_opc_map;
+	struct crt_opc_info	*info;
+	crt_opcode_t		 opc;
+	int			 i;
+
+	pthread_barrier_wait(arg->ba_barrier);
+	for (i = 0; i < arg->ba_lookups; i++) {
+		/* the threads walk the opcodes from different points */
+		opc = BENCH_OPC_BASE + (i + arg->ba_id * 7) % arg->ba_opc_num;
+		if (arg->ba_locked)
+			pthread_rwlock_rdlock(&map->com_rwlock);
+		info = crt_opc_lookup(map, opc);
+		if (arg->ba_locked)
+			pthread_rwlock_unlock(&map->com_rwlock);
+		assert(info != NULL && info->coi_opc == opc);
+	}
+
+	return NULL;
+}
+
+/* wall time (us) of \a threads threads doing \a lookups lookups each */
+static double
+bench_run(int threads, int lookups, int opc_num, bool locked)
+{
+	pthread_barrier_t	 barrier;
+	pthread_t		*tids;
+	struct bench_arg	*args;
+	struct timespec		 start, end;
+	int			 i, rc;
+
+	C_ALLOC(tids, threads * sizeof(*tids));
+	C_ALLOC(args, threads * sizeof(*args));
+	assert(tids != NULL && args != NULL);
+	rc = pthread_barrier_init(&barrier, NULL, threads + 1);
+	assert(rc == 0);
+
+	for (i = 0; i < threads; i++) {
+		args[i].ba_barrier = &barrier;
+		args[i].ba_lookups = lookups;
+		args[i].ba_opc_num = opc_num;
+		args[i].ba_id = i;
+		args[i].ba_locked = locked;
+		rc = pthread_create(&tids[i], NULL, bench_lookup, &args[i]);
+		assert(rc == 0);
+	}
+
+	pthread_barrier_wait(&barrier);
+	crt_gettime(&start);
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	crt_gettime(&end);
+
+	pthread_barrier_destroy(&barrier);
+	C_FREE(args, threads * sizeof(*args));
+	C_FREE(tids, threads * sizeof(*tids));
+
+	return crt_time2us(crt_timediff(start, end));
+}
+
+int
+main(int argc, char **argv)
+{
+	int		threads = 8;
+	int		lookups = 4 * 1024 * 1024;
+	int		opc_num = 64;
+	double		locked_us, free_us;
+	uint64_t	total;
+	int		i, rc;
+
+	if (argc > 1)
+		threads = atoi(argv[1]);
+	if (argc > 2)
+		lookups = atoi(argv[2]);
+	if (argc > 3)
+		opc_num = atoi(argv[3]);
+	if (threads <= 0 || lookups <= 0 || opc_num <= 0) {
+		fprintf(stderr, "usage: %s [threads] [lookups per thread] "
+			"[opcodes]\n", argv[0]);
+		return 1;
+	}
+
+	/* only the opcode map, no need of crt_init */
+	rc = crt_opc_map_create(CRT_OPC_MAP_BITS);
+	assert(rc == 0);
+	for (i = 0; i < opc_num; i++) {
+		rc = crt_rpc_register(BENCH_OPC_BASE + i, NULL);
+		assert(rc == 0);
+	}
+
+	locked_us = bench_run(threads, lookups, opc_num, true);
+	free_us = bench_run(threads, lookups, opc_num, false);
+
+	total = (uint64_t)threads * lookups;
+	printf("%d threads, "CF_U64" lookups of %d opcodes:\n", threads,
+	       total, opc_num);
+	printf("  read lock: %10.0f us, %6.1f M lookups/s\n", locked_us,
+	       total / locked_us);
+	printf("  lock-free: %10.0f us, %6.1f M lookups/s\n", free_us,
+	       total / free_us);
+
+	crt_opc_map_destroy(crt_gdata.cg_opc_map);
+
+	return 0;
+}
@@ -0,0 +1,241 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * Micro-benchmark of the RPC timeout tracking structures: the timing wheel
+ * (crt_twheel) versus the bin heap (crt_binheap) it replaced. It simulates
+ * the RPC pattern, every "send" arms a timer and the "reply" cancels it,
+ * with a window of inflight RPCs. It also measures the per crt_progress cost
+ * of checking for expired timers when none is due, with the fine clock and
+ * the wheel lock versus the coarse clock and a cached next deadline.
+ *
+ * usage: crt_timeout_bench [inflight] [total]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include <crt_util/common.h>
+#include <crt_util/heap.h>
+#include <crt_util/wheel.h>
+
+#define BENCH_TICK_US		(1000)
+#define BENCH_TIMEOUT_US	(60 * 1000 * 1000)
+
+struct bench_timer {
+	struct crt_binheap_node	bt_bh_node;
+	struct crt_twheel_node	bt_tw_node;
+	uint64_t		bt_deadline;
+};
+
+static bool
+bench_bh_cmp(struct crt_binheap_node *a, struct crt_binheap_node *b)
+{
+	struct bench_timer	*ta, *tb;
+
+	ta = container_of(a, struct bench_timer, bt_bh_node);
+	tb = container_of(b, struct bench_timer, bt_bh_node);
+
+	return ta->bt_deadline < tb->bt_deadline;
+}
+
+static struct crt_binheap_ops bench_bh_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= bench_bh_cmp,
+};
+
+static double
+bench_binheap(struct bench_timer *timers, int inflight, int total)
+{
+	struct crt_binheap	 bh;
+	struct crt_binheap_node	*root;
+	struct timespec		 start, end;
+	uint64_t		 now = 0;
+	int			 i, rc;
+
+	rc = crt_binheap_create_inplace(CBH_FT_NOLOCK, inflight, NULL,
+					&bench_bh_ops, &bh);
+	assert(rc == 0);
+
+	crt_gettime(&start);
+	for (i = 0; i < total; i++) {
+		/* reply of the oldest inflight RPC */
+		if (i >= inflight)
+			crt_binheap_remove(&bh,
+				&timers[i % inflight].bt_bh_node);
+		now += 1;
+		timers[i % inflight].bt_deadline = now + BENCH_TIMEOUT_US;
+		rc = crt_binheap_insert(&bh, &timers[i % inflight].bt_bh_node);
+		assert(rc == 0);
+		/* the timeout check of every progress */
+		root = crt_binheap_root(&bh);
+		assert(root != NULL);
+	}
+	crt_gettime(&end);
+
+	crt_binheap_destroy_inplace(&bh);
+
+	return crt_time2us(crt_timediff(start, end));
+}
+
+static double
+bench_twheel(struct bench_timer *timers, int inflight, int total)
+{
+	struct crt_twheel	*tw;
+	crt_list_t		 expired;
+	struct timespec		 start, end;
+	uint64_t		 now = 0;
+	int			 i, rc;
+
+	C_ALLOC_PTR(tw);
+	assert(tw != NULL);
+	rc = crt_twheel_init(tw, BENCH_TICK_US, now);
+	assert(rc == 0);
+	CRT_INIT_LIST_HEAD(&expired);
+	for (i = 0; i < inflight; i++)
+		crt_twheel_node_init(&timers[i].bt_tw_node);
+
+	crt_gettime(&start);
+	for (i = 0; i < total; i++) {
+		if (i >= inflight)
+			crt_twheel_cancel(tw, &timers[i % inflight].bt_tw_node);
+		now += 1;
+		crt_twheel_arm(tw, &timers[i % inflight].bt_tw_node,
+			       now + BENCH_TIMEOUT_US);
+		rc = crt_twheel_expire(tw, now, &expired);
+		assert(rc == 0);
+	}
+	crt_gettime(&end);
+
+	C_FREE_PTR(tw);
+
+	return crt_time2us(crt_timediff(start, end));
+}
+
+static void
+bench_check(struct bench_timer *timers, int inflight, int total)
+{
+	struct crt_twheel	*tw;
+	pthread_mutex_t		 mutex;
+	crt_list_t		 expired;
+	struct timespec		 start, end;
+	uint64_t		 next;
+	double			 lock_us, cached_us;
+	int			 i, rc;
+
+	C_ALLOC_PTR(tw);
+	assert(tw != NULL);
+	rc = crt_twheel_init(tw, BENCH_TICK_US, crt_timeus_secdiff(0));
+	assert(rc == 0);
+	pthread_mutex_init(&mutex, NULL);
+	CRT_INIT_LIST_HEAD(&expired);
+	for (i = 0; i < inflight; i++) {
+		crt_twheel_node_init(&timers[i].bt_tw_node);
+		crt_twheel_arm(tw, &timers[i].bt_tw_node,
+			       crt_timeus_secdiff(60));
+	}
+
+	crt_gettime(&start);
+	for (i = 0; i < total; i++) {
+		pthread_mutex_lock(&mutex);
+		rc = crt_twheel_expire(tw, crt_timeus_secdiff(0), &expired);
+		pthread_mutex_unlock(&mutex);
+		assert(rc == 0);
+	}
+	crt_gettime(&end);
+	lock_us = crt_time2us(crt_timediff(start, end));
+
+	next = crt_twheel_next(tw);
+	crt_gettime(&start);
+	for (i = 0; i < total; i++) {
+		if (crt_timeus_coarse() < __atomic_load_n(&next,
+							  __ATOMIC_RELAXED))
+			continue;
+		pthread_mutex_lock(&mutex);
+		crt_twheel_expire(tw, crt_timeus_coarse(), &expired);
+		next = crt_twheel_next(tw);
+		pthread_mutex_unlock(&mutex);
+	}
+	crt_gettime(&end);
+	cached_us = crt_time2us(crt_timediff(start, end));
+
+	printf("%d empty timeout checks:\n", total);
+	printf("  clock + lock + expire: %8.1f ns per check\n",
+	       lock_us * 1000 / total);
+	printf("  coarse clock + cached: %8.1f ns per check\n",
+	       cached_us * 1000 / total);
+
+	pthread_mutex_destroy(&mutex);
+	C_FREE_PTR(tw);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_timer	*timers;
+	int			 inflight = 4096;
+	int			 total = 4 * 1024 * 1024;
+	double			 bh_us, tw_us;
+
+	if (argc > 1)
+		inflight = atoi(argv[1]);
+	if (argc > 2)
+		total = atoi(argv[2]);
+	if (inflight <= 0 || total < inflight) {
+		fprintf(stderr, "usage: %s [inflight] [total]\n", argv[0]);
+		return 1;
+	}
+
+	C_ALLOC(timers, inflight * sizeof(*timers));
+	assert(timers != NULL);
+
+	bh_us = bench_binheap(timers, inflight, total);
+	tw_us = bench_twheel(timers, inflight, total);
+
+	printf("%d timers inflight, %d arm/cancel pairs:\n", inflight, total);
+	printf("  binheap: %10.0f us, %8.1f ns per op\n", bh_us,
+	       bh_us * 1000 / total);
+	printf("  twheel:  %10.0f us, %8.1f ns per op\n", tw_us,
+	       tw_us * 1000 / total);
+
+	bench_check(timers, inflight, total);
+
+	C_FREE(timers, inflight * sizeof(*timers));
+
+	return 0;
+}
@@ -0,0 +1,255 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It checks that a forwarded corpc copying the
+ * input encoded once per hop (crt_rpc_priv::crp_co_body) puts the same bytes
+ * on the wire as encoding the input for each child. Built with UTEST_BENCH it
+ * times the CPU per hop of both for 4 KB and 64 KB bodies.
+ */
+#include <stdio.h>
+#include "utest_cmocka.h"
+#include <crt_internal.h>
+
+/* children of a hop */
+#define BENCH_FANOUT		(4)
+#define BENCH_NR_HOPS		(2000)
+#define BENCH_BUF_SIZE		(128 << 10)
+
+struct bench_body {
+	crt_rank_list_t		*bb_ranks;
+	uint32_t		 bb_seq;
+};
+
+static struct crt_msg_field *bench_body_fields[] = {
+	&CMF_RANK_LIST,		/* bb_ranks */
+	&CMF_UINT32,		/* bb_seq */
+};
+
+static struct crt_msg_field *bench_out_fields[] = {
+	&CMF_INT,
+};
+
+static struct crt_req_format CQF_BENCH_BODY =
+	DEFINE_CRT_REQ_FMT("BENCH_BODY", bench_body_fields, bench_out_fields);
+
+static na_class_t		*bench_na_class;
+static struct crt_context	 bench_ctx;
+static struct crt_opc_info	 bench_opc_info;
+static struct crt_rpc_priv	 bench_rpc;
+static struct bench_body	 bench_in;
+static void			*bench_bufs[BENCH_FANOUT];
+
+static int
+init_tests(void **state)
+{
+	int	i;
+
+	bench_na_class = NA_Initialize("cci+tcp://", false /* listen */);
+	assert_non_null(bench_na_class);
+	bench_ctx.cc_hg_ctx.chc_hgcla = HG_Init_na(bench_na_class);
+	assert_non_null(bench_ctx.cc_hg_ctx.chc_hgcla);
+
+	bench_opc_info.coi_crf = &CQF_BENCH_BODY;
+	bench_rpc.crp_opc_info = &bench_opc_info;
+	bench_rpc.crp_pub.cr_ctx = &bench_ctx;
+	bench_rpc.crp_pub.cr_input = &bench_in;
+	bench_rpc.crp_pub.cr_input_size = sizeof(bench_in);
+	bench_rpc.crp_flags = CRT_RPC_FLAG_COLL;
+	bench_rpc.crp_coreq_hdr.coh_int_grpid = 1;
+	for (i = 0; i < BENCH_FANOUT; i++) {
+		C_ALLOC(bench_bufs[i], BENCH_BUF_SIZE);
+		assert_non_null(bench_bufs[i]);
+	}
+
+	return 0;
+}
+
+static int
+fini_tests(void **state)
+{
+	int	i;
+
+	for (i = 0; i < BENCH_FANOUT; i++)
+		C_FREE(bench_bufs[i], BENCH_BUF_SIZE);
+	HG_Finalize(bench_ctx.cc_hg_ctx.chc_hgcla);
+	NA_Finalize(bench_na_class);
+
+	return 0;
+}
+
+static void
+bench_body_init(uint32_t nr)
+{
+	uint32_t	i;
+
+	bench_in.bb_seq = nr;
+	bench_in.bb_ranks = crt_rank_list_alloc(nr);
+	assert_non_null(bench_in.bb_ranks);
+	for (i = 0; i < nr; i++)
+		bench_in.bb_ranks->rl_ranks[i] = i * 7;
+}
+
+/* encode the request to one child as HG_Forward does, returns its size */
+static hg_size_t
+bench_encode_child(int child)
+{
+	hg_proc_t	proc;
+	hg_return_t	hg_ret;
+	hg_size_t	size;
+	int		rc;
+
+	hg_ret = hg_proc_create(bench_ctx.cc_hg_ctx.chc_hgcla,
+				bench_bufs[child], BENCH_BUF_SIZE, HG_ENCODE,
+				HG_NOHASH, &proc);
+	assert_int_equal(hg_ret, HG_SUCCESS);
+	rc = crt_proc_in_common(proc, &bench_rpc.crp_pub.cr_input);
+	assert_int_equal(rc, 0);
+	size = hg_proc_get_size_used(proc);
+	hg_proc_free(proc);
+
+	return size;
+}
+
+static void
+test_corpc_fwd_body(void **state)
+{
+	void		*expect;
+	void		*body;
+	crt_size_t	 body_size, body_len;
+	hg_size_t	 expect_size, size;
+	int		 rc;
+
+	bench_body_init(1000);
+	bench_rpc.crp_co_body = NULL;
+	expect_size = bench_encode_child(0);
+	C_ALLOC(expect, expect_size);
+	assert_non_null(expect);
+	memcpy(expect, bench_bufs[0], expect_size);
+
+	rc = crt_proc_input_encode(&bench_rpc, &body, &body_size, &body_len);
+	assert_int_equal(rc, 0);
+	assert_true(body_len > 1000 * sizeof(crt_rank_t));
+	bench_rpc.crp_co_body = body;
+	bench_rpc.crp_co_body_len = body_len;
+	size = bench_encode_child(1);
+	assert_int_equal(size, expect_size);
+	assert_memory_equal(bench_bufs[1], expect, expect_size);
+
+	bench_rpc.crp_co_body = NULL;
+	C_FREE(body, body_size);
+	C_FREE(expect, expect_size);
+	crt_rank_list_free(bench_in.bb_ranks);
+}
+
+#ifdef UTEST_BENCH
+static void
+bench_hops(const char *name, uint32_t nr)
+{
+	struct timespec	 t1, t2;
+	double		 per_child, root, forward;
+	void		*body;
+	crt_size_t	 body_size, body_len;
+	int		 i, j, rc;
+
+	bench_body_init(nr);
+
+	/* the input encoded for each child */
+	bench_rpc.crp_co_body = NULL;
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_HOPS; i++)
+		for (j = 0; j < BENCH_FANOUT; j++)
+			bench_encode_child(j);
+	crt_gettime(&t2);
+	per_child = crt_timediff_ns(&t1, &t2) / BENCH_NR_HOPS / 1000.0;
+
+	/* the root, encoded once and copied to each child */
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_HOPS; i++) {
+		rc = crt_proc_input_encode(&bench_rpc, &body, &body_size,
+					   &body_len);
+		assert_int_equal(rc, 0);
+		bench_rpc.crp_co_body = body;
+		bench_rpc.crp_co_body_len = body_len;
+		for (j = 0; j < BENCH_FANOUT; j++)
+			bench_encode_child(j);
+		bench_rpc.crp_co_body = NULL;
+		C_FREE(body, body_size);
+	}
+	crt_gettime(&t2);
+	root = crt_timediff_ns(&t1, &t2) / BENCH_NR_HOPS / 1000.0;
+
+	/* an intermediate rank, received encoded and copied to each child */
+	rc = crt_proc_input_encode(&bench_rpc, &body, &body_size, &body_len);
+	assert_int_equal(rc, 0);
+	bench_rpc.crp_co_body = body;
+	bench_rpc.crp_co_body_len = body_len;
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_HOPS; i++)
+		for (j = 0; j < BENCH_FANOUT; j++)
+			bench_encode_child(j);
+	crt_gettime(&t2);
+	forward = crt_timediff_ns(&t1, &t2) / BENCH_NR_HOPS / 1000.0;
+	bench_rpc.crp_co_body = NULL;
+	C_FREE(body, body_size);
+
+	printf("%-6s body, %d children: %8.2f us/hop encoded per child, "
+	       "%8.2f us/hop at root, %8.2f us/hop forwarded.\n", name,
+	       BENCH_FANOUT, per_child, root, forward);
+	crt_rank_list_free(bench_in.bb_ranks);
+}
+
+static void
+test_corpc_fwd_bench(void **state)
+{
+	bench_hops("4 KB", (4 << 10) / sizeof(crt_rank_t));
+	bench_hops("64 KB", (64 << 10) / sizeof(crt_rank_t));
+}
+#endif /* UTEST_BENCH */
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest	tests[] = {
+		cmocka_unit_test(test_corpc_fwd_body),
+#ifdef UTEST_BENCH
+		cmocka_unit_test(test_corpc_fwd_bench),
+#endif
+	};
+
+	return cmocka_run_group_tests(tests, init_tests, fini_tests);
+}
@@ -0,0 +1,366 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It checks the built-in reductions of collective
+ * RPC replies (struct crt_corpc_red) against a plain loop for every operator
+ * and type. Built with UTEST_BENCH, it also times them against the scalar
+ * co_aggregate callback users write for the same reduction.
+ */
+#include <stdio.h>
+#include <float.h>
+#include "utest_cmocka.h"
+#include <crt_internal.h>
+
+/* replies aggregated at once, as crt_corpc_aggregate does at most */
+#define BENCH_NR_SOURCES	(32)
+#define BENCH_NR_ELEMS		(4096)
+#define BENCH_NR_ROUNDS		(2000)
+/* elements of the check, covers the vector loop and the tail */
+#define CHECK_NR_ELEMS		(71)
+
+struct bench_out {
+	uint64_t	bo_bytes[BENCH_NR_ELEMS];
+	double		bo_lat[BENCH_NR_ELEMS];
+};
+
+static crt_rpc_t	 bench_sources[BENCH_NR_SOURCES];
+static crt_rpc_t	*bench_source_ptrs[BENCH_NR_SOURCES];
+static crt_rpc_t	 bench_result;
+/* elements reduced by the bench */
+static uint32_t		 bench_nr_elems;
+
+/*
+ * the outputs, one after another as from the RPC pool. Separate page aligned
+ * buffers would put the same field of all sources in the same cache sets.
+ */
+#define BENCH_OUT_STRIDE	(sizeof(struct bench_out) + 192)
+#define BENCH_OUTS_SIZE		((BENCH_NR_SOURCES + 1) * BENCH_OUT_STRIDE)
+
+static char		*bench_outputs;
+
+static int
+init_tests(void **state)
+{
+	int	i;
+
+	C_ALLOC(bench_outputs, BENCH_OUTS_SIZE);
+	assert_non_null(bench_outputs);
+	for (i = 0; i < BENCH_NR_SOURCES; i++) {
+		bench_sources[i].cr_output = bench_outputs +
+					     i * BENCH_OUT_STRIDE;
+		bench_sources[i].cr_output_size = sizeof(struct bench_out);
+		bench_source_ptrs[i] = &bench_sources[i];
+	}
+	bench_result.cr_output = bench_outputs + i * BENCH_OUT_STRIDE;
+	bench_result.cr_output_size = sizeof(struct bench_out);
+
+	return 0;
+}
+
+static int
+fini_tests(void **state)
+{
+	C_FREE(bench_outputs, BENCH_OUTS_SIZE);
+
+	return 0;
+}
+
+/* the reference, one element at a time */
+#define REF_RED(type, op, dst, src, count)				\
+	do {								\
+		type		*d = (type *)(dst);			\
+		const type	*s = (const type *)(src);		\
+		uint32_t	 k;					\
+									\
+		for (k = 0; k < (count); k++) {				\
+			switch (op) {					\
+			case CRT_RED_SUM:				\
+				d[k] = d[k] + s[k];			\
+				break;					\
+			case CRT_RED_MIN:				\
+				d[k] = s[k] < d[k] ? s[k] : d[k];	\
+				break;					\
+			case CRT_RED_MAX:				\
+				d[k] = s[k] > d[k] ? s[k] : d[k];	\
+				break;					\
+			default:					\
+				assert_true(0);				\
+			}						\
+		}							\
+	} while (0)
+
+#define REF_RED_INT(type, op, dst, src, count)				\
+	do {								\
+		type		*d = (type *)(dst);			\
+		const type	*s = (const type *)(src);		\
+		uint32_t	 k;					\
+									\
+		if ((op) == CRT_RED_MIN || (op) == CRT_RED_MAX) {	\
+			REF_RED(type, op, dst, src, count);		\
+			break;						\
+		}							\
+		for (k = 0; k < (count); k++) {				\
+			if ((op) == CRT_RED_SUM)			\
+				/* wraps around */			\
+				d[k] = (type)((uint64_t)d[k] +		\
+					      (uint64_t)s[k]);		\
+			else if ((op) == CRT_RED_BOR)			\
+				d[k] = d[k] | s[k];			\
+			else						\
+				d[k] = d[k] & s[k];			\
+		}							\
+	} while (0)
+
+static void
+ref_reduce(int op, int type, void *dst, const void *src, uint32_t count)
+{
+	switch (type) {
+	case CRT_RED_INT32:
+		REF_RED_INT(int32_t, op, dst, src, count);
+		break;
+	case CRT_RED_UINT32:
+		REF_RED_INT(uint32_t, op, dst, src, count);
+		break;
+	case CRT_RED_INT64:
+		REF_RED_INT(int64_t, op, dst, src, count);
+		break;
+	case CRT_RED_UINT64:
+		REF_RED_INT(uint64_t, op, dst, src, count);
+		break;
+	case CRT_RED_DOUBLE:
+		REF_RED(double, op, dst, src, count);
+		break;
+	}
+}
+
+/* random bytes, doubles in a sane range as sums are compared exactly */
+static void
+fill_random(void *buf, size_t size, int type)
+{
+	size_t	i;
+
+	if (type == CRT_RED_DOUBLE) {
+		for (i = 0; i < size / sizeof(double); i++)
+			((double *)buf)[i] = (double)(random() % 2001 - 1000);
+		return;
+	}
+	for (i = 0; i < size; i++)
+		((unsigned char *)buf)[i] = random();
+}
+
+static void
+test_corpc_red_check(void **state)
+{
+	unsigned char	 expect[CHECK_NR_ELEMS * sizeof(uint64_t)];
+	unsigned char	*result = bench_result.cr_output;
+	int		 op, type, i;
+	int		 rc;
+
+	for (op = CRT_RED_OP_MIN; op <= CRT_RED_OP_MAX; op++) {
+		for (type = CRT_RED_TYPE_MIN; type <= CRT_RED_TYPE_MAX;
+		     type++) {
+			/* a field not aligned to the vector size */
+			struct crt_corpc_red	 red = {
+				.cr_op		= op,
+				.cr_type	= type,
+				.cr_offset	= sizeof(uint64_t),
+				.cr_count	= CHECK_NR_ELEMS,
+			};
+			struct crt_corpc_ops	 co_ops = {
+				.co_reds	= &red,
+				.co_red_nr	= 1,
+			};
+
+			rc = crt_corpc_red_check(&co_ops,
+						 sizeof(struct bench_out));
+			if (type == CRT_RED_DOUBLE &&
+			    (op == CRT_RED_BOR || op == CRT_RED_BAND)) {
+				assert_int_equal(rc, -CER_INVAL);
+				continue;
+			}
+			assert_int_equal(rc, 0);
+
+			fill_random(result, sizeof(struct bench_out), type);
+			for (i = 0; i < BENCH_NR_SOURCES; i++)
+				fill_random(bench_sources[i].cr_output,
+					    sizeof(struct bench_out), type);
+			memcpy(expect, result + red.cr_offset, sizeof(expect));
+			for (i = 0; i < BENCH_NR_SOURCES; i++)
+				ref_reduce(op, type, expect,
+					   (unsigned char *)
+					   bench_sources[i].cr_output +
+					   red.cr_offset, red.cr_count);
+
+			crt_corpc_reduce(&red, 1, bench_source_ptrs,
+					 BENCH_NR_SOURCES, &bench_result);
+			assert_memory_equal(result + red.cr_offset, expect,
+				red.cr_count * (type == CRT_RED_INT32 ||
+				type == CRT_RED_UINT32 ? 4 : 8));
+		}
+	}
+}
+
+static void
+test_corpc_red_invalid(void **state)
+{
+	struct crt_corpc_red	 red = CRT_CORPC_RED(CRT_RED_SUM,
+						     CRT_RED_UINT64,
+						     struct bench_out, bo_lat,
+						     BENCH_NR_ELEMS);
+	struct crt_corpc_ops	 co_ops = {
+		.co_reds	= &red,
+		.co_red_nr	= 1,
+	};
+
+	assert_int_equal(crt_corpc_red_check(&co_ops,
+					     sizeof(struct bench_out)), 0);
+	/* beyond the output struct */
+	red.cr_count++;
+	assert_int_equal(crt_corpc_red_check(&co_ops,
+					     sizeof(struct bench_out)),
+			 -CER_INVAL);
+	red.cr_count--;
+	red.cr_op = CRT_RED_OP_MAX + 1;
+	assert_int_equal(crt_corpc_red_check(&co_ops,
+					     sizeof(struct bench_out)),
+			 -CER_INVAL);
+	red.cr_op = CRT_RED_SUM;
+	red.cr_type = CRT_RED_TYPE_INVALID;
+	assert_int_equal(crt_corpc_red_check(&co_ops,
+					     sizeof(struct bench_out)),
+			 -CER_INVAL);
+}
+
+#ifdef UTEST_BENCH
+/* what the corpc users write for the reductions below */
+static int
+bench_scalar_aggregate(crt_rpc_t *source, crt_rpc_t *result, void *priv)
+{
+	struct bench_out	*out_source = source->cr_output;
+	struct bench_out	*out_result = result->cr_output;
+	uint32_t		 i;
+
+	for (i = 0; i < bench_nr_elems; i++) {
+		out_result->bo_bytes[i] += out_source->bo_bytes[i];
+		if (out_source->bo_lat[i] > out_result->bo_lat[i])
+			out_result->bo_lat[i] = out_source->bo_lat[i];
+	}
+
+	return 0;
+}
+
+/* called through the ops table as crt_corpc_aggregate does, not inlined */
+struct crt_corpc_ops bench_scalar_ops = {
+	.co_aggregate = bench_scalar_aggregate,
+};
+
+static void
+bench_reduce(uint32_t nr_elems)
+{
+	struct crt_corpc_red	 reds[] = {
+		CRT_CORPC_RED(CRT_RED_SUM, CRT_RED_UINT64, struct bench_out,
+			      bo_bytes, nr_elems),
+		CRT_CORPC_RED(CRT_RED_MAX, CRT_RED_DOUBLE, struct bench_out,
+			      bo_lat, nr_elems),
+	};
+	struct crt_corpc_ops	 co_ops = {
+		.co_reds	= reds,
+		.co_red_nr	= ARRAY_SIZE(reds),
+	};
+	struct bench_out	*expect;
+	struct timespec		 t1, t2;
+	double			 scalar, builtin;
+	int			 i, j;
+
+	bench_nr_elems = nr_elems;
+	assert_int_equal(crt_corpc_red_check(&co_ops,
+					     sizeof(struct bench_out)), 0);
+	for (i = 0; i < BENCH_NR_SOURCES; i++)
+		fill_random(bench_sources[i].cr_output,
+			    sizeof(struct bench_out), CRT_RED_DOUBLE);
+	memset(bench_result.cr_output, 0, sizeof(struct bench_out));
+
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_ROUNDS; i++)
+		for (j = 0; j < BENCH_NR_SOURCES; j++)
+			bench_scalar_ops.co_aggregate(bench_source_ptrs[j],
+						      &bench_result, NULL);
+	crt_gettime(&t2);
+	scalar = crt_timediff_ns(&t1, &t2) / BENCH_NR_ROUNDS / 1000.0;
+
+	C_ALLOC_PTR(expect);
+	assert_non_null(expect);
+	memcpy(expect, bench_result.cr_output, sizeof(*expect));
+	memset(bench_result.cr_output, 0, sizeof(struct bench_out));
+
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_ROUNDS; i++)
+		crt_corpc_reduce(reds, ARRAY_SIZE(reds), bench_source_ptrs,
+				 BENCH_NR_SOURCES, &bench_result);
+	crt_gettime(&t2);
+	builtin = crt_timediff_ns(&t1, &t2) / BENCH_NR_ROUNDS / 1000.0;
+	assert_memory_equal(bench_result.cr_output, expect, sizeof(*expect));
+	C_FREE_PTR(expect);
+
+	printf("%d replies of %4d uint64 sums and double maxes: %8.2f us "
+	       "scalar callback, %8.2f us built-in.\n", BENCH_NR_SOURCES,
+	       nr_elems, scalar, builtin);
+}
+
+static void
+test_corpc_red_bench(void **state)
+{
+	/* in L1, then beyond L2 */
+	bench_reduce(64);
+	bench_reduce(BENCH_NR_ELEMS);
+}
+#endif /* UTEST_BENCH */
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest	tests[] = {
+		cmocka_unit_test(test_corpc_red_check),
+		cmocka_unit_test(test_corpc_red_invalid),
+#ifdef UTEST_BENCH
+		cmocka_unit_test(test_corpc_red_bench),
+#endif
+	};
+
+	return cmocka_run_group_tests(tests, init_tests, fini_tests);
+}
@@ -0,0 +1,157 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It checks the per-context endpoint index
+ * (crt_epi_insert, crt_epi_lookup) against the inserted endpoints. Built
+ * with UTEST_BENCH, it times the inserts, hits and misses with 10, 1k and 100k
+ * endpoints.
+ */
+#include <stdio.h>
+#include "utest_cmocka.h"
+#include <crt_internal.h>
+
+/* endpoints are spread over this many tags of each rank */
+#define BENCH_NR_TAGS		(4)
+#define BENCH_NR_LOOKUPS	(1000000)
+
+static void
+bench_ep(uint32_t i, crt_endpoint_t *ep)
+{
+	ep->ep_grp = NULL;
+	ep->ep_rank = i / BENCH_NR_TAGS;
+	ep->ep_tag = i % BENCH_NR_TAGS;
+}
+
+static void
+bench_index(uint32_t nr)
+{
+	struct crt_context	 ctx;
+	struct crt_ep_inflight	*epis;
+	crt_endpoint_t		 ep;
+	struct timespec		 t1, t2;
+	double			 insert;
+	uint32_t		 i;
+	int			 rc;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.cc_epi_table = crt_epi_table_alloc(1U << CRT_EPI_TABLE_BITS);
+	assert_non_null(ctx.cc_epi_table);
+	C_ALLOC(epis, nr * sizeof(*epis));
+	assert_non_null(epis);
+
+	crt_gettime(&t1);
+	for (i = 0; i < nr; i++) {
+		bench_ep(i, &epis[i].epi_ep);
+		epis[i].epi_ctx = &ctx;
+		rc = crt_epi_insert(&ctx, &epis[i]);
+		assert_int_equal(rc, 0);
+	}
+	crt_gettime(&t2);
+	insert = crt_timediff_ns(&t1, &t2) / nr;
+	assert_int_equal(ctx.cc_epi_num, nr);
+	assert_true(ctx.cc_epi_table->et_cap >= 2 * nr);
+
+	/* every endpoint is found, none of another rank, tag or group */
+	for (i = 0; i < nr; i++) {
+		bench_ep(i, &ep);
+		assert_ptr_equal(crt_epi_lookup(&ctx, &ep), &epis[i]);
+		ep.ep_rank += nr;
+		assert_null(crt_epi_lookup(&ctx, &ep));
+		ep.ep_rank -= nr;
+		ep.ep_tag += BENCH_NR_TAGS;
+		assert_null(crt_epi_lookup(&ctx, &ep));
+		ep.ep_tag -= BENCH_NR_TAGS;
+		ep.ep_grp = (crt_group_t *)&ctx;
+		assert_null(crt_epi_lookup(&ctx, &ep));
+	}
+
+#ifdef UTEST_BENCH
+	{
+		struct crt_ep_inflight	*epi;
+		double			 hit, miss;
+
+		crt_gettime(&t1);
+		for (i = 0; i < BENCH_NR_LOOKUPS; i++) {
+			bench_ep((i * 7919) % nr, &ep);
+			epi = crt_epi_lookup(&ctx, &ep);
+			assert_non_null(epi);
+		}
+		crt_gettime(&t2);
+		hit = crt_timediff_ns(&t1, &t2) / BENCH_NR_LOOKUPS;
+
+		crt_gettime(&t1);
+		for (i = 0; i < BENCH_NR_LOOKUPS; i++) {
+			bench_ep((i * 7919) % nr, &ep);
+			ep.ep_rank += nr;
+			epi = crt_epi_lookup(&ctx, &ep);
+			assert_null(epi);
+		}
+		crt_gettime(&t2);
+		miss = crt_timediff_ns(&t1, &t2) / BENCH_NR_LOOKUPS;
+
+		printf("%6d endpoints, %6d slots: %8.1f ns/insert, "
+		       "%6.1f ns/hit, %6.1f ns/miss.\n", nr,
+		       ctx.cc_epi_table->et_cap, insert, hit, miss);
+	}
+#else
+	(void)insert;
+#endif
+
+	crt_epi_table_free(ctx.cc_epi_table);
+	C_FREE(epis, nr * sizeof(*epis));
+}
+
+static void
+test_epi_index(void **state)
+{
+	bench_index(10);
+	bench_index(1000);
+#ifdef UTEST_BENCH
+	bench_index(100000);
+#endif
+}
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest	tests[] = {
+		cmocka_unit_test(test_epi_index),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,334 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It simulates the startup of a client fanning
+ * out to every tag of a 1k-rank group, with a loopback stand-in of
+ * HG_Addr_lookup wrapped by --wrap: each round trip completes the lookups in
+ * flight at its start. The round trips to the first full fan-out are counted
+ * for endpoints connected one at a time, as the first RPC to each of them
+ * did, and for crt_group_connect. Built with UTEST_BENCH it also times the
+ * CPU spent per endpoint by crt_group_connect.
+ */
+#include <stdio.h>
+#include "utest_cmocka.h"
+#include <crt_internal.h>
+
+#define BENCH_GRP_SIZE		(1024)
+#define BENCH_NR_TAGS		(4)
+#define BENCH_NR_PAIRS		(BENCH_GRP_SIZE * BENCH_NR_TAGS)
+/* simulated round trip of one address lookup, only used for the report */
+#define BENCH_RTT_US		(100)
+
+/* a lookup in flight */
+struct bench_lookup {
+	hg_cb_t		 bl_cb;
+	void		*bl_arg;
+};
+
+static struct bench_lookup	 bench_inflight[BENCH_NR_PAIRS];
+static struct bench_lookup	 bench_done[BENCH_NR_PAIRS];
+static uint32_t			 bench_nr_inflight;
+static uint32_t			 bench_max_inflight;
+static uint32_t			 bench_nr_lookup;
+/* the connected address of every endpoint */
+static int			 bench_addr;
+
+static struct crt_grp_gdata	 bench_grp_gdata;
+static struct crt_grp_priv	 bench_grp;
+static struct crt_context	 bench_ctx;
+static uint32_t			 bench_tags[BENCH_NR_TAGS];
+
+hg_return_t
+__wrap_HG_Addr_lookup(hg_context_t *context, hg_cb_t callback, void *arg,
+		      const char *name, hg_op_id_t *op_id)
+{
+	assert_int_equal(strncmp(name, "tcp://", 6), 0);
+	assert_true(bench_nr_inflight < BENCH_NR_PAIRS);
+
+	bench_inflight[bench_nr_inflight].bl_cb = callback;
+	bench_inflight[bench_nr_inflight].bl_arg = arg;
+	bench_nr_inflight++;
+	bench_max_inflight = max(bench_max_inflight, bench_nr_inflight);
+	bench_nr_lookup++;
+
+	return HG_SUCCESS;
+}
+
+hg_return_t
+__wrap_HG_Addr_free(hg_class_t *hg_class, hg_addr_t addr)
+{
+	assert_ptr_equal((void *)addr, (void *)&bench_addr);
+	return HG_SUCCESS;
+}
+
+/*
+ * one simulated round trip, completes the lookups in flight at its start.
+ * The lookups issued by their callbacks complete in the next one.
+ */
+static void
+bench_round(void)
+{
+	struct hg_cb_info	cb_info;
+	uint32_t		nr = bench_nr_inflight;
+	uint32_t		i;
+
+	memcpy(bench_done, bench_inflight, nr * sizeof(bench_done[0]));
+	bench_nr_inflight = 0;
+	for (i = 0; i < nr; i++) {
+		memset(&cb_info, 0, sizeof(cb_info));
+		cb_info.arg = bench_done[i].bl_arg;
+		cb_info.ret = HG_SUCCESS;
+		cb_info.type = HG_CB_LOOKUP;
+		cb_info.info.lookup.addr = (hg_addr_t)&bench_addr;
+		bench_done[i].bl_cb(&cb_info);
+	}
+}
+
+static int
+bench_connect_cb(crt_group_t *grp, void *arg, int status)
+{
+	assert_int_equal(status, 0);
+	*(int *)arg = 1;
+
+	return 0;
+}
+
+/* round trips until crt_group_connect of \a ranks and \a tags completes */
+static uint32_t
+bench_connect(crt_rank_list_t *ranks, uint32_t *tags, uint32_t tag_num)
+{
+	uint32_t	rounds = 0;
+	int		done = 0;
+	int		rc;
+
+	rc = crt_group_connect(&bench_ctx, &bench_grp.gp_pub, ranks, tags,
+			       tag_num, bench_connect_cb, &done);
+	assert_int_equal(rc, 0);
+	while (!done) {
+		assert_true(bench_nr_inflight > 0);
+		bench_round();
+		rounds++;
+	}
+	assert_int_equal(bench_nr_inflight, 0);
+
+	return rounds;
+}
+
+/* the first full fan-out finds every address cached, it takes one round */
+static uint32_t
+bench_fanout(void)
+{
+	na_addr_t	addr;
+	crt_rank_t	rank;
+	uint32_t	i;
+	int		rc;
+
+	for (rank = 0; rank < BENCH_GRP_SIZE; rank++) {
+		for (i = 0; i < BENCH_NR_TAGS; i++) {
+			rc = crt_grp_lc_addr_get(&bench_grp, bench_ctx.cc_idx,
+						 rank, bench_tags[i], NULL,
+						 &addr);
+			assert_int_equal(rc, 0);
+			assert_ptr_equal((void *)addr, (void *)&bench_addr);
+		}
+	}
+
+	return 1;
+}
+
+static void
+bench_reset(void)
+{
+	crt_grp_lc_ctx_purge(&bench_ctx);
+	bench_max_inflight = 0;
+	bench_nr_lookup = 0;
+}
+
+static int
+init_tests(void **state)
+{
+	struct crt_lookup_item	*li;
+	char			 uri[CRT_ADDR_STR_MAX_LEN];
+	crt_rank_t		 rank;
+	uint32_t		 i;
+
+	bench_grp.gp_pub.cg_grpid = (char *)"bench_srv";
+	bench_grp.gp_primary = 1;
+	bench_grp.gp_local = 1;
+	bench_grp.gp_size = BENCH_GRP_SIZE;
+	pthread_mutex_init(&bench_grp.gp_lc_mutex, NULL);
+	CRT_INIT_LIST_HEAD(&bench_grp.gp_lc_lru);
+	CRT_INIT_LIST_HEAD(&bench_grp.gp_uri_waiters);
+	C_ALLOC(bench_grp.gp_lookup_cache,
+		BENCH_GRP_SIZE * sizeof(struct crt_lookup_item));
+	assert_non_null(bench_grp.gp_lookup_cache);
+	/* the URIs are known, as collected by the startup fence */
+	for (rank = 0; rank < BENCH_GRP_SIZE; rank++) {
+		li = &bench_grp.gp_lookup_cache[rank];
+		snprintf(uri, sizeof(uri), "tcp://10.0.%d.%d:31416",
+			 rank / 256, rank % 256);
+		li->li_base_phy_addr = strdup(uri);
+		assert_non_null(li->li_base_phy_addr);
+	}
+
+	/* crt_grp_lc_ctx_purge walks the primary groups */
+	CRT_INIT_LIST_HEAD(&bench_grp_gdata.gg_srv_grps_attached);
+	pthread_rwlock_init(&bench_grp_gdata.gg_rwlock, NULL);
+	bench_grp_gdata.gg_srv_pri_grp = &bench_grp;
+	crt_gdata.cg_grp = &bench_grp_gdata;
+
+	bench_ctx.cc_idx = 0;
+	CRT_INIT_LIST_HEAD(&bench_ctx.cc_addr_pend_list);
+	bench_ctx.cc_addr_pend_next = UINT64_MAX;
+	pthread_mutex_init(&bench_ctx.cc_addr_mutex, NULL);
+
+	for (i = 0; i < BENCH_NR_TAGS; i++)
+		bench_tags[i] = i;
+
+	return 0;
+}
+
+static int
+fini_tests(void **state)
+{
+	struct crt_lookup_item	*li;
+	struct crt_lc_addrs	*addrs, *prev;
+	crt_rank_t		 rank;
+
+	crt_grp_lc_ctx_purge(&bench_ctx);
+	crt_gdata.cg_grp = NULL;
+	for (rank = 0; rank < BENCH_GRP_SIZE; rank++) {
+		li = &bench_grp.gp_lookup_cache[rank];
+		free(li->li_base_phy_addr);
+		for (addrs = li->li_addrs; addrs != NULL; addrs = prev) {
+			prev = addrs->la_prev;
+			free(addrs);
+		}
+	}
+	C_FREE(bench_grp.gp_lookup_cache,
+	       BENCH_GRP_SIZE * sizeof(struct crt_lookup_item));
+	pthread_mutex_destroy(&bench_grp.gp_lc_mutex);
+	pthread_mutex_destroy(&bench_ctx.cc_addr_mutex);
+	pthread_rwlock_destroy(&bench_grp_gdata.gg_rwlock);
+
+	return 0;
+}
+
+/* the first RPC to each endpoint resolved it before the next one */
+static void
+test_connect_serial(void **state)
+{
+	crt_rank_list_t	*one;
+	uint32_t	 rounds = 0;
+	uint32_t	 i;
+
+	bench_reset();
+	one = crt_rank_list_alloc(1);
+	assert_non_null(one);
+	for (one->rl_ranks[0] = 0; one->rl_ranks[0] < BENCH_GRP_SIZE;
+	     one->rl_ranks[0]++) {
+		for (i = 0; i < BENCH_NR_TAGS; i++)
+			rounds += bench_connect(one, &bench_tags[i], 1);
+	}
+	crt_rank_list_free(one);
+	rounds += bench_fanout();
+
+	printf("%d ranks x %d tags, one at a time: %d round trips to the "
+	       "first full fan-out, %.1f ms at %d us each.\n", BENCH_GRP_SIZE,
+	       BENCH_NR_TAGS, rounds, rounds * BENCH_RTT_US / 1e3,
+	       BENCH_RTT_US);
+	assert_int_equal(rounds, BENCH_NR_PAIRS + 1);
+	assert_int_equal(bench_max_inflight, 1);
+	assert_int_equal(bench_nr_lookup, BENCH_NR_PAIRS);
+}
+
+static void
+test_connect_window(void **state)
+{
+	uint32_t	rounds;
+#ifdef UTEST_BENCH
+	struct timespec	t1, t2;
+#endif
+
+	bench_reset();
+#ifdef UTEST_BENCH
+	crt_gettime(&t1);
+#endif
+	rounds = bench_connect(NULL /* all ranks */, bench_tags,
+			       BENCH_NR_TAGS);
+#ifdef UTEST_BENCH
+	crt_gettime(&t2);
+	printf("crt_group_connect CPU per endpoint: %.3f us.\n",
+	       crt_timediff_ns(&t1, &t2) / 1e3 / BENCH_NR_PAIRS);
+#endif
+	rounds += bench_fanout();
+
+	printf("%d ranks x %d tags, crt_group_connect: %d round trips to the "
+	       "first full fan-out, %.1f ms at %d us each.\n", BENCH_GRP_SIZE,
+	       BENCH_NR_TAGS, rounds, rounds * BENCH_RTT_US / 1e3,
+	       BENCH_RTT_US);
+	/* the window stays full until the last lookups */
+	assert_int_equal(rounds, BENCH_NR_PAIRS / CRT_GROUP_CONNECT_WINDOW + 1);
+	assert_int_equal(bench_max_inflight, CRT_GROUP_CONNECT_WINDOW);
+	assert_int_equal(bench_nr_lookup, BENCH_NR_PAIRS);
+
+	/* connected endpoints complete in place, without any lookup */
+	bench_nr_lookup = 0;
+	rounds = bench_connect(NULL /* all ranks */, bench_tags,
+			       BENCH_NR_TAGS);
+	assert_int_equal(rounds, 0);
+	assert_int_equal(bench_nr_lookup, 0);
+}
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest	tests[] = {
+		cmocka_unit_test(test_connect_serial),
+		cmocka_unit_test(test_connect_window),
+	};
+	int			rc;
+
+	rc = crt_debug_init();
+	if (rc != 0)
+		return rc;
+	rc = cmocka_run_group_tests(tests, init_tests, fini_tests);
+	crt_debug_fini();
+
+	return rc;
+}
@@ -0,0 +1,220 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It benchmarks the startup rank assignment
+ * (crt_pmix_assign_rank) with a PMIx stand-in wrapped by --wrap, counting
+ * the PMIx calls made by one process of a 1k universe, or of universes
+ * growing up to 64k when built with UTEST_BENCH. The URIs collected by the
+ * same fence are then read by crt_pmix_uri_get.
+ */
+#include <stdio.h>
+#include "utest_cmocka.h"
+#include <crt_internal.h>
+
+/* universe is a server set followed by a client set of the same size */
+#define BENCH_SRV_GRPID		"bench_srv"
+#define BENCH_CLI_GRPID		"bench_cli"
+#define BENCH_URI_FMT		"bench://%u"
+#define BENCH_MIN_UNIV		(1024)
+#ifdef UTEST_BENCH
+#define BENCH_MAX_UNIV		(65536)
+#else
+#define BENCH_MAX_UNIV		BENCH_MIN_UNIV
+#endif
+
+static uint32_t	bench_univ_size;
+static int	bench_nr_put;
+static int	bench_nr_fence;
+static int	bench_nr_get;
+static int	bench_nr_lookup;
+
+int
+__wrap_PMIx_Put(pmix_scope_t scope, const char key[], pmix_value_t *val)
+{
+	bench_nr_put++;
+	assert_int_equal(val->type, PMIX_STRING);
+	return PMIX_SUCCESS;
+}
+
+int
+__wrap_PMIx_Commit(void)
+{
+	return PMIX_SUCCESS;
+}
+
+int
+__wrap_PMIx_Fence(const pmix_proc_t procs[], size_t nprocs,
+		  const pmix_info_t info[], size_t ninfo)
+{
+	bench_nr_fence++;
+	return PMIX_SUCCESS;
+}
+
+int
+__wrap_PMIx_Get(const pmix_proc_t *proc, const char key[],
+		const pmix_info_t info[], size_t ninfo,
+		pmix_value_t **val)
+{
+	char	uri[32];
+
+	bench_nr_get++;
+	assert_true(proc->rank < bench_univ_size);
+
+	*val = (pmix_value_t *)calloc(sizeof(pmix_value_t), 1);
+	assert_non_null(*val);
+	(*val)->type = PMIX_STRING;
+	if (strcmp(key, CRT_PMIX_URI_KEY) == 0) {
+		/* only read from the client's cache */
+		assert_int_equal(ninfo, 1);
+		assert_string_equal(info[0].key, PMIX_IMMEDIATE);
+		snprintf(uri, sizeof(uri), BENCH_URI_FMT, proc->rank);
+		(*val)->data.string = strdup(uri);
+	} else {
+		assert_string_equal(key, CRT_PMIX_PSNAME_KEY);
+		(*val)->data.string =
+			strdup(proc->rank < bench_univ_size / 2 ?
+			       BENCH_SRV_GRPID : BENCH_CLI_GRPID);
+	}
+	assert_non_null((*val)->data.string);
+
+	return PMIX_SUCCESS;
+}
+
+int
+__wrap_PMIx_Lookup(pmix_pdata_t data[], size_t ndata,
+		   const pmix_info_t info[], size_t ninfo)
+{
+	bench_nr_lookup++;
+	return PMIX_ERR_NOT_FOUND;
+}
+
+static void
+bench_assign_rank(uint32_t univ_size)
+{
+	struct crt_grp_gdata	grp_gdata;
+	struct crt_pmix_gdata	pmix_gdata;
+	struct crt_grp_priv	grp_priv;
+	struct timespec		t1, t2;
+	crt_rank_t		myrank = univ_size / 4;
+	char			expect[32];
+	char			*uri = NULL;
+	int			rc;
+
+	memset(&grp_gdata, 0, sizeof(grp_gdata));
+	memset(&pmix_gdata, 0, sizeof(pmix_gdata));
+	memset(&grp_priv, 0, sizeof(grp_priv));
+	strncpy(pmix_gdata.pg_proc.nspace, "bench", PMIX_MAX_NSLEN);
+	pmix_gdata.pg_proc.rank = myrank;
+	pmix_gdata.pg_univ_size = univ_size;
+	grp_gdata.gg_pmix = &pmix_gdata;
+	crt_gdata.cg_grp = &grp_gdata;
+
+	grp_priv.gp_pub.cg_grpid = (char *)BENCH_SRV_GRPID;
+	grp_priv.gp_rank_map = (struct crt_rank_map *)
+		calloc(univ_size, sizeof(struct crt_rank_map));
+	assert_non_null(grp_priv.gp_rank_map);
+	grp_priv.gp_pmix_ranks = (uint32_t *)calloc(univ_size,
+						    sizeof(uint32_t));
+	assert_non_null(grp_priv.gp_pmix_ranks);
+	crt_gdata.cg_addr = (char *)"bench://self";
+
+	bench_univ_size = univ_size;
+	bench_nr_put = bench_nr_fence = bench_nr_get = bench_nr_lookup = 0;
+
+	crt_gettime(&t1);
+	rc = crt_pmix_assign_rank(&grp_priv);
+	crt_gettime(&t2);
+	assert_int_equal(rc, 0);
+
+	printf("universe %6d: %8.3f ms, %d put, %d fence, %d get, "
+	       "%d lookup.\n", univ_size,
+	       crt_timediff_ns(&t1, &t2) / 1e6, bench_nr_put, bench_nr_fence,
+	       bench_nr_get, bench_nr_lookup);
+
+	/* one collective exchange, no blocking lookup per process */
+	assert_int_equal(bench_nr_put, 2);
+	assert_int_equal(bench_nr_fence, 1);
+	assert_int_equal(bench_nr_lookup, 0);
+	assert_int_equal(bench_nr_get, univ_size);
+	assert_int_equal(grp_priv.gp_size, univ_size / 2);
+	assert_int_equal(grp_priv.gp_self, myrank);
+	assert_int_equal(grp_priv.gp_rank_map[univ_size - 1].rm_status,
+			 CRT_RANK_NOENT);
+
+	/* the URI of the last rank, from the fence data */
+	rc = crt_pmix_uri_get(&grp_priv, grp_priv.gp_size - 1, &uri);
+	assert_int_equal(rc, 0);
+	snprintf(expect, sizeof(expect), BENCH_URI_FMT, univ_size / 2 - 1);
+	assert_string_equal(uri, expect);
+	assert_int_equal(bench_nr_lookup, 0);
+	free(uri);
+
+	free(grp_priv.gp_pmix_ranks);
+	free(grp_priv.gp_rank_map);
+	crt_gdata.cg_addr = NULL;
+	crt_gdata.cg_grp = NULL;
+}
+
+static void
+test_assign_rank(void **state)
+{
+	uint32_t	univ_size;
+
+	(void)state;
+
+	for (univ_size = BENCH_MIN_UNIV; univ_size <= BENCH_MAX_UNIV;
+	     univ_size *= 4)
+		bench_assign_rank(univ_size);
+}
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest	tests[] = {
+		cmocka_unit_test(test_assign_rank),
+	};
+	int			rc;
+
+	rc = crt_debug_init();
+	if (rc != 0)
+		return rc;
+	rc = cmocka_run_group_tests(tests, NULL, NULL);
+	crt_debug_fini();
+
+	return rc;
+}
@@ -0,0 +1,261 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It checks the rank list set operations
+ * (crt_rank_list_dup_sort_uniq, crt_rank_list_filter, crt_rank_set) against
+ * a plain scan. The UTEST_BENCH build also times them on groups of 100k ranks.
+ */
+#include <stdio.h>
+#include "utest_cmocka.h"
+#include "crt_util/common.h"
+
+#define BENCH_NR_RANKS		(100000)
+#define BENCH_NR_EXCLUDED	(10000)
+
+/* the O(n * m) filter, as reference */
+static void
+ref_filter(crt_rank_list_t *src_set, crt_rank_list_t *dst_set, bool exclude)
+{
+	uint32_t	i, j;
+
+	for (i = 0, j = 0; i < dst_set->rl_nr.num; i++) {
+		if (crt_rank_in_rank_list(src_set, dst_set->rl_ranks[i],
+					  true /* input */) == exclude)
+			continue;
+		dst_set->rl_ranks[j++] = dst_set->rl_ranks[i];
+	}
+	dst_set->rl_nr.num = j;
+}
+
+/* nr random ranks below max, with duplicates */
+static crt_rank_list_t *
+random_ranks(uint32_t nr, uint32_t max)
+{
+	crt_rank_list_t	*list;
+	uint32_t	 i;
+
+	list = crt_rank_list_alloc(nr);
+	assert_non_null(list);
+	for (i = 0; i < nr; i++)
+		list->rl_ranks[i] = random() % max;
+
+	return list;
+}
+
+static void
+check_filter(crt_rank_list_t *src_set, crt_rank_list_t *dst_set, bool exclude)
+{
+	crt_rank_list_t	*result, *expect;
+	int		 rc;
+
+	rc = crt_rank_list_dup(&result, dst_set, true /* input */);
+	assert_int_equal(rc, 0);
+	rc = crt_rank_list_dup(&expect, dst_set, true /* input */);
+	assert_int_equal(rc, 0);
+
+	crt_rank_list_filter(src_set, result, true /* input */, exclude);
+	ref_filter(src_set, expect, exclude);
+	assert_int_equal(result->rl_nr.num, expect->rl_nr.num);
+	assert_memory_equal(result->rl_ranks, expect->rl_ranks,
+			    expect->rl_nr.num * sizeof(crt_rank_t));
+
+	crt_rank_list_free(result);
+	crt_rank_list_free(expect);
+}
+
+static void
+test_rank_set(void **state)
+{
+	crt_rank_list_t		*list, *sorted;
+	crt_rank_list_t		*sparse, *dense;
+	struct crt_rank_set	 set;
+	uint32_t		 i, idx;
+	int			 rc;
+
+	(void)state;
+	srandom(1);
+
+	/* sorted and unique */
+	list = random_ranks(1000, 500);
+	rc = crt_rank_list_dup_sort_uniq(&sorted, list, true /* input */);
+	assert_int_equal(rc, 0);
+	for (i = 1; i < sorted->rl_nr.num; i++)
+		assert_true(sorted->rl_ranks[i - 1] < sorted->rl_ranks[i]);
+	for (i = 0; i < list->rl_nr.num; i++)
+		assert_true(crt_rank_in_rank_list(sorted, list->rl_ranks[i],
+						  true /* input */));
+	for (i = 0; i < sorted->rl_nr.num; i++) {
+		rc = crt_idx_in_sorted_rank_list(sorted, sorted->rl_ranks[i],
+						 &idx, true /* input */);
+		assert_int_equal(rc, 0);
+		assert_int_equal(idx, i);
+	}
+	rc = crt_idx_in_sorted_rank_list(sorted, 500, &idx, true /* input */);
+	assert_int_equal(rc, -CER_OOG);
+
+	/* the set with and without bitmap agrees with a plain scan */
+	dense = random_ranks(200, 400);
+	sparse = random_ranks(200, 1 << 30);
+	rc = crt_rank_set_init(&set, dense, true /* input */);
+	assert_int_equal(rc, 0);
+	assert_non_null(set.rs_bits);
+	for (i = 0; i < 500; i++)
+		assert_int_equal(crt_rank_set_has(&set, i),
+				 crt_rank_in_rank_list(dense, i,
+						       true /* input */));
+	crt_rank_set_fini(&set);
+	rc = crt_rank_set_init(&set, sparse, true /* input */);
+	assert_int_equal(rc, 0);
+	assert_null(set.rs_bits);
+	for (i = 0; i < sparse->rl_nr.num; i++)
+		assert_true(crt_rank_set_has(&set, sparse->rl_ranks[i]));
+	assert_false(crt_rank_set_has(&set, 1 << 30));
+	crt_rank_set_fini(&set);
+
+	/* filter with sorted/unsorted, dense/sparse sets, both ways */
+	check_filter(dense, list, true /* exclude */);
+	check_filter(dense, list, false /* exclude */);
+	check_filter(sorted, list, true /* exclude */);
+	check_filter(list, sorted, false /* exclude */);
+	check_filter(sparse, list, true /* exclude */);
+	check_filter(list, dense, true /* exclude */);
+
+	crt_rank_list_free(list);
+	crt_rank_list_free(sorted);
+	crt_rank_list_free(dense);
+	crt_rank_list_free(sparse);
+}
+
+#ifdef UTEST_BENCH
+static void
+test_rank_set_bench(void **state)
+{
+	crt_rank_list_t	*membs, *excluded, *random_list, *result, *tmp;
+	struct timespec	 t1, t2;
+	uint32_t	 i, idx;
+	int		 rc;
+
+	(void)state;
+	srandom(2);
+
+	/* a group of every other rank of the primary group */
+	membs = crt_rank_list_alloc(BENCH_NR_RANKS);
+	assert_non_null(membs);
+	for (i = 0; i < BENCH_NR_RANKS; i++)
+		membs->rl_ranks[i] = 2 * i;
+	random_list = random_ranks(BENCH_NR_RANKS, 2 * BENCH_NR_RANKS);
+	excluded = random_ranks(BENCH_NR_EXCLUDED, 2 * BENCH_NR_RANKS);
+
+	crt_gettime(&t1);
+	rc = crt_rank_list_dup_sort_uniq(&result, random_list,
+					 true /* input */);
+	crt_gettime(&t2);
+	assert_int_equal(rc, 0);
+	printf("dup_sort_uniq %d ranks: %8.3f ms.\n", BENCH_NR_RANKS,
+	       crt_timediff_ns(&t1, &t2) / 1e6);
+	crt_rank_list_free(result);
+
+	/* the corpc/tree case: members without the excluded ranks */
+	rc = crt_rank_list_dup_sort_uniq(&tmp, excluded, true /* input */);
+	assert_int_equal(rc, 0);
+	rc = crt_rank_list_dup(&result, membs, true /* input */);
+	assert_int_equal(rc, 0);
+	crt_gettime(&t1);
+	crt_rank_list_filter(tmp, result, true /* input */,
+			     true /* exclude */);
+	crt_gettime(&t2);
+	printf("filter %d ranks out of %d: %8.3f ms, %d left.\n",
+	       tmp->rl_nr.num, BENCH_NR_RANKS,
+	       crt_timediff_ns(&t1, &t2) / 1e6, result->rl_nr.num);
+	crt_rank_list_free(result);
+
+	/* unsorted input, the set is sorted first */
+	rc = crt_rank_list_dup(&result, random_list, true /* input */);
+	assert_int_equal(rc, 0);
+	crt_gettime(&t1);
+	crt_rank_list_filter(excluded, result, true /* input */,
+			     true /* exclude */);
+	crt_gettime(&t2);
+	printf("filter %d unsorted ranks out of %d: %8.3f ms.\n",
+	       BENCH_NR_EXCLUDED, BENCH_NR_RANKS,
+	       crt_timediff_ns(&t1, &t2) / 1e6);
+	crt_rank_list_free(result);
+
+	/* the O(n * m) scan, with a tenth of the excluded ranks */
+	excluded->rl_nr.num = BENCH_NR_EXCLUDED / 10;
+	rc = crt_rank_list_dup(&result, membs, true /* input */);
+	assert_int_equal(rc, 0);
+	crt_gettime(&t1);
+	ref_filter(excluded, result, true /* exclude */);
+	crt_gettime(&t2);
+	printf("reference filter %d ranks out of %d: %8.3f ms.\n",
+	       excluded->rl_nr.num, BENCH_NR_RANKS,
+	       crt_timediff_ns(&t1, &t2) / 1e6);
+	excluded->rl_nr.num = BENCH_NR_EXCLUDED;
+	crt_rank_list_free(result);
+
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_RANKS; i++) {
+		rc = crt_idx_in_sorted_rank_list(membs, 2 * i, &idx,
+						 true /* input */);
+		assert_int_equal(rc, 0);
+	}
+	crt_gettime(&t2);
+	assert_int_equal(idx, BENCH_NR_RANKS - 1);
+	printf("idx_in_sorted_rank_list x %d: %8.3f ms.\n", BENCH_NR_RANKS,
+	       crt_timediff_ns(&t1, &t2) / 1e6);
+
+	crt_rank_list_free(tmp);
+	crt_rank_list_free(membs);
+	crt_rank_list_free(excluded);
+	crt_rank_list_free(random_list);
+}
+#endif /* UTEST_BENCH */
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest	tests[] = {
+		cmocka_unit_test(test_rank_set),
+#ifdef UTEST_BENCH
+		cmocka_unit_test(test_rank_set_bench),
+#endif
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
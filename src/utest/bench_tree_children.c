@@ -0,0 +1,213 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of CaRT. It checks the memoized corpc tree children
+ * (crt_tree_children_lookup) against crt_tree_get_children in a group of 10k
+ * ranks, plus the per-hop fan-out time with and without the cache when built
+ * with UTEST_BENCH.
+ */
+#include <stdio.h>
+#include "utest_cmocka.h"
+#include <crt_internal.h>
+
+#define BENCH_GRP_SIZE		(10000)
+#define BENCH_NR_HOPS		(10000)
+/* exclude one rank out of BENCH_EXCL_STRIDE */
+#define BENCH_EXCL_STRIDE	(100)
+
+static struct crt_grp_priv	bench_grp;
+static crt_rank_list_t		*bench_excluded;
+
+static int
+init_tests(void **state)
+{
+	uint32_t	i;
+
+	memset(&bench_grp, 0, sizeof(bench_grp));
+	bench_grp.gp_membs = crt_rank_list_alloc(BENCH_GRP_SIZE);
+	assert_non_null(bench_grp.gp_membs);
+	bench_grp.gp_size = BENCH_GRP_SIZE;
+	bench_grp.gp_pub.cg_grpid = (char *)"bench_grp";
+	crt_tree_cache_init(&bench_grp);
+
+	bench_excluded = crt_rank_list_alloc(BENCH_GRP_SIZE /
+					     BENCH_EXCL_STRIDE);
+	assert_non_null(bench_excluded);
+	for (i = 0; i < bench_excluded->rl_nr.num; i++)
+		bench_excluded->rl_ranks[i] = (i + 1) * BENCH_EXCL_STRIDE - 1;
+
+	return 0;
+}
+
+static int
+fini_tests(void **state)
+{
+	crt_tree_cache_fini(&bench_grp);
+	crt_rank_list_free(bench_grp.gp_membs);
+	crt_rank_list_free(bench_excluded);
+
+	return 0;
+}
+
+static void
+check_children(int tree_topo, crt_rank_list_t *excluded, crt_rank_t root,
+	       crt_rank_t self)
+{
+	struct crt_tree_children	*tc;
+	crt_rank_list_t			*expect = NULL;
+	int				 rc;
+
+	rc = crt_tree_get_children(&bench_grp, 0 /* grp_ver */, excluded,
+				   tree_topo, root, self, &expect);
+	assert_int_equal(rc, 0);
+	rc = crt_tree_children_lookup(&bench_grp, 0 /* grp_ver */, excluded,
+				      tree_topo, root, self, &tc);
+	assert_int_equal(rc, 0);
+	if (expect == NULL) {
+		assert_null(tc->tc_children);
+	} else {
+		assert_non_null(tc->tc_children);
+		assert_int_equal(tc->tc_children->rl_nr.num,
+				 expect->rl_nr.num);
+		assert_memory_equal(tc->tc_children->rl_ranks,
+				    expect->rl_ranks,
+				    expect->rl_nr.num * sizeof(crt_rank_t));
+	}
+	crt_tree_children_decref(&bench_grp, tc);
+	crt_rank_list_free(expect);
+}
+
+static void
+test_tree_children(void **state)
+{
+	struct crt_tree_children	*tc, *tc2;
+	int				 topo;
+	crt_rank_t			 self;
+	int				 rc;
+
+	topo = crt_tree_topo(CRT_TREE_KNOMIAL, 4);
+	/* hit and miss, with and without excluded ranks */
+	for (self = 0; self < 64; self++) {
+		check_children(topo, NULL, 0, self);
+		check_children(topo, bench_excluded, 0, self);
+		check_children(topo, bench_excluded, 0, self);
+		check_children(crt_tree_topo(CRT_TREE_KARY, 8), NULL, 5, self);
+	}
+	assert_int_equal(bench_grp.gp_tree_cache_num, CRT_TREE_CACHE_MAX);
+
+	/* an entry in use survives invalidation */
+	rc = crt_tree_children_lookup(&bench_grp, 0, NULL, topo, 0, 0, &tc);
+	assert_int_equal(rc, 0);
+	crt_tree_cache_invalidate(&bench_grp);
+	assert_int_equal(bench_grp.gp_tree_cache_num, 0);
+	assert_non_null(tc->tc_children);
+	rc = crt_tree_children_lookup(&bench_grp, 0, NULL, topo, 0, 0, &tc2);
+	assert_int_equal(rc, 0);
+	assert_true(tc != tc2);
+	crt_tree_children_decref(&bench_grp, tc);
+	crt_tree_children_decref(&bench_grp, tc2);
+
+	/* another group version is another shape */
+	rc = crt_tree_children_lookup(&bench_grp, 1, NULL, topo, 0, 0, &tc);
+	assert_int_equal(rc, 0);
+	assert_int_equal(bench_grp.gp_tree_cache_num, 2);
+	crt_tree_children_decref(&bench_grp, tc);
+	crt_tree_cache_invalidate(&bench_grp);
+}
+
+#ifdef UTEST_BENCH
+static void
+bench_hops(const char *name, int tree_topo, crt_rank_list_t *excluded)
+{
+	struct crt_tree_children	*tc;
+	crt_rank_list_t			*children;
+	struct timespec			 t1, t2;
+	double				 uncached, cached;
+	int				 i, rc;
+
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_HOPS; i++) {
+		rc = crt_tree_get_children(&bench_grp, 0, excluded, tree_topo,
+					   0 /* root */, 1 /* self */,
+					   &children);
+		assert_int_equal(rc, 0);
+		crt_rank_list_free(children);
+	}
+	crt_gettime(&t2);
+	uncached = crt_timediff_ns(&t1, &t2) / BENCH_NR_HOPS;
+
+	crt_gettime(&t1);
+	for (i = 0; i < BENCH_NR_HOPS; i++) {
+		rc = crt_tree_children_lookup(&bench_grp, 0, excluded,
+					      tree_topo, 0 /* root */,
+					      1 /* self */, &tc);
+		assert_int_equal(rc, 0);
+		crt_tree_children_decref(&bench_grp, tc);
+	}
+	crt_gettime(&t2);
+	cached = crt_timediff_ns(&t1, &t2) / BENCH_NR_HOPS;
+
+	printf("%-24s %d ranks, %3d excluded: %10.1f ns/hop uncached, "
+	       "%8.1f ns/hop cached.\n", name, BENCH_GRP_SIZE,
+	       excluded == NULL ? 0 : excluded->rl_nr.num, uncached, cached);
+	crt_tree_cache_invalidate(&bench_grp);
+}
+
+static void
+test_tree_children_bench(void **state)
+{
+	bench_hops("knomial:4", crt_tree_topo(CRT_TREE_KNOMIAL, 4), NULL);
+	bench_hops("knomial:4", crt_tree_topo(CRT_TREE_KNOMIAL, 4),
+		   bench_excluded);
+	bench_hops("kary:8", crt_tree_topo(CRT_TREE_KARY, 8), bench_excluded);
+	bench_hops("flat", crt_tree_topo(CRT_TREE_FLAT, 0), bench_excluded);
+}
+#endif /* UTEST_BENCH */
+
+int
+main(int argc, char **argv)
+{
+	const struct CMUnitTest	tests[] = {
+		cmocka_unit_test(test_tree_children),
+#ifdef UTEST_BENCH
+		cmocka_unit_test(test_tree_children_bench),
+#endif
+	};
+
+	return cmocka_run_group_tests(tests, init_tests, fini_tests);
+}
@@ -61,9 +61,9 @@ test_crt_api_linkage(void **state)
 	expect_pmix_get(PMIX_UINT32, 1); /* group size */
 	expect_pmix_get(PMIX_UINT32, 1); /* universe size */
 
-	/* Lookup group name */
-	expect_pmix_lookup(PMIX_STRING,
-		   cast_ptr_to_largest_integral_type("bogus_cli_group"));
+	/* Get group name of each rank */
+	expect_pmix_get(PMIX_STRING,
+		cast_ptr_to_largest_integral_type("bogus_cli_group"));
 	expect_pmix_lookup(PMIX_UINT32, 1); /* group size */
 	/* Lookup uri */
 	expect_pmix_lookup(PMIX_STRING,
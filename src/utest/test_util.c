@@ -46,6 +46,7 @@
 #include "crt_util/list.h"
 #include "crt_util/sysqueue.h"
 #include <crt_util/heap.h>
+#include <crt_util/wheel.h>
 
 static char *__cwd;
 static char *__root;
@@ -885,6 +886,74 @@ test_binheap(void **state)
 	crt_binheap_destroy(h);
 }
 
+static void
+test_twheel(void **state)
+{
+	struct crt_twheel	*tw;
+	struct crt_twheel_node	 n1, n2, n3, n4;
+	crt_list_t		 expired;
+	int			 rc;
+
+	(void)state;
+
+	C_ALLOC_PTR(tw);
+	assert_non_null(tw);
+	/* 1000 us per tick, starting at 5s */
+	rc = crt_twheel_init(tw, 1000, 5000000);
+	assert_int_equal(rc, 0);
+
+	CRT_INIT_LIST_HEAD(&expired);
+	crt_twheel_node_init(&n1);
+	crt_twheel_node_init(&n2);
+	crt_twheel_node_init(&n3);
+	crt_twheel_node_init(&n4);
+
+	/* level 0, level 1, level 2 and out of range */
+	crt_twheel_arm(tw, &n1, 5000000 + 100000);
+	crt_twheel_arm(tw, &n2, 5000000 + 60000000);
+	crt_twheel_arm(tw, &n3, 5000000 + 3600000000ULL);
+	crt_twheel_arm(tw, &n4, 5000000 + 24 * 3600000000ULL);
+	assert_true(crt_twheel_armed(&n1));
+
+	rc = crt_twheel_expire(tw, 5000000 + 99999, &expired);
+	assert_int_equal(rc, 0);
+	assert_true(crt_twheel_next(tw) == 5000000 + 100000);
+	rc = crt_twheel_expire(tw, 5000000 + 100000, &expired);
+	assert_int_equal(rc, 1);
+	assert_true(expired.next == &n1.tn_link);
+	crt_list_del_init(&n1.tn_link);
+
+	crt_twheel_cancel(tw, &n2);
+	assert_false(crt_twheel_armed(&n2));
+	rc = crt_twheel_expire(tw, 5000000 + 60000000, &expired);
+	assert_int_equal(rc, 0);
+
+	rc = crt_twheel_expire(tw, 5000000 + 3600000000ULL - 1000, &expired);
+	assert_int_equal(rc, 0);
+	rc = crt_twheel_expire(tw, 5000000 + 3600000000ULL, &expired);
+	assert_int_equal(rc, 1);
+	assert_true(expired.next == &n3.tn_link);
+	crt_list_del_init(&n3.tn_link);
+
+	rc = crt_twheel_expire(tw, 5000000 + 24 * 3600000000ULL - 1000,
+			       &expired);
+	assert_int_equal(rc, 0);
+	rc = crt_twheel_expire(tw, 5000000 + 24 * 3600000000ULL, &expired);
+	assert_int_equal(rc, 1);
+	crt_list_del_init(&n4.tn_link);
+
+	/* deadline in the past expires at the next tick */
+	crt_twheel_arm(tw, &n1, 0);
+	rc = crt_twheel_expire(tw, 5000000 + 24 * 3600000000ULL + 1000,
+			       &expired);
+	assert_int_equal(rc, 1);
+	crt_list_del_init(&n1.tn_link);
+	assert_true(crt_list_empty(&expired));
+	assert_true(crt_twheel_next(tw) == UINT64_MAX);
+
+	C_FREE_PTR(tw);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -901,6 +970,7 @@ main(int argc, char **argv)
 		cmocka_unit_test(test_crt_list),
 		cmocka_unit_test(test_crt_hlist),
 		cmocka_unit_test(test_binheap),
+		cmocka_unit_test(test_twheel),
 	};
 
 	return cmocka_run_group_tests(tests, init_tests, fini_tests);
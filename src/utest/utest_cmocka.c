@@ -21,10 +21,27 @@ __wrap_PMIx_Get(const pmix_proc_t *proc, const char key[],
 
 	if ((*val)->type == PMIX_UINT32)
 		(*val)->data.uint32 = mock_type(int);
+	else {
+		const char *str = mock_type(const char *);
+
+		(*val)->data.string = strdup(str);
+	}
 
 	return mock_type(int);
 }
 
+int
+__wrap_PMIx_Put(pmix_scope_t scope, const char key[], pmix_value_t *val)
+{
+	return PMIX_SUCCESS;
+}
+
+int
+__wrap_PMIx_Commit(void)
+{
+	return PMIX_SUCCESS;
+}
+
 int
 __wrap_PMIx_Publish(const pmix_info_t info[], size_t ninfo)
 {
@@ -52,6 +52,8 @@ extern "C" {
 int __wrap_PMIx_Init(pmix_proc_t *proc, pmix_info_t info[], size_t ninfo);
 int __wrap_PMIx_Get(const pmix_proc_t *proc, const char key[],
 		    const pmix_info_t info[], size_t ninfo, pmix_value_t **val);
+int __wrap_PMIx_Put(pmix_scope_t scope, const char key[], pmix_value_t *val);
+int __wrap_PMIx_Commit(void);
 int __wrap_PMIx_Publish(const pmix_info_t info[], size_t ninfo);
 int __wrap_PMIx_Lookup(pmix_pdata_t data[], size_t ndata,
 		       const pmix_info_t info[], size_t ninfo);
@@ -93,14 +93,28 @@ out:
 	return rc;
 }
 
+static inline int
+rank_compare(const void *rank1, const void *rank2)
+{
+	const crt_rank_t	*r1 = rank1;
+	const crt_rank_t	*r2 = rank2;
+
+	C_ASSERT(r1 != NULL && r2 != NULL);
+	if (*r1 < *r2)
+		return -1;
+	else if (*r1 == *r2)
+		return 0;
+	else /* *r1 > *r2 */
+		return 1;
+}
+
 int
 crt_rank_list_dup_sort_uniq(crt_rank_list_t **dst, const crt_rank_list_t *src,
 			    bool input)
 {
 	crt_rank_list_t		*rank_list;
-	crt_rank_t		 rank_tmp;
 	uint32_t		 rank_num, identical_num;
-	int			 i, j;
+	uint32_t		 i, j;
 	int			 rc = 0;
 
 	rc = crt_rank_list_dup(dst, src, input);
@@ -113,26 +127,18 @@ crt_rank_list_dup_sort_uniq(crt_rank_list_t **dst, const crt_rank_list_t *src,
 	if (rank_list == NULL || rank_list->rl_ranks == NULL)
 		C_GOTO(out, rc);
 
-	crt_rank_list_sort(rank_list);
-
-	/* uniq - remove same rank number in the list */
 	rank_num = (input == true) ? src->rl_nr.num : src->rl_nr.num_out;
 	if (rank_num <= 1)
 		C_GOTO(out, rc);
-	identical_num = 0;
-	rank_tmp = rank_list->rl_ranks[0];
-	for (i = 1; i < rank_num - identical_num; i++) {
-		if (rank_tmp == rank_list->rl_ranks[i]) {
-			identical_num++;
-			for (j = i; j < rank_num; j++)
-				rank_list->rl_ranks[j - 1] =
-					rank_list->rl_ranks[j];
-			crt_log(MISC_DBG, "%s:%d, rank_list %p, removed "
-				"identical rank[%d](%d).\n", __FILE__, __LINE__,
-				rank_list, i, rank_tmp);
-		}
-		rank_tmp = rank_list->rl_ranks[i];
+	qsort(rank_list->rl_ranks, rank_num, sizeof(crt_rank_t), rank_compare);
+
+	/* uniq - remove same rank number in the sorted list, in one pass */
+	for (i = 1, j = 0; i < rank_num; i++) {
+		if (rank_list->rl_ranks[i] == rank_list->rl_ranks[j])
+			continue;
+		rank_list->rl_ranks[++j] = rank_list->rl_ranks[i];
 	}
+	identical_num = rank_num - (j + 1);
 	if (identical_num != 0) {
 		if (input == true)
 			rank_list->rl_nr.num -= identical_num;
@@ -146,6 +152,140 @@ out:
 	return rc;
 }
 
+/* binary search of rank in the sorted array ranks[nr] */
+static inline bool
+crt_rank_bsearch(const crt_rank_t *ranks, uint32_t nr, crt_rank_t rank,
+		 uint32_t *idx)
+{
+	uint32_t	lo = 0, hi = nr, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (ranks[mid] < rank)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == nr || ranks[lo] != rank)
+		return false;
+	if (idx != NULL)
+		*idx = lo;
+	return true;
+}
+
+static inline bool
+crt_ranks_sorted_uniq(const crt_rank_t *ranks, uint32_t nr)
+{
+	uint32_t	i;
+
+	for (i = 1; i < nr; i++) {
+		if (ranks[i - 1] >= ranks[i])
+			return false;
+	}
+	return true;
+}
+
+static int
+crt_rank_set_build(struct crt_rank_set *set, const crt_rank_list_t *list,
+		   bool input, bool bitmap)
+{
+	crt_rank_list_t	*sorted = NULL;
+	crt_rank_t	 rank;
+	uint64_t	 span;
+	uint32_t	 nr, i;
+	int		 rc = 0;
+
+	if (set == NULL) {
+		C_ERROR("Invalid parameter, set: %p.\n", set);
+		C_GOTO(out, rc = -CER_INVAL);
+	}
+	memset(set, 0, sizeof(*set));
+
+	nr = (list == NULL || list->rl_ranks == NULL) ? 0 :
+	     ((input == true) ? list->rl_nr.num : list->rl_nr.num_out);
+	if (nr == 0)
+		C_GOTO(out, rc);
+
+	if (crt_ranks_sorted_uniq(list->rl_ranks, nr)) {
+		set->rs_ranks = list->rl_ranks;
+		set->rs_nr = nr;
+	} else {
+		rc = crt_rank_list_dup_sort_uniq(&sorted, list, input);
+		if (rc != 0)
+			C_GOTO(out, rc);
+		set->rs_ranks = sorted->rl_ranks;
+		set->rs_nr = (input == true) ? sorted->rl_nr.num :
+					       sorted->rl_nr.num_out;
+		set->rs_alloc_nr = nr;
+		/* keep the array only */
+		C_FREE_PTR(sorted);
+	}
+
+	span = (uint64_t)set->rs_ranks[set->rs_nr - 1] - set->rs_ranks[0] + 1;
+	if (!bitmap || set->rs_nr < CRT_RANK_SET_BITMAP_MIN ||
+	    span > (uint64_t)set->rs_nr * CRT_RANK_SET_DENSITY)
+		C_GOTO(out, rc);
+
+	C_ALLOC(set->rs_bits, ((span + 63) / 64) * sizeof(uint64_t));
+	if (set->rs_bits == NULL) {
+		/* the sorted array is good enough */
+		crt_log(MISC_DBG, "%s:%d, no memory for %"PRIu64" bits bitmap, "
+			"use binary search.\n", __FILE__, __LINE__, span);
+		C_GOTO(out, rc);
+	}
+	set->rs_base = set->rs_ranks[0];
+	set->rs_nbits = span;
+	for (i = 0; i < set->rs_nr; i++) {
+		rank = set->rs_ranks[i] - set->rs_base;
+		set->rs_bits[rank >> 6] |= 1ULL << (rank & 63);
+	}
+
+out:
+	return rc;
+}
+
+/*
+ * Init a rank set from the rank list. A rank list which is sorted and unique
+ * already (group members, corpc excluded ranks) is referenced rather than
+ * copied, so it must not change while the set is in use. The bitmap is only
+ * built when it is at most CRT_RANK_SET_DENSITY bits per rank.
+ */
+int
+crt_rank_set_init(struct crt_rank_set *set, const crt_rank_list_t *list,
+		  bool input)
+{
+	return crt_rank_set_build(set, list, input, true /* bitmap */);
+}
+
+void
+crt_rank_set_fini(struct crt_rank_set *set)
+{
+	if (set == NULL)
+		return;
+	if (set->rs_bits != NULL)
+		C_FREE(set->rs_bits,
+		       ((set->rs_nbits + 63) / 64) * sizeof(uint64_t));
+	if (set->rs_alloc_nr != 0)
+		C_FREE(set->rs_ranks, set->rs_alloc_nr * sizeof(crt_rank_t));
+	memset(set, 0, sizeof(*set));
+}
+
+/* check whether one rank belongs to the set, O(1) with bitmap or O(log n) */
+bool
+crt_rank_set_has(const struct crt_rank_set *set, crt_rank_t rank)
+{
+	uint32_t	off;
+
+	if (set->rs_bits != NULL) {
+		off = rank - set->rs_base;
+		if (rank < set->rs_base || off >= set->rs_nbits)
+			return false;
+		return (set->rs_bits[off >> 6] >> (off & 63)) & 1;
+	}
+
+	return crt_rank_bsearch(set->rs_ranks, set->rs_nr, rank, NULL);
+}
+
 /*
  * Filter the rank list:
  * 1) exclude == true, the result dst_set does not has any rank belong to src_
@@ -153,14 +293,20 @@ out:
  * 2) exclude == false, the result dst_set does not has any rank not belong to
  *    src_set, i.e. the ranks not belong to src_set will be filtered out
  *    from dst_set
+ *
+ * The order of dst_set is kept. It takes O(n + m log m) with n ranks in dst_set
+ * and m in src_set, or O(n + m) when src_set is sorted already.
  */
 void
 crt_rank_list_filter(crt_rank_list_t *src_set, crt_rank_list_t *dst_set,
 		     bool input, bool exclude)
 {
-	crt_rank_t	rank;
-	uint32_t	rank_num, filter_num;
-	int		i, j;
+	struct crt_rank_set	set;
+	crt_rank_t		rank;
+	uint32_t		rank_num, filter_num;
+	uint32_t		i, j;
+	bool			in;
+	int			rc;
 
 	if (src_set == NULL || dst_set == NULL)
 		return;
@@ -172,20 +318,28 @@ crt_rank_list_filter(crt_rank_list_t *src_set, crt_rank_list_t *dst_set,
 	if (rank_num == 0)
 		return;
 
-	filter_num = 0;
-	for (i = 0; i < rank_num - filter_num; i++) {
+	/* a bitmap only pays off when there are more lookups than ranks */
+	rc = crt_rank_set_build(&set, src_set, input,
+				rank_num >= ((input == true) ?
+					     src_set->rl_nr.num :
+					     src_set->rl_nr.num_out));
+	if (rc != 0)
+		crt_log(MISC_DBG, "%s:%d, crt_rank_set_build failed, rc: %d, "
+			"scan rank_list %p.\n", __FILE__, __LINE__, rc,
+			src_set);
+
+	/* compact the kept ranks in place, without moving the tail */
+	for (i = 0, j = 0; i < rank_num; i++) {
 		rank = dst_set->rl_ranks[i];
-		if (crt_rank_in_rank_list(src_set, rank, input) != exclude)
-			continue;
-		filter_num++;
-		for (j = i; j < rank_num - 1; j++)
-			dst_set->rl_ranks[j] =
-				dst_set->rl_ranks[j + 1];
-		crt_log(MISC_DBG, "%s:%d, rank_list %p, filter rank[%d](%d).\n",
-			__FILE__, __LINE__, dst_set, i, rank);
-		/* as dst_set moved one item ahead */
-		i--;
+		in = (rc == 0) ? crt_rank_set_has(&set, rank) :
+				 crt_rank_in_rank_list(src_set, rank, input);
+		dst_set->rl_ranks[j] = rank;
+		j += (in != exclude);
 	}
+	filter_num = rank_num - j;
+	if (rc == 0)
+		crt_rank_set_fini(&set);
+
 	if (filter_num != 0) {
 		if (input == true)
 			dst_set->rl_nr.num -= filter_num;
@@ -258,21 +412,6 @@ crt_rank_list_copy(crt_rank_list_t *dst, crt_rank_list_t *src, bool input)
 	}
 }
 
-static inline int
-rank_compare(const void *rank1, const void *rank2)
-{
-	const crt_rank_t	*r1 = rank1;
-	const crt_rank_t	*r2 = rank2;
-
-	C_ASSERT(r1 != NULL && r2 != NULL);
-	if (*r1 < *r2)
-		return -1;
-	else if (*r1 == *r2)
-		return 0;
-	else /* *r1 > *r2 */
-		return 1;
-}
-
 void
 crt_rank_list_sort(crt_rank_list_t *rank_list)
 {
@@ -385,6 +524,30 @@ crt_idx_in_rank_list(crt_rank_list_t *rank_list, crt_rank_t rank, uint32_t *idx,
 	return found == true ? 0 : -CER_OOG;
 }
 
+/*
+ * query the idx of rank within the sorted rank_list (such as the members of a
+ * group), O(log n).
+ *
+ * return -CER_OOG when rank not belong to rank list.
+ */
+int
+crt_idx_in_sorted_rank_list(crt_rank_list_t *rank_list, crt_rank_t rank,
+			    uint32_t *idx, bool input)
+{
+	uint32_t	rank_num;
+
+	if (rank_list == NULL || idx == NULL)
+		return -CER_INVAL;
+
+	rank_num = (input == true) ? rank_list->rl_nr.num :
+				     rank_list->rl_nr.num_out;
+	if (rank_list->rl_ranks == NULL)
+		rank_num = 0;
+
+	return crt_rank_bsearch(rank_list->rl_ranks, rank_num, rank, idx) ?
+	       0 : -CER_OOG;
+}
+
 /**
  * Initialise a scatter/gather list, create an array to store @nr iovecs.
  */
@@ -444,3 +607,18 @@ void crt_getenv_bool(const char *env, bool *bool_val)
 
 	*bool_val = (atoi(env_val) == 0 ? false : true);
 }
+
+void crt_getenv_int(const char *env, unsigned *int_val)
+{
+	char *env_val;
+
+	if (env == NULL)
+		return;
+	C_ASSERT(int_val != NULL);
+
+	env_val = getenv(env);
+	if (!env_val)
+		return;
+
+	*int_val = (unsigned)atoi(env_val);
+}
@@ -0,0 +1,199 @@
+/* Copyright (C) 2016 Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted for any purpose (including commercial purposes)
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the
+ *    documentation and/or materials provided with the distribution.
+ *
+ * 3. In addition, redistributions of modified forms of the source or binary
+ *    code must carry prominent notices stating that the original code was
+ *    changed and the date of the change.
+ *
+ *  4. All publications or advertising materials mentioning features or use of
+ *     this software are asked, but not required, to acknowledge that it was
+ *     developed by Intel Corporation and credit the contributors.
+ *
+ * 5. Neither the name of Intel Corporation, nor the name of any Contributor
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * This file is part of cart, it implements the crt timing wheel functions.
+ */
+
+#include <crt_util/common.h>
+#include <crt_util/wheel.h>
+
+int
+crt_twheel_init(struct crt_twheel *tw, uint64_t tick, uint64_t now)
+{
+	int	i, j;
+
+	if (tw == NULL || tick == 0)
+		return -CER_INVAL;
+
+	tw->tw_tick = tick;
+	tw->tw_now = now / tick;
+	tw->tw_count = 0;
+	for (i = 0; i < CRT_TWHEEL_LEVELS; i++)
+		for (j = 0; j < CRT_TWHEEL_SIZE; j++)
+			CRT_INIT_LIST_HEAD(&tw->tw_slots[i][j]);
+
+	return 0;
+}
+
+/* hash the node to the lowest level covering its deadline */
+static void
+twheel_add(struct crt_twheel *tw, struct crt_twheel_node *node)
+{
+	uint64_t	expire = node->tn_expire;
+	uint64_t	delta;
+	int		level;
+
+	if (expire < tw->tw_now)
+		expire = tw->tw_now;
+	delta = expire - tw->tw_now;
+
+	for (level = 0; level < CRT_TWHEEL_LEVELS - 1; level++) {
+		if (delta < (1ULL << (CRT_TWHEEL_BITS * (level + 1))))
+			break;
+	}
+	/* out of range, park it at the farthest slot of the highest level */
+	if (delta >= (1ULL << (CRT_TWHEEL_BITS * CRT_TWHEEL_LEVELS)))
+		expire = tw->tw_now +
+			 (1ULL << (CRT_TWHEEL_BITS * CRT_TWHEEL_LEVELS)) - 1;
+
+	crt_list_add_tail(&node->tn_link,
+			  &tw->tw_slots[level][(expire >>
+			  (CRT_TWHEEL_BITS * level)) & CRT_TWHEEL_MASK]);
+}
+
+void
+crt_twheel_arm(struct crt_twheel *tw, struct crt_twheel_node *node,
+	       uint64_t expire)
+{
+	C_ASSERT(tw != NULL && node != NULL);
+	C_ASSERT(!crt_twheel_armed(node));
+
+	/* round up, never expire earlier than requested */
+	node->tn_expire = expire / tw->tw_tick +
+			  (expire % tw->tw_tick != 0);
+	twheel_add(tw, node);
+	tw->tw_count++;
+}
+
+void
+crt_twheel_cancel(struct crt_twheel *tw, struct crt_twheel_node *node)
+{
+	C_ASSERT(tw != NULL && node != NULL);
+	C_ASSERT(crt_twheel_armed(node));
+	C_ASSERT(tw->tw_count > 0);
+
+	crt_list_del_init(&node->tn_link);
+	tw->tw_count--;
+}
+
+uint64_t
+crt_twheel_next(struct crt_twheel *tw)
+{
+	uint64_t	tick;
+
+	C_ASSERT(tw != NULL);
+
+	if (tw->tw_count == 0)
+		return UINT64_MAX;
+
+	/* cascading of the current tick is pending */
+	if ((tw->tw_now & CRT_TWHEEL_MASK) == 0)
+		return tw->tw_now * tw->tw_tick;
+
+	/* level 0 slots before the next cascading */
+	for (tick = tw->tw_now; ; tick++) {
+		if (!crt_list_empty(&tw->tw_slots[0][tick & CRT_TWHEEL_MASK]))
+			return tick * tw->tw_tick;
+		if (((tick + 1) & CRT_TWHEEL_MASK) == 0)
+			break;
+	}
+
+	return (tick + 1) * tw->tw_tick;
+}
+
+/* re-hash all nodes of a higher level slot to lower levels */
+static void
+twheel_cascade(struct crt_twheel *tw, int level, uint32_t idx)
+{
+	struct crt_twheel_node	*node, *next;
+	crt_list_t		 slot;
+
+	CRT_INIT_LIST_HEAD(&slot);
+	crt_list_splice_init(&tw->tw_slots[level][idx], &slot);
+	crt_list_for_each_entry_safe(node, next, &slot, tn_link) {
+		crt_list_del(&node->tn_link);
+		twheel_add(tw, node);
+	}
+}
+
+int
+crt_twheel_expire(struct crt_twheel *tw, uint64_t now, crt_list_t *expired)
+{
+	struct crt_twheel_node	*node, *next;
+	crt_list_t		*slot;
+	uint64_t		 now_tick;
+	uint32_t		 idx;
+	int			 level;
+	int			 count = 0;
+
+	C_ASSERT(tw != NULL && expired != NULL);
+
+	now_tick = now / tw->tw_tick;
+	while (tw->tw_now <= now_tick) {
+		/* nothing armed, jump to now directly */
+		if (tw->tw_count == 0) {
+			tw->tw_now = now_tick + 1;
+			break;
+		}
+
+		idx = tw->tw_now & CRT_TWHEEL_MASK;
+		/* entering a new round of level 0, cascade the higher ones */
+		for (level = 1; idx == 0 && level < CRT_TWHEEL_LEVELS;
+		     level++) {
+			idx = (tw->tw_now >> (CRT_TWHEEL_BITS * level)) &
+			      CRT_TWHEEL_MASK;
+			twheel_cascade(tw, level, idx);
+		}
+
+		slot = &tw->tw_slots[0][tw->tw_now & CRT_TWHEEL_MASK];
+		crt_list_for_each_entry_safe(node, next, slot, tn_link) {
+			crt_list_del(&node->tn_link);
+			if (node->tn_expire > tw->tw_now) {
+				/* parked out of range timer */
+				twheel_add(tw, node);
+				continue;
+			}
+			crt_list_add_tail(&node->tn_link, expired);
+			tw->tw_count--;
+			count++;
+		}
+		tw->tw_now++;
+	}
+
+	return count;
+}